@@ -1,13 +1,242 @@
 // Google Apps Script for handling ESP32 radar sensor data
 // This script receives ON/OFF status from ESP32 and logs it to Google Sheets with timestamp
+// Periodic occupancy summaries (type=summary) go to a separate "Summary" sheet
+// Heatmap exports (type=heatmap) replace the grid on the "Heatmap" sheet
+
+// Columns of the "Summary" sheet, in order; keys match the device's
+// occupancy summary fields
+const SUMMARY_FIELDS = [
+  "up",
+  "dur",
+  "frames",
+  "occ_s",
+  "entries",
+  "tmean",
+  "tmax",
+  "dmin",
+  "dmean",
+  "dmax",
+  "smin",
+  "smean",
+  "smax",
+  "r1_s",
+  "r2_s",
+  // Radar frames lost before the device aggregated them (its handoff ring
+  // was full); the row's statistics are missing those frames
+  "frames_lost",
+];
+
+// Append one occupancy summary row (one per device interval)
+function logSummary(params) {
+  const spreadsheet = SpreadsheetApp.getActiveSpreadsheet();
+  let sheet = spreadsheet.getSheetByName("Summary");
+  if (!sheet) {
+    sheet = spreadsheet.insertSheet("Summary");
+    sheet.appendRow(["Timestamp"].concat(SUMMARY_FIELDS));
+    sheet.getRange(1, 1, 1, SUMMARY_FIELDS.length + 1).setFontWeight("bold");
+  } else if (sheet.getLastColumn() < SUMMARY_FIELDS.length + 1) {
+    // Name columns added since the sheet was created
+    sheet
+      .getRange(1, 1, 1, SUMMARY_FIELDS.length + 1)
+      .setValues([["Timestamp"].concat(SUMMARY_FIELDS)])
+      .setFontWeight("bold");
+  }
+
+  const timestamp = new Date();
+  const row = [timestamp].concat(
+    SUMMARY_FIELDS.map((key) => Number(params[key] || 0))
+  );
+  sheet.appendRow(row);
+
+  return ContentService.createTextOutput(
+    JSON.stringify({ result: "success", message: "Summary logged" })
+  ).setMimeType(ContentService.MimeType.JSON);
+}
+
+// Expand the run-length encoded heatmap ("v" or "v*n", '.'-separated,
+// row-major from y0/x0) into rows of cell values
+function decodeHeatmap(cols, rows, encoded) {
+  const values = [];
+  encoded.split(".").forEach((token) => {
+    if (token === "") {
+      return;
+    }
+    const parts = token.split("*");
+    const value = Number(parts[0]);
+    const count = parts.length > 1 ? Number(parts[1]) : 1;
+    for (let i = 0; i < count; i++) {
+      values.push(value);
+    }
+  });
+  if (values.length !== cols * rows) {
+    throw new Error("Heatmap has " + values.length + " cells, expected " +
+                    cols * rows);
+  }
+
+  const grid = [];
+  for (let r = 0; r < rows; r++) {
+    grid.push(values.slice(r * cols, (r + 1) * cols));
+  }
+  return grid;
+}
+
+// Replace the "Heatmap" sheet with the latest export. Row 1 holds the
+// geometry; the grid starts at row 3 with the nearest row (y0) first.
+function logHeatmap(params) {
+  const cols = Number(params.cols);
+  const rows = Number(params.rows);
+  const grid = decodeHeatmap(cols, rows, params.cells || "");
+
+  const spreadsheet = SpreadsheetApp.getActiveSpreadsheet();
+  let sheet = spreadsheet.getSheetByName("Heatmap");
+  if (!sheet) {
+    sheet = spreadsheet.insertSheet("Heatmap");
+  }
+  sheet.clear();
+  sheet.getRange(1, 1, 1, 7).setValues([[
+    new Date(),
+    "cell_mm=" + params.cell,
+    "x0_mm=" + params.x0,
+    "y0_mm=" + params.y0,
+    "cols=" + cols,
+    "rows=" + rows,
+    "max=" + params.max,
+  ]]);
+  sheet.getRange(3, 1, rows, cols).setValues(grid);
+
+  return ContentService.createTextOutput(
+    JSON.stringify({ result: "success", message: "Heatmap logged" })
+  ).setMimeType(ContentService.MimeType.JSON);
+}
+
+// Inverse of the device's LZSS encoder (components/uplink/lzss.c): a flag
+// byte per eight items, bit 0 first; a set bit is a literal byte, a clear
+// bit a big-endian 16-bit (offset - 1) << 7 | (length - 3) back-reference
+function lzssDecode(bytes) {
+  const out = [];
+  let i = 0;
+  while (i < bytes.length) {
+    const flags = bytes[i++] & 0xff;
+    for (let bit = 0; bit < 8 && i < bytes.length; bit++) {
+      if (flags & (1 << bit)) {
+        out.push(bytes[i++] & 0xff);
+        continue;
+      }
+      if (i + 1 >= bytes.length) {
+        throw new Error("Truncated LZSS match");
+      }
+      const word = ((bytes[i] & 0xff) << 8) | (bytes[i + 1] & 0xff);
+      i += 2;
+      const offset = (word >> 7) + 1;
+      const length = (word & 0x7f) + 3;
+      if (offset > out.length) {
+        throw new Error("LZSS match before start of data");
+      }
+      for (let k = 0; k < length; k++) {
+        out.push(out[out.length - offset]);
+      }
+    }
+  }
+  return out;
+}
+
+// Compressed heatmap uploads carry their form fields LZSS-compressed and
+// base64url encoded (no padding) in "z"; return them as a plain parameter
+// object. Summaries and transitions are always sent plain.
+function expandParameters(params) {
+  if (params.enc !== "lzss") {
+    return params;
+  }
+  let z = params.z || "";
+  while (z.length % 4) {
+    z += "=";
+  }
+  const text = String.fromCharCode.apply(
+    null, lzssDecode(Utilities.base64DecodeWebSafe(z)));
+  const expanded = { type: params.type };
+  text.split("&").forEach((pair) => {
+    const eq = pair.indexOf("=");
+    if (eq > 0) {
+      expanded[decodeURIComponent(pair.slice(0, eq))] =
+        decodeURIComponent(pair.slice(eq + 1));
+    }
+  });
+  return expanded;
+}
+
+// How long a device's high-water mark is remembered: far beyond the
+// device's 60 s retry ceiling, and the longest CacheService allows
+const DEDUP_TTL_S = 21600;
+
+// Devices resend an upload that got no answer with the same dev, boot and
+// seq. Within one boot and stream (status or summary) seq only grows, so a
+// cached high-water mark per device and stream identifies repeats without
+// reading the sheet. Returns null for a repeat; otherwise a function that
+// gives the sequence back if the row could not be stored.
+function claimSequence(params, stream) {
+  if (!params.dev || !params.seq) {
+    return () => {};  // Firmware without upload identity
+  }
+  const cache = CacheService.getScriptCache();
+  const key = "hwm:" + params.dev + ":" + stream;
+  const claim = params.boot + ":" + params.seq;
+  const lock = LockService.getScriptLock();
+  lock.waitLock(10000);
+  try {
+    const previous = cache.get(key);
+    if (previous) {
+      const parts = previous.split(":");
+      if (parts[0] === params.boot &&
+          Number(params.seq) <= Number(parts[1])) {
+        return null;
+      }
+    }
+    cache.put(key, claim, DEDUP_TTL_S);
+    return () => {
+      lock.waitLock(10000);
+      try {
+        if (cache.get(key) === claim) {
+          if (previous) {
+            cache.put(key, previous, DEDUP_TTL_S);
+          } else {
+            cache.remove(key);
+          }
+        }
+      } finally {
+        lock.releaseLock();
+      }
+    };
+  } finally {
+    lock.releaseLock();
+  }
+}
 
 function doPost(e) {
+  let release = null;
   try {
+    if (e.parameter.type === "heatmap") {
+      return logHeatmap(expandParameters(e.parameter));
+    }
+
+    release = claimSequence(e.parameter,
+                            e.parameter.type === "summary" ? "summary"
+                                                           : "status");
+    if (!release) {
+      return ContentService.createTextOutput(
+        JSON.stringify({ result: "duplicate", seq: e.parameter.seq })
+      ).setMimeType(ContentService.MimeType.JSON);
+    }
+    if (e.parameter.type === "summary") {
+      return logSummary(e.parameter);
+    }
+
     // Get the active spreadsheet (make sure to create one and note the ID)
     const sheet = SpreadsheetApp.getActiveSheet();
 
-    // Get current timestamp
-    const timestamp = new Date();
+    // When the transition happened: the device queues transitions while
+    // the link is busy or down and sends how long each one waited
+    const ageMs = Math.max(0, Number(e.parameter.age_ms) || 0);
+    const timestamp = new Date(Date.now() - ageMs);
 
     // Get the status from POST parameters
     const status = e.parameter.status;
@@ -22,25 +251,19 @@ function doPost(e) {
       ).setMimeType(ContentService.MimeType.JSON);
     }
 
-    // Get the last row to append new data
-    const lastRow = sheet.getLastRow();
-    const newRow = lastRow + 1;
-
-    // Add data to the sheet
-    // Column A: Timestamp, Column B: Status
-    sheet.getRange(newRow, 1).setValue(timestamp);
-    sheet.getRange(newRow, 2).setValue(status);
-
-    // Optional: Add formatted timestamp in Column C for better readability
-    sheet
-      .getRange(newRow, 3)
-      .setValue(
-        Utilities.formatDate(
-          timestamp,
-          Session.getScriptTimeZone(),
-          "yyyy-MM-dd HH:mm:ss"
-        )
-      );
+    // One write per event: timestamp, status and a readable timestamp.
+    // appendRow is a single spreadsheet call and picks the row atomically,
+    // so concurrent executions from several devices cannot claim the same
+    // getLastRow() row and overwrite each other.
+    sheet.appendRow([
+      timestamp,
+      status,
+      Utilities.formatDate(
+        timestamp,
+        Session.getScriptTimeZone(),
+        "yyyy-MM-dd HH:mm:ss"
+      ),
+    ]);
 
     // Log the activity
     console.log(`Status logged: ${status} at ${timestamp}`);
@@ -56,6 +279,9 @@ function doPost(e) {
     ).setMimeType(ContentService.MimeType.JSON);
   } catch (error) {
     console.error("Error processing request:", error);
+    if (release) {
+      release();
+    }
 
     return ContentService.createTextOutput(
       JSON.stringify({
@@ -67,6 +293,17 @@ function doPost(e) {
 }
 
 function doGet(e) {
+  // Relay rules for devices polling with type=rules (config key rules_poll):
+  // the RULES script property as plain text, empty for the built-in policy.
+  // Set it under Project Settings > Script Properties.
+  if (e && e.parameter && e.parameter.type === "rules") {
+    const rules =
+      PropertiesService.getScriptProperties().getProperty("RULES") || "";
+    return ContentService.createTextOutput(rules).setMimeType(
+      ContentService.MimeType.TEXT
+    );
+  }
+
   // Optional: Handle GET requests for testing
   return ContentService.createTextOutput(
     JSON.stringify({
@@ -82,12 +319,10 @@ function initializeSheet() {
   const sheet = SpreadsheetApp.getActiveSheet();
 
   // Set headers
-  sheet.getRange(1, 1).setValue("Timestamp");
-  sheet.getRange(1, 2).setValue("Status");
-  sheet.getRange(1, 3).setValue("Formatted Time");
+  const headerRange = sheet.getRange(1, 1, 1, 3);
+  headerRange.setValues([["Timestamp", "Status", "Formatted Time"]]);
 
   // Format header row
-  const headerRange = sheet.getRange(1, 1, 1, 3);
   headerRange.setFontWeight("bold");
   headerRange.setBackground("#4285f4");
   headerRange.setFontColor("white");
@@ -0,0 +1,495 @@
+#include "app_config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/gpio.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "rules.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "APP_CONFIG";
+
+#define NVS_NAMESPACE "app_config"
+#define NVS_KEY_VERSION "version"
+#define NVS_KEY_SCHEMA "schema"
+
+/*
+ * Snapshots live in a small set of static slots. An update fills a free slot
+ * and publishes it with a single pointer store, so readers never lock. Each
+ * slot counts the readers holding it, and the writer only refills a slot
+ * that is neither current nor held. One slot per long-lived reader task
+ * plus the current and the next one means the writer normally never waits;
+ * if it does, it waits with the write lock released.
+ */
+#define SNAPSHOT_SLOTS 8
+#define SLOT_WAIT_MS 10
+#define SLOT_WAIT_MAX_MS 2000
+
+typedef enum {
+  ENTRY_STR,
+  ENTRY_U32,
+  ENTRY_GPIO,
+  ENTRY_RULES,  // String that must compile with rules_compile()
+} entry_type_t;
+
+typedef struct {
+  const char* key;  // Also the NVS key, at most 15 characters
+  entry_type_t type;
+  size_t offset;
+  size_t size;  // Buffer size for strings
+  uint32_t min;
+  uint32_t max;
+  bool secret;  // Masked when listed
+} config_entry_t;
+
+#define STR_ENTRY(key, field, secret)                                     \
+  {key, ENTRY_STR, offsetof(app_config_t, field),                        \
+   sizeof(((app_config_t*)0)->field), 0, 0, secret}
+#define U32_ENTRY(key, field, min, max) \
+  {key, ENTRY_U32, offsetof(app_config_t, field), 4, min, max, false}
+#define GPIO_ENTRY(key, field) \
+  {key, ENTRY_GPIO, offsetof(app_config_t, field), 4, 0, 0, false}
+#define RULES_ENTRY(key, field)                                           \
+  {key, ENTRY_RULES, offsetof(app_config_t, field),                      \
+   sizeof(((app_config_t*)0)->field), 0, 0, false}
+
+static const config_entry_t s_entries[] = {
+    STR_ENTRY("wifi_ssid", wifi_ssid, false),
+    STR_ENTRY("wifi_pass", wifi_password, true),
+    STR_ENTRY("script_url", apps_script_url, false),
+    GPIO_ENTRY("relay1_gpio", relay_ch1_gpio),
+    GPIO_ENTRY("relay2_gpio", relay_ch2_gpio),
+    U32_ENTRY("radar_baud", radar_baud, 9600, 921600),
+    U32_ENTRY("radar_track", radar_tracking, 0, 1),
+    U32_ENTRY("sensor_period", sensor_period_ms, 10, 10000),
+    U32_ENTRY("sensor_sched", sensor_sched_mode, 0, 2),
+    U32_ENTRY("wifi_retry_ms", wifi_reconnect_ms, 1000, 600000),
+    U32_ENTRY("http_timeout", http_timeout_ms, 1000, 60000),
+    U32_ENTRY("http_verify", http_verify, 0, 1),
+    U32_ENTRY("agg_interval", agg_interval_s, 0, 86400),
+    U32_ENTRY("raw_uploads", raw_uploads, 0, 1),
+    U32_ENTRY("heatmap_upload", heatmap_upload_s, 0, 604800),
+    U32_ENTRY("compress", upload_compress, 0, 1),
+    U32_ENTRY("clutter_learn", clutter_learn_s, 0, 86400),
+    U32_ENTRY("clutter_forget", clutter_forget_s, 0, 604800),
+    U32_ENTRY("clutter_motion", clutter_motion, 1, 500),
+    U32_ENTRY("presence_range", presence_range_mm, 0, 20000),
+    U32_ENTRY("idle_after", idle_after_s, 0, 3600),
+    U32_ENTRY("idle_period", idle_period_ms, 100, 2000),
+    U32_ENTRY("rules_poll", rules_poll_s, 0, 86400),
+    U32_ENTRY("bcast_interval", bcast_interval_ms, 0, 60000),
+    U32_ENTRY("bcast_target", bcast_target_ms, 0, 10000),
+    RULES_ENTRY("rules", rules),
+};
+
+#define ENTRY_COUNT (sizeof(s_entries) / sizeof(s_entries[0]))
+
+static const app_config_t s_defaults = {
+    .version = 0,
+    .wifi_ssid = CONFIG_APP_CONFIG_WIFI_SSID,
+    .wifi_password = CONFIG_APP_CONFIG_WIFI_PASSWORD,
+    .apps_script_url = CONFIG_APP_CONFIG_APPS_SCRIPT_URL,
+    .relay_ch1_gpio = CONFIG_APP_CONFIG_RELAY_CH1_GPIO,
+    .relay_ch2_gpio = CONFIG_APP_CONFIG_RELAY_CH2_GPIO,
+    .radar_baud = CONFIG_APP_CONFIG_RADAR_BAUD,
+    .radar_tracking = CONFIG_APP_CONFIG_RADAR_TRACKING,
+    .sensor_period_ms = CONFIG_APP_CONFIG_SENSOR_PERIOD_MS,
+    .sensor_sched_mode = CONFIG_APP_CONFIG_SENSOR_SCHED_MODE,
+    .wifi_reconnect_ms = CONFIG_APP_CONFIG_WIFI_RECONNECT_MS,
+    .http_timeout_ms = CONFIG_APP_CONFIG_HTTP_TIMEOUT_MS,
+    .http_verify = CONFIG_APP_CONFIG_HTTP_VERIFY,
+    .agg_interval_s = CONFIG_APP_CONFIG_AGG_INTERVAL_S,
+    .raw_uploads = CONFIG_APP_CONFIG_RAW_UPLOADS,
+    .heatmap_upload_s = CONFIG_APP_CONFIG_HEATMAP_UPLOAD_S,
+    .upload_compress = CONFIG_APP_CONFIG_UPLOAD_COMPRESS,
+    .clutter_learn_s = CONFIG_APP_CONFIG_CLUTTER_LEARN_S,
+    .clutter_forget_s = CONFIG_APP_CONFIG_CLUTTER_FORGET_S,
+    .clutter_motion = CONFIG_APP_CONFIG_CLUTTER_MOTION_CM_S,
+    .presence_range_mm = CONFIG_APP_CONFIG_PRESENCE_RANGE_MM,
+    .idle_after_s = CONFIG_APP_CONFIG_IDLE_AFTER_S,
+    .idle_period_ms = CONFIG_APP_CONFIG_IDLE_PERIOD_MS,
+    .rules_poll_s = CONFIG_APP_CONFIG_RULES_POLL_S,
+    .bcast_interval_ms = CONFIG_APP_CONFIG_BCAST_INTERVAL_MS,
+    .bcast_target_ms = CONFIG_APP_CONFIG_BCAST_TARGET_MS,
+    .rules = CONFIG_APP_CONFIG_RULES,
+};
+
+static app_config_t s_slots[SNAPSHOT_SLOTS];
+static uint32_t s_slot_refs[SNAPSHOT_SLOTS];  // Readers holding each slot
+static uint32_t s_next_slot;
+static const app_config_t* s_current = &s_defaults;
+
+static SemaphoreHandle_t s_write_lock;
+static StaticSemaphore_t s_write_lock_buf;
+
+static const config_entry_t* find_entry(const char* key) {
+  for (size_t i = 0; i < ENTRY_COUNT; i++) {
+    if (strcmp(s_entries[i].key, key) == 0) {
+      return &s_entries[i];
+    }
+  }
+  return NULL;
+}
+
+static bool is_slot(const app_config_t* cfg) {
+  return cfg >= s_slots && cfg < s_slots + SNAPSHOT_SLOTS;
+}
+
+// Takes s_write_lock and returns a slot no reader can see. The reference
+// counts are read sequentially consistent, pairing with app_config_get():
+// a reader that increments after the check below re-reads s_current, finds
+// another slot and backs off. Returns NULL without the lock on timeout.
+static app_config_t* lock_free_slot(void) {
+  for (uint32_t waited_ms = 0;; waited_ms += SLOT_WAIT_MS) {
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    for (uint32_t n = 0; n < SNAPSHOT_SLOTS; n++) {
+      uint32_t index = (s_next_slot + n) % SNAPSHOT_SLOTS;
+      if (&s_slots[index] != s_current &&
+          __atomic_load_n(&s_slot_refs[index], __ATOMIC_SEQ_CST) == 0) {
+        s_next_slot = index;
+        return &s_slots[index];
+      }
+    }
+    xSemaphoreGive(s_write_lock);
+    if (waited_ms >= SLOT_WAIT_MAX_MS) {
+      return NULL;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SLOT_WAIT_MS));
+  }
+}
+
+// Caller holds s_write_lock and filled the slot returned by lock_free_slot()
+static void publish_slot(void) {
+  __atomic_store_n(&s_current, &s_slots[s_next_slot], __ATOMIC_SEQ_CST);
+  s_next_slot = (s_next_slot + 1) % SNAPSHOT_SLOTS;
+}
+
+static esp_err_t parse_value(const config_entry_t* entry, const char* text,
+                             app_config_t* cfg) {
+  void* field = (uint8_t*)cfg + entry->offset;
+
+  if (entry->type == ENTRY_STR || entry->type == ENTRY_RULES) {
+    if (strlen(text) >= entry->size) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    if (entry->type == ENTRY_RULES) {
+      // Caller holds s_write_lock, which also guards the scratch program
+      static rules_program_t check;
+      rules_error_t error;
+      if (!rules_compile(&check, text, &error)) {
+        ESP_LOGW(TAG, "Rules rejected at offset %u: %s",
+                 (unsigned)error.offset, error.message);
+        return ESP_ERR_INVALID_ARG;
+      }
+    }
+    memset(field, 0, entry->size);
+    memcpy(field, text, strlen(text));
+    return ESP_OK;
+  }
+
+  char* end = NULL;
+  unsigned long value = strtoul(text, &end, 0);
+  if (!*text || *end) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (entry->type == ENTRY_GPIO) {
+    if (!GPIO_IS_VALID_OUTPUT_GPIO((gpio_num_t)value)) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    *(int32_t*)field = (int32_t)value;
+  } else {
+    if (value < entry->min || value > entry->max) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    *(uint32_t*)field = (uint32_t)value;
+  }
+  return ESP_OK;
+}
+
+static void format_value(const config_entry_t* entry, const app_config_t* cfg,
+                         char* out, size_t size) {
+  const void* field = (const uint8_t*)cfg + entry->offset;
+
+  switch (entry->type) {
+    case ENTRY_STR:
+    case ENTRY_RULES:
+      snprintf(out, size, "%s", entry->secret ? "********" : (const char*)field);
+      break;
+    case ENTRY_GPIO:
+      snprintf(out, size, "%ld", (long)*(const int32_t*)field);
+      break;
+    case ENTRY_U32:
+      snprintf(out, size, "%lu", (unsigned long)*(const uint32_t*)field);
+      break;
+  }
+}
+
+static esp_err_t store_entry(nvs_handle_t nvs, const config_entry_t* entry,
+                             const app_config_t* cfg) {
+  const void* field = (const uint8_t*)cfg + entry->offset;
+
+  switch (entry->type) {
+    case ENTRY_STR:
+    case ENTRY_RULES:
+      return nvs_set_str(nvs, entry->key, (const char*)field);
+    case ENTRY_GPIO:
+      return nvs_set_i32(nvs, entry->key, *(const int32_t*)field);
+    case ENTRY_U32:
+      return nvs_set_u32(nvs, entry->key, *(const uint32_t*)field);
+  }
+  return ESP_ERR_INVALID_ARG;
+}
+
+static void load_entry(nvs_handle_t nvs, const config_entry_t* entry,
+                       app_config_t* cfg) {
+  void* field = (uint8_t*)cfg + entry->offset;
+  esp_err_t ret;
+
+  switch (entry->type) {
+    case ENTRY_STR:
+    case ENTRY_RULES: {
+      size_t len = entry->size;
+      ret = nvs_get_str(nvs, entry->key, (char*)field, &len);
+      break;
+    }
+    case ENTRY_GPIO:
+      ret = nvs_get_i32(nvs, entry->key, (int32_t*)field);
+      break;
+    case ENTRY_U32:
+      ret = nvs_get_u32(nvs, entry->key, (uint32_t*)field);
+      break;
+    default:
+      ret = ESP_ERR_INVALID_ARG;
+      break;
+  }
+
+  if (ret == ESP_OK) {
+    ESP_LOGI(TAG, "Loaded '%s' from NVS", entry->key);
+  } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGW(TAG, "Failed to read '%s' (%s), using default", entry->key,
+             esp_err_to_name(ret));
+  }
+}
+
+esp_err_t app_config_init(void) {
+  esp_err_t ret = nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+      ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret = nvs_flash_init();
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  s_write_lock = xSemaphoreCreateMutexStatic(&s_write_lock_buf);
+
+  app_config_t* boot = &s_slots[0];
+  memcpy(boot, &s_defaults, sizeof(*boot));
+
+  nvs_handle_t nvs;
+  ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (ret == ESP_OK) {
+    uint8_t schema = 0;
+    nvs_get_u8(nvs, NVS_KEY_SCHEMA, &schema);
+    if (schema == APP_CONFIG_SCHEMA_VERSION) {
+      nvs_get_u32(nvs, NVS_KEY_VERSION, &boot->version);
+      for (size_t i = 0; i < ENTRY_COUNT; i++) {
+        load_entry(nvs, &s_entries[i], boot);
+      }
+    } else {
+      ESP_LOGW(TAG, "Stored schema %u != %u, using defaults", schema,
+               APP_CONFIG_SCHEMA_VERSION);
+    }
+    nvs_close(nvs);
+  } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGW(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+  }
+
+  __atomic_store_n(&s_current, boot, __ATOMIC_RELEASE);
+  s_next_slot = 1;
+
+  ESP_LOGI(TAG, "Configuration version %lu loaded",
+           (unsigned long)boot->version);
+  return ESP_OK;
+}
+
+const app_config_t* app_config_get(void) {
+  while (1) {
+    const app_config_t* cfg = __atomic_load_n(&s_current, __ATOMIC_SEQ_CST);
+    if (!is_slot(cfg)) {
+      return cfg;  // Compiled-in defaults, never rewritten
+    }
+    uint32_t index = cfg - s_slots;
+    __atomic_fetch_add(&s_slot_refs[index], 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s_current, __ATOMIC_SEQ_CST) == cfg) {
+      return cfg;
+    }
+    // Replaced meanwhile, so the writer may already be refilling it
+    __atomic_fetch_sub(&s_slot_refs[index], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+void app_config_release(const app_config_t* cfg) {
+  if (is_slot(cfg)) {
+    __atomic_fetch_sub(&s_slot_refs[cfg - s_slots], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+const app_config_t* app_config_refresh(const app_config_t* cfg) {
+  const app_config_t* next = app_config_get();
+  app_config_release(cfg);
+  return next;
+}
+
+esp_err_t app_config_set(const char* key, const char* value) {
+  if (!key || !value || !s_write_lock) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const config_entry_t* entry = find_entry(key);
+  if (!entry) {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  app_config_t* next = lock_free_slot();
+  if (!next) {
+    ESP_LOGE(TAG, "No free snapshot slot for '%s'", key);
+    return ESP_ERR_TIMEOUT;
+  }
+  memcpy(next, s_current, sizeof(*next));
+
+  esp_err_t ret = parse_value(entry, value, next);
+  if (ret != ESP_OK) {
+    xSemaphoreGive(s_write_lock);
+    return ret;
+  }
+  next->version++;
+
+  nvs_handle_t nvs;
+  ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (ret == ESP_OK) {
+    ret = store_entry(nvs, entry, next);
+    if (ret == ESP_OK) {
+      ret = nvs_set_u32(nvs, NVS_KEY_VERSION, next->version);
+    }
+    if (ret == ESP_OK) {
+      ret = nvs_set_u8(nvs, NVS_KEY_SCHEMA, APP_CONFIG_SCHEMA_VERSION);
+    }
+    if (ret == ESP_OK) {
+      ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+
+  if (ret == ESP_OK) {
+    publish_slot();
+    ESP_LOGI(TAG, "'%s' updated, configuration version %lu", key,
+             (unsigned long)next->version);
+  } else {
+    ESP_LOGE(TAG, "Failed to persist '%s': %s", key, esp_err_to_name(ret));
+  }
+
+  xSemaphoreGive(s_write_lock);
+  return ret;
+}
+
+esp_err_t app_config_reset(void) {
+  if (!s_write_lock) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  app_config_t* next = lock_free_slot();
+  if (!next) {
+    ESP_LOGE(TAG, "No free snapshot slot for the reset");
+    return ESP_ERR_TIMEOUT;
+  }
+
+  nvs_handle_t nvs;
+  esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (ret == ESP_OK) {
+    ret = nvs_erase_all(nvs);
+    if (ret == ESP_OK) {
+      ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+
+  if (ret == ESP_OK) {
+    uint32_t version = s_current->version + 1;
+    memcpy(next, &s_defaults, sizeof(*next));
+    next->version = version;
+    publish_slot();
+    ESP_LOGI(TAG, "Configuration reset to defaults (version %lu)",
+             (unsigned long)version);
+  }
+
+  xSemaphoreGive(s_write_lock);
+  return ret;
+}
+
+static int cmd_config(int argc, char** argv) {
+  static char value[APP_CONFIG_RULES_MAX];  // Console task only
+
+  if (argc < 2 || strcmp(argv[1], "list") == 0) {
+    const app_config_t* cfg = app_config_get();
+    printf("version %lu (schema %d)\n", (unsigned long)cfg->version,
+           APP_CONFIG_SCHEMA_VERSION);
+    for (size_t i = 0; i < ENTRY_COUNT; i++) {
+      format_value(&s_entries[i], cfg, value, sizeof(value));
+      printf("  %-14s %s\n", s_entries[i].key, value);
+    }
+    app_config_release(cfg);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "get") == 0 && argc == 3) {
+    const config_entry_t* entry = find_entry(argv[2]);
+    if (!entry) {
+      printf("unknown key '%s'\n", argv[2]);
+      return 1;
+    }
+    const app_config_t* cfg = app_config_get();
+    format_value(entry, cfg, value, sizeof(value));
+    app_config_release(cfg);
+    printf("%s\n", value);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "set") == 0 && argc == 4) {
+    esp_err_t ret = app_config_set(argv[2], argv[3]);
+    if (ret != ESP_OK) {
+      printf("set failed: %s\n", esp_err_to_name(ret));
+      return 1;
+    }
+    return 0;
+  }
+
+  if (strcmp(argv[1], "reset") == 0) {
+    return app_config_reset() == ESP_OK ? 0 : 1;
+  }
+
+  printf("usage: config [list|get <key>|set <key> <value>|reset]\n");
+  return 1;
+}
+
+void app_config_register_console_cmd(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "config",
+      .help = "List, get or set runtime configuration; changes are stored in "
+              "NVS and applied without a restart",
+      .hint = "[list|get <key>|set <key> <value>|reset]",
+      .func = &cmd_config,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
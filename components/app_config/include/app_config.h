@@ -0,0 +1,125 @@
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bumped whenever the meaning of a stored key changes */
+#define APP_CONFIG_SCHEMA_VERSION 1
+
+#define APP_CONFIG_SSID_MAX 33
+#define APP_CONFIG_PASSWORD_MAX 65
+#define APP_CONFIG_URL_MAX 256
+#define APP_CONFIG_RULES_MAX 512
+
+/** Sensor loop scheduling modes */
+#define APP_CONFIG_SCHED_FIXED_DELAY 0
+#define APP_CONFIG_SCHED_PERIODIC 1
+#define APP_CONFIG_SCHED_FRAME_DRIVEN 2
+
+/** Radar tracking modes */
+#define APP_CONFIG_RADAR_MULTI_TARGET 0
+#define APP_CONFIG_RADAR_SINGLE_TARGET 1
+
+/**
+ * @brief Immutable configuration snapshot
+ *
+ * Snapshots are never modified after publication. A snapshot from
+ * app_config_get() stays valid until app_config_release(); loop tasks swap
+ * theirs once per iteration with app_config_refresh().
+ */
+typedef struct {
+  uint32_t version;  ///< Incremented on every applied update
+  char wifi_ssid[APP_CONFIG_SSID_MAX];
+  char wifi_password[APP_CONFIG_PASSWORD_MAX];
+  char apps_script_url[APP_CONFIG_URL_MAX];
+  int32_t relay_ch1_gpio;
+  int32_t relay_ch2_gpio;
+  uint32_t radar_baud;
+  uint32_t radar_tracking;  ///< APP_CONFIG_RADAR_* value
+  uint32_t sensor_period_ms;
+  uint32_t sensor_sched_mode;  ///< APP_CONFIG_SCHED_* value
+  uint32_t wifi_reconnect_ms;
+  uint32_t http_timeout_ms;
+  uint32_t http_verify;        ///< 1 to follow the redirect after each upload
+  uint32_t agg_interval_s;     ///< Occupancy summary interval, 0 disables
+  uint32_t raw_uploads;        ///< 1 to upload every relay transition too
+  uint32_t heatmap_upload_s;   ///< Heatmap export interval, 0 disables
+  uint32_t upload_compress;    ///< 1 to LZSS-compress batch uploads
+  uint32_t clutter_learn_s;    ///< Still time before a cell is clutter, 0 off
+  uint32_t clutter_forget_s;   ///< Absence that clears a clutter cell
+  uint32_t clutter_motion;     ///< Speed (cm/s) that counts as real motion
+  uint32_t presence_range_mm;  ///< Presence radius around the room origin
+  uint32_t idle_after_s;       ///< Empty time before frames are decimated
+  uint32_t idle_period_ms;     ///< Frame spacing processed while idle
+  uint32_t rules_poll_s;       ///< Rule download interval, 0 disables
+  uint32_t bcast_interval_ms;  ///< LAN state heartbeat, 0 disables
+  uint32_t bcast_target_ms;    ///< Target packet spacing, 0 for none
+  /** Relay rules (see rules.h), empty for the built-in presence policy */
+  char rules[APP_CONFIG_RULES_MAX];
+} app_config_t;
+
+/**
+ * @brief Initialize NVS and load the boot snapshot (defaults for missing keys)
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t app_config_init(void);
+
+/**
+ * @brief Hold the current snapshot without taking any lock
+ *
+ * The slot is not reused until the snapshot is released, however long the
+ * caller blocks in between. Every call needs an app_config_release().
+ *
+ * @return Pointer to the current snapshot (never NULL after init)
+ */
+const app_config_t* app_config_get(void);
+
+/**
+ * @brief Release a snapshot from app_config_get()
+ *
+ * @param cfg Snapshot, not used afterwards
+ */
+void app_config_release(const app_config_t* cfg);
+
+/**
+ * @brief Hold the current snapshot and release the given one
+ *
+ * @param cfg Snapshot from app_config_get() or app_config_refresh()
+ * @return Current snapshot, to be released the same way
+ */
+const app_config_t* app_config_refresh(const app_config_t* cfg);
+
+/**
+ * @brief Parse, validate, persist and publish a new value for one key
+ *
+ * @param key Registry key (see "config list")
+ * @param value Value as text
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND for an unknown key,
+ *         ESP_ERR_INVALID_ARG for an out-of-range value or rules that do
+ *         not compile, ESP_ERR_TIMEOUT when readers hold every slot
+ */
+esp_err_t app_config_set(const char* key, const char* value);
+
+/**
+ * @brief Erase all stored values and publish the compiled-in defaults
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t app_config_reset(void);
+
+/**
+ * @brief Register the "config" console command
+ */
+void app_config_register_console_cmd(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APP_CONFIG_H
@@ -0,0 +1,234 @@
+#include "dlog.h"
+
+#if CONFIG_DLOG_ENABLE
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define RING_SIZE CONFIG_DLOG_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+#define LINE_MAX 192
+
+_Static_assert((RING_SIZE & RING_MASK) == 0,
+               "CONFIG_DLOG_RING_SIZE must be a power of two");
+
+typedef struct {
+  const dlog_site_t* site;
+  const char* tag;
+  uint32_t timestamp_ms;
+  uint16_t nargs;
+  uint16_t suppressed;
+  dlog_arg_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+typedef struct {
+  dlog_record_t records[RING_SIZE];
+  uint32_t head;  // Next slot to write
+  uint32_t tail;  // Next slot to format
+  portMUX_TYPE lock;
+} dlog_ring_t;
+
+static dlog_ring_t s_rings[portNUM_PROCESSORS];
+static dlog_stats_t s_stats;
+
+void dlog_write(dlog_site_t* site, const char* tag, const dlog_arg_t* args,
+                uint32_t nargs) {
+  int64_t now_us = esp_timer_get_time();
+
+  if (site->min_interval_ms &&
+      site->last_emit_us != 0 &&
+      now_us - site->last_emit_us < (int64_t)site->min_interval_ms * 1000) {
+    site->suppressed++;
+    __atomic_fetch_add(&s_stats.suppressed, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  uint32_t folded = site->suppressed;
+  site->suppressed = 0;
+  site->last_emit_us = now_us;
+
+  if (nargs > DLOG_MAX_ARGS) {
+    nargs = DLOG_MAX_ARGS;
+  }
+
+  dlog_ring_t* ring = &s_rings[xPortGetCoreID()];
+  portENTER_CRITICAL(&ring->lock);
+  if (ring->head - ring->tail >= RING_SIZE) {
+    portEXIT_CRITICAL(&ring->lock);
+    __atomic_fetch_add(&s_stats.dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  dlog_record_t* rec = &ring->records[ring->head & RING_MASK];
+  rec->site = site;
+  rec->tag = tag;
+  rec->timestamp_ms = (uint32_t)(now_us / 1000);
+  rec->nargs = (uint16_t)nargs;
+  rec->suppressed = folded > UINT16_MAX ? UINT16_MAX : (uint16_t)folded;
+  memcpy(rec->args, args, nargs * sizeof(dlog_arg_t));
+  ring->head++;
+  portEXIT_CRITICAL(&ring->lock);
+
+  __atomic_fetch_add(&s_stats.written, 1, __ATOMIC_RELAXED);
+}
+
+void dlog_get_stats(dlog_stats_t* out) {
+  if (out) {
+    *out = s_stats;
+  }
+}
+
+static char level_letter(esp_log_level_t level) {
+  switch (level) {
+    case ESP_LOG_ERROR:
+      return 'E';
+    case ESP_LOG_WARN:
+      return 'W';
+    case ESP_LOG_INFO:
+      return 'I';
+    case ESP_LOG_DEBUG:
+      return 'D';
+    default:
+      return 'V';
+  }
+}
+
+// printf-style formatting driven by recorded 32-bit arguments
+static void format_record(const dlog_record_t* rec, char* out, size_t size) {
+  const char* p = rec->site->fmt;
+  size_t len = 0;
+  uint32_t arg = 0;
+
+  while (*p && len + 1 < size) {
+    if (*p != '%') {
+      out[len++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[len++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // Copy flags/width/precision, drop length modifiers (args are 32-bit)
+    char spec[16];
+    size_t spec_len = 0;
+    spec[spec_len++] = *p++;
+    while (*p && strchr("-+ #0123456789.", *p) && spec_len < sizeof(spec) - 2) {
+      spec[spec_len++] = *p++;
+    }
+    while (*p && strchr("hlzjt", *p)) {
+      p++;
+    }
+    char conv = *p;
+    if (!conv) {
+      break;
+    }
+    p++;
+    spec[spec_len++] = conv;
+    spec[spec_len] = '\0';
+
+    dlog_arg_t a = arg < rec->nargs ? rec->args[arg] : (dlog_arg_t){.u = 0};
+    arg++;
+
+    int n;
+    switch (conv) {
+      case 'd':
+      case 'i':
+      case 'c':
+        n = snprintf(out + len, size - len, spec, (int)a.i);
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+        n = snprintf(out + len, size - len, spec, (unsigned int)a.u);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+        n = snprintf(out + len, size - len, spec, (double)a.f);
+        break;
+      case 's':
+        n = snprintf(out + len, size - len, spec, a.s ? a.s : "(null)");
+        break;
+      case 'p':
+        n = snprintf(out + len, size - len, spec, a.p);
+        break;
+      default:
+        n = snprintf(out + len, size - len, "%s", spec);
+        break;
+    }
+    if (n > 0) {
+      len += (size_t)n < size - len ? (size_t)n : size - len - 1;
+    }
+  }
+  out[len] = '\0';
+}
+
+static void emit_record(const dlog_record_t* rec) {
+  static char line[LINE_MAX];
+
+  format_record(rec, line, sizeof(line));
+  if (rec->suppressed) {
+    esp_log_write(rec->site->level, rec->tag,
+                  "%c (%lu) %s: %s [+%u similar suppressed]\n",
+                  level_letter(rec->site->level),
+                  (unsigned long)rec->timestamp_ms, rec->tag, line,
+                  rec->suppressed);
+  } else {
+    esp_log_write(rec->site->level, rec->tag, "%c (%lu) %s: %s\n",
+                  level_letter(rec->site->level),
+                  (unsigned long)rec->timestamp_ms, rec->tag, line);
+  }
+}
+
+static void dlog_task(void* pvParameters) {
+  dlog_record_t rec;
+
+  while (1) {
+    bool drained_any = false;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+      dlog_ring_t* ring = &s_rings[core];
+
+      portENTER_CRITICAL(&ring->lock);
+      bool have = ring->tail != ring->head;
+      if (have) {
+        rec = ring->records[ring->tail & RING_MASK];
+        ring->tail++;
+      }
+      portEXIT_CRITICAL(&ring->lock);
+
+      if (have) {
+        emit_record(&rec);
+        drained_any = true;
+      }
+    }
+
+    // Poll rather than notify so producers never touch the scheduler
+    if (!drained_any) {
+      vTaskDelay(pdMS_TO_TICKS(50));
+    }
+  }
+}
+
+esp_err_t dlog_init(void) {
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    portMUX_INITIALIZE(&s_rings[core].lock);
+  }
+
+  // Stack and TCB live in .bss, like the rings
+  static StackType_t stack[3072];
+  static StaticTask_t tcb;
+  TaskHandle_t task = xTaskCreateStaticPinnedToCore(
+      dlog_task, "dlog", sizeof(stack), NULL, CONFIG_DLOG_TASK_PRIORITY, stack,
+      &tcb, CONFIG_DLOG_TASK_CORE);
+  return task != NULL ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+#endif  // CONFIG_DLOG_ENABLE
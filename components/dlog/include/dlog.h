@@ -0,0 +1,168 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred logging: DLOG* macros capture the call site and up to
+ * DLOG_MAX_ARGS raw 32-bit arguments into a per-core ring; formatting and
+ * console output happen later on a low-priority task. Supported conversions
+ * are the integer ones (%d %i %u %x %X %o %c, with or without l/h/z), floating
+ * point (%f %e %g) and %s / %p. Strings passed to %s must outlive the call
+ * (literals or static storage), since only the pointer is recorded.
+ */
+
+#define DLOG_MAX_ARGS 6
+
+/**
+ * @brief Static per-call-site descriptor; its address is the format id
+ */
+typedef struct {
+  const char* fmt;
+  esp_log_level_t level;
+  uint32_t min_interval_ms;  ///< Rate limit, 0 to log every call
+  int64_t last_emit_us;      ///< Mutable rate limiter state
+  uint32_t suppressed;       ///< Calls folded since the last emitted record
+} dlog_site_t;
+
+/**
+ * @brief One recorded argument
+ */
+typedef union {
+  uint32_t u;
+  int32_t i;
+  float f;
+  const char* s;
+  const void* p;
+} dlog_arg_t;
+
+/**
+ * @brief Deferred logging counters
+ */
+typedef struct {
+  uint32_t written;     ///< Records queued
+  uint32_t dropped;     ///< Records lost because a ring was full
+  uint32_t suppressed;  ///< Calls folded by rate limiting
+} dlog_stats_t;
+
+#if CONFIG_DLOG_ENABLE
+
+/**
+ * @brief Start the background formatter task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * @brief Queue a record; use the DLOG* macros instead of calling directly
+ *
+ * @param site Call site descriptor
+ * @param tag Log tag
+ * @param args Argument array
+ * @param nargs Number of arguments (at most DLOG_MAX_ARGS)
+ */
+void dlog_write(dlog_site_t* site, const char* tag, const dlog_arg_t* args,
+                uint32_t nargs);
+
+/**
+ * @brief Copy the deferred logging counters
+ *
+ * @param out Destination
+ */
+void dlog_get_stats(dlog_stats_t* out);
+
+static inline dlog_arg_t dlog_arg_u(uint32_t v) {
+  dlog_arg_t a = {.u = v};
+  return a;
+}
+static inline dlog_arg_t dlog_arg_f(double v) {
+  dlog_arg_t a = {.f = (float)v};
+  return a;
+}
+static inline dlog_arg_t dlog_arg_s(const char* v) {
+  dlog_arg_t a = {.s = v};
+  return a;
+}
+static inline dlog_arg_t dlog_arg_p(const void* v) {
+  dlog_arg_t a = {.p = v};
+  return a;
+}
+
+#define DLOG_ARG(x)                                        \
+  _Generic((x),                                            \
+      float: dlog_arg_f,                                   \
+      double: dlog_arg_f,                                  \
+      char*: dlog_arg_s,                                   \
+      const char*: dlog_arg_s,                             \
+      void*: dlog_arg_p,                                   \
+      const void*: dlog_arg_p,                             \
+      default: dlog_arg_u)(x)
+
+// Argument counting and per-argument expansion (0..DLOG_MAX_ARGS)
+#define DLOG_NARGS(...) DLOG_NARGS_(_, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define DLOG_ARGS_0()
+#define DLOG_ARGS_1(a) , DLOG_ARG(a)
+#define DLOG_ARGS_2(a, ...) , DLOG_ARG(a) DLOG_ARGS_1(__VA_ARGS__)
+#define DLOG_ARGS_3(a, ...) , DLOG_ARG(a) DLOG_ARGS_2(__VA_ARGS__)
+#define DLOG_ARGS_4(a, ...) , DLOG_ARG(a) DLOG_ARGS_3(__VA_ARGS__)
+#define DLOG_ARGS_5(a, ...) , DLOG_ARG(a) DLOG_ARGS_4(__VA_ARGS__)
+#define DLOG_ARGS_6(a, ...) , DLOG_ARG(a) DLOG_ARGS_5(__VA_ARGS__)
+#define DLOG_ARGS_N(n, ...) DLOG_ARGS_##n(__VA_ARGS__)
+#define DLOG_ARGS_X(n, ...) DLOG_ARGS_N(n, ##__VA_ARGS__)
+
+#define DLOG_LEVEL_RATE(lvl, tag, interval_ms, format, ...)                \
+  do {                                                                     \
+    if ((lvl) <= LOG_LOCAL_LEVEL) {                                        \
+      static dlog_site_t _dlog_site = {.fmt = (format),                    \
+                                       .level = (lvl),                     \
+                                       .min_interval_ms = (interval_ms)};  \
+      /* Element 0 is padding so the zero-argument form stays valid C */   \
+      const dlog_arg_t _dlog_args[] = {                                    \
+          {.u = 0} DLOG_ARGS_X(DLOG_NARGS(__VA_ARGS__), ##__VA_ARGS__)};   \
+      dlog_write(&_dlog_site, (tag), &_dlog_args[1],                       \
+                 DLOG_NARGS(__VA_ARGS__));                                 \
+    }                                                                      \
+  } while (0)
+
+#else  // !CONFIG_DLOG_ENABLE
+
+static inline esp_err_t dlog_init(void) { return ESP_OK; }
+static inline void dlog_get_stats(dlog_stats_t* out) {
+  out->written = out->dropped = out->suppressed = 0;
+}
+
+#define DLOG_LEVEL_RATE(lvl, tag, interval_ms, format, ...) \
+  ESP_LOG_LEVEL_LOCAL((lvl), (tag), format, ##__VA_ARGS__)
+
+#endif  // CONFIG_DLOG_ENABLE
+
+#define DLOGE(tag, format, ...) \
+  DLOG_LEVEL_RATE(ESP_LOG_ERROR, tag, 0, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) \
+  DLOG_LEVEL_RATE(ESP_LOG_WARN, tag, 0, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) \
+  DLOG_LEVEL_RATE(ESP_LOG_INFO, tag, 0, format, ##__VA_ARGS__)
+
+/**
+ * Rate-limited variants: at most one record per interval_ms per call site,
+ * later records carry the number of calls folded in between.
+ */
+#define DLOGW_RATE(tag, interval_ms, format, ...) \
+  DLOG_LEVEL_RATE(ESP_LOG_WARN, tag, interval_ms, format, ##__VA_ARGS__)
+#define DLOGI_RATE(tag, interval_ms, format, ...) \
+  DLOG_LEVEL_RATE(ESP_LOG_INFO, tag, interval_ms, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DLOG_H
@@ -1,6 +1,7 @@
 #include "gsheet_client.h"
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include "esp_crt_bundle.h"
 #include "esp_event.h"
 #include "esp_http_client.h"
@@ -10,11 +11,20 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
+#include "metrics.h"
 #include "nvs_flash.h"
 
 static const char* TAG = "GSHEET_CLIENT";
 
-/* WiFi event group */
+// Redirects followed by gsheet_client_get(); Apps Script uses one
+#define GET_MAX_REDIRECTS 3
+
+// Where Apps Script redirects once doPost has run
+#define ECHO_HOST "script.googleusercontent.com"
+#define ECHO_PATH "/macros/echo"
+
+/* WiFi event group (static, cleared rather than recreated per connect) */
+static StaticEventGroup_t s_wifi_event_group_buf;
 static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
@@ -22,6 +32,7 @@ static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 static const int WIFI_MAXIMUM_RETRY = 5;  // Increased retry count
 static bool s_wifi_initialized = false;
+static bool s_wifi_started = false;
 static esp_event_handler_instance_t wifi_handler_instance = NULL;
 static esp_event_handler_instance_t ip_handler_instance = NULL;
 
@@ -56,6 +67,133 @@ static void wifi_event_handler(void* arg,
   }
 }
 
+// Host of an http(s) URL, without port; false for a relative URL
+static bool url_host(const char* url, const char** host, size_t* len) {
+  const char* start = strstr(url, "://");
+  if (!start) {
+    return false;
+  }
+  *host = start + 3;
+  *len = strcspn(*host, ":/?#");
+  return *len > 0;
+}
+
+// True for the script's result page. A deployment that is not anonymous,
+// or has been replaced, answers the POST with a 302 to a sign-in page
+// instead, and that upload was never stored. A stand-in serving the page
+// from the script's own host (tools/redirect_bench) is accepted too.
+static bool is_echo_location(const char* location, const char* script_url) {
+  const char* host;
+  size_t len;
+  if (!url_host(location, &host, &len)) {
+    return false;
+  }
+  const char* path = host + len;
+  path += strcspn(path, "/?#");
+  if (strncmp(path, ECHO_PATH, strlen(ECHO_PATH)) != 0) {
+    return false;
+  }
+  if (len == strlen(ECHO_HOST) && strncasecmp(host, ECHO_HOST, len) == 0) {
+    return true;
+  }
+  const char* script_host;
+  size_t script_len;
+  return script_url && url_host(script_url, &script_host, &script_len) &&
+         script_len == len && strncasecmp(host, script_host, len) == 0;
+}
+
+/* Lean-mode ack state for the request in flight (only one uploader task) */
+static const char* s_script_url;
+static bool s_echo_redirect;  // Location pointed at the script's result page
+
+#if CONFIG_METRICS_ENABLE
+/* Phase timestamps for the request in flight (only one uploader task) */
+typedef struct {
+  int64_t start_us;
+  int64_t connected_us;
+  int64_t headers_sent_us;
+  bool got_response;
+} http_phases_t;
+
+static http_phases_t s_http_phases;
+#endif
+
+static esp_err_t http_event_handler(esp_http_client_event_t* evt) {
+  if (evt->event_id == HTTP_EVENT_ON_HEADER &&
+      strcasecmp(evt->header_key, "Location") == 0) {
+    s_echo_redirect = is_echo_location(evt->header_value, s_script_url);
+    if (!s_echo_redirect) {
+      ESP_LOGW(TAG, "Redirected to %s", evt->header_value);
+    }
+  }
+
+#if CONFIG_METRICS_ENABLE
+  http_phases_t* phases = (http_phases_t*)evt->user_data;
+  int64_t now = METRICS_NOW_US();
+
+  switch (evt->event_id) {
+    case HTTP_EVENT_ON_CONNECTED:
+      // Redirects reconnect; only the first connection is the TLS phase
+      if (!phases->connected_us) {
+        phases->connected_us = now;
+        METRICS_HIST_RECORD(METRICS_HIST_HTTP_CONNECT, now - phases->start_us);
+        METRICS_TRACE(METRICS_EVT_HTTP_CONNECTED, 0);
+      }
+      break;
+    case HTTP_EVENT_HEADERS_SENT:
+      if (!phases->headers_sent_us && phases->connected_us) {
+        phases->headers_sent_us = now;
+        METRICS_HIST_RECORD(METRICS_HIST_HTTP_SEND,
+                            now - phases->connected_us);
+        METRICS_TRACE(METRICS_EVT_HTTP_HEADERS_SENT, 0);
+      }
+      break;
+    case HTTP_EVENT_ON_HEADER:
+      if (!phases->got_response && phases->headers_sent_us) {
+        phases->got_response = true;
+        METRICS_HIST_RECORD(METRICS_HIST_HTTP_RESPONSE,
+                            now - phases->headers_sent_us);
+        METRICS_TRACE(METRICS_EVT_HTTP_RESPONSE, 0);
+      }
+      break;
+    default:
+      break;
+  }
+#endif
+  return ESP_OK;
+}
+
+// NVS, netif, default event loop and WiFi driver. Deferred to the first
+// connect so that boot does not wait for the network stack.
+static void gsheet_client_net_init(void) {
+  if (s_wifi_initialized) {
+    return;
+  }
+
+  esp_err_t ret = nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+      ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret = nvs_flash_init();
+  }
+  ESP_ERROR_CHECK(ret);
+
+  // Initialize network interface
+  ESP_ERROR_CHECK(esp_netif_init());
+  ESP_ERROR_CHECK(esp_event_loop_create_default());
+  esp_netif_create_default_wifi_sta();
+
+  // Initialize WiFi
+  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+  // Set WiFi mode
+  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+
+  s_wifi_initialized = true;
+  ESP_LOGI(TAG, "Network stack initialized");
+}
+
 esp_err_t gsheet_client_init(gsheet_client_t* client,
                              const gsheet_config_t* config) {
   if (!client || !config) {
@@ -65,45 +203,56 @@ esp_err_t gsheet_client_init(gsheet_client_t* client,
   memset(client, 0, sizeof(gsheet_client_t));
 
   // Copy configuration
-  client->config.apps_script_url = strdup(config->apps_script_url);
-  client->config.wifi_ssid = strdup(config->wifi_ssid);
-  client->config.wifi_password = strdup(config->wifi_password);
-  client->config.timeout_ms =
-      config->timeout_ms > 0 ? config->timeout_ms : 10000;
-
-  if (!client->config.apps_script_url || !client->config.wifi_ssid ||
-      !client->config.wifi_password) {
-    ESP_LOGE(TAG, "Failed to allocate memory for configuration");
-    gsheet_client_deinit(client);
-    return ESP_ERR_NO_MEM;
+  esp_err_t err = gsheet_client_set_config(client, config);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Invalid configuration: %s", esp_err_to_name(err));
+    memset(client, 0, sizeof(gsheet_client_t));
+    return err;
   }
 
-  // Initialize NVS (only once)
-  if (!s_wifi_initialized) {
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
-        ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-      ESP_ERROR_CHECK(nvs_flash_erase());
-      ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
+  ESP_LOGI(TAG, "Google Sheets client initialized");
+  return ESP_OK;
+}
 
-    // Initialize network interface
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+esp_err_t gsheet_client_set_config(gsheet_client_t* client,
+                                   const gsheet_config_t* config) {
+  if (!client || !config || !config->apps_script_url || !config->wifi_ssid ||
+      !config->wifi_password) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (strlen(config->apps_script_url) >= sizeof(client->url_buf) ||
+      strlen(config->wifi_ssid) >= sizeof(client->ssid_buf) ||
+      strlen(config->wifi_password) >= sizeof(client->password_buf)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
 
-    // Initialize WiFi
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+  // Fixed buffers inside the client: no heap churn on config updates
+  if (config->apps_script_url != client->url_buf) {
+    strcpy(client->url_buf, config->apps_script_url);
+  }
+  if (config->wifi_ssid != client->ssid_buf) {
+    strcpy(client->ssid_buf, config->wifi_ssid);
+  }
+  if (config->wifi_password != client->password_buf) {
+    strcpy(client->password_buf, config->wifi_password);
+  }
 
-    // Set WiFi mode
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+  client->config.apps_script_url = client->url_buf;
+  client->config.wifi_ssid = client->ssid_buf;
+  client->config.wifi_password = client->password_buf;
+  client->config.timeout_ms =
+      config->timeout_ms > 0 ? config->timeout_ms : 10000;
+  client->config.wifi_listen_interval = config->wifi_listen_interval;
 
-    s_wifi_initialized = true;
+  // Redirect handling and headers are fixed when the handle is created
+  if (config->verify_redirect != client->config.verify_redirect &&
+      client->http_client) {
+    esp_http_client_cleanup(client->http_client);
+    client->http_client = NULL;
   }
+  client->config.verify_redirect = config->verify_redirect;
 
-  ESP_LOGI(TAG, "Google Sheets client initialized");
   return ESP_OK;
 }
 
@@ -114,9 +263,14 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
 
   ESP_LOGI(TAG, "Starting WiFi connection process...");
 
+  gsheet_client_net_init();
+
   // Stop WiFi first if it was running
-  esp_wifi_stop();
-  vTaskDelay(pdMS_TO_TICKS(500));  // Give it time to stop completely
+  if (s_wifi_started) {
+    esp_wifi_stop();
+    s_wifi_started = false;
+    vTaskDelay(pdMS_TO_TICKS(500));  // Give it time to stop completely
+  }
 
   // Unregister any existing event handlers
   if (wifi_handler_instance) {
@@ -130,15 +284,11 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
     ip_handler_instance = NULL;
   }
 
-  // Delete existing event group and create new one
-  if (s_wifi_event_group) {
-    vEventGroupDelete(s_wifi_event_group);
-  }
-  s_wifi_event_group = xEventGroupCreate();
+  // Reuse the event group with its bits cleared
   if (!s_wifi_event_group) {
-    ESP_LOGE(TAG, "Failed to create WiFi event group");
-    return ESP_FAIL;
+    s_wifi_event_group = xEventGroupCreateStatic(&s_wifi_event_group_buf);
   }
+  xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
 
   // Reset retry counter
   s_retry_num = 0;
@@ -174,6 +324,7 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
               .scan_method = WIFI_FAST_SCAN,
               .sort_method = WIFI_CONNECT_AP_BY_SIGNAL,
               .failure_retry_cnt = 3,
+              .listen_interval = client->config.wifi_listen_interval,
           },
   };
 
@@ -200,6 +351,16 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
     ESP_LOGE(TAG, "Failed to start WiFi: %s", esp_err_to_name(ret));
     return ret;
   }
+  s_wifi_started = true;
+
+  // With a listen interval the radio sleeps across several DTIM periods
+  // between uploads; otherwise keep the default per-DTIM modem sleep
+  ret = esp_wifi_set_ps(client->config.wifi_listen_interval
+                            ? WIFI_PS_MAX_MODEM
+                            : WIFI_PS_MIN_MODEM);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to set WiFi power save: %s", esp_err_to_name(ret));
+  }
 
   ESP_LOGI(TAG, "WiFi started. Connecting to %s...", client->config.wifi_ssid);
 
@@ -227,6 +388,7 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
 
     // Stop WiFi on timeout
     esp_wifi_stop();
+    s_wifi_started = false;
   }
 
   // Clean up event handlers on failure
@@ -246,24 +408,100 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client) {
   return result;
 }
 
+void gsheet_client_wifi_abort(void) {
+  // The connecting task may be stopping the driver at the same time
+  if (__atomic_exchange_n(&s_wifi_started, false, __ATOMIC_ACQ_REL)) {
+    ESP_LOGW(TAG, "Stopping WiFi to break a stuck connection");
+    esp_wifi_stop();
+  }
+  if (s_wifi_event_group) {
+    xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+  }
+}
+
 esp_err_t gsheet_client_send_status(gsheet_client_t* client,
                                     gsheet_status_t status) {
-  if (!client) {
-    return ESP_ERR_INVALID_ARG;
+  char post_data[64];
+  snprintf(post_data, sizeof(post_data), "status=%s",
+           (status == GSHEET_STATUS_ON) ? "ON" : "OFF");
+  return gsheet_client_post(client, post_data);
+}
+
+// Lean path. Apps Script runs doPost before answering the POST with a 302 to
+// its result page, so the status line and its Location are the commit point:
+// the redirect is not followed and the body is never read. Closing the
+// connection (no keep-alive) discards whatever of it has arrived.
+static esp_err_t post_ack(esp_http_client_handle_t http, const char* body,
+                          int* status_code) {
+  size_t len = strlen(body);
+  esp_err_t err = esp_http_client_open(http, (int)len);
+  if (err != ESP_OK) {
+    return err;
+  }
+  if (esp_http_client_write(http, body, (int)len) != (int)len) {
+    return ESP_ERR_HTTP_WRITE_DATA;
   }
+  if (esp_http_client_fetch_headers(http) < 0) {
+    return ESP_ERR_HTTP_FETCH_HEADER;
+  }
+  *status_code = esp_http_client_get_status_code(http);
+  return ESP_OK;
+}
 
-  if (!client->wifi_connected) {
-    ESP_LOGE(TAG, "WiFi not connected");
-    return ESP_ERR_INVALID_STATE;
+// Verify path: follow the redirect by hand and read the script's reply.
+// doPost catches its own exceptions (lock timeout, failed append) and
+// answers {"result":"error"} behind the same 302 as a stored row, so only
+// the reply tells the two apart.
+static esp_err_t post_and_follow(esp_http_client_handle_t http,
+                                 const char* body, int* status_code,
+                                 bool* script_error) {
+  esp_err_t err = post_ack(http, body, status_code);
+  for (int hop = 0; err == ESP_OK && *status_code >= 300 &&
+                    *status_code < 400 && hop < GET_MAX_REDIRECTS;
+       hop++) {
+    err = esp_http_client_set_redirection(http);
+    esp_http_client_close(http);
+    if (err != ESP_OK) {
+      break;
+    }
+    esp_http_client_set_method(http, HTTP_METHOD_GET);
+    err = esp_http_client_open(http, 0);
+    if (err != ESP_OK) {
+      break;
+    }
+    if (esp_http_client_fetch_headers(http) < 0) {
+      err = ESP_ERR_HTTP_FETCH_HEADER;
+      break;
+    }
+    *status_code = esp_http_client_get_status_code(http);
+  }
+  if (err != ESP_OK) {
+    return err;
   }
 
-  // Double-check WiFi connection before making HTTP request
-  if (!gsheet_client_check_wifi_connection(client)) {
-    ESP_LOGW(TAG, "WiFi connection lost during send attempt");
-    return ESP_ERR_INVALID_STATE;
+  // "result" is the first key of every reply, well within this buffer
+  char response[256];
+  int total = 0;
+  while (total < (int)sizeof(response) - 1) {
+    int got = esp_http_client_read(http, response + total,
+                                   (int)sizeof(response) - 1 - total);
+    if (got <= 0) {
+      break;
+    }
+    total += got;
   }
+  response[total] = '\0';
+  ESP_LOGI(TAG, "HTTP %d, response: %s", *status_code, response);
+  *script_error = strstr(response, "\"result\":\"error\"") != NULL;
+  return ESP_OK;
+}
+
+// Create the HTTP handle on first use, or point the kept one back at the
+// script. The configuration is used once: the handle and its RX/TX buffers
+// are kept for the lifetime of the client (or until the mode changes).
+static esp_err_t prepare_http(gsheet_client_t* client) {
+  bool verify = client->config.verify_redirect;
 
-  // Create HTTP client configuration
   esp_http_client_config_t config = {
       .url = client->config.apps_script_url,
       .method = HTTP_METHOD_POST,
@@ -273,109 +511,222 @@ esp_err_t gsheet_client_send_status(gsheet_client_t* client,
       .crt_bundle_attach = esp_crt_bundle_attach,
       .buffer_size = 4096,
       .buffer_size_tx = 4096,
+      .disable_auto_redirect = !verify,
       .keep_alive_enable =
           false,  // Disable keep-alive to avoid connection issues
+      .event_handler = http_event_handler,
+#if CONFIG_METRICS_ENABLE
+      .user_data = &s_http_phases,
+#endif
   };
 
-  client->http_client = esp_http_client_init(&config);
   if (!client->http_client) {
-    ESP_LOGE(TAG, "Failed to initialize HTTP client");
-    return ESP_FAIL;
+    client->http_client = esp_http_client_init(&config);
+    if (!client->http_client) {
+      ESP_LOGE(TAG, "Failed to initialize HTTP client");
+      return ESP_FAIL;
+    }
+
+    // Headers never change, set them once. Apps Script only needs the
+    // content type; the rest is kept for verify mode's debugging.
+    esp_http_client_set_header(client->http_client, "Content-Type",
+                               "application/x-www-form-urlencoded");
+    if (verify) {
+      esp_http_client_set_header(client->http_client, "User-Agent",
+                                 "ESP32-RadarWatch/1.0");
+      esp_http_client_set_header(client->http_client, "Accept", "*/*");
+      esp_http_client_set_header(client->http_client, "Cache-Control",
+                                 "no-cache");
+      esp_http_client_set_header(client->http_client, "Connection", "close");
+    }
+  } else {
+    // A redirect leaves the handle on the target host and may switch the
+    // method, so point it back at the script for every request
+    esp_http_client_set_url(client->http_client,
+                            client->config.apps_script_url);
+    esp_http_client_set_method(client->http_client, HTTP_METHOD_POST);
+    esp_http_client_set_timeout_ms(client->http_client,
+                                   client->config.timeout_ms);
   }
+  return ESP_OK;
+}
 
-  // Set headers
-  esp_http_client_set_header(client->http_client, "Content-Type",
-                             "application/x-www-form-urlencoded");
-  esp_http_client_set_header(client->http_client, "User-Agent",
-                             "ESP32-RadarWatch/1.0");
-  esp_http_client_set_header(client->http_client, "Accept", "*/*");
-  esp_http_client_set_header(client->http_client, "Cache-Control", "no-cache");
-  esp_http_client_set_header(client->http_client, "Connection", "close");
+esp_err_t gsheet_client_post(gsheet_client_t* client, const char* form_body) {
+  if (!client || !form_body) {
+    return ESP_ERR_INVALID_ARG;
+  }
 
-  // Create POST data
-  char post_data[64];
-  const char* status_str = (status == GSHEET_STATUS_ON) ? "ON" : "OFF";
-  snprintf(post_data, sizeof(post_data), "status=%s", status_str);
+  if (!client->wifi_connected) {
+    ESP_LOGE(TAG, "WiFi not connected");
+    return ESP_ERR_INVALID_STATE;
+  }
 
-  // Set POST data
-  esp_http_client_set_post_field(client->http_client, post_data,
-                                 strlen(post_data));
+  // Double-check WiFi connection before making HTTP request
+  if (!gsheet_client_check_wifi_connection(client)) {
+    ESP_LOGW(TAG, "WiFi connection lost during send attempt");
+    return ESP_ERR_INVALID_STATE;
+  }
 
-  ESP_LOGI(TAG, "Sending HTTP POST to: %s", client->config.apps_script_url);
-  ESP_LOGI(TAG, "POST data: %s", post_data);
+  bool verify = client->config.verify_redirect;
 
-  // Perform HTTP request
-  esp_err_t err = esp_http_client_perform(client->http_client);
+#if CONFIG_METRICS_ENABLE
+  memset(&s_http_phases, 0, sizeof(s_http_phases));
+  s_http_phases.start_us = METRICS_NOW_US();
+  METRICS_TRACE(METRICS_EVT_HTTP_START, strlen(form_body));
+#endif
 
-  if (err == ESP_OK) {
-    int status_code = esp_http_client_get_status_code(client->http_client);
-    int content_length =
-        esp_http_client_get_content_length(client->http_client);
-
-    ESP_LOGI(TAG, "HTTP POST Status = %d, Content-Length = %d", status_code,
-             content_length);
-
-    if (status_code == 200) {
-      // Read response body for debugging
-      char response_buffer[512];
-      int data_read = esp_http_client_read_response(
-          client->http_client, response_buffer, sizeof(response_buffer) - 1);
-      if (data_read > 0) {
-        response_buffer[data_read] = '\0';
-        ESP_LOGI(TAG, "Response: %s", response_buffer);
-      }
+  esp_err_t err = prepare_http(client);
+  if (err != ESP_OK) {
+    return err;
+  }
 
-      ESP_LOGI(TAG, "Status '%s' sent successfully", status_str);
-    } else if (status_code == 302) {
-      // Handle redirect (common with Google Apps Script)
-      ESP_LOGI(
-          TAG,
-          "Received redirect (302) - this is normal for Google Apps Script");
-
-      // Read response for any error details
-      char response_buffer[512];
-      int data_read = esp_http_client_read_response(
-          client->http_client, response_buffer, sizeof(response_buffer) - 1);
-      if (data_read > 0) {
-        response_buffer[data_read] = '\0';
-        ESP_LOGI(TAG, "Redirect response: %s", response_buffer);
-      }
+  ESP_LOGD(TAG, "Sending HTTP POST to: %s", client->config.apps_script_url);
+  ESP_LOGD(TAG, "POST data: %s", form_body);
 
-      // For Google Apps Script, 302 is often success
-      ESP_LOGI(TAG, "Status '%s' likely sent successfully (302 redirect)",
-               status_str);
-    } else {
-      ESP_LOGW(TAG, "HTTP request completed with status code: %d", status_code);
-
-      // Read response body for error details
-      char response_buffer[512];
-      int data_read = esp_http_client_read_response(
-          client->http_client, response_buffer, sizeof(response_buffer) - 1);
-      if (data_read > 0) {
-        response_buffer[data_read] = '\0';
-        ESP_LOGW(TAG, "Error response: %s", response_buffer);
-      }
+  int status_code = 0;
+  bool script_error = false;
+  s_script_url = client->config.apps_script_url;
+  s_echo_redirect = false;
+  err = verify ? post_and_follow(client->http_client, form_body,
+                                 &status_code, &script_error)
+               : post_ack(client->http_client, form_body, &status_code);
 
+  if (err == ESP_OK) {
+    // Lean mode accepts the 302 to the result page: the script has run by
+    // the time Google sends it, but whether it stored the row is only in
+    // the reply, which verify mode reads. A 302 anywhere else (a sign-in
+    // page) means doPost never ran.
+    if (script_error) {
+      ESP_LOGW(TAG, "Script reported an error, upload kept for a retry");
+      err = ESP_FAIL;
+    } else if (status_code == 200 ||
+               (!verify && status_code == 302 && s_echo_redirect)) {
+      ESP_LOGD(TAG, "POST acknowledged (HTTP %d)", status_code);
+    } else {
+      ESP_LOGW(TAG, "HTTP request completed with status code: %d",
+               status_code);
       err = ESP_FAIL;
     }
   } else {
     ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
 
-    // For connection-related errors, return specific error codes
-    if (err == ESP_ERR_HTTP_CONNECT || err == ESP_ERR_TIMEOUT) {
+    // Only a failed connect says the link is down; a timeout may be a slow
+    // script, and the caller retries that request as is
+    if (err == ESP_ERR_HTTP_CONNECT) {
       ESP_LOGW(TAG, "Connection error detected, marking WiFi as disconnected");
       client->wifi_connected = false;  // Mark as disconnected
     }
   }
 
-  esp_http_client_cleanup(client->http_client);
-  client->http_client = NULL;
+  // Drop the connection (and its TLS session) but keep the handle
+  esp_http_client_close(client->http_client);
+
+#if CONFIG_METRICS_ENABLE
+  METRICS_HIST_SINCE(METRICS_HIST_HTTP_TOTAL, s_http_phases.start_us);
+  METRICS_TRACE(METRICS_EVT_HTTP_DONE, err == ESP_OK);
+#endif
+
+  return err;
+}
+
+esp_err_t gsheet_client_get(gsheet_client_t* client, const char* query,
+                            char* buf, size_t size, size_t* out_len) {
+  if (!client || !query || !buf || size == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!client->wifi_connected ||
+      !gsheet_client_check_wifi_connection(client)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  char url[GSHEET_URL_MAX + 64];
+  const char* script = client->config.apps_script_url;
+  int n = snprintf(url, sizeof(url), "%s%c%s", script,
+                   strchr(script, '?') ? '&' : '?', query);
+  if (n < 0 || (size_t)n >= sizeof(url)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  s_script_url = script;
+
+#if CONFIG_METRICS_ENABLE
+  memset(&s_http_phases, 0, sizeof(s_http_phases));
+  s_http_phases.start_us = METRICS_NOW_US();
+#endif
+
+  esp_err_t err = prepare_http(client);
+  if (err != ESP_OK) {
+    return err;
+  }
+  esp_http_client_handle_t http = client->http_client;
+  esp_http_client_set_url(http, url);
+  esp_http_client_set_method(http, HTTP_METHOD_GET);
+
+  // Apps Script answers doGet with a redirect to the content host. Follow
+  // it by hand so the kept handle's redirect setting does not matter.
+  int status_code = 0;
+  for (int hop = 0; hop <= GET_MAX_REDIRECTS; hop++) {
+    err = esp_http_client_open(http, 0);
+    if (err != ESP_OK) {
+      break;
+    }
+    if (esp_http_client_fetch_headers(http) < 0) {
+      err = ESP_ERR_HTTP_FETCH_HEADER;
+      break;
+    }
+    status_code = esp_http_client_get_status_code(http);
+    if (status_code < 300 || status_code >= 400 || hop == GET_MAX_REDIRECTS) {
+      break;
+    }
+    err = esp_http_client_set_redirection(http);
+    esp_http_client_close(http);
+    if (err != ESP_OK) {
+      break;
+    }
+  }
+
+  size_t total = 0;
+  if (err == ESP_OK && status_code == 200) {
+    while (total < size - 1) {
+      int got =
+          esp_http_client_read(http, buf + total, (int)(size - 1 - total));
+      if (got < 0) {
+        err = ESP_FAIL;
+        break;
+      }
+      if (got == 0) {
+        break;
+      }
+      total += (size_t)got;
+    }
+    if (err == ESP_OK && !esp_http_client_is_complete_data_received(http)) {
+      ESP_LOGW(TAG, "GET reply does not fit in %u bytes", (unsigned)size);
+      err = ESP_ERR_INVALID_SIZE;
+    }
+  } else if (err == ESP_OK) {
+    ESP_LOGW(TAG, "GET completed with status code: %d", status_code);
+    err = ESP_FAIL;
+  } else {
+    ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+    if (err == ESP_ERR_HTTP_CONNECT) {
+      client->wifi_connected = false;
+    }
+  }
+  buf[total] = '\0';
+  if (out_len) {
+    *out_len = total;
+  }
+
+  esp_http_client_close(http);
+
+#if CONFIG_METRICS_ENABLE
+  METRICS_HIST_SINCE(METRICS_HIST_HTTP_TOTAL, s_http_phases.start_us);
+#endif
 
   return err;
 }
 
 bool gsheet_client_check_wifi_connection(gsheet_client_t* client) {
-  if (!client) {
+  if (!client || !s_wifi_initialized) {
     return false;
   }
 
@@ -426,11 +777,12 @@ void gsheet_client_deinit(gsheet_client_t* client) {
     ip_handler_instance = NULL;
   }
 
-  // Stop WiFi if connected
-  if (client->wifi_connected) {
+  // Stop WiFi if it was started
+  if (s_wifi_started) {
     esp_wifi_stop();
-    client->wifi_connected = false;
+    s_wifi_started = false;
   }
+  client->wifi_connected = false;
 
   // Clean up HTTP client if exists
   if (client->http_client) {
@@ -438,26 +790,6 @@ void gsheet_client_deinit(gsheet_client_t* client) {
     client->http_client = NULL;
   }
 
-  // Free configuration strings
-  if (client->config.apps_script_url) {
-    free(client->config.apps_script_url);
-    client->config.apps_script_url = NULL;
-  }
-  if (client->config.wifi_ssid) {
-    free(client->config.wifi_ssid);
-    client->config.wifi_ssid = NULL;
-  }
-  if (client->config.wifi_password) {
-    free(client->config.wifi_password);
-    client->config.wifi_password = NULL;
-  }
-
-  // Clean up event group
-  if (s_wifi_event_group) {
-    vEventGroupDelete(s_wifi_event_group);
-    s_wifi_event_group = NULL;
-  }
-
   memset(client, 0, sizeof(gsheet_client_t));
   ESP_LOGI(TAG, "Google Sheets client deinitialized");
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef GSHEET_CLIENT_H
 #define GSHEET_CLIENT_H
 
+#include <stddef.h>
 #include "esp_err.h"
 #include "esp_http_client.h"
 
@@ -8,23 +9,34 @@
 extern "C" {
 #endif
 
+#define GSHEET_URL_MAX 256
+#define GSHEET_SSID_MAX 33
+#define GSHEET_PASSWORD_MAX 65
+
 /**
  * @brief Google Sheets client configuration
  */
 typedef struct {
-  char* apps_script_url;  ///< Google Apps Script Web App URL
-  char* wifi_ssid;        ///< WiFi SSID
-  char* wifi_password;    ///< WiFi password
-  int timeout_ms;         ///< HTTP request timeout in milliseconds
+  char* apps_script_url;         ///< Google Apps Script Web App URL
+  char* wifi_ssid;               ///< WiFi SSID
+  char* wifi_password;           ///< WiFi password
+  int timeout_ms;                ///< HTTP request timeout in milliseconds
+  uint8_t wifi_listen_interval;  ///< 0: default modem sleep, N: max modem
+                                 ///< sleep waking every N DTIM beacons
+  bool verify_redirect;          ///< Follow the Apps Script redirect and log
+                                 ///< the reply instead of acking on the 302
 } gsheet_config_t;
 
 /**
  * @brief Google Sheets client handle
  */
 typedef struct {
-  gsheet_config_t config;
+  gsheet_config_t config;  ///< Strings point into the buffers below
   bool wifi_connected;
-  esp_http_client_handle_t http_client;
+  esp_http_client_handle_t http_client;  ///< Created on first send, reused
+  char url_buf[GSHEET_URL_MAX];
+  char ssid_buf[GSHEET_SSID_MAX];
+  char password_buf[GSHEET_PASSWORD_MAX];
 } gsheet_client_t;
 
 /**
@@ -35,6 +47,10 @@ typedef enum { GSHEET_STATUS_OFF = 0, GSHEET_STATUS_ON = 1 } gsheet_status_t;
 /**
  * @brief Initialize Google Sheets client
  *
+ * Only copies the configuration. NVS, netif and the WiFi driver are brought
+ * up by the first gsheet_client_wifi_connect(), and the HTTP/TLS client by the
+ * first gsheet_client_send_status().
+ *
  * @param client Pointer to gsheet_client_t structure
  * @param config Configuration parameters
  * @return ESP_OK on success, error code otherwise
@@ -42,6 +58,21 @@ typedef enum { GSHEET_STATUS_OFF = 0, GSHEET_STATUS_ON = 1 } gsheet_status_t;
 esp_err_t gsheet_client_init(gsheet_client_t* client,
                              const gsheet_config_t* config);
 
+/**
+ * @brief Replace the URL, credentials and timeout of an initialized client
+ *
+ * Strings are copied into the client, nothing is allocated. Takes effect on
+ * the next request; call gsheet_client_wifi_connect() again for new WiFi
+ * credentials to be used.
+ *
+ * @param client Pointer to gsheet_client_t structure
+ * @param config New configuration parameters
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if a string does not fit,
+ *         error code otherwise
+ */
+esp_err_t gsheet_client_set_config(gsheet_client_t* client,
+                                   const gsheet_config_t* config);
+
 /**
  * @brief Connect to WiFi
  *
@@ -50,6 +81,15 @@ esp_err_t gsheet_client_init(gsheet_client_t* client,
  */
 esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client);
 
+/**
+ * @brief Stop the WiFi driver from another task to break a stuck uploader
+ *
+ * Ends a gsheet_client_wifi_connect() that is waiting for the AP and takes
+ * the interface down, so a request in flight fails instead of hanging. The
+ * uploader then sees the link down and reconnects as usual.
+ */
+void gsheet_client_wifi_abort(void);
+
 /**
  * @brief Send status to Google Sheets
  *
@@ -60,6 +100,40 @@ esp_err_t gsheet_client_wifi_connect(gsheet_client_t* client);
 esp_err_t gsheet_client_send_status(gsheet_client_t* client,
                                     gsheet_status_t status);
 
+/**
+ * @brief POST a form-encoded body to the Apps Script URL
+ *
+ * Used for status rows and for periodic summaries. By default the 302 that
+ * Apps Script answers with once doPost has run counts as success and is
+ * not followed, so a row the script failed to store is lost (at most
+ * once). With verify_redirect the redirect is followed, the script's reply
+ * is logged and a {"result":"error"} reply fails the call, so the caller
+ * keeps the item and retries it.
+ *
+ * @param client Pointer to gsheet_client_t structure
+ * @param form_body application/x-www-form-urlencoded body, kept by the
+ *        caller until the call returns
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gsheet_client_post(gsheet_client_t* client, const char* form_body);
+
+/**
+ * @brief GET the Apps Script URL with a query string and read the reply
+ *
+ * Follows the redirect Apps Script answers doGet with. Shares the HTTP
+ * handle with gsheet_client_post(), so call it from the same task.
+ *
+ * @param client Pointer to gsheet_client_t structure
+ * @param query Query string without the leading '?', already URL-encoded
+ * @param buf Reply body, NUL-terminated
+ * @param size Size of buf
+ * @param out_len Body length, may be NULL
+ * @return ESP_OK on HTTP 200, ESP_ERR_INVALID_SIZE if the body does not fit,
+ *         error code otherwise
+ */
+esp_err_t gsheet_client_get(gsheet_client_t* client, const char* query,
+                            char* buf, size_t size, size_t* out_len);
+
 /**
  * @brief Check if WiFi is connected
  *
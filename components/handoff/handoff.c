@@ -0,0 +1,69 @@
+#include "handoff.h"
+
+#include <string.h>
+
+// head and tail run freely and wrap at 2^32; their difference is the depth.
+// The producer's release store of head orders the slot contents before it,
+// the consumer's release store of tail orders its reads before the slot is
+// reused.
+
+bool handoff_init(handoff_t* h, void* storage, size_t slot_size,
+                  size_t count) {
+  if (!h || !storage || count == 0 || (count & (count - 1)) != 0) {
+    return false;
+  }
+  memset(h, 0, sizeof(*h));
+  h->slots = storage;
+  h->slot_size = slot_size;
+  h->mask = (uint32_t)count - 1;
+  return true;
+}
+
+void* handoff_claim(handoff_t* h) {
+  uint32_t head = h->head;
+  uint32_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+  if (head - tail > h->mask) {
+    __atomic_fetch_add(&h->claim_failures, 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+  return h->slots + (size_t)(head & h->mask) * h->slot_size;
+}
+
+uint32_t handoff_commit(handoff_t* h) {
+  uint32_t head = h->head + 1;
+  __atomic_store_n(&h->head, head, __ATOMIC_RELEASE);
+  __atomic_store_n(&h->written, h->written + 1, __ATOMIC_RELAXED);
+  uint32_t depth = head - __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+  if (depth > h->max_depth) {
+    __atomic_store_n(&h->max_depth, depth, __ATOMIC_RELAXED);
+  }
+  return depth;
+}
+
+const void* handoff_peek(handoff_t* h) {
+  uint32_t tail = h->tail;
+  if (__atomic_load_n(&h->head, __ATOMIC_ACQUIRE) == tail) {
+    return NULL;
+  }
+  return h->slots + (size_t)(tail & h->mask) * h->slot_size;
+}
+
+void handoff_release(handoff_t* h) {
+  __atomic_store_n(&h->tail, h->tail + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t handoff_depth(const handoff_t* h) {
+  return __atomic_load_n(&h->head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+}
+
+void handoff_get_stats(const handoff_t* h, handoff_stats_t* out) {
+  uint32_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+  uint32_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+  out->depth = head - tail;
+  out->capacity = h->mask + 1;
+  out->max_depth = __atomic_load_n(&h->max_depth, __ATOMIC_RELAXED);
+  out->written = __atomic_load_n(&h->written, __ATOMIC_RELAXED);
+  out->claim_failures =
+      __atomic_load_n(&h->claim_failures, __ATOMIC_RELAXED);
+}
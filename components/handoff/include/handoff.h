@@ -0,0 +1,115 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Single-producer, single-consumer ring of fixed-size message slots in
+ * caller-provided storage, for handing work from the real-time tasks on
+ * Core 1 to the tasks on Core 0. The producer fills a slot in place and
+ * publishes it with a release store; the consumer reads it in place and
+ * frees it the same way, so neither side copies twice, blocks or takes a
+ * lock. A claim on a full ring fails and is counted; the producer decides
+ * whether the message is lost or retried later. Plain C with no
+ * ESP-IDF dependencies; tools/pipeline_replay runs it on pthreads.
+ */
+
+/**
+ * @brief Ring state; treat as opaque
+ */
+typedef struct {
+  uint8_t* slots;
+  size_t slot_size;
+  uint32_t mask;  ///< Slot count - 1
+  uint32_t head;  ///< Next slot to publish, written by the producer only
+  uint32_t tail;  ///< Next slot to read, written by the consumer only
+  uint32_t written;
+  uint32_t claim_failures;
+  uint32_t max_depth;
+} handoff_t;
+
+/**
+ * @brief Counters since boot
+ */
+typedef struct {
+  uint32_t depth;           ///< Messages waiting now
+  uint32_t capacity;        ///< Slot count
+  uint32_t max_depth;       ///< Deepest the ring has been
+  uint32_t written;         ///< Messages published
+  uint32_t claim_failures;  ///< Claims refused because the ring was full
+} handoff_stats_t;
+
+/**
+ * @brief Set up an empty ring
+ *
+ * @param h Ring
+ * @param storage count * slot_size bytes, aligned for the message type
+ * @param slot_size Size of one message
+ * @param count Slot count, a power of two
+ * @return false when count is not a power of two
+ */
+bool handoff_init(handoff_t* h, void* storage, size_t slot_size,
+                  size_t count);
+
+/**
+ * @brief Slot for the next message (producer)
+ *
+ * The slot is not visible to the consumer until handoff_commit(). Calling
+ * again without committing returns the same slot.
+ *
+ * @param h Ring
+ * @return Slot to fill, NULL when the ring is full (counted as a claim
+ *         failure)
+ */
+void* handoff_claim(handoff_t* h);
+
+/**
+ * @brief Publish the claimed slot (producer)
+ *
+ * @param h Ring
+ * @return Messages waiting, including this one
+ */
+uint32_t handoff_commit(handoff_t* h);
+
+/**
+ * @brief Oldest waiting message (consumer)
+ *
+ * @param h Ring
+ * @return Message, valid until handoff_release(); NULL when empty
+ */
+const void* handoff_peek(handoff_t* h);
+
+/**
+ * @brief Free the message returned by handoff_peek() (consumer)
+ *
+ * @param h Ring
+ */
+void handoff_release(handoff_t* h);
+
+/**
+ * @brief Messages waiting (any task)
+ *
+ * @param h Ring
+ * @return Depth
+ */
+uint32_t handoff_depth(const handoff_t* h);
+
+/**
+ * @brief Read the counters (any task)
+ *
+ * @param h Ring
+ * @param out Counters
+ */
+void handoff_get_stats(const handoff_t* h, handoff_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HANDOFF_H
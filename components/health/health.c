@@ -0,0 +1,142 @@
+#include "health.h"
+
+#include <string.h>
+
+static const char* const s_action_names[HEALTH_ACTION_COUNT] = {
+    "none", "resync", "reinstall UART", "restart WiFi", "reboot",
+};
+
+void health_init(health_t* health) { memset(health, 0, sizeof(*health)); }
+
+int health_add_stage(health_t* health, const health_stage_config_t* config,
+                     int64_t now_us) {
+  if (health->count >= HEALTH_MAX_STAGES || config->step_count == 0 ||
+      config->step_count > HEALTH_MAX_STEPS ||
+      config->depends_on >= (int)health->count) {
+    return -1;
+  }
+  health_stage_t* stage = &health->stages[health->count];
+  memset(stage, 0, sizeof(*stage));
+  stage->config = *config;
+  stage->progress_us = now_us;
+  stage->resumed_us = now_us;
+  return (int)health->count++;
+}
+
+void health_set_timeout(health_t* health, int stage, uint32_t timeout_ms) {
+  health->stages[stage].config.timeout_ms = timeout_ms;
+}
+
+void health_observe(health_t* health, int stage, uint32_t counter,
+                    int64_t now_us) {
+  health_stage_t* s = &health->stages[stage];
+  if (counter == s->counter) {
+    return;
+  }
+  s->counter = counter;
+
+  if (s->stalled_us != 0) {
+    uint32_t outage_ms = (uint32_t)((now_us - s->progress_us) / 1000);
+    s->recoveries++;
+    s->last_outage_ms = outage_ms;
+    if (outage_ms > s->max_outage_ms) {
+      s->max_outage_ms = outage_ms;
+    }
+    s->stalled_us = 0;
+    s->step = 0;
+    s->resumed_us = now_us;
+  } else if (!s->progressed) {
+    s->resumed_us = now_us;
+  }
+  s->progressed = true;
+  s->progress_us = now_us;
+}
+
+// Next step of the ladder and how long it gets before the one after
+static health_action_t next_step(health_stage_t* s) {
+  const health_stage_config_t* c = &s->config;
+  bool repeat = s->step >= c->step_count;
+  uint8_t step = repeat ? c->step_count - 1 : s->step;
+
+  // Rebooting cannot bring back something that never worked this boot
+  if (c->steps[step] == HEALTH_ACTION_REBOOT && !s->progressed && step > 0) {
+    step--;
+    repeat = true;
+  }
+
+  if (repeat) {
+    uint32_t wait_ms = s->wait_ms * 2;
+    s->wait_ms = wait_ms > HEALTH_REPEAT_MAX_MS ? HEALTH_REPEAT_MAX_MS
+                                                : wait_ms;
+    if (s->wait_ms < c->step_ms[step]) {
+      s->wait_ms = c->step_ms[step];
+    }
+  } else {
+    s->wait_ms = c->step_ms[step];
+  }
+  if (s->step < c->step_count) {
+    s->step++;
+  }
+  return c->steps[step];
+}
+
+// The stage this one depends on is without progress itself
+static bool upstream_stalled(const health_t* health, const health_stage_t* s,
+                             int64_t now_us) {
+  if (s->config.depends_on < 0) {
+    return false;
+  }
+  const health_stage_t* up = &health->stages[s->config.depends_on];
+  return up->stalled_us != 0 ||
+         now_us - up->progress_us >= (int64_t)up->config.timeout_ms * 1000;
+}
+
+health_action_t health_check(health_t* health, int64_t now_us, int* stage) {
+  for (size_t i = 0; i < health->count; i++) {
+    health_stage_t* s = &health->stages[i];
+    if (upstream_stalled(health, s, now_us)) {
+      continue;
+    }
+
+    // A stage downstream of one that just recovered gets a full timeout
+    int64_t since = s->progress_us;
+    if (s->config.depends_on >= 0) {
+      int64_t resumed = health->stages[s->config.depends_on].resumed_us;
+      if (resumed > since) {
+        since = resumed;
+      }
+    }
+    if (now_us - since < (int64_t)s->config.timeout_ms * 1000) {
+      continue;
+    }
+
+    if (s->stalled_us == 0) {
+      s->stalled_us = now_us;
+      s->next_step_us = now_us;
+      s->step = 0;
+      s->wait_ms = 0;
+      s->stalls++;
+    }
+    if (now_us < s->next_step_us) {
+      continue;
+    }
+
+    health_action_t action = next_step(s);
+    s->next_step_us = now_us + (int64_t)s->wait_ms * 1000;
+    s->last_action = action;
+    s->actions[action]++;
+    if (stage) {
+      *stage = (int)i;
+    }
+    return action;
+  }
+  return HEALTH_ACTION_NONE;
+}
+
+bool health_stalled(const health_t* health, int stage) {
+  return health->stages[stage].stalled_us != 0;
+}
+
+const char* health_action_name(health_action_t action) {
+  return action < HEALTH_ACTION_COUNT ? s_action_names[action] : "?";
+}
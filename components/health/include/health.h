@@ -0,0 +1,158 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+// Stall detection and staged recovery for the radar-to-relay pipeline.
+// Every stage publishes a counter that moves while it makes progress; a
+// stage whose counter stands still for its timeout is stalled, and each
+// check then hands out its recovery steps one at a time, cheapest first.
+// Plain C with no ESP-IDF dependencies; tools/recovery_sim injects faults
+// on the host and measures the recovery time of each.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEALTH_MAX_STAGES 8
+#define HEALTH_MAX_STEPS 4
+#define HEALTH_REPEAT_MAX_MS 60000  ///< Longest wait between repeated steps
+
+/**
+ * @brief Recovery steps, cheapest first
+ */
+typedef enum {
+  HEALTH_ACTION_NONE,
+  HEALTH_ACTION_RESYNC,        ///< Drop buffered bytes and frame sync
+  HEALTH_ACTION_REINSTALL,     ///< Delete and reinstall the UART driver
+  HEALTH_ACTION_RESTART_WIFI,  ///< Stop the WiFi driver, uploader reconnects
+  HEALTH_ACTION_REBOOT,        ///< Restart the chip
+  HEALTH_ACTION_COUNT,
+} health_action_t;
+
+/**
+ * @brief What a stage is expected to do and how to recover it
+ */
+typedef struct {
+  const char* name;
+  uint32_t timeout_ms;  ///< Without progress for this long is a stall
+  int8_t depends_on;    ///< Stage whose stall also stops this one, -1 none
+  uint8_t step_count;
+  health_action_t steps[HEALTH_MAX_STEPS];
+  uint32_t step_ms[HEALTH_MAX_STEPS];  ///< Time each step gets to work
+} health_stage_config_t;
+
+/**
+ * @brief Stage state and recovery record
+ */
+typedef struct {
+  health_stage_config_t config;
+  uint32_t counter;      ///< Last counter value seen
+  int64_t progress_us;   ///< When the counter last moved
+  int64_t resumed_us;    ///< First progress after boot or a stall
+  int64_t stalled_us;    ///< When the stall was seen, 0 while healthy
+  int64_t next_step_us;  ///< Next step is due
+  uint32_t wait_ms;      ///< Wait after the last step handed out
+  uint8_t step;          ///< Next step of the ladder
+  bool progressed;       ///< Counter has moved since init
+  health_action_t last_action;
+  uint32_t stalls;                        ///< Stalls since init
+  uint32_t recoveries;                    ///< Stalls that ended in progress
+  uint32_t actions[HEALTH_ACTION_COUNT];  ///< Steps handed out, per action
+  uint32_t last_outage_ms;                ///< Last progress to progress again
+  uint32_t max_outage_ms;
+} health_stage_t;
+
+/**
+ * @brief Supervisor; keep it static
+ */
+typedef struct {
+  health_stage_t stages[HEALTH_MAX_STAGES];
+  size_t count;
+} health_t;
+
+/**
+ * @brief Start with no stages
+ *
+ * @param health Supervisor
+ */
+void health_init(health_t* health);
+
+/**
+ * @brief Add a stage; its timeout starts now
+ *
+ * A stage that depends on another must be added after it. When every step
+ * has been handed out, the last one repeats with a doubling wait (up to
+ * HEALTH_REPEAT_MAX_MS). A reboot is never handed out for a stage that has
+ * not progressed since init, so a missing module does not cause a reboot
+ * loop; the step before it repeats instead.
+ *
+ * @param health Supervisor
+ * @param config Timeout and recovery ladder, copied
+ * @param now_us Current time
+ * @return Stage index, -1 when full or the ladder is empty
+ */
+int health_add_stage(health_t* health, const health_stage_config_t* config,
+                     int64_t now_us);
+
+/**
+ * @brief Change the timeout of a stage, for example with its loop period
+ *
+ * @param health Supervisor
+ * @param stage Stage index
+ * @param timeout_ms New timeout
+ */
+void health_set_timeout(health_t* health, int stage, uint32_t timeout_ms);
+
+/**
+ * @brief Report a stage's progress counter
+ *
+ * A different value from last time is progress. Progress ends a stall and
+ * records how long the stage was without it.
+ *
+ * @param health Supervisor
+ * @param stage Stage index
+ * @param counter Counter that moves while the stage works
+ * @param now_us Current time
+ */
+void health_observe(health_t* health, int stage, uint32_t counter,
+                    int64_t now_us);
+
+/**
+ * @brief Hand out the next recovery step that is due
+ *
+ * Call until it returns HEALTH_ACTION_NONE. A stage is left alone while the
+ * stage it depends on is stalled, and its timeout restarts when that one
+ * recovers.
+ *
+ * @param health Supervisor
+ * @param now_us Current time
+ * @param stage Set to the stalled stage, may be NULL
+ * @return Step to carry out, HEALTH_ACTION_NONE when nothing is due
+ */
+health_action_t health_check(health_t* health, int64_t now_us, int* stage);
+
+/**
+ * @brief Whether a stage is currently stalled
+ *
+ * @param health Supervisor
+ * @param stage Stage index
+ * @return true between a stall and the next progress
+ */
+bool health_stalled(const health_t* health, int stage);
+
+/**
+ * @brief Short name of a recovery step, for logs
+ *
+ * @param action Step
+ * @return Static string
+ */
+const char* health_action_name(health_action_t action);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HEALTH_H
@@ -0,0 +1,121 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size-class block pool reserved once in .bss. The allocator core has no
+ * ESP-IDF dependencies so the host soak harness (tools/soak) can drive it;
+ * off target it is always enabled.
+ */
+#if CONFIG_MEM_POOL_ENABLE || !defined(ESP_PLATFORM)
+#define MEM_POOL_ACTIVE 1
+#else
+#define MEM_POOL_ACTIVE 0
+#endif
+
+#define MEM_POOL_CLASS_COUNT 6
+#define MEM_POOL_MAX_WATCHED_TASKS 8
+
+/**
+ * @brief Usage of one size class
+ */
+typedef struct {
+  uint32_t block_size;
+  uint32_t blocks;
+  uint32_t in_use;
+  uint32_t high_water;
+  uint32_t allocs;  ///< Successful allocations since boot
+} mem_pool_class_stats_t;
+
+/**
+ * @brief Pool usage snapshot
+ */
+typedef struct {
+  mem_pool_class_stats_t classes[MEM_POOL_CLASS_COUNT];
+  uint32_t fallback_allocs;  ///< Requests served by the heap (too large or
+                             ///< class exhausted)
+} mem_pool_stats_t;
+
+#if MEM_POOL_ACTIVE
+
+/**
+ * @brief Allocate zeroed memory from the smallest class that fits, falling
+ *        back to the heap when the class and all larger ones are exhausted
+ *
+ * @param n Number of elements
+ * @param size Element size
+ * @return Pointer to zeroed memory, NULL on failure
+ */
+void* mem_pool_calloc(size_t n, size_t size);
+
+/**
+ * @brief Return memory obtained from mem_pool_calloc()
+ *
+ * @param ptr Block to release (NULL is ignored)
+ */
+void mem_pool_free(void* ptr);
+
+/**
+ * @brief Copy the pool usage counters
+ *
+ * @param out Destination snapshot
+ */
+void mem_pool_get_stats(mem_pool_stats_t* out);
+
+#endif  // MEM_POOL_ACTIVE
+
+#if CONFIG_MEM_POOL_ENABLE
+
+/**
+ * @brief Count heap allocations made by a task from now on
+ *
+ * @param task Task to watch
+ * @return true if a slot was free
+ */
+bool mem_pool_watch_task(TaskHandle_t task);
+
+/**
+ * @brief Heap allocations made by a watched task since it was registered
+ *
+ * @param task Watched task
+ * @return Allocation count (0 for tasks that are not watched)
+ */
+uint32_t mem_pool_task_allocs(TaskHandle_t task);
+
+/**
+ * @brief Log per-class pool usage and the heap fallback count
+ */
+void mem_pool_log_summary(void);
+
+#elif defined(ESP_PLATFORM)
+
+static inline bool mem_pool_watch_task(TaskHandle_t task) {
+  (void)task;
+  return false;
+}
+static inline uint32_t mem_pool_task_allocs(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+static inline void mem_pool_log_summary(void) {}
+
+#endif  // CONFIG_MEM_POOL_ENABLE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MEM_POOL_H
@@ -0,0 +1,249 @@
+#include "mem_pool.h"
+
+#if MEM_POOL_ACTIVE
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <inttypes.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char* TAG = "MEM_POOL";
+
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+#define POOL_LOCK() portENTER_CRITICAL_SAFE(&s_pool_lock)
+#define POOL_UNLOCK() portEXIT_CRITICAL_SAFE(&s_pool_lock)
+#define FALLBACK_CALLOC(n, size) heap_caps_calloc((n), (size), MALLOC_CAP_DEFAULT)
+#else
+// Host build (soak harness): single threaded
+#define POOL_LOCK()
+#define POOL_UNLOCK()
+#define FALLBACK_CALLOC(n, size) calloc((n), (size))
+#endif
+
+#ifndef CONFIG_MEM_POOL_LARGE_BLOCKS
+#define CONFIG_MEM_POOL_LARGE_BLOCKS 1
+#endif
+
+/*
+ * Classes sized for an mbedTLS client handshake against the Apps Script
+ * endpoints: many small MPI/ASN.1 allocations, SSL contexts and parsed
+ * certificates in the middle, one 4 KB output and one 16 KB input record
+ * buffer per connection.
+ */
+#define CLASS_0_SIZE 32
+#define CLASS_0_COUNT 128
+#define CLASS_1_SIZE 128
+#define CLASS_1_COUNT 96
+#define CLASS_2_SIZE 512
+#define CLASS_2_COUNT 48
+#define CLASS_3_SIZE 2048
+#define CLASS_3_COUNT 12
+#define CLASS_4_SIZE 5120
+#define CLASS_4_COUNT 2
+#define CLASS_5_SIZE 17408
+#define CLASS_5_COUNT CONFIG_MEM_POOL_LARGE_BLOCKS
+
+#define ARENA_SIZE                                                   \
+  (CLASS_0_SIZE * CLASS_0_COUNT + CLASS_1_SIZE * CLASS_1_COUNT +     \
+   CLASS_2_SIZE * CLASS_2_COUNT + CLASS_3_SIZE * CLASS_3_COUNT +     \
+   CLASS_4_SIZE * CLASS_4_COUNT + CLASS_5_SIZE * CLASS_5_COUNT)
+
+typedef struct free_block {
+  struct free_block* next;
+} free_block_t;
+
+typedef struct {
+  uint32_t size;
+  uint32_t count;
+  uint8_t* start;
+  uint8_t* end;
+  free_block_t* free_list;
+} pool_class_t;
+
+static uint8_t s_arena[ARENA_SIZE] __attribute__((aligned(16)));
+
+static pool_class_t s_classes[MEM_POOL_CLASS_COUNT] = {
+    {.size = CLASS_0_SIZE, .count = CLASS_0_COUNT},
+    {.size = CLASS_1_SIZE, .count = CLASS_1_COUNT},
+    {.size = CLASS_2_SIZE, .count = CLASS_2_COUNT},
+    {.size = CLASS_3_SIZE, .count = CLASS_3_COUNT},
+    {.size = CLASS_4_SIZE, .count = CLASS_4_COUNT},
+    {.size = CLASS_5_SIZE, .count = CLASS_5_COUNT},
+};
+
+static mem_pool_stats_t s_stats;
+static bool s_initialized;
+
+// Carve the arena into free lists. Runs on first use because mbedTLS may
+// allocate before app_main gets a chance to call anything.
+static void pool_init_locked(void) {
+  uint8_t* cursor = s_arena;
+
+  for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+    pool_class_t* cls = &s_classes[c];
+    cls->start = cursor;
+    cls->free_list = NULL;
+    for (uint32_t i = cls->count; i > 0; i--) {
+      free_block_t* block = (free_block_t*)(cursor + (i - 1) * cls->size);
+      block->next = cls->free_list;
+      cls->free_list = block;
+    }
+    cursor += cls->size * cls->count;
+    cls->end = cursor;
+
+    s_stats.classes[c].block_size = cls->size;
+    s_stats.classes[c].blocks = cls->count;
+  }
+  s_initialized = true;
+}
+
+void* mem_pool_calloc(size_t n, size_t size) {
+  if (n != 0 && size > SIZE_MAX / n) {
+    return NULL;
+  }
+  size_t bytes = n * size;
+  void* block = NULL;
+
+  POOL_LOCK();
+  if (!s_initialized) {
+    pool_init_locked();
+  }
+  // Smallest class that fits; a larger class stands in when it runs dry
+  for (int c = 0; c < MEM_POOL_CLASS_COUNT && !block; c++) {
+    pool_class_t* cls = &s_classes[c];
+    if (bytes > cls->size || !cls->free_list) {
+      continue;
+    }
+    block = cls->free_list;
+    cls->free_list = cls->free_list->next;
+
+    mem_pool_class_stats_t* stats = &s_stats.classes[c];
+    stats->allocs++;
+    if (++stats->in_use > stats->high_water) {
+      stats->high_water = stats->in_use;
+    }
+  }
+  if (!block) {
+    s_stats.fallback_allocs++;
+  }
+  POOL_UNLOCK();
+
+  if (!block) {
+    return FALLBACK_CALLOC(n, size);
+  }
+  memset(block, 0, bytes);
+  return block;
+}
+
+void mem_pool_free(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  uint8_t* p = (uint8_t*)ptr;
+  if (p < s_arena || p >= s_arena + ARENA_SIZE) {
+    free(ptr);
+    return;
+  }
+
+  POOL_LOCK();
+  for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+    pool_class_t* cls = &s_classes[c];
+    if (p >= cls->start && p < cls->end) {
+      free_block_t* block = (free_block_t*)ptr;
+      block->next = cls->free_list;
+      cls->free_list = block;
+      s_stats.classes[c].in_use--;
+      break;
+    }
+  }
+  POOL_UNLOCK();
+}
+
+void mem_pool_get_stats(mem_pool_stats_t* out) {
+  if (!out) {
+    return;
+  }
+  POOL_LOCK();
+  if (!s_initialized) {
+    pool_init_locked();
+  }
+  memcpy(out, &s_stats, sizeof(*out));
+  POOL_UNLOCK();
+}
+
+#endif  // MEM_POOL_ACTIVE
+
+#if CONFIG_MEM_POOL_ENABLE
+
+// mbedTLS custom allocator (CONFIG_MBEDTLS_CUSTOM_MEM_ALLOC)
+void* esp_mbedtls_mem_calloc(size_t n, size_t size) {
+  return mem_pool_calloc(n, size);
+}
+
+void esp_mbedtls_mem_free(void* ptr) { mem_pool_free(ptr); }
+
+// Heap allocation counters per watched task (CONFIG_HEAP_USE_HOOKS)
+static TaskHandle_t s_watched[MEM_POOL_MAX_WATCHED_TASKS];
+static uint32_t s_watched_allocs[MEM_POOL_MAX_WATCHED_TASKS];
+
+IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size,
+                                         uint32_t caps) {
+  (void)ptr;
+  (void)size;
+  (void)caps;
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < MEM_POOL_MAX_WATCHED_TASKS; i++) {
+    if (s_watched[i] == task && task) {
+      __atomic_fetch_add(&s_watched_allocs[i], 1, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+}
+
+IRAM_ATTR void esp_heap_trace_free_hook(void* ptr) { (void)ptr; }
+
+bool mem_pool_watch_task(TaskHandle_t task) {
+  bool added = false;
+  POOL_LOCK();
+  for (int i = 0; i < MEM_POOL_MAX_WATCHED_TASKS && task; i++) {
+    if (!s_watched[i]) {
+      s_watched_allocs[i] = 0;
+      s_watched[i] = task;
+      added = true;
+      break;
+    }
+  }
+  POOL_UNLOCK();
+  return added;
+}
+
+uint32_t mem_pool_task_allocs(TaskHandle_t task) {
+  for (int i = 0; i < MEM_POOL_MAX_WATCHED_TASKS; i++) {
+    if (s_watched[i] == task && task) {
+      return __atomic_load_n(&s_watched_allocs[i], __ATOMIC_RELAXED);
+    }
+  }
+  return 0;
+}
+
+void mem_pool_log_summary(void) {
+  mem_pool_stats_t stats;
+  mem_pool_get_stats(&stats);
+
+  for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+    const mem_pool_class_stats_t* cls = &stats.classes[c];
+    ESP_LOGI(TAG,
+             "%5" PRIu32 " B x %3" PRIu32 ": in use %" PRIu32 ", peak %" PRIu32
+             ", allocs %" PRIu32,
+             cls->block_size, cls->blocks, cls->in_use, cls->high_water,
+             cls->allocs);
+  }
+  ESP_LOGI(TAG, "Heap fallbacks: %" PRIu32, stats.fallback_allocs);
+}
+
+#endif  // CONFIG_MEM_POOL_ENABLE
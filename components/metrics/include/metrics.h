@@ -0,0 +1,165 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#if CONFIG_METRICS_ENABLE
+#include "esp_timer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Latency histograms kept by the metrics subsystem (microseconds)
+ */
+typedef enum {
+  METRICS_HIST_FRAME_PARSE = 0,  ///< Decoding one radar frame
+  METRICS_HIST_FRAME_TO_RELAY,   ///< Frame complete -> relay GPIO written
+  METRICS_HIST_QUEUE_RESIDENCY,  ///< Status queued -> dequeued by uploader
+  METRICS_HIST_HTTP_CONNECT,     ///< Request start -> TCP/TLS connected
+  METRICS_HIST_HTTP_SEND,        ///< Connected -> request headers sent
+  METRICS_HIST_HTTP_RESPONSE,    ///< Headers sent -> first response header
+  METRICS_HIST_HTTP_TOTAL,       ///< Whole upload round trip
+  METRICS_HIST_SENSOR_LOOP,      ///< Busy time of one sensor task iteration
+  METRICS_HIST_FUSION,           ///< Merging all sensors after one frame
+  METRICS_HIST_RADAR_CMD,        ///< Radar command frame sent -> ACK parsed
+  METRICS_HIST_HEATMAP,          ///< Heatmap decay or snapshot (whole grid)
+  METRICS_HIST_APPROACH_LEAD,    ///< Predictive switch-on -> presence
+  METRICS_HIST_BROADCAST,        ///< Relay or presence change -> packet sent
+  METRICS_HIST_HANDOFF,          ///< Core 1 message posted -> Core 0 pickup
+  METRICS_HIST_AGGREGATE,        ///< Core 0 work for one handed-off message
+  METRICS_HIST_COUNT
+} metrics_hist_id_t;
+
+/**
+ * @brief Trace events recorded in the per-core trace ring
+ */
+typedef enum {
+  METRICS_EVT_FRAME_PARSED = 1,
+  METRICS_EVT_RELAY_SET,
+  METRICS_EVT_STATUS_QUEUED,
+  METRICS_EVT_STATUS_DEQUEUED,
+  METRICS_EVT_HTTP_START,
+  METRICS_EVT_HTTP_CONNECTED,
+  METRICS_EVT_HTTP_HEADERS_SENT,
+  METRICS_EVT_HTTP_RESPONSE,
+  METRICS_EVT_HTTP_DONE,
+} metrics_event_t;
+
+/*
+ * Log-linear bucketing: values below 2^METRICS_HIST_SUB_BITS get one bucket
+ * each, every power of two above that is split into 2^METRICS_HIST_SUB_BITS
+ * linear sub-buckets. Values at or above 2^METRICS_HIST_MAX_EXP (~67 s) land
+ * in the last bucket.
+ */
+#define METRICS_HIST_SUB_BITS 2
+#define METRICS_HIST_MAX_EXP 26
+#define METRICS_HIST_BUCKETS \
+  ((METRICS_HIST_MAX_EXP - METRICS_HIST_SUB_BITS + 1) << METRICS_HIST_SUB_BITS)
+
+/**
+ * @brief Point-in-time copy of one histogram
+ */
+typedef struct {
+  uint32_t buckets[METRICS_HIST_BUCKETS];
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t sum_us;
+} metrics_hist_snapshot_t;
+
+#if CONFIG_METRICS_ENABLE
+
+/**
+ * @brief Record one sample into a histogram (lock-free on the caller side
+ *        apart from a short critical section, no allocation)
+ *
+ * @param id Histogram to update
+ * @param value_us Sample in microseconds
+ */
+void metrics_hist_record(metrics_hist_id_t id, uint32_t value_us);
+
+/**
+ * @brief Append an event to the calling core's trace ring
+ *
+ * @param event Event identifier
+ * @param arg Event-specific 16-bit argument
+ */
+void metrics_trace(metrics_event_t event, uint16_t arg);
+
+/**
+ * @brief Copy a histogram into caller-provided storage
+ *
+ * @param id Histogram to copy
+ * @param out Destination snapshot
+ */
+void metrics_hist_snapshot(metrics_hist_id_t id, metrics_hist_snapshot_t* out);
+
+/**
+ * @brief Estimate a percentile from a snapshot
+ *
+ * @param snap Snapshot to inspect
+ * @param percentile Percentile in the range 0-100
+ * @return Upper bound of the bucket holding the percentile, in microseconds
+ */
+uint32_t metrics_hist_percentile(const metrics_hist_snapshot_t* snap,
+                                 uint32_t percentile);
+
+/**
+ * @brief Log a one-line summary (count, p50, p99, max) for every histogram
+ */
+void metrics_log_summary(void);
+
+/**
+ * @brief Print all histograms bucket by bucket and both trace rings
+ */
+void metrics_dump(void);
+
+/**
+ * @brief Clear all histograms and trace rings
+ */
+void metrics_reset(void);
+
+/**
+ * @brief Register the "metrics" console command
+ */
+void metrics_register_console_cmd(void);
+
+#define METRICS_NOW_US() esp_timer_get_time()
+#define METRICS_HIST_RECORD(id, value_us) \
+  metrics_hist_record((id), (uint32_t)(value_us))
+#define METRICS_HIST_SINCE(id, start_us) \
+  metrics_hist_record((id), (uint32_t)(esp_timer_get_time() - (start_us)))
+#define METRICS_TRACE(event, arg) metrics_trace((event), (uint16_t)(arg))
+
+#else  // !CONFIG_METRICS_ENABLE
+
+static inline void metrics_log_summary(void) {}
+static inline void metrics_dump(void) {}
+static inline void metrics_reset(void) {}
+static inline void metrics_register_console_cmd(void) {}
+
+#define METRICS_NOW_US() ((int64_t)0)
+#define METRICS_HIST_RECORD(id, value_us) \
+  do {                                    \
+    (void)(value_us);                     \
+  } while (0)
+#define METRICS_HIST_SINCE(id, start_us) \
+  do {                                   \
+    (void)(start_us);                    \
+  } while (0)
+#define METRICS_TRACE(event, arg) \
+  do {                            \
+  } while (0)
+
+#endif  // CONFIG_METRICS_ENABLE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // METRICS_H
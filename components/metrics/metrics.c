@@ -0,0 +1,247 @@
+#include "metrics.h"
+
+#if CONFIG_METRICS_ENABLE
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_console.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char* TAG = "METRICS";
+
+#define TRACE_RING_SIZE CONFIG_METRICS_TRACE_RING_SIZE
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+_Static_assert((TRACE_RING_SIZE & TRACE_RING_MASK) == 0,
+               "CONFIG_METRICS_TRACE_RING_SIZE must be a power of two");
+
+typedef struct {
+  uint32_t cycles;
+  uint16_t event;
+  uint16_t arg;
+} trace_record_t;
+
+static const char* const s_hist_names[METRICS_HIST_COUNT] = {
+    [METRICS_HIST_FRAME_PARSE] = "frame_parse",
+    [METRICS_HIST_FRAME_TO_RELAY] = "frame_to_relay",
+    [METRICS_HIST_QUEUE_RESIDENCY] = "queue_residency",
+    [METRICS_HIST_HTTP_CONNECT] = "http_connect",
+    [METRICS_HIST_HTTP_SEND] = "http_send",
+    [METRICS_HIST_HTTP_RESPONSE] = "http_response",
+    [METRICS_HIST_HTTP_TOTAL] = "http_total",
+    [METRICS_HIST_SENSOR_LOOP] = "sensor_loop",
+    [METRICS_HIST_FUSION] = "fusion",
+    [METRICS_HIST_RADAR_CMD] = "radar_cmd",
+    [METRICS_HIST_HEATMAP] = "heatmap",
+    [METRICS_HIST_APPROACH_LEAD] = "approach_lead",
+    [METRICS_HIST_BROADCAST] = "broadcast",
+    [METRICS_HIST_HANDOFF] = "handoff",
+    [METRICS_HIST_AGGREGATE] = "aggregate",
+};
+
+static metrics_hist_snapshot_t s_hists[METRICS_HIST_COUNT];
+static portMUX_TYPE s_hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static trace_record_t s_trace[portNUM_PROCESSORS][TRACE_RING_SIZE];
+static uint32_t s_trace_head[portNUM_PROCESSORS];
+
+static inline uint32_t bucket_index(uint32_t value) {
+  if (value < (1u << METRICS_HIST_SUB_BITS)) {
+    return value;
+  }
+  uint32_t exp = 31 - __builtin_clz(value);
+  if (exp >= METRICS_HIST_MAX_EXP) {
+    return METRICS_HIST_BUCKETS - 1;
+  }
+  uint32_t sub = (value >> (exp - METRICS_HIST_SUB_BITS)) &
+                 ((1u << METRICS_HIST_SUB_BITS) - 1);
+  return ((exp - METRICS_HIST_SUB_BITS + 1) << METRICS_HIST_SUB_BITS) + sub;
+}
+
+// Largest value that maps into the given bucket
+static uint32_t bucket_upper_bound(uint32_t index) {
+  if (index < (1u << METRICS_HIST_SUB_BITS)) {
+    return index;
+  }
+  uint32_t exp = (index >> METRICS_HIST_SUB_BITS) + METRICS_HIST_SUB_BITS - 1;
+  uint32_t sub = index & ((1u << METRICS_HIST_SUB_BITS) - 1);
+  return (((1u << METRICS_HIST_SUB_BITS) + sub + 1)
+          << (exp - METRICS_HIST_SUB_BITS)) -
+         1;
+}
+
+void metrics_hist_record(metrics_hist_id_t id, uint32_t value_us) {
+  if (id >= METRICS_HIST_COUNT) {
+    return;
+  }
+
+  uint32_t index = bucket_index(value_us);
+  metrics_hist_snapshot_t* hist = &s_hists[id];
+
+  portENTER_CRITICAL_SAFE(&s_hist_lock);
+  hist->buckets[index]++;
+  if (hist->count == 0 || value_us < hist->min_us) {
+    hist->min_us = value_us;
+  }
+  if (value_us > hist->max_us) {
+    hist->max_us = value_us;
+  }
+  hist->count++;
+  hist->sum_us += value_us;
+  portEXIT_CRITICAL_SAFE(&s_hist_lock);
+}
+
+void metrics_trace(metrics_event_t event, uint16_t arg) {
+  int core = xPortGetCoreID();
+  // Slots are reserved atomically so a preempting task on the same core
+  // never overwrites a record that is half written.
+  uint32_t slot =
+      __atomic_fetch_add(&s_trace_head[core], 1, __ATOMIC_RELAXED) &
+      TRACE_RING_MASK;
+  trace_record_t* rec = &s_trace[core][slot];
+  rec->cycles = esp_cpu_get_cycle_count();
+  rec->event = (uint16_t)event;
+  rec->arg = arg;
+}
+
+void metrics_hist_snapshot(metrics_hist_id_t id, metrics_hist_snapshot_t* out) {
+  if (id >= METRICS_HIST_COUNT || !out) {
+    return;
+  }
+  portENTER_CRITICAL(&s_hist_lock);
+  memcpy(out, &s_hists[id], sizeof(*out));
+  portEXIT_CRITICAL(&s_hist_lock);
+}
+
+uint32_t metrics_hist_percentile(const metrics_hist_snapshot_t* snap,
+                                 uint32_t percentile) {
+  if (!snap || snap->count == 0) {
+    return 0;
+  }
+  if (percentile > 100) {
+    percentile = 100;
+  }
+
+  uint64_t target = ((uint64_t)snap->count * percentile + 99) / 100;
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+    seen += snap->buckets[i];
+    if (seen >= target) {
+      uint32_t upper = bucket_upper_bound(i);
+      return upper < snap->max_us ? upper : snap->max_us;
+    }
+  }
+  return snap->max_us;
+}
+
+void metrics_log_summary(void) {
+  // Static to keep the 400-byte snapshot off the monitor task's stack
+  static metrics_hist_snapshot_t snap;
+
+  for (int id = 0; id < METRICS_HIST_COUNT; id++) {
+    metrics_hist_snapshot((metrics_hist_id_t)id, &snap);
+    if (snap.count == 0) {
+      continue;
+    }
+    ESP_LOGI(TAG,
+             "%-16s n=%" PRIu32 " mean=%" PRIu32 "us p50=%" PRIu32
+             "us p99=%" PRIu32 "us max=%" PRIu32 "us",
+             s_hist_names[id], snap.count, (uint32_t)(snap.sum_us / snap.count),
+             metrics_hist_percentile(&snap, 50),
+             metrics_hist_percentile(&snap, 99), snap.max_us);
+  }
+}
+
+static void dump_histograms(void) {
+  static metrics_hist_snapshot_t snap;
+
+  for (int id = 0; id < METRICS_HIST_COUNT; id++) {
+    metrics_hist_snapshot((metrics_hist_id_t)id, &snap);
+    printf("%s: n=%" PRIu32 " min=%" PRIu32 "us max=%" PRIu32 "us\n",
+           s_hist_names[id], snap.count, snap.count ? snap.min_us : 0,
+           snap.max_us);
+    for (uint32_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+      if (snap.buckets[i]) {
+        printf("  <=%" PRIu32 "us: %" PRIu32 "\n", bucket_upper_bound(i),
+               snap.buckets[i]);
+      }
+    }
+  }
+}
+
+static void dump_trace(void) {
+  uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    uint32_t head = __atomic_load_n(&s_trace_head[core], __ATOMIC_RELAXED);
+    uint32_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    uint32_t prev_cycles = 0;
+
+    printf("trace core %d: %" PRIu32 " events (%" PRIu32 " shown)\n", core,
+           head, head - start);
+    for (uint32_t i = start; i < head; i++) {
+      const trace_record_t* rec = &s_trace[core][i & TRACE_RING_MASK];
+      uint32_t delta = (i == start) ? 0 : rec->cycles - prev_cycles;
+      printf("  %10" PRIu32 " +%8" PRIu32 "us evt=%u arg=%u\n", rec->cycles,
+             delta / ticks_per_us, rec->event, rec->arg);
+      prev_cycles = rec->cycles;
+    }
+  }
+}
+
+void metrics_dump(void) {
+  dump_histograms();
+  dump_trace();
+}
+
+void metrics_reset(void) {
+  portENTER_CRITICAL(&s_hist_lock);
+  memset(s_hists, 0, sizeof(s_hists));
+  portEXIT_CRITICAL(&s_hist_lock);
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    __atomic_store_n(&s_trace_head[core], 0, __ATOMIC_RELAXED);
+  }
+}
+
+static int cmd_metrics(int argc, char** argv) {
+  if (argc < 2) {
+    dump_histograms();
+    return 0;
+  }
+
+  if (strcmp(argv[1], "trace") == 0) {
+    dump_trace();
+  } else if (strcmp(argv[1], "all") == 0) {
+    metrics_dump();
+  } else if (strcmp(argv[1], "reset") == 0) {
+    metrics_reset();
+    printf("metrics cleared\n");
+  } else {
+    printf("usage: metrics [trace|all|reset]\n");
+    return 1;
+  }
+  return 0;
+}
+
+void metrics_register_console_cmd(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "metrics",
+      .help = "Dump latency histograms; 'trace' dumps the per-core trace "
+              "rings, 'all' both, 'reset' clears them",
+      .hint = "[trace|all|reset]",
+      .func = &cmd_metrics,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+#endif  // CONFIG_METRICS_ENABLE
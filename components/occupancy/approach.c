@@ -0,0 +1,165 @@
+#include "approach.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Fastest plausible walk; bounds how far a target can move between frames
+#define MAX_WALK_MM_S 3000.0f
+// Association slack for position noise
+#define MATCH_SLACK_MM 300.0f
+// Frames closer together than this (two radars reporting back to back) are
+// too short to difference; the older sample is kept
+#define MIN_VELOCITY_DT_US 50000
+// Tracks not seen for this long are dropped
+#define TRACK_TIMEOUT_US 1000000
+
+void approach_init(approach_t* approach, const approach_entry_t* entries,
+                   size_t count, uint32_t min_speed_cm_s,
+                   uint8_t confirm_frames) {
+  if (!approach) {
+    return;
+  }
+  memset(approach, 0, sizeof(*approach));
+  if (count > APPROACH_MAX_ENTRIES) {
+    count = APPROACH_MAX_ENTRIES;
+  }
+  for (size_t e = 0; e < count && entries; e++) {
+    approach->entries[e] = entries[e];
+    // Same convention as radar_mount_apply: +Y rotated counter-clockwise
+    float rad = entries[e].heading_deg * (float)(M_PI / 180.0);
+    approach->heading_x[e] = -sinf(rad);
+    approach->heading_y[e] = cosf(rad);
+  }
+  approach->entry_count = entries ? count : 0;
+  approach->min_speed_mm_s = (float)min_speed_cm_s * 10.0f;
+  approach->confirm_frames = confirm_frames ? confirm_frames : 1;
+}
+
+// Nearest previous track within reach of the target, or -1
+static int match_track(const approach_t* approach, const bool* taken,
+                       const radar_fused_target_t* target, int64_t now_us) {
+  int best = -1;
+  float best_sq = 0.0f;
+  for (size_t t = 0; t < approach->track_count; t++) {
+    const approach_track_t* track = &approach->tracks[t];
+    if (taken[t]) {
+      continue;
+    }
+    float reach = MAX_WALK_MM_S * (float)(now_us - track->seen_us) / 1e6f +
+                  MATCH_SLACK_MM;
+    float dx = target->x - track->x;
+    float dy = target->y - track->y;
+    float dist_sq = dx * dx + dy * dy;
+    if (dist_sq <= reach * reach && (best < 0 || dist_sq < best_sq)) {
+      best = (int)t;
+      best_sq = dist_sq;
+    }
+  }
+  return best;
+}
+
+uint8_t approach_update(approach_t* approach,
+                        const radar_fused_target_t* targets, size_t count,
+                        int64_t now_us) {
+  if (!approach || approach->entry_count == 0) {
+    return 0;
+  }
+  if (!targets) {
+    count = 0;
+  }
+  if (count > RADAR_FUSION_MAX_TARGETS) {
+    count = RADAR_FUSION_MAX_TARGETS;
+  }
+
+  approach_track_t next[RADAR_FUSION_MAX_TARGETS];
+  size_t next_count = 0;
+  bool taken[RADAR_FUSION_MAX_TARGETS] = {false};
+  uint8_t mask = 0;
+  uint8_t entry_mask = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    const radar_fused_target_t* target = &targets[i];
+    approach_track_t* track = &next[next_count++];
+    int prev = match_track(approach, taken, target, now_us);
+
+    if (prev < 0) {
+      // New target: position only until the next frame
+      memset(track, 0, sizeof(*track));
+      track->x = target->x;
+      track->y = target->y;
+      track->seen_us = now_us;
+      continue;
+    }
+
+    taken[prev] = true;
+    *track = approach->tracks[prev];
+    int64_t dt_us = now_us - track->seen_us;
+    if (dt_us < MIN_VELOCITY_DT_US) {
+      for (size_t e = 0; e < approach->entry_count; e++) {
+        if (track->streak[e] >= approach->confirm_frames) {
+          mask |= approach->entries[e].relay_mask;
+          entry_mask |= (uint8_t)(1u << e);
+        }
+      }
+      continue;
+    }
+
+    float vx = (target->x - track->x) * 1e6f / (float)dt_us;
+    float vy = (target->y - track->y) * 1e6f / (float)dt_us;
+    if (track->moving) {
+      track->vx = 0.5f * (track->vx + vx);
+      track->vy = 0.5f * (track->vy + vy);
+    } else {
+      track->vx = vx;
+      track->vy = vy;
+      track->moving = true;
+    }
+    track->x = target->x;
+    track->y = target->y;
+    track->seen_us = now_us;
+
+    for (size_t e = 0; e < approach->entry_count; e++) {
+      const approach_entry_t* entry = &approach->entries[e];
+      float dx = track->x - entry->x_mm;
+      float dy = track->y - entry->y_mm;
+      float along = track->vx * approach->heading_x[e] +
+                    track->vy * approach->heading_y[e];
+      float across = track->vx * approach->heading_y[e] -
+                     track->vy * approach->heading_x[e];
+      bool approaching =
+          dx * dx + dy * dy <= entry->radius_mm * entry->radius_mm &&
+          along >= approach->min_speed_mm_s && along >= fabsf(across);
+
+      if (!approaching) {
+        track->streak[e] = 0;
+        continue;
+      }
+      if (track->streak[e] < UINT8_MAX) {
+        track->streak[e]++;
+      }
+      if (track->streak[e] >= approach->confirm_frames) {
+        mask |= entry->relay_mask;
+        entry_mask |= (uint8_t)(1u << e);
+        if (track->streak[e] == approach->confirm_frames) {
+          approach->triggers++;
+        }
+      }
+    }
+  }
+
+  // Tracks that missed this frame survive briefly (radar dropouts)
+  for (size_t t = 0; t < approach->track_count; t++) {
+    if (!taken[t] && next_count < RADAR_FUSION_MAX_TARGETS &&
+        now_us - approach->tracks[t].seen_us < TRACK_TIMEOUT_US) {
+      next[next_count++] = approach->tracks[t];
+    }
+  }
+
+  memcpy(approach->tracks, next, next_count * sizeof(next[0]));
+  approach->track_count = next_count;
+  approach->entry_mask = entry_mask;
+  return mask;
+}
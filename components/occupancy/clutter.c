@@ -0,0 +1,157 @@
+#include "clutter.h"
+#include <math.h>
+#include <string.h>
+
+// Slow target seen in the cell since the last sweep
+#define CELL_SEEN 0x01
+// Slow targets in the cell are dropped
+#define CELL_CLUTTER 0x02
+
+// Learning and forgetting run on a one second grid
+#define SWEEP_PERIOD_US 1000000LL
+// Longer sweep gaps (task stalled, clock jump) count as one period
+#define MAX_SWEEP_GAP_US 10000000LL
+
+static void clear_model(clutter_t* map) {
+  memset(map->score, 0, sizeof(map->score));
+  memset(map->flags, 0, sizeof(map->flags));
+  map->clutter_cells = 0;
+}
+
+void clutter_init(clutter_t* map, uint32_t learn_s, uint32_t forget_s,
+                  uint32_t motion_cm_s) {
+  if (!map) {
+    return;
+  }
+  memset(map, 0, sizeof(*map));
+  clutter_set_rates(map, learn_s, forget_s, motion_cm_s);
+}
+
+void clutter_set_rates(clutter_t* map, uint32_t learn_s, uint32_t forget_s,
+                       uint32_t motion_cm_s) {
+  if (!map) {
+    return;
+  }
+  if (learn_s == 0) {
+    // Turning the model off must not leave old cells suppressing targets
+    clear_model(map);
+  }
+  map->learn_s = learn_s;
+  map->forget_s = forget_s;
+  map->motion_cm_s = (float)motion_cm_s;
+}
+
+// Real motion: nothing in this 3 x 3 block is background any more
+static void clear_block(clutter_t* map, int index) {
+  int row = index / HEATMAP_COLS;
+  int col = index % HEATMAP_COLS;
+  for (int r = row - 1; r <= row + 1; r++) {
+    for (int c = col - 1; c <= col + 1; c++) {
+      if (r < 0 || r >= HEATMAP_ROWS || c < 0 || c >= HEATMAP_COLS) {
+        continue;
+      }
+      int i = r * HEATMAP_COLS + c;
+      map->score[i] = 0;
+      if (map->flags[i] & CELL_CLUTTER) {
+        map->flags[i] &= (uint8_t)~CELL_CLUTTER;
+        map->clutter_cells--;
+      }
+    }
+  }
+}
+
+size_t clutter_filter(clutter_t* map, radar_fused_target_t* targets,
+                      size_t count) {
+  if (!map || !targets || map->learn_s == 0) {
+    return count;
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    int index = heatmap_cell_index(targets[i].x, targets[i].y);
+    if (index >= 0) {
+      if (fabsf(targets[i].speed) >= map->motion_cm_s) {
+        clear_block(map, index);
+      } else {
+        // Scored by the next sweep
+        map->flags[index] |= CELL_SEEN;
+        if (map->flags[index] & CELL_CLUTTER) {
+          map->suppressed++;
+          continue;
+        }
+      }
+    }
+    targets[kept++] = targets[i];
+  }
+  return kept;
+}
+
+static uint32_t rate_step(int64_t elapsed_us, uint32_t full_s) {
+  uint64_t scaled = (uint64_t)elapsed_us * CLUTTER_SCORE_MAX /
+                    ((uint64_t)full_s * 1000000ULL);
+  if (scaled > CLUTTER_SCORE_MAX) {
+    return CLUTTER_SCORE_MAX;
+  }
+  return scaled ? (uint32_t)scaled : 1;
+}
+
+void clutter_sweep(clutter_t* map, int64_t now_us) {
+  if (!map) {
+    return;
+  }
+  if (map->last_sweep_us == 0 || now_us < map->last_sweep_us) {
+    map->last_sweep_us = now_us;
+    return;
+  }
+  int64_t elapsed_us = now_us - map->last_sweep_us;
+  if (elapsed_us < SWEEP_PERIOD_US) {
+    return;
+  }
+  map->last_sweep_us = now_us;
+  if (elapsed_us > MAX_SWEEP_GAP_US) {
+    elapsed_us = SWEEP_PERIOD_US;
+  }
+  if (map->learn_s == 0) {
+    return;
+  }
+
+  // A cell learns for every second that had a slow target in it, however
+  // many frames hit it, so clutter jittering over a few cells still learns
+  // at full rate
+  uint32_t learn_step = rate_step(elapsed_us, map->learn_s);
+  uint32_t forget_step =
+      map->forget_s > 0 ? rate_step(elapsed_us, map->forget_s) : 0;
+
+  for (size_t i = 0; i < HEATMAP_CELLS; i++) {
+    if (map->flags[i] & CELL_SEEN) {
+      map->flags[i] &= (uint8_t)~CELL_SEEN;
+      uint32_t score = map->score[i] + learn_step;
+      map->score[i] =
+          (uint16_t)(score > CLUTTER_SCORE_MAX ? CLUTTER_SCORE_MAX : score);
+      if (map->score[i] == CLUTTER_SCORE_MAX &&
+          !(map->flags[i] & CELL_CLUTTER)) {
+        map->flags[i] |= CELL_CLUTTER;
+        map->clutter_cells++;
+      }
+      continue;
+    }
+    if (forget_step == 0 || map->score[i] == 0) {
+      continue;
+    }
+    map->score[i] =
+        map->score[i] > forget_step ? (uint16_t)(map->score[i] - forget_step)
+                                    : 0;
+    // Hysteresis: a clutter cell stays suppressing until it is half forgotten
+    if ((map->flags[i] & CELL_CLUTTER) &&
+        map->score[i] < CLUTTER_SCORE_MAX / 2) {
+      map->flags[i] &= (uint8_t)~CELL_CLUTTER;
+      map->clutter_cells--;
+    }
+  }
+}
+
+bool clutter_is_clutter(const clutter_t* map, int index) {
+  if (!map || index < 0 || index >= HEATMAP_CELLS) {
+    return false;
+  }
+  return (map->flags[index] & CELL_CLUTTER) != 0;
+}
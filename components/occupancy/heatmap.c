@@ -0,0 +1,141 @@
+#include "heatmap.h"
+#include <stdio.h>
+#include <string.h>
+
+int heatmap_cell_index(float x, float y) {
+  // Offsets are checked before the integer conversion so points just below
+  // the grid edge do not round into the first cell
+  float dx = x - HEATMAP_X_MIN_MM;
+  float dy = y - HEATMAP_Y_MIN_MM;
+  if (dx < 0.0f || dy < 0.0f ||
+      dx >= (float)(HEATMAP_COLS * HEATMAP_CELL_MM) ||
+      dy >= (float)(HEATMAP_ROWS * HEATMAP_CELL_MM)) {
+    return -1;
+  }
+  uint32_t col = (uint32_t)dx / HEATMAP_CELL_MM;
+  uint32_t row = (uint32_t)dy / HEATMAP_CELL_MM;
+  return (int)(row * HEATMAP_COLS + col);
+}
+
+void heatmap_reset(heatmap_t* map) {
+  if (map) {
+    memset(map, 0, sizeof(*map));
+  }
+}
+
+void heatmap_add(heatmap_t* map, const radar_fused_target_t* targets,
+                 size_t count) {
+  if (!map || !targets) {
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    int index = heatmap_cell_index(targets[i].x, targets[i].y);
+    if (index < 0) {
+      map->out_of_range++;
+      continue;
+    }
+
+    uint16_t* cell = &map->cells[index];
+    if (*cell < UINT16_MAX) {
+      (*cell)++;
+    }
+    map->samples++;
+  }
+}
+
+void heatmap_decay(heatmap_t* map, unsigned shift) {
+  if (!map || shift == 0) {
+    return;
+  }
+  if (shift > 15) {
+    shift = 15;
+  }
+  for (size_t i = 0; i < HEATMAP_CELLS; i++) {
+    map->cells[i] -= (uint16_t)(map->cells[i] >> shift);
+  }
+  map->samples -= map->samples >> shift;
+}
+
+uint16_t heatmap_max(const heatmap_t* map) {
+  uint16_t peak = 0;
+  for (size_t i = 0; map && i < HEATMAP_CELLS; i++) {
+    if (map->cells[i] > peak) {
+      peak = map->cells[i];
+    }
+  }
+  return peak;
+}
+
+static uint32_t export_level(uint16_t value, uint16_t peak) {
+  if (value == 0 || peak == 0) {
+    return 0;
+  }
+  uint32_t level = (uint32_t)value * (HEATMAP_EXPORT_LEVELS - 1) / peak;
+  return level > 0 ? level : 1;
+}
+
+bool heatmap_export_stream(const heatmap_t* map, heatmap_sink_t sink,
+                           void* ctx) {
+  if (!map || !sink) {
+    return false;
+  }
+
+  char text[80];
+  uint16_t peak = heatmap_max(map);
+  int n = snprintf(text, sizeof(text),
+                   "cols=%d&rows=%d&cell=%d&x0=%d&y0=%d&max=%u&cells=",
+                   HEATMAP_COLS, HEATMAP_ROWS, HEATMAP_CELL_MM,
+                   HEATMAP_X_MIN_MM, HEATMAP_Y_MIN_MM, (unsigned)peak);
+  if (n < 0 || (size_t)n >= sizeof(text) || !sink(ctx, text, (size_t)n)) {
+    return false;
+  }
+
+  size_t i = 0;
+  while (i < HEATMAP_CELLS) {
+    uint32_t level = export_level(map->cells[i], peak);
+    size_t run = 1;
+    while (i + run < HEATMAP_CELLS &&
+           export_level(map->cells[i + run], peak) == level) {
+      run++;
+    }
+
+    n = run > 1 ? snprintf(text, sizeof(text), "%s%lu*%lu", i ? "." : "",
+                           (unsigned long)level, (unsigned long)run)
+                : snprintf(text, sizeof(text), "%s%lu", i ? "." : "",
+                           (unsigned long)level);
+    if (n < 0 || !sink(ctx, text, (size_t)n)) {
+      return false;
+    }
+    i += run;
+  }
+  return true;
+}
+
+typedef struct {
+  char* buf;
+  size_t len;
+  size_t used;
+} export_buffer_t;
+
+// heatmap_export sink: append to a fixed buffer, keeping it terminated
+static bool export_to_buffer(void* ctx, const char* text, size_t len) {
+  export_buffer_t* out = (export_buffer_t*)ctx;
+  if (out->used + len >= out->len) {
+    return false;
+  }
+  memcpy(out->buf + out->used, text, len);
+  out->used += len;
+  out->buf[out->used] = '\0';
+  return true;
+}
+
+int heatmap_export(const heatmap_t* map, char* buf, size_t len) {
+  if (!map || !buf || len == 0) {
+    return -1;
+  }
+  export_buffer_t out = {buf, len, 0};
+  buf[0] = '\0';
+  return heatmap_export_stream(map, export_to_buffer, &out) ? (int)out.used
+                                                            : -1;
+}
@@ -0,0 +1,97 @@
+#ifndef APPROACH_H
+#define APPROACH_H
+
+// Predicts room entries from fused target motion towards configured
+// doorways, so relays can switch on before a person reaches the presence
+// area. Plain C with no ESP-IDF dependencies; tools/approach_replay
+// measures it on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_fusion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APPROACH_MAX_ENTRIES 2
+
+/**
+ * @brief One way into the room
+ */
+typedef struct {
+  float x_mm;          ///< Doorway centre in the room frame
+  float y_mm;
+  float heading_deg;   ///< Inward direction, counter-clockwise from room +Y
+  float radius_mm;     ///< Targets this close to the doorway are watched
+  uint8_t relay_mask;  ///< Relays to energise, bit 0 = channel 1
+} approach_entry_t;
+
+/**
+ * @brief Fused target followed from frame to frame
+ */
+typedef struct {
+  float x;
+  float y;
+  float vx;  ///< Smoothed velocity (mm/s)
+  float vy;
+  int64_t seen_us;
+  uint8_t streak[APPROACH_MAX_ENTRIES];  ///< Consecutive approaching frames
+  bool moving;                           ///< Velocity has been measured
+} approach_track_t;
+
+/**
+ * @brief Entry predictor state
+ */
+typedef struct {
+  approach_entry_t entries[APPROACH_MAX_ENTRIES];
+  float heading_x[APPROACH_MAX_ENTRIES];  ///< Unit vectors of entry headings
+  float heading_y[APPROACH_MAX_ENTRIES];
+  size_t entry_count;
+  float min_speed_mm_s;
+  uint8_t confirm_frames;
+  approach_track_t tracks[RADAR_FUSION_MAX_TARGETS];
+  size_t track_count;
+  uint32_t triggers;   ///< Entry approaches confirmed since init
+  uint8_t entry_mask;  ///< Entries approached in the last frame, bit 0 = 1st
+} approach_t;
+
+/**
+ * @brief Set up the predictor
+ *
+ * @param approach Predictor
+ * @param entries Doorways, at most APPROACH_MAX_ENTRIES are used
+ * @param count Number of doorways, 0 disables prediction
+ * @param min_speed_cm_s Slowest walk along the heading that counts
+ * @param confirm_frames Consecutive approaching frames before a trigger
+ */
+void approach_init(approach_t* approach, const approach_entry_t* entries,
+                   size_t count, uint32_t min_speed_cm_s,
+                   uint8_t confirm_frames);
+
+/**
+ * @brief Follow one fused frame and report approaching targets
+ *
+ * Targets are matched to the previous frame's by nearest neighbour, and
+ * their velocity comes from successive room frame positions. A target
+ * within radius_mm of a doorway that moves along its heading (within 45
+ * degrees) at min_speed or faster for confirm_frames frames triggers that
+ * entry. Targets moving away or across the doorway never do.
+ * O(targets * (targets + entries)).
+ *
+ * @param approach Predictor
+ * @param targets Fused targets in the room frame
+ * @param count Number of targets
+ * @param now_us Frame timestamp
+ * @return Relay mask of the entries being approached in this frame
+ */
+uint8_t approach_update(approach_t* approach,
+                        const radar_fused_target_t* targets, size_t count,
+                        int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPROACH_H
@@ -0,0 +1,104 @@
+#ifndef CLUTTER_H
+#define CLUTTER_H
+
+// Background model of static clutter (fans, curtains, reflections) on the
+// heatmap grid. Plain C with no ESP-IDF dependencies; tools/clutter_replay
+// evaluates it on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "heatmap.h"
+#include "radar_fusion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A cell is clutter once its score reaches this value */
+#define CLUTTER_SCORE_MAX UINT16_MAX
+
+/**
+ * @brief Per-cell persistence scores on the heatmap grid
+ *
+ * Once a second a cell's score grows if a slow target was in it during that
+ * second, and reaches CLUTTER_SCORE_MAX after learn_s such seconds. From
+ * then on slow targets in the cell are dropped. A target at or above motion_cm_s in
+ * the cell or one of its eight neighbours is real motion: it is never
+ * dropped and clears the score of the whole 3 x 3 block, so something that
+ * moved in has to sit still for a full learn_s again. Cells without slow
+ * targets lose score at a rate that empties a full cell in forget_s.
+ */
+typedef struct {
+  uint16_t score[HEATMAP_CELLS];
+  uint8_t flags[HEATMAP_CELLS];
+  uint32_t learn_s;   ///< Still presence that makes a cell clutter, 0 off
+  uint32_t forget_s;  ///< Absence that empties a full cell, 0 never
+  float motion_cm_s;  ///< Speeds from here on count as real motion
+  int64_t last_sweep_us;
+  uint32_t suppressed;     ///< Targets dropped since init
+  uint32_t clutter_cells;  ///< Cells currently classed as clutter
+} clutter_t;
+
+/**
+ * @brief Start with an empty model
+ *
+ * @param map Clutter model
+ * @param learn_s Seconds of still presence before a cell is clutter, 0
+ *        disables learning and suppression
+ * @param forget_s Seconds of absence that empty a fully learnt cell, 0 keeps
+ *        cells until motion clears them
+ * @param motion_cm_s Absolute speed that counts as real motion
+ */
+void clutter_init(clutter_t* map, uint32_t learn_s, uint32_t forget_s,
+                  uint32_t motion_cm_s);
+
+/**
+ * @brief Change the rates without losing what has been learnt
+ *
+ * @param map Clutter model
+ * @param learn_s See clutter_init()
+ * @param forget_s See clutter_init()
+ * @param motion_cm_s See clutter_init()
+ */
+void clutter_set_rates(clutter_t* map, uint32_t learn_s, uint32_t forget_s,
+                       uint32_t motion_cm_s);
+
+/**
+ * @brief Learn from one fused frame and drop targets in clutter cells
+ *
+ * O(1) per target. Targets outside the grid are kept untouched.
+ *
+ * @param map Clutter model
+ * @param targets Fused targets, compacted in place
+ * @param count Number of targets
+ * @return Number of targets kept
+ */
+size_t clutter_filter(clutter_t* map, radar_fused_target_t* targets,
+                      size_t count);
+
+/**
+ * @brief Score the cells that saw slow targets and age the others
+ *
+ * Sweeps the grid at most once per second and returns immediately
+ * otherwise, so it can be called on every loop iteration.
+ *
+ * @param map Clutter model
+ * @param now_us Current time
+ */
+void clutter_sweep(clutter_t* map, int64_t now_us);
+
+/**
+ * @brief Whether a cell currently suppresses slow targets
+ *
+ * @param map Clutter model
+ * @param index Cell index from heatmap_cell_index()
+ * @return true for a clutter cell
+ */
+bool clutter_is_clutter(const clutter_t* map, int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CLUTTER_H
@@ -0,0 +1,138 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+// Fixed-resolution occupancy grid over the room frame. Plain C with no
+// ESP-IDF dependencies; tools/heatmap_bench measures it on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_fusion.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_OCCUPANCY_HEATMAP_CELL_MM
+#define CONFIG_OCCUPANCY_HEATMAP_CELL_MM 200
+#define CONFIG_OCCUPANCY_HEATMAP_X_MIN_MM -4000
+#define CONFIG_OCCUPANCY_HEATMAP_X_MAX_MM 4000
+#define CONFIG_OCCUPANCY_HEATMAP_Y_MIN_MM 0
+#define CONFIG_OCCUPANCY_HEATMAP_Y_MAX_MM 6000
+#endif
+
+#define HEATMAP_CELL_MM CONFIG_OCCUPANCY_HEATMAP_CELL_MM
+#define HEATMAP_X_MIN_MM CONFIG_OCCUPANCY_HEATMAP_X_MIN_MM
+#define HEATMAP_Y_MIN_MM CONFIG_OCCUPANCY_HEATMAP_Y_MIN_MM
+#define HEATMAP_COLS                                                       \
+  ((CONFIG_OCCUPANCY_HEATMAP_X_MAX_MM - CONFIG_OCCUPANCY_HEATMAP_X_MIN_MM + \
+    HEATMAP_CELL_MM - 1) /                                                 \
+   HEATMAP_CELL_MM)
+#define HEATMAP_ROWS                                                       \
+  ((CONFIG_OCCUPANCY_HEATMAP_Y_MAX_MM - CONFIG_OCCUPANCY_HEATMAP_Y_MIN_MM + \
+    HEATMAP_CELL_MM - 1) /                                                 \
+   HEATMAP_CELL_MM)
+#define HEATMAP_CELLS (HEATMAP_COLS * HEATMAP_ROWS)
+
+/** Export levels run from 0 to HEATMAP_EXPORT_LEVELS - 1 */
+#define HEATMAP_EXPORT_LEVELS 100
+
+/**
+ * @brief Grid of per-cell target counts, row-major from the near-left corner
+ */
+typedef struct {
+  uint16_t cells[HEATMAP_CELLS];  ///< Saturating counters
+  uint32_t samples;               ///< Targets counted since the last reset
+  uint32_t out_of_range;          ///< Targets outside the grid
+} heatmap_t;
+
+/**
+ * @brief Grid cell containing a room frame point
+ *
+ * @param x Room frame X (mm)
+ * @param y Room frame Y (mm)
+ * @return Row-major cell index, or -1 outside the grid
+ */
+int heatmap_cell_index(float x, float y);
+
+/**
+ * @brief Clear every cell and counter
+ *
+ * @param map Heatmap
+ */
+void heatmap_reset(heatmap_t* map);
+
+/**
+ * @brief Count one frame's targets, one increment per target: O(targets)
+ *
+ * @param map Heatmap
+ * @param targets Fused targets in the room frame
+ * @param count Number of targets
+ */
+void heatmap_add(heatmap_t* map, const radar_fused_target_t* targets,
+                 size_t count);
+
+/**
+ * @brief Age the map: every cell loses 1/2^shift of its count, O(cells)
+ *
+ * @param map Heatmap
+ * @param shift Decay strength (1 halves every cell)
+ */
+void heatmap_decay(heatmap_t* map, unsigned shift);
+
+/**
+ * @brief Largest cell value
+ *
+ * @param map Heatmap
+ * @return Peak count
+ */
+uint16_t heatmap_max(const heatmap_t* map);
+
+/**
+ * @brief Export as form fields with run-length encoded, normalised levels
+ *
+ * Writes "cols=..&rows=..&cell=..&x0=..&y0=..&max=..&cells=..". Cells are
+ * scaled to 0..HEATMAP_EXPORT_LEVELS-1 against the peak (non-zero cells stay
+ * at least 1) and written row-major as '.'-separated tokens: "v" for one cell
+ * or "v*n" for a run of n equal cells.
+ *
+ * @param map Heatmap
+ * @param buf Destination
+ * @param len Destination size
+ * @return Length written, or -1 if it does not fit
+ */
+int heatmap_export(const heatmap_t* map, char* buf, size_t len);
+
+/**
+ * @brief Receives export text piece by piece
+ *
+ * @param ctx Caller context
+ * @param text Next piece, not terminated
+ * @param len Piece length, at most a few dozen bytes
+ * @return false to stop the export
+ */
+typedef bool (*heatmap_sink_t)(void* ctx, const char* text, size_t len);
+
+/**
+ * @brief Export in the heatmap_export() format without a destination buffer
+ *
+ * Feeds the header and then one RLE token at a time to sink, so an encoder
+ * can consume the export without a full text copy.
+ *
+ * @param map Heatmap
+ * @param sink Receives the text in order
+ * @param ctx Passed to sink
+ * @return false if sink stopped the export
+ */
+bool heatmap_export_stream(const heatmap_t* map, heatmap_sink_t sink,
+                           void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HEATMAP_H
@@ -0,0 +1,117 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+// Per-interval occupancy statistics. Plain C with no ESP-IDF dependencies
+// so captures can be replayed through it on the host (tools/occupancy_replay).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_fusion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OCCUPANCY_RELAY_CHANNELS 2
+
+/**
+ * @brief Statistics for one closed interval
+ *
+ * Distance is measured from the room origin (radar 1 with the default
+ * mount), speed is the absolute target speed. Both are sampled once per
+ * fused target per frame.
+ */
+typedef struct {
+  int64_t start_us;
+  int64_t end_us;
+  uint32_t frames;
+  uint32_t occupied_ms;  ///< Time with at least one target
+  uint32_t entries;      ///< Empty-to-occupied transitions
+  uint32_t target_sum;   ///< Sum of per-frame target counts
+  uint32_t target_max;
+  uint32_t samples;  ///< Target samples behind the distance/speed stats
+  float distance_min_mm;
+  float distance_max_mm;
+  float distance_sum_mm;
+  float speed_min;
+  float speed_max;
+  float speed_sum;
+  uint32_t relay_on_ms[OCCUPANCY_RELAY_CHANNELS];
+  /** Radar frames the reader could not hand over because the ring was
+   *  full, so they are missing from the statistics above; set by caller */
+  uint32_t frames_dropped;
+} occupancy_summary_t;
+
+/**
+ * @brief Aggregation state; every update is O(1) in the interval length
+ */
+typedef struct {
+  occupancy_summary_t current;
+  int64_t max_gap_us;     ///< Frame gaps longer than this do not count
+  int64_t last_frame_us;  ///< 0 before the first frame
+  int64_t occupied_mark_us;
+  uint64_t occupied_us;
+  bool occupied;
+  bool relay_on[OCCUPANCY_RELAY_CHANNELS];
+  int64_t relay_mark_us[OCCUPANCY_RELAY_CHANNELS];
+  uint64_t relay_on_us[OCCUPANCY_RELAY_CHANNELS];
+} occupancy_t;
+
+/**
+ * @brief Start aggregating
+ *
+ * @param occ State to initialise
+ * @param now_us Interval start
+ * @param max_gap_us Longest frame gap still counted as continuous presence
+ */
+void occupancy_init(occupancy_t* occ, int64_t now_us, int64_t max_gap_us);
+
+/**
+ * @brief Account one fused frame
+ *
+ * @param occ Aggregation state
+ * @param targets Fused targets of the frame
+ * @param count Number of targets
+ * @param now_us Frame time
+ */
+void occupancy_update(occupancy_t* occ, const radar_fused_target_t* targets,
+                      size_t count, int64_t now_us);
+
+/**
+ * @brief Record a relay channel state; repeated states are ignored
+ *
+ * @param occ Aggregation state
+ * @param channel Relay channel (0-based)
+ * @param on New state
+ * @param now_us Switching time
+ */
+void occupancy_set_relay(occupancy_t* occ, int channel, bool on,
+                         int64_t now_us);
+
+/**
+ * @brief Close the current interval and start the next one at now_us
+ *
+ * @param occ Aggregation state
+ * @param now_us Interval end
+ * @param out Closed interval
+ */
+void occupancy_close(occupancy_t* occ, int64_t now_us,
+                     occupancy_summary_t* out);
+
+/**
+ * @brief Format a summary as an application/x-www-form-urlencoded body
+ *
+ * @param summary Closed interval
+ * @param buf Destination
+ * @param len Destination size
+ * @return Length written (as snprintf)
+ */
+int occupancy_format(const occupancy_summary_t* summary, char* buf,
+                     size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OCCUPANCY_H
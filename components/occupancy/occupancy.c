@@ -0,0 +1,150 @@
+#include "occupancy.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static void reset_interval(occupancy_t* occ, int64_t now_us) {
+  memset(&occ->current, 0, sizeof(occ->current));
+  occ->current.start_us = now_us;
+  occ->occupied_us = 0;
+  occ->occupied_mark_us = now_us;
+  for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+    occ->relay_on_us[ch] = 0;
+    occ->relay_mark_us[ch] = now_us;
+  }
+}
+
+// Presence holds from the last frame for at most max_gap_us, so a radar that
+// goes silent does not keep the room occupied forever
+static void accrue_occupied(occupancy_t* occ, int64_t now_us) {
+  if (occ->occupied && occ->last_frame_us != 0) {
+    int64_t end_us = occ->last_frame_us + occ->max_gap_us;
+    if (end_us > now_us) {
+      end_us = now_us;
+    }
+    if (end_us > occ->occupied_mark_us) {
+      occ->occupied_us += (uint64_t)(end_us - occ->occupied_mark_us);
+    }
+  }
+  occ->occupied_mark_us = now_us;
+}
+
+static void accrue_relay(occupancy_t* occ, int channel, int64_t now_us) {
+  if (occ->relay_on[channel] && now_us > occ->relay_mark_us[channel]) {
+    occ->relay_on_us[channel] +=
+        (uint64_t)(now_us - occ->relay_mark_us[channel]);
+  }
+  occ->relay_mark_us[channel] = now_us;
+}
+
+void occupancy_init(occupancy_t* occ, int64_t now_us, int64_t max_gap_us) {
+  if (!occ) {
+    return;
+  }
+  memset(occ, 0, sizeof(*occ));
+  occ->max_gap_us = max_gap_us;
+  reset_interval(occ, now_us);
+}
+
+void occupancy_update(occupancy_t* occ, const radar_fused_target_t* targets,
+                      size_t count, int64_t now_us) {
+  if (!occ || (count > 0 && !targets)) {
+    return;
+  }
+
+  occupancy_summary_t* s = &occ->current;
+  accrue_occupied(occ, now_us);
+
+  bool occupied = count > 0;
+  if (occupied && !occ->occupied) {
+    s->entries++;
+  }
+  occ->occupied = occupied;
+  occ->last_frame_us = now_us;
+
+  s->frames++;
+  s->target_sum += (uint32_t)count;
+  if (count > s->target_max) {
+    s->target_max = (uint32_t)count;
+  }
+
+  // At most RADAR_FUSION_MAX_TARGETS per frame
+  for (size_t i = 0; i < count; i++) {
+    float distance = sqrtf(targets[i].x * targets[i].x +
+                           targets[i].y * targets[i].y);
+    float speed = fabsf(targets[i].speed);
+    if (s->samples == 0) {
+      s->distance_min_mm = s->distance_max_mm = distance;
+      s->speed_min = s->speed_max = speed;
+    } else {
+      s->distance_min_mm = fminf(s->distance_min_mm, distance);
+      s->distance_max_mm = fmaxf(s->distance_max_mm, distance);
+      s->speed_min = fminf(s->speed_min, speed);
+      s->speed_max = fmaxf(s->speed_max, speed);
+    }
+    s->distance_sum_mm += distance;
+    s->speed_sum += speed;
+    s->samples++;
+  }
+}
+
+void occupancy_set_relay(occupancy_t* occ, int channel, bool on,
+                         int64_t now_us) {
+  if (!occ || channel < 0 || channel >= OCCUPANCY_RELAY_CHANNELS ||
+      occ->relay_on[channel] == on) {
+    return;
+  }
+  accrue_relay(occ, channel, now_us);
+  occ->relay_on[channel] = on;
+}
+
+void occupancy_close(occupancy_t* occ, int64_t now_us,
+                     occupancy_summary_t* out) {
+  if (!occ) {
+    return;
+  }
+
+  accrue_occupied(occ, now_us);
+  for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+    accrue_relay(occ, ch, now_us);
+  }
+
+  if (out) {
+    *out = occ->current;
+    out->end_us = now_us;
+    out->occupied_ms = (uint32_t)(occ->occupied_us / 1000);
+    for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+      out->relay_on_ms[ch] = (uint32_t)(occ->relay_on_us[ch] / 1000);
+    }
+  }
+
+  // Occupancy and relay states carry over into the next interval
+  reset_interval(occ, now_us);
+}
+
+int occupancy_format(const occupancy_summary_t* summary, char* buf,
+                     size_t len) {
+  if (!summary || !buf) {
+    return -1;
+  }
+
+  const occupancy_summary_t* s = summary;
+  float target_mean =
+      s->frames ? (float)s->target_sum / (float)s->frames : 0.0f;
+  float distance_mean = s->samples ? s->distance_sum_mm / s->samples : 0.0f;
+  float speed_mean = s->samples ? s->speed_sum / s->samples : 0.0f;
+
+  return snprintf(
+      buf, len,
+      "type=summary&up=%lu&dur=%lu&frames=%lu&occ_s=%lu&entries=%lu"
+      "&tmean=%.2f&tmax=%lu&dmin=%.0f&dmean=%.0f&dmax=%.0f"
+      "&smin=%.1f&smean=%.1f&smax=%.1f&r1_s=%lu&r2_s=%lu&frames_lost=%lu",
+      (unsigned long)(s->end_us / 1000000),
+      (unsigned long)((s->end_us - s->start_us) / 1000000),
+      (unsigned long)s->frames, (unsigned long)(s->occupied_ms / 1000),
+      (unsigned long)s->entries, target_mean, (unsigned long)s->target_max,
+      s->distance_min_mm, distance_mean, s->distance_max_mm, s->speed_min,
+      speed_mean, s->speed_max, (unsigned long)(s->relay_on_ms[0] / 1000),
+      (unsigned long)(s->relay_on_ms[1] / 1000),
+      (unsigned long)s->frames_dropped);
+}
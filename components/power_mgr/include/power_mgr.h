@@ -0,0 +1,103 @@
+#ifndef POWER_MGR_H
+#define POWER_MGR_H
+
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Work phases that keep the CPU at full speed and out of light sleep
+ */
+typedef enum {
+  POWER_LOCK_PARSE = 0,  ///< Radar frame parsing and relay decision
+  POWER_LOCK_HTTP,       ///< Status upload in flight
+  POWER_LOCK_COUNT
+} power_lock_id_t;
+
+/**
+ * @brief Cumulative time-in-state counters since boot
+ */
+typedef struct {
+  int64_t uptime_us;
+  int64_t lock_held_us[POWER_LOCK_COUNT];
+  uint32_t lock_acquired[POWER_LOCK_COUNT];
+  int64_t light_sleep_us;
+  uint32_t light_sleep_count;
+} power_mgr_stats_t;
+
+#if CONFIG_POWER_MGR_ENABLE
+
+/**
+ * @brief Enable dynamic frequency scaling with automatic light sleep and
+ *        create the PM locks
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t power_mgr_init(void);
+
+/**
+ * @brief Let activity on a UART RX line wake the chip from light sleep
+ *
+ * Arms the UART edge-count wake-up and, because the ESP32 only routes it
+ * from IOMUX pins, also a low-level GPIO wake-up on the RX pin.
+ *
+ * @param port UART port with an installed driver
+ * @param rx_pin GPIO carrying the port's RX signal
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t power_mgr_enable_uart_wakeup(uart_port_t port, gpio_num_t rx_pin);
+
+/**
+ * @brief Hold the lock for one work phase (not recursive per phase)
+ */
+void power_mgr_acquire(power_lock_id_t id);
+
+/**
+ * @brief Release a lock taken with power_mgr_acquire()
+ */
+void power_mgr_release(power_lock_id_t id);
+
+/**
+ * @brief Copy the time-in-state counters
+ */
+void power_mgr_get_stats(power_mgr_stats_t* out);
+
+/**
+ * @brief Log time spent locked, awake idle and in light sleep
+ */
+void power_mgr_log_summary(void);
+
+/**
+ * @brief WiFi listen interval to request from the AP, in DTIM beacons
+ */
+static inline uint8_t power_mgr_wifi_listen_interval(void) {
+  return CONFIG_POWER_MGR_WIFI_LISTEN_INTERVAL;
+}
+
+#else  // !CONFIG_POWER_MGR_ENABLE
+
+static inline esp_err_t power_mgr_init(void) { return ESP_OK; }
+static inline esp_err_t power_mgr_enable_uart_wakeup(uart_port_t port,
+                                                     gpio_num_t rx_pin) {
+  (void)port;
+  (void)rx_pin;
+  return ESP_OK;
+}
+static inline void power_mgr_acquire(power_lock_id_t id) { (void)id; }
+static inline void power_mgr_release(power_lock_id_t id) { (void)id; }
+static inline void power_mgr_log_summary(void) {}
+static inline uint8_t power_mgr_wifi_listen_interval(void) { return 0; }
+
+#endif  // CONFIG_POWER_MGR_ENABLE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // POWER_MGR_H
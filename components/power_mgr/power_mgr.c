@@ -0,0 +1,168 @@
+#include "power_mgr.h"
+
+#if CONFIG_POWER_MGR_ENABLE
+
+#include <inttypes.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static const char* TAG = "POWER_MGR";
+
+typedef struct {
+  esp_pm_lock_handle_t cpu_max;   // Keeps the CPU at max frequency
+  esp_pm_lock_handle_t no_sleep;  // Keeps the chip out of light sleep
+  int64_t acquired_at_us;
+} power_lock_t;
+
+static const char* const s_lock_names[POWER_LOCK_COUNT] = {
+    [POWER_LOCK_PARSE] = "parse",
+    [POWER_LOCK_HTTP] = "http",
+};
+
+static power_lock_t s_locks[POWER_LOCK_COUNT];
+static power_mgr_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Called from the idle task with interrupts disabled once light sleep ends
+static IRAM_ATTR esp_err_t on_light_sleep_exit(int64_t sleep_time_us,
+                                               void* arg) {
+  (void)arg;
+  portENTER_CRITICAL_SAFE(&s_stats_lock);
+  s_stats.light_sleep_us += sleep_time_us;
+  s_stats.light_sleep_count++;
+  portEXIT_CRITICAL_SAFE(&s_stats_lock);
+  return ESP_OK;
+}
+
+esp_err_t power_mgr_init(void) {
+  const esp_pm_config_t pm_config = {
+      .max_freq_mhz = CONFIG_POWER_MGR_MAX_CPU_MHZ,
+      .min_freq_mhz = CONFIG_POWER_MGR_MIN_CPU_MHZ,
+      .light_sleep_enable = true,
+  };
+  esp_err_t ret = esp_pm_configure(&pm_config);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to configure power management: %s",
+             esp_err_to_name(ret));
+    return ret;
+  }
+
+  for (int i = 0; i < POWER_LOCK_COUNT; i++) {
+    ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, s_lock_names[i],
+                             &s_locks[i].cpu_max);
+    if (ret == ESP_OK) {
+      ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, s_lock_names[i],
+                               &s_locks[i].no_sleep);
+    }
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to create PM lock '%s': %s", s_lock_names[i],
+               esp_err_to_name(ret));
+      return ret;
+    }
+  }
+
+  esp_pm_sleep_cbs_register_config_t cbs = {
+      .exit_cb = on_light_sleep_exit,
+  };
+  ret = esp_pm_light_sleep_register_cbs(&cbs);
+  if (ret != ESP_OK) {
+    // Sleep still works, only the light sleep counters stay at zero
+    ESP_LOGW(TAG, "Light sleep accounting unavailable: %s",
+             esp_err_to_name(ret));
+  }
+
+  ESP_LOGI(TAG, "Light sleep enabled (%d-%d MHz)",
+           CONFIG_POWER_MGR_MIN_CPU_MHZ, CONFIG_POWER_MGR_MAX_CPU_MHZ);
+  return ESP_OK;
+}
+
+esp_err_t power_mgr_enable_uart_wakeup(uart_port_t port, gpio_num_t rx_pin) {
+  esp_err_t ret =
+      uart_set_wakeup_threshold(port, CONFIG_POWER_MGR_UART_WAKEUP_THRESHOLD);
+  if (ret == ESP_OK) {
+    ret = esp_sleep_enable_uart_wakeup(port);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "UART%d wake-up unavailable: %s", port,
+             esp_err_to_name(ret));
+  }
+
+  // The line idles high, so the first start bit wakes the chip
+  ret = gpio_wakeup_enable(rx_pin, GPIO_INTR_LOW_LEVEL);
+  if (ret == ESP_OK) {
+    ret = esp_sleep_enable_gpio_wakeup();
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to enable wake-up on GPIO%d: %s", rx_pin,
+             esp_err_to_name(ret));
+  }
+  return ret;
+}
+
+void power_mgr_acquire(power_lock_id_t id) {
+  if (id >= POWER_LOCK_COUNT || !s_locks[id].cpu_max) {
+    return;
+  }
+  esp_pm_lock_acquire(s_locks[id].cpu_max);
+  esp_pm_lock_acquire(s_locks[id].no_sleep);
+  s_locks[id].acquired_at_us = esp_timer_get_time();
+}
+
+void power_mgr_release(power_lock_id_t id) {
+  if (id >= POWER_LOCK_COUNT || !s_locks[id].cpu_max) {
+    return;
+  }
+  int64_t held_us = esp_timer_get_time() - s_locks[id].acquired_at_us;
+
+  portENTER_CRITICAL(&s_stats_lock);
+  s_stats.lock_held_us[id] += held_us;
+  s_stats.lock_acquired[id]++;
+  portEXIT_CRITICAL(&s_stats_lock);
+
+  esp_pm_lock_release(s_locks[id].no_sleep);
+  esp_pm_lock_release(s_locks[id].cpu_max);
+}
+
+void power_mgr_get_stats(power_mgr_stats_t* out) {
+  if (!out) {
+    return;
+  }
+  portENTER_CRITICAL(&s_stats_lock);
+  memcpy(out, &s_stats, sizeof(*out));
+  portEXIT_CRITICAL(&s_stats_lock);
+  out->uptime_us = esp_timer_get_time();
+}
+
+void power_mgr_log_summary(void) {
+  power_mgr_stats_t stats;
+  power_mgr_get_stats(&stats);
+  if (stats.uptime_us <= 0) {
+    return;
+  }
+
+  // Locks overlap only when parsing and an upload run on both cores at once,
+  // so the awake-idle figure is a lower bound.
+  int64_t locked_us = 0;
+  for (int i = 0; i < POWER_LOCK_COUNT; i++) {
+    locked_us += stats.lock_held_us[i];
+    ESP_LOGI(TAG, "lock %-5s held %" PRId64 "%% (%" PRIu32 " times)",
+             s_lock_names[i], stats.lock_held_us[i] * 100 / stats.uptime_us,
+             stats.lock_acquired[i]);
+  }
+  int64_t idle_us = stats.uptime_us - locked_us - stats.light_sleep_us;
+  if (idle_us < 0) {
+    idle_us = 0;
+  }
+  ESP_LOGI(TAG,
+           "light sleep %" PRId64 "%% (%" PRIu32 " entries), awake idle %" PRId64
+           "%%",
+           stats.light_sleep_us * 100 / stats.uptime_us,
+           stats.light_sleep_count, idle_us * 100 / stats.uptime_us);
+}
+
+#endif  // CONFIG_POWER_MGR_ENABLE
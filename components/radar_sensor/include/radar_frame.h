@@ -0,0 +1,78 @@
+#ifndef RADAR_FRAME_H
+#define RADAR_FRAME_H
+
+// Data frame sync and target decoding for the module selected in
+// radar_protocol.h. Plain C with no ESP-IDF dependencies so it can be
+// built on the host; tools/frame_bench compares it with the hand-written
+// LD2450 parser it replaced.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_protocol.h"
+#include "radar_target.h"
+
+#if RADAR_PROTO_TARGETS > RADAR_MAX_TARGETS
+#error "Radar protocol reports more targets than RADAR_MAX_TARGETS"
+#endif
+
+typedef enum
+{
+    RADAR_FRAME_NONE,    // Byte is not part of a data frame
+    RADAR_FRAME_PENDING, // Byte consumed, frame not complete (or dropped)
+    RADAR_FRAME_READY    // Payload of a well-framed report is in the buffer
+} radar_frame_status_t;
+
+typedef struct
+{
+    uint8_t buffer[RADAR_PROTO_PAYLOAD_LEN + RADAR_PROTO_TAIL_LEN];
+    uint8_t sync;   // Header bytes matched so far
+    uint8_t length; // Bytes in buffer once the header matched
+} radar_frame_parser_t;
+
+static inline void radar_frame_reset(radar_frame_parser_t *parser)
+{
+    parser->sync = 0;
+    parser->length = 0;
+}
+
+// Run one byte through the parser. Inline so the byte loop of
+// radar_sensor_feed() compares against the descriptor's constants directly.
+static inline radar_frame_status_t radar_frame_push(radar_frame_parser_t *parser, uint8_t byte_in)
+{
+    static const uint8_t header[RADAR_PROTO_HEADER_LEN] = {RADAR_PROTO_HEADER};
+    static const uint8_t tail[RADAR_PROTO_TAIL_LEN] = {RADAR_PROTO_TAIL};
+
+    if (parser->sync < RADAR_PROTO_HEADER_LEN)
+    {
+        if (byte_in == header[parser->sync])
+        {
+            parser->sync++;
+            return RADAR_FRAME_PENDING;
+        }
+        // A broken header may be the start of the next one
+        parser->sync = (byte_in == header[0]) ? 1 : 0;
+        return parser->sync ? RADAR_FRAME_PENDING : RADAR_FRAME_NONE;
+    }
+
+    parser->buffer[parser->length++] = byte_in;
+    if (parser->length < sizeof(parser->buffer))
+    {
+        return RADAR_FRAME_PENDING;
+    }
+
+    radar_frame_reset(parser);
+    uint8_t diff = 0;
+    for (int i = 0; i < RADAR_PROTO_TAIL_LEN; i++)
+    {
+        diff |= parser->buffer[RADAR_PROTO_PAYLOAD_LEN + i] ^ tail[i];
+    }
+    return diff == 0 ? RADAR_FRAME_READY : RADAR_FRAME_PENDING;
+}
+
+// Decode a payload into targets[0..RADAR_PROTO_TARGETS), with distance and
+// angle derived from x and y; slots the module does not report are cleared.
+// Returns the number of targets present.
+int radar_frame_decode(const uint8_t *payload, radar_target_t targets[RADAR_MAX_TARGETS]);
+
+#endif // RADAR_FRAME_H
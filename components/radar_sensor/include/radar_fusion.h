@@ -0,0 +1,67 @@
+#ifndef RADAR_FUSION_H
+#define RADAR_FUSION_H
+
+// Cross-sensor fusion. Plain C with no ESP-IDF dependencies so it can be
+// built on the host and fed replayed frame streams.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_target.h"
+
+#define RADAR_FUSION_MAX_SENSORS 3
+#define RADAR_FUSION_MAX_TARGETS (RADAR_FUSION_MAX_SENSORS * RADAR_MAX_TARGETS)
+
+// Where a sensor sits in the room frame (mm) and how far its boresight is
+// rotated counter-clockwise from the room's +y axis (degrees)
+typedef struct
+{
+    float x_mm;
+    float y_mm;
+    float rotation_deg;
+} radar_mount_t;
+
+// Target in the room frame
+typedef struct
+{
+    float x;
+    float y;
+    float speed;
+    uint8_t sensor_mask; // Bit n set when sensor n saw this target
+} radar_fused_target_t;
+
+typedef struct
+{
+    float cos_r;
+    float sin_r;
+    float offset_x;
+    float offset_y;
+    radar_target_t targets[RADAR_MAX_TARGETS];
+    int64_t timestamp_us; // 0 until the first frame
+} radar_fusion_sensor_t;
+
+typedef struct
+{
+    radar_fusion_sensor_t sensors[RADAR_FUSION_MAX_SENSORS];
+    size_t sensor_count;
+    float merge_radius_mm; // Targets from different sensors closer than this are one person
+    int64_t max_age_us;    // Frames older than this are ignored
+} radar_fusion_t;
+
+void radar_fusion_init(radar_fusion_t *fusion, float merge_radius_mm, int64_t max_age_us);
+
+// Returns the sensor index, or -1 when RADAR_FUSION_MAX_SENSORS are registered
+int radar_fusion_add_sensor(radar_fusion_t *fusion, const radar_mount_t *mount);
+
+// Store the latest frame of one sensor (targets in the sensor frame)
+void radar_fusion_update(radar_fusion_t *fusion, int sensor,
+                         const radar_target_t targets[RADAR_MAX_TARGETS], int64_t now_us);
+
+// Transform fresh targets into the room frame and merge duplicates seen by
+// several sensors. Returns the number of targets written to out.
+size_t radar_fusion_merge(const radar_fusion_t *fusion, int64_t now_us,
+                          radar_fused_target_t *out, size_t max_targets);
+
+// Apply a mount transform to a single sensor-frame point
+void radar_mount_apply(const radar_mount_t *mount, float x, float y, float *room_x, float *room_y);
+
+#endif // RADAR_FUSION_H
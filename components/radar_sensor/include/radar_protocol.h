@@ -0,0 +1,55 @@
+#ifndef RADAR_PROTOCOL_H
+#define RADAR_PROTOCOL_H
+
+// Compile-time description of a module's data frame. Each supported module
+// has a descriptor header defining the RADAR_PROTO_* macros below; the one
+// chosen in menuconfig (Radar module) is included here, and the frame
+// parser and decoder in radar_frame.c are built from it, so the byte loop
+// compares against constants and every field read folds to fixed loads,
+// masks and multiplies.
+//
+// A frame is header | payload | tail. The payload holds RADAR_PROTO_TARGETS
+// slots of RADAR_PROTO_TARGET_STRIDE bytes starting at
+// RADAR_PROTO_TARGET_BASE. Field offsets are relative to the slot.
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+typedef enum
+{
+    RADAR_ENC_ABSENT,         // Not reported; reads as 0
+    RADAR_ENC_UNSIGNED,       // Little endian
+    RADAR_ENC_SIGN_MAGNITUDE, // Little endian, top bit set = negative
+    RADAR_ENC_TWOS_COMPLEMENT // Little endian
+} radar_encoding_t;
+
+// One target field: raw value at offset, width bytes (1 or 2), times scale
+// gives mm (positions) or cm/s (speed)
+typedef struct
+{
+    uint8_t offset;
+    uint8_t width;
+    radar_encoding_t encoding;
+    float scale;
+} radar_field_t;
+
+#define RADAR_FIELD(offset, width, encoding, scale) {(offset), (width), (encoding), (scale)}
+#define RADAR_FIELD_NONE RADAR_FIELD(0, 0, RADAR_ENC_ABSENT, 0.0f)
+
+// Target presence: a slot counts when any of its bytes is non-zero, or,
+// with a presence offset, when bit t of that payload byte is set
+#define RADAR_PRESENCE_NONZERO_SLOT (-1)
+
+#if defined(CONFIG_RADAR_PROTOCOL_LD2410)
+#include "radar_protocol_ld2410.h"
+#else
+#include "radar_protocol_ld2450.h"
+#endif
+
+#define RADAR_PROTO_FRAME_LEN \
+    (RADAR_PROTO_HEADER_LEN + RADAR_PROTO_PAYLOAD_LEN + RADAR_PROTO_TAIL_LEN)
+
+#endif // RADAR_PROTOCOL_H
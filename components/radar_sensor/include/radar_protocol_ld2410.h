@@ -0,0 +1,31 @@
+#ifndef RADAR_PROTOCOL_LD2410_H
+#define RADAR_PROTOCOL_LD2410_H
+
+// HLK-LD2410 basic report: F4 F3 F2 F1 0D 00 02 AA | state, moving target
+// distance (cm, 16 bit) and energy, stationary target distance and energy,
+// detection distance | 55 00 F8 F7 F6 F5. The length, report type and head
+// byte are fixed for basic reports, so they are matched as part of the
+// header; engineering-mode reports do not match and are skipped.
+//
+// The module only ranges along its boresight: the moving target becomes
+// slot 0 and the stationary one slot 1, both at x = 0, with state bit 0 and
+// bit 1 saying which are present. Speed is not reported.
+
+#define RADAR_PROTO_NAME "LD2410"
+
+#define RADAR_PROTO_HEADER 0xF4, 0xF3, 0xF2, 0xF1, 0x0D, 0x00, 0x02, 0xAA
+#define RADAR_PROTO_HEADER_LEN 8
+#define RADAR_PROTO_TAIL 0x55, 0x00, 0xF8, 0xF7, 0xF6, 0xF5
+#define RADAR_PROTO_TAIL_LEN 6
+#define RADAR_PROTO_PAYLOAD_LEN 9
+
+#define RADAR_PROTO_TARGETS 2
+#define RADAR_PROTO_TARGET_BASE 1
+#define RADAR_PROTO_TARGET_STRIDE 3
+#define RADAR_PROTO_PRESENCE 0
+
+#define RADAR_PROTO_FIELD_X RADAR_FIELD_NONE
+#define RADAR_PROTO_FIELD_Y RADAR_FIELD(0, 2, RADAR_ENC_UNSIGNED, 10.0f)
+#define RADAR_PROTO_FIELD_SPEED RADAR_FIELD_NONE
+
+#endif // RADAR_PROTOCOL_LD2410_H
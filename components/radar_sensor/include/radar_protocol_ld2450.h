@@ -0,0 +1,25 @@
+#ifndef RADAR_PROTOCOL_LD2450_H
+#define RADAR_PROTOCOL_LD2450_H
+
+// HLK-LD2450 tracking report: AA FF 03 00 | 3 x 8-byte target | 55 CC.
+// A target is x, y (mm), speed (cm/s) and distance resolution (mm), each
+// a 16-bit little endian word; an all-zero slot is an empty one.
+
+#define RADAR_PROTO_NAME "LD2450"
+
+#define RADAR_PROTO_HEADER 0xAA, 0xFF, 0x03, 0x00
+#define RADAR_PROTO_HEADER_LEN 4
+#define RADAR_PROTO_TAIL 0x55, 0xCC
+#define RADAR_PROTO_TAIL_LEN 2
+#define RADAR_PROTO_PAYLOAD_LEN 24
+
+#define RADAR_PROTO_TARGETS 3
+#define RADAR_PROTO_TARGET_BASE 0
+#define RADAR_PROTO_TARGET_STRIDE 8
+#define RADAR_PROTO_PRESENCE RADAR_PRESENCE_NONZERO_SLOT
+
+#define RADAR_PROTO_FIELD_X RADAR_FIELD(0, 2, RADAR_ENC_SIGN_MAGNITUDE, 1.0f)
+#define RADAR_PROTO_FIELD_Y RADAR_FIELD(2, 2, RADAR_ENC_SIGN_MAGNITUDE, 1.0f)
+#define RADAR_PROTO_FIELD_SPEED RADAR_FIELD(4, 2, RADAR_ENC_SIGN_MAGNITUDE, 1.0f)
+
+#endif // RADAR_PROTOCOL_LD2450_H
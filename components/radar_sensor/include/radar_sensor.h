@@ -6,48 +6,148 @@
 #include <math.h>
 #include "driver/uart.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "radar_frame.h"
+#include "radar_target.h"
 
-#define RADAR_BUFFER_SIZE 30
-#define RADAR_FRAME_SIZE 24
-#define RADAR_FULL_FRAME_SIZE 26
+// Data frame layout comes from the module descriptor (radar_protocol.h)
+#define RADAR_BUFFER_SIZE RADAR_PROTO_FRAME_LEN // Whole frame on the wire
+#define RADAR_FRAME_SIZE RADAR_PROTO_PAYLOAD_LEN
+#define RADAR_UART_EVENT_QUEUE_LEN 16
 
-typedef struct
-{
-    bool detected;
-    float x;
-    float y;
-    float speed;
-    float distance;
-    float angle;
-} radar_target_t;
+// Command channel (module config over the TX line). Frames are
+// FD FC FB FA | length | command | value | 04 03 02 01, ACKs echo the
+// command word with bit 8 set followed by a status word and return values.
+// The framing is shared by the LD2410 and LD2450; the tracking mode
+// commands exist on the LD2450 only and an LD2410 refuses them.
+#define RADAR_CMD_ENABLE_CONFIG 0x00FF
+#define RADAR_CMD_END_CONFIG 0x00FE
+#define RADAR_CMD_SINGLE_TARGET 0x0080
+#define RADAR_CMD_MULTI_TARGET 0x0090
+#define RADAR_CMD_QUERY_TRACKING 0x0091
+#define RADAR_CMD_READ_FIRMWARE 0x00A0
+#define RADAR_CMD_SET_BAUD 0x00A1
+#define RADAR_CMD_FACTORY_RESET 0x00A2
+#define RADAR_CMD_RESTART 0x00A3
+
+#define RADAR_CMD_MAX_STEPS 4
+#define RADAR_ACK_BUFFER_SIZE 32
+#define RADAR_CMD_ACK_TIMEOUT_US 500000
+#define RADAR_DEFAULT_BAUD 256000
 
 typedef enum
 {
-    WAIT_AA,
-    WAIT_FF,
-    WAIT_03,
-    WAIT_00,
-    RECEIVE_FRAME
+    WAIT_FRAME, // Data frames go through sensor->frame; FD starts an ACK
+    ACK_WAIT_FC,
+    ACK_WAIT_FB,
+    ACK_WAIT_FA,
+    ACK_LENGTH_LO,
+    ACK_LENGTH_HI,
+    RECEIVE_ACK
 } radar_parser_state_t;
 
+typedef enum
+{
+    RADAR_CMD_IDLE,
+    RADAR_CMD_BUSY,
+    RADAR_CMD_DONE,
+    RADAR_CMD_FAILED
+} radar_cmd_state_t;
+
+// One command frame of a sequence; value_len is 0 or 2
+typedef struct
+{
+    uint16_t command;
+    uint16_t value;
+    uint8_t value_len;
+} radar_cmd_step_t;
+
+// Outcome of a finished command sequence
+typedef struct
+{
+    esp_err_t error;   // ESP_OK, ESP_FAIL (module refused) or ESP_ERR_TIMEOUT
+    uint16_t command;  // Command whose return values are in reply
+    uint16_t status;   // ACK status word of the last step answered
+    uint8_t reply[RADAR_ACK_BUFFER_SIZE];
+    uint8_t reply_len;
+    uint32_t round_trip_us; // First frame sent -> last ACK received
+} radar_cmd_result_t;
+
+// Non-blocking request/response engine; the frame parser completes steps
+typedef struct
+{
+    radar_cmd_state_t state;
+    radar_cmd_step_t steps[RADAR_CMD_MAX_STEPS];
+    uint8_t step_count;
+    uint8_t step;        // Step waiting for its ACK
+    uint8_t result_step; // Step whose return values are kept
+    int64_t started_us;
+    int64_t step_sent_us;
+    uint32_t pending_baud; // Host baud to switch to once the module restarts
+    radar_cmd_result_t result;
+} radar_cmd_t;
+
 typedef struct
 {
     uart_port_t uart_port;
     gpio_num_t rx_pin;
     gpio_num_t tx_pin;
-    radar_target_t target;
-    uint8_t buffer[RADAR_BUFFER_SIZE];
-    size_t buffer_index;
+    QueueHandle_t uart_queue; // UART driver events, for queue-set based readers
+    radar_target_t target;    // First target slot, kept for single-target callers
+    radar_target_t targets[RADAR_MAX_TARGETS];
+    radar_frame_parser_t frame;
+    size_t buffer_index; // Bytes of the ACK received
     radar_parser_state_t parser_state;
+    uint8_t ack_buffer[RADAR_ACK_BUFFER_SIZE + 4]; // Payload + tail
+    uint16_t ack_length;
+    radar_cmd_t cmd;
+    int64_t frame_timestamp_us;  // esp_timer time at which the last valid frame completed
+    uint32_t frame_count;        // Valid frames since init
+    uint32_t target_frame_count; // Valid frames with at least one target
+    uint32_t overflow_count;     // RX buffer/FIFO overflows (bytes lost)
+    uint32_t byte_count;         // Bytes fed to the parser since init
 } radar_sensor_t;
 
 // Function prototypes
 esp_err_t radar_sensor_init(radar_sensor_t *sensor, uart_port_t uart_port,
                             gpio_num_t rx_pin, gpio_num_t tx_pin);
 esp_err_t radar_sensor_begin(radar_sensor_t *sensor, uint32_t baud_rate);
+esp_err_t radar_sensor_set_baud_rate(radar_sensor_t *sensor, uint32_t baud_rate);
+// Let the UART driver collect this many frames (2-4) before raising a data
+// event, or 0/1 for an event per frame. Fewer reader wake-ups for up to
+// (frames - 1) frame periods of extra latency; no bytes are skipped.
+esp_err_t radar_sensor_set_rx_batch(radar_sensor_t *sensor, uint8_t frames);
 bool radar_sensor_update(radar_sensor_t *sensor);
+// Drop buffered bytes and restart frame and ACK sync
+esp_err_t radar_sensor_resync(radar_sensor_t *sensor);
+// Delete and reinstall the UART driver, for a port that stopped delivering
+// data. uart_queue is replaced (NULL on failure); counters are kept.
+esp_err_t radar_sensor_reinstall(radar_sensor_t *sensor, uint32_t baud_rate);
+// Run bytes from any source (UART, software UART, replay) through the frame
+// parser. Returns the number of complete frames decoded.
+int radar_sensor_feed(radar_sensor_t *sensor, const uint8_t *data, size_t len);
+// Service one event from sensor->uart_queue. Returns frames decoded.
+int radar_sensor_handle_event(radar_sensor_t *sensor, const uart_event_t *event);
 bool radar_sensor_parse_data(radar_sensor_t *sensor, const uint8_t *buf, size_t len);
 radar_target_t radar_sensor_get_target(radar_sensor_t *sensor);
+
+// Command channel. Only one sequence runs at a time per sensor; starting
+// another returns ESP_ERR_INVALID_STATE. Replies are picked up by the frame
+// parser, so the caller keeps feeding the sensor and calls
+// radar_sensor_cmd_poll() to collect the result and enforce timeouts.
+esp_err_t radar_sensor_cmd_start(radar_sensor_t *sensor, const radar_cmd_step_t *steps,
+                                 size_t step_count, size_t result_step);
+esp_err_t radar_sensor_set_tracking_mode(radar_sensor_t *sensor, bool single_target);
+esp_err_t radar_sensor_query_firmware(radar_sensor_t *sensor);
+esp_err_t radar_sensor_factory_reset(radar_sensor_t *sensor);
+// Reconfigure the module's baud rate; the host UART follows once the module
+// has acknowledged its restart
+esp_err_t radar_sensor_change_module_baud(radar_sensor_t *sensor, uint32_t baud_rate);
+// Returns true once when a sequence has finished and fills result
+bool radar_sensor_cmd_poll(radar_sensor_t *sensor, radar_cmd_result_t *result);
+// Format a RADAR_CMD_READ_FIRMWARE reply as "V<major>.<minor>.<build>"
+void radar_sensor_format_firmware(const radar_cmd_result_t *result, char *buf, size_t size);
 void radar_sensor_deinit(radar_sensor_t *sensor);
 
 #endif // RADAR_SENSOR_H
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef RADAR_TARGET_H
+#define RADAR_TARGET_H
+
+#include <stdbool.h>
+
+// LD2450 frames carry up to three targets
+#define RADAR_MAX_TARGETS 3
+
+// Target in the sensor's own frame: x across the boresight, y along it (mm)
+typedef struct
+{
+    bool detected;
+    float x;
+    float y;
+    float speed;
+    float distance;
+    float angle;
+} radar_target_t;
+
+#endif // RADAR_TARGET_H
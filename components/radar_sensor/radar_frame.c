@@ -0,0 +1,101 @@
+#include "radar_frame.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const radar_field_t s_field_x = RADAR_PROTO_FIELD_X;
+static const radar_field_t s_field_y = RADAR_PROTO_FIELD_Y;
+static const radar_field_t s_field_speed = RADAR_PROTO_FIELD_SPEED;
+
+// Every argument is a constant once inlined, so each read reduces to the
+// loads, mask and multiply its encoding needs (a scale of 1 disappears)
+static inline __attribute__((always_inline)) float read_field(const uint8_t *slot,
+                                                              const radar_field_t field)
+{
+    if (field.encoding == RADAR_ENC_ABSENT)
+    {
+        return 0.0f;
+    }
+
+    uint32_t raw = slot[field.offset];
+    if (field.width == 2)
+    {
+        raw |= (uint32_t)slot[field.offset + 1] << 8;
+    }
+    uint32_t sign = 1u << (8 * field.width - 1);
+
+    float value;
+    switch (field.encoding)
+    {
+    case RADAR_ENC_SIGN_MAGNITUDE:
+        value = (raw & sign) ? -(float)(raw & (sign - 1)) : (float)(raw & (sign - 1));
+        break;
+    case RADAR_ENC_TWOS_COMPLEMENT:
+        value = (float)((int32_t)(raw ^ sign) - (int32_t)sign);
+        break;
+    default:
+        value = (float)raw;
+        break;
+    }
+    return value * field.scale;
+}
+
+static inline __attribute__((always_inline)) bool slot_present(const uint8_t *payload,
+                                                               const uint8_t *slot, int t)
+{
+#if RADAR_PROTO_PRESENCE == RADAR_PRESENCE_NONZERO_SLOT
+    (void)payload;
+    (void)t;
+    uint8_t any = 0;
+    for (int i = 0; i < RADAR_PROTO_TARGET_STRIDE; i++)
+    {
+        any |= slot[i];
+    }
+    return any != 0;
+#else
+    (void)slot;
+    return (payload[RADAR_PROTO_PRESENCE] >> t) & 1;
+#endif
+}
+
+int radar_frame_decode(const uint8_t *payload, radar_target_t targets[RADAR_MAX_TARGETS])
+{
+    int present = 0;
+
+    for (int t = 0; t < RADAR_PROTO_TARGETS; t++)
+    {
+        const uint8_t *slot = payload + RADAR_PROTO_TARGET_BASE + t * RADAR_PROTO_TARGET_STRIDE;
+        radar_target_t *target = &targets[t];
+
+        target->detected = slot_present(payload, slot, t);
+        target->x = read_field(slot, s_field_x);
+        target->y = read_field(slot, s_field_y);
+        target->speed = read_field(slot, s_field_speed);
+
+        if (target->detected)
+        {
+            present++;
+            target->distance = sqrtf(target->x * target->x + target->y * target->y);
+
+            // Angle calculation (convert radians to degrees, then flip)
+            float angle_rad = atan2f(target->y, target->x) - (M_PI / 2.0f);
+            float angle_deg = angle_rad * (180.0f / M_PI);
+            target->angle = -angle_deg; // align angle with x measurement positive/negative sign
+        }
+        else
+        {
+            target->distance = 0.0f;
+            target->angle = 0.0f;
+        }
+    }
+
+    for (int t = RADAR_PROTO_TARGETS; t < RADAR_MAX_TARGETS; t++)
+    {
+        memset(&targets[t], 0, sizeof(targets[t]));
+    }
+
+    return present;
+}
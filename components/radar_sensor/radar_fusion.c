@@ -0,0 +1,136 @@
+#include "radar_fusion.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void radar_fusion_init(radar_fusion_t *fusion, float merge_radius_mm, int64_t max_age_us)
+{
+    if (!fusion)
+    {
+        return;
+    }
+
+    memset(fusion, 0, sizeof(*fusion));
+    fusion->merge_radius_mm = merge_radius_mm;
+    fusion->max_age_us = max_age_us;
+}
+
+int radar_fusion_add_sensor(radar_fusion_t *fusion, const radar_mount_t *mount)
+{
+    if (!fusion || !mount || fusion->sensor_count >= RADAR_FUSION_MAX_SENSORS)
+    {
+        return -1;
+    }
+
+    radar_fusion_sensor_t *sensor = &fusion->sensors[fusion->sensor_count];
+    float rotation_rad = mount->rotation_deg * (float)(M_PI / 180.0);
+    sensor->cos_r = cosf(rotation_rad);
+    sensor->sin_r = sinf(rotation_rad);
+    sensor->offset_x = mount->x_mm;
+    sensor->offset_y = mount->y_mm;
+    sensor->timestamp_us = 0;
+
+    return (int)fusion->sensor_count++;
+}
+
+void radar_fusion_update(radar_fusion_t *fusion, int sensor,
+                         const radar_target_t targets[RADAR_MAX_TARGETS], int64_t now_us)
+{
+    if (!fusion || !targets || sensor < 0 || (size_t)sensor >= fusion->sensor_count)
+    {
+        return;
+    }
+
+    memcpy(fusion->sensors[sensor].targets, targets,
+           sizeof(fusion->sensors[sensor].targets));
+    fusion->sensors[sensor].timestamp_us = now_us;
+}
+
+void radar_mount_apply(const radar_mount_t *mount, float x, float y, float *room_x, float *room_y)
+{
+    float rotation_rad = mount->rotation_deg * (float)(M_PI / 180.0);
+    float c = cosf(rotation_rad);
+    float s = sinf(rotation_rad);
+    *room_x = x * c - y * s + mount->x_mm;
+    *room_y = x * s + y * c + mount->y_mm;
+}
+
+size_t radar_fusion_merge(const radar_fusion_t *fusion, int64_t now_us,
+                          radar_fused_target_t *out, size_t max_targets)
+{
+    if (!fusion || !out || max_targets == 0)
+    {
+        return 0;
+    }
+
+    // Running sums per cluster so the centroid moves as points join
+    uint8_t members[RADAR_FUSION_MAX_TARGETS];
+    size_t count = 0;
+    float radius_sq = fusion->merge_radius_mm * fusion->merge_radius_mm;
+
+    for (size_t s = 0; s < fusion->sensor_count; s++)
+    {
+        const radar_fusion_sensor_t *sensor = &fusion->sensors[s];
+        if (sensor->timestamp_us == 0 || now_us - sensor->timestamp_us > fusion->max_age_us)
+        {
+            continue;
+        }
+
+        for (int t = 0; t < RADAR_MAX_TARGETS; t++)
+        {
+            const radar_target_t *target = &sensor->targets[t];
+            if (!target->detected)
+            {
+                continue;
+            }
+
+            float x = target->x * sensor->cos_r - target->y * sensor->sin_r + sensor->offset_x;
+            float y = target->x * sensor->sin_r + target->y * sensor->cos_r + sensor->offset_y;
+
+            // Nearest cluster that this sensor has not contributed to yet;
+            // two targets from one sensor are always two people
+            int best = -1;
+            float best_dist_sq = radius_sq;
+            for (size_t c = 0; c < count; c++)
+            {
+                if (out[c].sensor_mask & (1u << s))
+                {
+                    continue;
+                }
+                float dx = out[c].x - x;
+                float dy = out[c].y - y;
+                float dist_sq = dx * dx + dy * dy;
+                if (dist_sq <= best_dist_sq)
+                {
+                    best = (int)c;
+                    best_dist_sq = dist_sq;
+                }
+            }
+
+            if (best >= 0)
+            {
+                radar_fused_target_t *fused = &out[best];
+                float n = (float)members[best];
+                fused->x = (fused->x * n + x) / (n + 1.0f);
+                fused->y = (fused->y * n + y) / (n + 1.0f);
+                fused->speed = (fused->speed * n + target->speed) / (n + 1.0f);
+                fused->sensor_mask |= (uint8_t)(1u << s);
+                members[best]++;
+            }
+            else if (count < max_targets && count < RADAR_FUSION_MAX_TARGETS)
+            {
+                out[count].x = x;
+                out[count].y = y;
+                out[count].speed = target->speed;
+                out[count].sensor_mask = (uint8_t)(1u << s);
+                members[count] = 1;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
@@ -1,8 +1,23 @@
 #include "radar_sensor.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
 static const char *TAG = "RADAR_SENSOR";
 
+// Bytes pulled from the UART driver per read call
+#define RADAR_READ_CHUNK 64
+
+// UART driver defaults: a data event per burst (RX idle for 10 symbols) or
+// when the hardware FIFO holds 120 bytes
+#define RADAR_RX_TOUT_DEFAULT 10
+#define RADAR_RX_FULL_DEFAULT 120
+// Batched frames must fit the 128 byte hardware FIFO
+#define RADAR_RX_BATCH_MAX 4
+
 esp_err_t radar_sensor_init(radar_sensor_t *sensor, uart_port_t uart_port,
                             gpio_num_t rx_pin, gpio_num_t tx_pin)
 {
@@ -15,15 +30,20 @@ esp_err_t radar_sensor_init(radar_sensor_t *sensor, uart_port_t uart_port,
     sensor->rx_pin = rx_pin;
     sensor->tx_pin = tx_pin;
     sensor->buffer_index = 0;
-    sensor->parser_state = WAIT_AA;
+    sensor->parser_state = WAIT_FRAME;
+    radar_frame_reset(&sensor->frame);
+    sensor->frame_timestamp_us = 0;
+    sensor->frame_count = 0;
+    sensor->target_frame_count = 0;
+    sensor->overflow_count = 0;
+    sensor->byte_count = 0;
+    sensor->uart_queue = NULL;
+    sensor->ack_length = 0;
+    memset(&sensor->cmd, 0, sizeof(sensor->cmd));
 
-    // Initialize target structure
-    sensor->target.detected = false;
-    sensor->target.x = 0.0f;
-    sensor->target.y = 0.0f;
-    sensor->target.speed = 0.0f;
-    sensor->target.distance = 0.0f;
-    sensor->target.angle = 0.0f;
+    // Initialize target structures
+    memset(sensor->targets, 0, sizeof(sensor->targets));
+    sensor->target = sensor->targets[0];
 
     return ESP_OK;
 }
@@ -58,7 +78,10 @@ esp_err_t radar_sensor_begin(radar_sensor_t *sensor, uint32_t baud_rate)
         return ret;
     }
 
-    ret = uart_driver_install(sensor->uart_port, 1024, 1024, 0, NULL, 0);
+    // The event queue lets one reader task block on several sensors at once;
+    // polling callers can ignore it
+    ret = uart_driver_install(sensor->uart_port, 1024, 1024,
+                              RADAR_UART_EVENT_QUEUE_LEN, &sensor->uart_queue, 0);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to install UART driver");
@@ -68,6 +91,180 @@ esp_err_t radar_sensor_begin(radar_sensor_t *sensor, uint32_t baud_rate)
     return ESP_OK;
 }
 
+esp_err_t radar_sensor_set_baud_rate(radar_sensor_t *sensor, uint32_t baud_rate)
+{
+    if (!sensor)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = uart_set_baudrate(sensor->uart_port, baud_rate);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to change UART baud rate");
+        return ret;
+    }
+
+    // Bytes received at the old rate are garbage; restart frame sync
+    return radar_sensor_resync(sensor);
+}
+
+esp_err_t radar_sensor_resync(radar_sensor_t *sensor)
+{
+    if (!sensor)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = uart_flush_input(sensor->uart_port);
+    sensor->parser_state = WAIT_FRAME;
+    sensor->buffer_index = 0;
+    radar_frame_reset(&sensor->frame);
+    return ret;
+}
+
+esp_err_t radar_sensor_reinstall(radar_sensor_t *sensor, uint32_t baud_rate)
+{
+    if (!sensor)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    radar_sensor_deinit(sensor);
+    sensor->parser_state = WAIT_FRAME;
+    sensor->buffer_index = 0;
+    radar_frame_reset(&sensor->frame);
+    return radar_sensor_begin(sensor, baud_rate);
+}
+
+esp_err_t radar_sensor_set_rx_batch(radar_sensor_t *sensor, uint8_t frames)
+{
+    if (!sensor || frames > RADAR_RX_BATCH_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (frames <= 1)
+    {
+        esp_err_t ret = uart_set_rx_full_threshold(sensor->uart_port, RADAR_RX_FULL_DEFAULT);
+        if (ret == ESP_OK)
+        {
+            ret = uart_set_rx_timeout(sensor->uart_port, RADAR_RX_TOUT_DEFAULT);
+        }
+        return ret;
+    }
+
+    // No idle timeout: the driver only raises an event once the FIFO holds
+    // this many frames. Partial frames stay in the FIFO for the next batch.
+    esp_err_t ret = uart_set_rx_full_threshold(sensor->uart_port, frames * RADAR_BUFFER_SIZE);
+    if (ret == ESP_OK)
+    {
+        ret = uart_set_rx_timeout(sensor->uart_port, 0);
+    }
+    return ret;
+}
+
+static void cmd_send_frame(radar_sensor_t *sensor, const radar_cmd_step_t *step)
+{
+    uint8_t frame[14];
+    size_t len = 0;
+    uint16_t payload_len = 2 + step->value_len;
+
+    frame[len++] = 0xFD;
+    frame[len++] = 0xFC;
+    frame[len++] = 0xFB;
+    frame[len++] = 0xFA;
+    frame[len++] = payload_len & 0xFF;
+    frame[len++] = payload_len >> 8;
+    frame[len++] = step->command & 0xFF;
+    frame[len++] = step->command >> 8;
+    if (step->value_len == 2)
+    {
+        frame[len++] = step->value & 0xFF;
+        frame[len++] = step->value >> 8;
+    }
+    frame[len++] = 0x04;
+    frame[len++] = 0x03;
+    frame[len++] = 0x02;
+    frame[len++] = 0x01;
+
+    // Copies into the TX ring buffer and returns without waiting for the wire
+    uart_write_bytes(sensor->uart_port, frame, len);
+}
+
+static void cmd_finish(radar_sensor_t *sensor, esp_err_t error, int64_t now_us)
+{
+    radar_cmd_t *cmd = &sensor->cmd;
+    uint16_t command = cmd->steps[cmd->step].command;
+
+    cmd->result.error = error;
+    cmd->result.round_trip_us = (uint32_t)(now_us - cmd->started_us);
+    cmd->state = (error == ESP_OK) ? RADAR_CMD_DONE : RADAR_CMD_FAILED;
+
+    if (error != ESP_OK)
+    {
+        // Do not leave the module stuck in config mode (it stops reporting)
+        if (command != RADAR_CMD_END_CONFIG && command != RADAR_CMD_RESTART)
+        {
+            const radar_cmd_step_t end = {.command = RADAR_CMD_END_CONFIG};
+            cmd_send_frame(sensor, &end);
+        }
+        return;
+    }
+
+    if (cmd->pending_baud)
+    {
+        radar_sensor_set_baud_rate(sensor, cmd->pending_baud);
+    }
+}
+
+static void cmd_send_step(radar_sensor_t *sensor)
+{
+    radar_cmd_t *cmd = &sensor->cmd;
+    cmd_send_frame(sensor, &cmd->steps[cmd->step]);
+    cmd->step_sent_us = esp_timer_get_time();
+}
+
+static void cmd_handle_ack(radar_sensor_t *sensor)
+{
+    radar_cmd_t *cmd = &sensor->cmd;
+    uint16_t command = sensor->ack_buffer[0] | (sensor->ack_buffer[1] << 8);
+    uint16_t status = sensor->ack_buffer[2] | (sensor->ack_buffer[3] << 8);
+
+    if (cmd->state != RADAR_CMD_BUSY || command != (cmd->steps[cmd->step].command | 0x0100))
+    {
+        // Late ACK of a timed-out step
+        ESP_LOGD(TAG, "Ignoring ACK for command 0x%04x", command);
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    METRICS_HIST_RECORD(METRICS_HIST_RADAR_CMD, now_us - cmd->step_sent_us);
+    cmd->result.status = status;
+
+    if (status != 0)
+    {
+        cmd_finish(sensor, ESP_FAIL, now_us);
+        return;
+    }
+
+    if (cmd->step == cmd->result_step)
+    {
+        cmd->result.command = cmd->steps[cmd->step].command;
+        cmd->result.reply_len = (uint8_t)(sensor->ack_length - 4);
+        memcpy(cmd->result.reply, sensor->ack_buffer + 4, cmd->result.reply_len);
+    }
+
+    if (++cmd->step >= cmd->step_count)
+    {
+        cmd->step = cmd->step_count - 1;
+        cmd_finish(sensor, ESP_OK, now_us);
+        return;
+    }
+
+    cmd_send_step(sensor);
+}
+
 bool radar_sensor_update(radar_sensor_t *sensor)
 {
     if (!sensor)
@@ -76,70 +273,159 @@ bool radar_sensor_update(radar_sensor_t *sensor)
     }
 
     bool data_updated = false;
-    uint8_t byte_in;
+    uint8_t chunk[RADAR_READ_CHUNK];
+    int len;
 
-    while (uart_read_bytes(sensor->uart_port, &byte_in, 1, 0) > 0)
+    while ((len = uart_read_bytes(sensor->uart_port, chunk, sizeof(chunk), 0)) > 0)
     {
-        switch (sensor->parser_state)
+        if (radar_sensor_feed(sensor, chunk, (size_t)len) > 0)
+        {
+            data_updated = true;
+        }
+    }
+
+    return data_updated;
+}
+
+int radar_sensor_handle_event(radar_sensor_t *sensor, const uart_event_t *event)
+{
+    if (!sensor || !event)
+    {
+        return 0;
+    }
+
+    switch (event->type)
+    {
+    case UART_DATA:
+    {
+        uint8_t chunk[RADAR_READ_CHUNK];
+        size_t remaining = event->size;
+        int frames = 0;
+        while (remaining > 0)
         {
-        case WAIT_AA:
-            if (byte_in == 0xAA)
+            size_t want = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+            int len = uart_read_bytes(sensor->uart_port, chunk, want, 0);
+            if (len <= 0)
             {
-                sensor->parser_state = WAIT_FF;
+                break;
             }
-            break;
+            frames += radar_sensor_feed(sensor, chunk, (size_t)len);
+            remaining -= (size_t)len;
+        }
+        return frames;
+    }
+
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+        // Bytes were dropped mid-frame; start again from a clean buffer
+        sensor->overflow_count++;
+        radar_sensor_resync(sensor);
+        xQueueReset(sensor->uart_queue);
+        return 0;
 
-        case WAIT_FF:
-            if (byte_in == 0xFF)
+    default:
+        return 0;
+    }
+}
+
+int radar_sensor_feed(radar_sensor_t *sensor, const uint8_t *data, size_t len)
+{
+    if (!sensor || !data)
+    {
+        return 0;
+    }
+
+    int frames = 0;
+    sensor->byte_count += (uint32_t)len;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t byte_in = data[i];
+
+        switch (sensor->parser_state)
+        {
+        case WAIT_FRAME:
+        {
+            radar_frame_status_t status = radar_frame_push(&sensor->frame, byte_in);
+            if (status == RADAR_FRAME_NONE)
             {
-                sensor->parser_state = WAIT_03;
+                if (byte_in == 0xFD)
+                {
+                    sensor->parser_state = ACK_WAIT_FC;
+                }
             }
-            else
+            else if (status == RADAR_FRAME_READY)
             {
-                sensor->parser_state = WAIT_AA;
+                int64_t parse_start = METRICS_NOW_US();
+                if (radar_sensor_parse_data(sensor, sensor->frame.buffer, RADAR_FRAME_SIZE))
+                {
+                    frames++;
+                    sensor->frame_count++;
+                    for (int t = 0; t < RADAR_MAX_TARGETS; t++)
+                    {
+                        if (sensor->targets[t].detected)
+                        {
+                            sensor->target_frame_count++;
+                            break;
+                        }
+                    }
+                }
+                sensor->frame_timestamp_us = esp_timer_get_time();
+                METRICS_HIST_RECORD(METRICS_HIST_FRAME_PARSE,
+                                    sensor->frame_timestamp_us - parse_start);
+                METRICS_TRACE(METRICS_EVT_FRAME_PARSED, sensor->target.detected);
             }
             break;
+        }
 
-        case WAIT_03:
-            if (byte_in == 0x03)
-            {
-                sensor->parser_state = WAIT_00;
-            }
-            else
-            {
-                sensor->parser_state = WAIT_AA;
-            }
+        case ACK_WAIT_FC:
+            sensor->parser_state = (byte_in == 0xFC) ? ACK_WAIT_FB : WAIT_FRAME;
+            break;
+
+        case ACK_WAIT_FB:
+            sensor->parser_state = (byte_in == 0xFB) ? ACK_WAIT_FA : WAIT_FRAME;
+            break;
+
+        case ACK_WAIT_FA:
+            sensor->parser_state = (byte_in == 0xFA) ? ACK_LENGTH_LO : WAIT_FRAME;
             break;
 
-        case WAIT_00:
-            if (byte_in == 0x00)
+        case ACK_LENGTH_LO:
+            sensor->ack_length = byte_in;
+            sensor->parser_state = ACK_LENGTH_HI;
+            break;
+
+        case ACK_LENGTH_HI:
+            sensor->ack_length |= (uint16_t)(byte_in << 8);
+            // Command word + status word at minimum
+            if (sensor->ack_length < 4 || sensor->ack_length > RADAR_ACK_BUFFER_SIZE)
             {
-                sensor->buffer_index = 0;
-                sensor->parser_state = RECEIVE_FRAME;
+                sensor->parser_state = WAIT_FRAME;
             }
             else
             {
-                sensor->parser_state = WAIT_AA;
+                sensor->buffer_index = 0;
+                sensor->parser_state = RECEIVE_ACK;
             }
             break;
 
-        case RECEIVE_FRAME:
-            sensor->buffer[sensor->buffer_index++] = byte_in;
-            if (sensor->buffer_index >= RADAR_FULL_FRAME_SIZE)
+        case RECEIVE_ACK:
+            sensor->ack_buffer[sensor->buffer_index++] = byte_in;
+            if (sensor->buffer_index >= sensor->ack_length + 4u)
             {
-                // Check tail bytes
-                if (sensor->buffer[24] == 0x55 && sensor->buffer[25] == 0xCC)
+                const uint8_t *tail = sensor->ack_buffer + sensor->ack_length;
+                if (tail[0] == 0x04 && tail[1] == 0x03 && tail[2] == 0x02 && tail[3] == 0x01)
                 {
-                    data_updated = radar_sensor_parse_data(sensor, sensor->buffer, RADAR_FRAME_SIZE);
+                    cmd_handle_ack(sensor);
                 }
-                sensor->parser_state = WAIT_AA;
+                sensor->parser_state = WAIT_FRAME;
                 sensor->buffer_index = 0;
             }
             break;
         }
     }
 
-    return data_updated;
+    return frames;
 }
 
 bool radar_sensor_parse_data(radar_sensor_t *sensor, const uint8_t *buf, size_t len)
@@ -149,47 +435,169 @@ bool radar_sensor_parse_data(radar_sensor_t *sensor, const uint8_t *buf, size_t
         return false;
     }
 
-    // Parse first 8 bytes for the first target
-    int16_t raw_x = buf[0] | (buf[1] << 8);
-    int16_t raw_y = buf[2] | (buf[3] << 8);
-    int16_t raw_speed = buf[4] | (buf[5] << 8);
-    uint16_t raw_pixel_dist = buf[6] | (buf[7] << 8);
+    radar_frame_decode(buf, sensor->targets);
+    sensor->target = sensor->targets[0];
 
-    sensor->target.detected = !(raw_x == 0 && raw_y == 0 && raw_speed == 0 && raw_pixel_dist == 0);
+    return true;
+}
+
+radar_target_t radar_sensor_get_target(radar_sensor_t *sensor)
+{
+    if (!sensor)
+    {
+        radar_target_t empty_target = {0};
+        return empty_target;
+    }
 
-    // Parse signed values (fix the sign bit logic from original)
-    sensor->target.x = (raw_x & 0x8000) ? -(raw_x & 0x7FFF) : (raw_x & 0x7FFF);
-    sensor->target.y = (raw_y & 0x8000) ? -(raw_y & 0x7FFF) : (raw_y & 0x7FFF);
-    sensor->target.speed = (raw_speed & 0x8000) ? -(raw_speed & 0x7FFF) : (raw_speed & 0x7FFF);
+    return sensor->target;
+}
 
-    if (sensor->target.detected)
+esp_err_t radar_sensor_cmd_start(radar_sensor_t *sensor, const radar_cmd_step_t *steps,
+                                 size_t step_count, size_t result_step)
+{
+    if (!sensor || !steps || step_count == 0 || step_count > RADAR_CMD_MAX_STEPS ||
+        result_step >= step_count)
     {
-        sensor->target.distance = sqrtf(sensor->target.x * sensor->target.x +
-                                        sensor->target.y * sensor->target.y);
+        return ESP_ERR_INVALID_ARG;
+    }
 
-        // Angle calculation (convert radians to degrees, then flip)
-        float angle_rad = atan2f(sensor->target.y, sensor->target.x) - (M_PI / 2.0f);
-        float angle_deg = angle_rad * (180.0f / M_PI);
-        sensor->target.angle = -angle_deg; // align angle with x measurement positive/negative sign
+    radar_cmd_t *cmd = &sensor->cmd;
+    if (cmd->state != RADAR_CMD_IDLE)
+    {
+        return ESP_ERR_INVALID_STATE;
     }
-    else
+
+    memcpy(cmd->steps, steps, step_count * sizeof(steps[0]));
+    cmd->step_count = (uint8_t)step_count;
+    cmd->step = 0;
+    cmd->result_step = (uint8_t)result_step;
+    cmd->pending_baud = 0;
+    memset(&cmd->result, 0, sizeof(cmd->result));
+    cmd->result.command = steps[result_step].command;
+    cmd->state = RADAR_CMD_BUSY;
+    cmd->started_us = esp_timer_get_time();
+
+    cmd_send_step(sensor);
+    return ESP_OK;
+}
+
+// Wrap one command in enable/end config mode
+static esp_err_t cmd_start_configured(radar_sensor_t *sensor, uint16_t command)
+{
+    const radar_cmd_step_t steps[] = {
+        {.command = RADAR_CMD_ENABLE_CONFIG, .value = 0x0001, .value_len = 2},
+        {.command = command},
+        {.command = RADAR_CMD_END_CONFIG},
+    };
+    return radar_sensor_cmd_start(sensor, steps, 3, 1);
+}
+
+esp_err_t radar_sensor_set_tracking_mode(radar_sensor_t *sensor, bool single_target)
+{
+    return cmd_start_configured(sensor, single_target ? RADAR_CMD_SINGLE_TARGET
+                                                      : RADAR_CMD_MULTI_TARGET);
+}
+
+esp_err_t radar_sensor_query_firmware(radar_sensor_t *sensor)
+{
+    return cmd_start_configured(sensor, RADAR_CMD_READ_FIRMWARE);
+}
+
+esp_err_t radar_sensor_factory_reset(radar_sensor_t *sensor)
+{
+    // The reset only takes effect after a restart, which also ends config mode
+    const radar_cmd_step_t steps[] = {
+        {.command = RADAR_CMD_ENABLE_CONFIG, .value = 0x0001, .value_len = 2},
+        {.command = RADAR_CMD_FACTORY_RESET},
+        {.command = RADAR_CMD_RESTART},
+    };
+    esp_err_t ret = radar_sensor_cmd_start(sensor, steps, 3, 1);
+    if (ret == ESP_OK)
+    {
+        sensor->cmd.pending_baud = RADAR_DEFAULT_BAUD;
+    }
+    return ret;
+}
+
+esp_err_t radar_sensor_change_module_baud(radar_sensor_t *sensor, uint32_t baud_rate)
+{
+    static const uint32_t rates[] = {9600, 19200, 38400, 57600, 115200, 230400, 256000, 460800};
+    uint16_t index = 0;
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
     {
-        sensor->target.distance = 0.0f;
-        sensor->target.angle = 0.0f;
+        if (rates[i] == baud_rate)
+        {
+            index = (uint16_t)(i + 1);
+            break;
+        }
+    }
+    if (index == 0)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    return true;
+    const radar_cmd_step_t steps[] = {
+        {.command = RADAR_CMD_ENABLE_CONFIG, .value = 0x0001, .value_len = 2},
+        {.command = RADAR_CMD_SET_BAUD, .value = index, .value_len = 2},
+        {.command = RADAR_CMD_RESTART},
+    };
+    esp_err_t ret = radar_sensor_cmd_start(sensor, steps, 3, 1);
+    if (ret == ESP_OK)
+    {
+        sensor->cmd.pending_baud = baud_rate;
+    }
+    return ret;
 }
 
-radar_target_t radar_sensor_get_target(radar_sensor_t *sensor)
+bool radar_sensor_cmd_poll(radar_sensor_t *sensor, radar_cmd_result_t *result)
 {
     if (!sensor)
     {
-        radar_target_t empty_target = {0};
-        return empty_target;
+        return false;
     }
 
-    return sensor->target;
+    radar_cmd_t *cmd = &sensor->cmd;
+    if (cmd->state == RADAR_CMD_BUSY)
+    {
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - cmd->step_sent_us <= RADAR_CMD_ACK_TIMEOUT_US)
+        {
+            return false;
+        }
+        cmd_finish(sensor, ESP_ERR_TIMEOUT, now_us);
+    }
+
+    if (cmd->state == RADAR_CMD_IDLE)
+    {
+        return false;
+    }
+
+    if (result)
+    {
+        *result = cmd->result;
+    }
+    cmd->state = RADAR_CMD_IDLE;
+    return true;
+}
+
+void radar_sensor_format_firmware(const radar_cmd_result_t *result, char *buf, size_t size)
+{
+    if (!buf || size == 0)
+    {
+        return;
+    }
+    if (!result || result->command != RADAR_CMD_READ_FIRMWARE || result->reply_len < 8)
+    {
+        snprintf(buf, size, "unknown");
+        return;
+    }
+
+    // Reply: firmware type (2), major (2), minor (4), little endian
+    const uint8_t *r = result->reply;
+    uint16_t major = r[2] | (r[3] << 8);
+    uint32_t minor = r[4] | (r[5] << 8) | (r[6] << 16) | ((uint32_t)r[7] << 24);
+    snprintf(buf, size, "V%u.%02x.%08" PRIx32, major >> 8, major & 0xFF, minor);
 }
 
 void radar_sensor_deinit(radar_sensor_t *sensor)
@@ -197,5 +605,6 @@ void radar_sensor_deinit(radar_sensor_t *sensor)
     if (sensor)
     {
         uart_driver_delete(sensor->uart_port);
+        sensor->uart_queue = NULL;
     }
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef RULES_H
+#define RULES_H
+
+// Relay policy as text, compiled at load time into bytecode that runs
+// against every fused frame. Straight-line code (no jumps or loops) over a
+// fixed stack and fixed timer slots, so evaluation never allocates and its
+// cost is bounded at compile time. Plain C with no ESP-IDF dependencies;
+// tools/rules_bench measures it on the host.
+//
+//   program := rule { (';' | newline) rule }
+//   rule    := 'relay' N '=' expr [ 'hold' seconds ]
+//   expr    := and { ('|' | 'or') and }
+//   and     := not { ('&' | 'and') not }
+//   not     := ('!' | 'not') not | cmp
+//   cmp     := value [ ('<' | '<=' | '>' | '>=' | '==' | '!=') value ]
+//   value   := number | HH:MM | name | '(' expr ')'
+//            | 'in' '(' x0 ',' y0 ',' x1 ',' y1 ')'  targets in a rectangle
+//            | 'approach' '(' N ')'                  doorway N predicted
+//            | 'during' '(' HH:MM ',' HH:MM ')'      local time in window
+//
+// Names: present (targets within presence range), targets (all), moving
+// (fastest target, cm/s), hour, minute and time (local time, time in
+// minutes since midnight so it compares with HH:MM; -1 until known).
+// Coordinates are room-frame millimetres. '#' starts a comment.
+// Comparisons and logic give 0 or 1; any non-zero value is true. A relay
+// is on while any of its rules is true or was true less than hold seconds
+// ago, and off when no rule names it.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "radar_fusion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RULES_TEXT_MAX 512   ///< Longest rule text, including terminator
+#define RULES_CODE_MAX 256   ///< Bytecode bytes
+#define RULES_MAX 16         ///< Rules per program
+#define RULES_OUTPUTS 8      ///< relay1 .. relay8
+#define RULES_STACK_MAX 16   ///< Evaluation stack depth
+#define RULES_COST_MAX 1024  ///< Operations per evaluation, worst case
+
+/**
+ * @brief Frame inputs a program can read
+ */
+typedef struct {
+  const radar_fused_target_t* targets;  ///< Room frame
+  size_t count;
+  uint32_t present;       ///< Targets within the presence range
+  uint8_t approach_mask;  ///< Doorways being approached, bit 0 = entry 1
+  int32_t minute_of_day;  ///< Local time, -1 while unknown
+  int64_t now_us;         ///< Clock for hold timers
+} rules_input_t;
+
+/**
+ * @brief Compiled program and its timer state, about 0.5 KB; keep it static
+ */
+typedef struct {
+  uint8_t code[RULES_CODE_MAX];
+  uint16_t code_len;
+  uint8_t rule_count;
+  uint16_t cost;                    ///< Worst-case operations per frame
+  uint8_t outputs_used;             ///< Relays named by some rule
+  uint32_t hold_s[RULES_MAX];       ///< Per rule, 0 for none
+  int64_t last_true_us[RULES_MAX];  ///< Per rule, when it last held
+  bool was_true[RULES_MAX];
+} rules_program_t;
+
+/**
+ * @brief Where and why compilation failed
+ */
+typedef struct {
+  size_t offset;        ///< Character offset into the text
+  const char* message;  ///< Static string
+} rules_error_t;
+
+/**
+ * @brief Compile rule text and clear the timers
+ *
+ * Rejects programs that would overrun RULES_CODE_MAX, RULES_STACK_MAX or
+ * RULES_COST_MAX. An empty text compiles to a program with no rules.
+ *
+ * @param program Destination, left empty on failure
+ * @param text Rule text
+ * @param error Filled on failure, may be NULL
+ * @return true on success
+ */
+bool rules_compile(rules_program_t* program, const char* text,
+                   rules_error_t* error);
+
+/**
+ * @brief Run the program on one frame
+ *
+ * At most program->cost operations, no allocation, no recursion.
+ *
+ * @param program Compiled program
+ * @param input Frame inputs
+ * @return Relay mask, bit 0 = relay1
+ */
+uint8_t rules_eval(rules_program_t* program, const rules_input_t* input);
+
+/**
+ * @brief Write a readable listing of the bytecode, for the console
+ *
+ * @param program Compiled program
+ * @param buf Destination
+ * @param len Destination size
+ * @return Characters written (truncated to fit)
+ */
+int rules_disassemble(const rules_program_t* program, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RULES_H
@@ -0,0 +1,663 @@
+#include "rules.h"
+#include <stdio.h>
+#include <string.h>
+
+// Bytecode: one opcode byte followed by its operands, little-endian
+typedef enum {
+  OP_PUSH = 1,  ///< int16 constant
+  OP_LOAD,      ///< uint8 variable
+  OP_IN,        ///< int16 x0, y0, x1, y1 (already ordered)
+  OP_APPROACH,  ///< uint8 doorway bit
+  OP_DURING,    ///< uint16 start, end minute of day
+  OP_NOT,
+  OP_AND,
+  OP_OR,
+  OP_LT,
+  OP_LE,
+  OP_GT,
+  OP_GE,
+  OP_EQ,
+  OP_NE,
+  OP_STORE,  ///< uint8 relay, uint8 rule
+} rules_op_t;
+
+typedef enum {
+  VAR_PRESENT,
+  VAR_TARGETS,
+  VAR_MOVING,
+  VAR_HOUR,
+  VAR_MINUTE,
+  VAR_TIME,
+} rules_var_t;
+
+static const char* const s_var_names[] = {
+    "present", "targets", "moving", "hour", "minute", "time",
+};
+
+static const char* const s_op_names[] = {
+    "?",  "push", "load", "in", "approach", "during", "not", "and",
+    "or", "lt",   "le",   "gt", "ge",       "eq",     "ne",  "store",
+};
+
+// Nesting of parentheses and 'not' while compiling; the parser recurses
+#define MAX_NESTING 16
+
+typedef enum {
+  TOK_END,
+  TOK_SEP,  ///< ';' or newline
+  TOK_NUMBER,
+  TOK_TIME,  ///< HH:MM, value in minutes
+  TOK_NAME,
+  TOK_PUNCT,  ///< Operator or bracket, spelled in punct
+} token_kind_t;
+
+typedef struct {
+  const char* text;
+  size_t pos;
+  // Current token
+  token_kind_t kind;
+  size_t start;
+  int32_t value;
+  char name[12];
+  char punct[3];
+  // Output
+  rules_program_t* program;
+  int depth;  ///< Stack depth at this point of the code
+  int nesting;
+  rules_error_t error;
+} compiler_t;
+
+static bool fail(compiler_t* c, size_t offset, const char* message) {
+  if (!c->error.message) {
+    c->error.offset = offset;
+    c->error.message = message;
+  }
+  return false;
+}
+
+static bool next_token(compiler_t* c) {
+  const char* s = c->text;
+  while (s[c->pos] == ' ' || s[c->pos] == '\t' || s[c->pos] == '\r') {
+    c->pos++;
+  }
+  if (s[c->pos] == '#') {  // Comment to end of line
+    while (s[c->pos] && s[c->pos] != '\n') {
+      c->pos++;
+    }
+  }
+  c->start = c->pos;
+  char ch = s[c->pos];
+  if (ch == '\0') {
+    c->kind = TOK_END;
+    return true;
+  }
+  if (ch == ';' || ch == '\n') {
+    c->kind = TOK_SEP;
+    c->pos++;
+    return true;
+  }
+  if (ch >= '0' && ch <= '9') {
+    int32_t value = 0;
+    while (s[c->pos] >= '0' && s[c->pos] <= '9') {
+      value = value * 10 + (s[c->pos++] - '0');
+      if (value > 99999) {
+        return fail(c, c->start, "number too large");
+      }
+    }
+    c->kind = TOK_NUMBER;
+    if (s[c->pos] == ':') {
+      c->pos++;
+      if (s[c->pos] < '0' || s[c->pos] > '9' || s[c->pos + 1] < '0' ||
+          s[c->pos + 1] > '9') {
+        return fail(c, c->start, "time must be HH:MM");
+      }
+      int32_t minute = (s[c->pos] - '0') * 10 + (s[c->pos + 1] - '0');
+      c->pos += 2;
+      if (value > 23 || minute > 59) {
+        return fail(c, c->start, "time out of range");
+      }
+      value = value * 60 + minute;
+      c->kind = TOK_TIME;
+    }
+    c->value = value;
+    return true;
+  }
+  if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_') {
+    size_t n = 0;
+    while ((s[c->pos] >= 'a' && s[c->pos] <= 'z') ||
+           (s[c->pos] >= 'A' && s[c->pos] <= 'Z') ||
+           (s[c->pos] >= '0' && s[c->pos] <= '9') || s[c->pos] == '_') {
+      if (n + 1 >= sizeof(c->name)) {
+        return fail(c, c->start, "name too long");
+      }
+      char letter = s[c->pos++];
+      c->name[n++] = (letter >= 'A' && letter <= 'Z') ? letter + 32 : letter;
+    }
+    c->name[n] = '\0';
+    c->kind = TOK_NAME;
+    return true;
+  }
+  static const char* const two_char[] = {"<=", ">=", "==", "!=", "&&", "||"};
+  for (size_t i = 0; i < sizeof(two_char) / sizeof(two_char[0]); i++) {
+    if (ch == two_char[i][0] && s[c->pos + 1] == two_char[i][1]) {
+      // && and || are accepted as & and |
+      c->punct[0] = ch;
+      c->punct[1] = (ch == '&' || ch == '|') ? '\0' : s[c->pos + 1];
+      c->punct[2] = '\0';
+      c->pos += 2;
+      c->kind = TOK_PUNCT;
+      return true;
+    }
+  }
+  if (strchr("()<>=!&|,-", ch)) {
+    c->punct[0] = ch;
+    c->punct[1] = '\0';
+    c->pos++;
+    c->kind = TOK_PUNCT;
+    return true;
+  }
+  return fail(c, c->start, "unexpected character");
+}
+
+static bool is_punct(const compiler_t* c, const char* p) {
+  return c->kind == TOK_PUNCT && strcmp(c->punct, p) == 0;
+}
+
+static bool is_name(const compiler_t* c, const char* name) {
+  return c->kind == TOK_NAME && strcmp(c->name, name) == 0;
+}
+
+static bool expect_punct(compiler_t* c, const char* p, const char* message) {
+  if (!is_punct(c, p)) {
+    return fail(c, c->start, message);
+  }
+  return next_token(c);
+}
+
+// Append an opcode and its operands; pops/pushes keep depth honest
+static bool emit(compiler_t* c, uint8_t op, const uint8_t* args, size_t len,
+                 int pops, int pushes, int cost) {
+  rules_program_t* p = c->program;
+  if (p->code_len + 1 + len > RULES_CODE_MAX) {
+    return fail(c, c->start, "program too long");
+  }
+  c->depth += pushes - pops;
+  if (c->depth > RULES_STACK_MAX) {
+    return fail(c, c->start, "expression too deep");
+  }
+  if (p->cost + cost > RULES_COST_MAX) {
+    return fail(c, c->start, "program too expensive");
+  }
+  p->cost += cost;
+  p->code[p->code_len++] = op;
+  memcpy(&p->code[p->code_len], args, len);
+  p->code_len += len;
+  return true;
+}
+
+static void put_u16(uint8_t* out, int32_t value) {
+  out[0] = (uint8_t)(value & 0xFF);
+  out[1] = (uint8_t)((value >> 8) & 0xFF);
+}
+
+static int16_t get_i16(const uint8_t* in) {
+  return (int16_t)(in[0] | (in[1] << 8));
+}
+
+// Optionally negated integer literal, for function arguments
+static bool parse_integer(compiler_t* c, int32_t* value) {
+  bool negative = false;
+  if (is_punct(c, "-")) {
+    negative = true;
+    if (!next_token(c)) {
+      return false;
+    }
+  }
+  if (c->kind != TOK_NUMBER) {
+    return fail(c, c->start, "expected a number");
+  }
+  if (c->value > 32767) {
+    return fail(c, c->start, "number out of range");
+  }
+  *value = negative ? -c->value : c->value;
+  return next_token(c);
+}
+
+static bool parse_time(compiler_t* c, int32_t* minute) {
+  if (c->kind != TOK_TIME) {
+    return fail(c, c->start, "expected HH:MM");
+  }
+  *minute = c->value;
+  return next_token(c);
+}
+
+static bool parse_expr(compiler_t* c);
+
+static bool parse_call(compiler_t* c, const char* name) {
+  if (!expect_punct(c, "(", "expected '('")) {
+    return false;
+  }
+  uint8_t args[8];
+  if (strcmp(name, "in") == 0) {
+    int32_t v[4];
+    for (int i = 0; i < 4; i++) {
+      if (i > 0 && !expect_punct(c, ",", "in() takes x0, y0, x1, y1")) {
+        return false;
+      }
+      if (!parse_integer(c, &v[i])) {
+        return false;
+      }
+    }
+    // Order the corners once here rather than on every frame
+    put_u16(&args[0], v[0] < v[2] ? v[0] : v[2]);
+    put_u16(&args[2], v[1] < v[3] ? v[1] : v[3]);
+    put_u16(&args[4], v[0] < v[2] ? v[2] : v[0]);
+    put_u16(&args[6], v[1] < v[3] ? v[3] : v[1]);
+    if (!emit(c, OP_IN, args, 8, 0, 1, RADAR_FUSION_MAX_TARGETS)) {
+      return false;
+    }
+  } else if (strcmp(name, "approach") == 0) {
+    int32_t entry;
+    if (!parse_integer(c, &entry)) {
+      return false;
+    }
+    if (entry < 1 || entry > 8) {
+      return fail(c, c->start, "doorway must be 1..8");
+    }
+    args[0] = (uint8_t)(entry - 1);
+    if (!emit(c, OP_APPROACH, args, 1, 0, 1, 1)) {
+      return false;
+    }
+  } else {
+    int32_t start, end;
+    if (!parse_time(c, &start) ||
+        !expect_punct(c, ",", "during() takes two times") ||
+        !parse_time(c, &end)) {
+      return false;
+    }
+    put_u16(&args[0], start);
+    put_u16(&args[2], end);
+    if (!emit(c, OP_DURING, args, 4, 0, 1, 1)) {
+      return false;
+    }
+  }
+  return expect_punct(c, ")", "expected ')'");
+}
+
+static bool parse_value(compiler_t* c) {
+  uint8_t args[2];
+  if (c->kind == TOK_NUMBER || c->kind == TOK_TIME || is_punct(c, "-")) {
+    int32_t value;
+    if (c->kind == TOK_TIME) {
+      value = c->value;
+      if (!next_token(c)) {
+        return false;
+      }
+    } else if (!parse_integer(c, &value)) {
+      return false;
+    }
+    put_u16(args, value);
+    return emit(c, OP_PUSH, args, 2, 0, 1, 1);
+  }
+  if (is_punct(c, "(")) {
+    if (++c->nesting > MAX_NESTING) {
+      return fail(c, c->start, "too many parentheses");
+    }
+    if (!next_token(c) || !parse_expr(c) ||
+        !expect_punct(c, ")", "expected ')'")) {
+      return false;
+    }
+    c->nesting--;
+    return true;
+  }
+  if (c->kind != TOK_NAME) {
+    return fail(c, c->start, "expected a value");
+  }
+  char name[sizeof(c->name)];
+  size_t at = c->start;
+  memcpy(name, c->name, sizeof(name));
+  if (!next_token(c)) {
+    return false;
+  }
+  if (strcmp(name, "in") == 0 || strcmp(name, "approach") == 0 ||
+      strcmp(name, "during") == 0) {
+    return parse_call(c, name);
+  }
+  for (size_t v = 0; v < sizeof(s_var_names) / sizeof(s_var_names[0]); v++) {
+    if (strcmp(name, s_var_names[v]) == 0) {
+      args[0] = (uint8_t)v;
+      int cost = (v == VAR_MOVING) ? RADAR_FUSION_MAX_TARGETS : 1;
+      return emit(c, OP_LOAD, args, 1, 0, 1, cost);
+    }
+  }
+  return fail(c, at, "unknown name");
+}
+
+static bool parse_cmp(compiler_t* c) {
+  static const struct {
+    const char* punct;
+    uint8_t op;
+  } ops[] = {
+      {"<", OP_LT},  {"<=", OP_LE}, {">", OP_GT},
+      {">=", OP_GE}, {"==", OP_EQ}, {"!=", OP_NE},
+  };
+  if (!parse_value(c)) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+    if (is_punct(c, ops[i].punct)) {
+      return next_token(c) && parse_value(c) &&
+             emit(c, ops[i].op, NULL, 0, 2, 1, 1);
+    }
+  }
+  return true;
+}
+
+static bool parse_not(compiler_t* c) {
+  if (is_punct(c, "!") || is_name(c, "not")) {
+    if (++c->nesting > MAX_NESTING) {
+      return fail(c, c->start, "too many negations");
+    }
+    if (!next_token(c) || !parse_not(c)) {
+      return false;
+    }
+    c->nesting--;
+    return emit(c, OP_NOT, NULL, 0, 1, 1, 1);
+  }
+  return parse_cmp(c);
+}
+
+static bool parse_and(compiler_t* c) {
+  if (!parse_not(c)) {
+    return false;
+  }
+  while (is_punct(c, "&") || is_name(c, "and")) {
+    if (!next_token(c) || !parse_not(c) ||
+        !emit(c, OP_AND, NULL, 0, 2, 1, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool parse_expr(compiler_t* c) {
+  if (!parse_and(c)) {
+    return false;
+  }
+  while (is_punct(c, "|") || is_name(c, "or")) {
+    if (!next_token(c) || !parse_and(c) ||
+        !emit(c, OP_OR, NULL, 0, 2, 1, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool parse_rule(compiler_t* c) {
+  rules_program_t* p = c->program;
+  if (c->kind != TOK_NAME || strncmp(c->name, "relay", 5) != 0 ||
+      c->name[5] < '1' || c->name[5] > '0' + RULES_OUTPUTS ||
+      c->name[6] != '\0') {
+    return fail(c, c->start, "rule must start with relay1..relay8");
+  }
+  if (p->rule_count >= RULES_MAX) {
+    return fail(c, c->start, "too many rules");
+  }
+  uint8_t output = (uint8_t)(c->name[5] - '1');
+  uint8_t rule = p->rule_count++;
+  if (!next_token(c) || !expect_punct(c, "=", "expected '='") ||
+      !parse_expr(c)) {
+    return false;
+  }
+  if (is_name(c, "hold")) {
+    int32_t seconds;
+    if (!next_token(c)) {
+      return false;
+    }
+    if (!parse_integer(c, &seconds)) {
+      return false;
+    }
+    if (seconds < 0 || seconds > 86400) {
+      return fail(c, c->start, "hold must be 0..86400 seconds");
+    }
+    p->hold_s[rule] = (uint32_t)seconds;
+  }
+  if (c->kind != TOK_SEP && c->kind != TOK_END) {
+    return fail(c, c->start, "expected end of rule");
+  }
+  uint8_t args[2] = {output, rule};
+  if (!emit(c, OP_STORE, args, 2, 1, 0, 1)) {
+    return false;
+  }
+  p->outputs_used |= (uint8_t)(1u << output);
+  return true;
+}
+
+bool rules_compile(rules_program_t* program, const char* text,
+                   rules_error_t* error) {
+  if (!program) {
+    return false;
+  }
+  memset(program, 0, sizeof(*program));
+  compiler_t c = {.text = text ? text : "", .program = program};
+  bool ok = next_token(&c);
+  while (ok && c.kind != TOK_END) {
+    if (c.kind == TOK_SEP) {
+      ok = next_token(&c);
+      continue;
+    }
+    ok = parse_rule(&c);
+  }
+  if (!ok) {
+    memset(program, 0, sizeof(*program));
+    if (error) {
+      *error = c.error;
+    }
+  }
+  return ok;
+}
+
+// Targets inside an axis-aligned rectangle of the room frame (mm)
+static int32_t count_in(const rules_input_t* input, const uint8_t* args) {
+  float x0 = get_i16(&args[0]);
+  float y0 = get_i16(&args[2]);
+  float x1 = get_i16(&args[4]);
+  float y1 = get_i16(&args[6]);
+  int32_t n = 0;
+  for (size_t t = 0; t < input->count; t++) {
+    const radar_fused_target_t* target = &input->targets[t];
+    n += target->x >= x0 && target->x <= x1 && target->y >= y0 &&
+         target->y <= y1;
+  }
+  return n;
+}
+
+static int32_t load(const rules_input_t* input, uint8_t var) {
+  switch (var) {
+    case VAR_PRESENT:
+      return (int32_t)input->present;
+    case VAR_TARGETS:
+      return (int32_t)input->count;
+    case VAR_MOVING: {
+      float fastest = 0.0f;
+      for (size_t t = 0; t < input->count; t++) {
+        float speed = input->targets[t].speed;
+        speed = speed < 0.0f ? -speed : speed;
+        fastest = speed > fastest ? speed : fastest;
+      }
+      return (int32_t)fastest;
+    }
+    case VAR_HOUR:
+      return input->minute_of_day < 0 ? -1 : input->minute_of_day / 60;
+    case VAR_MINUTE:
+      return input->minute_of_day < 0 ? -1 : input->minute_of_day % 60;
+    default:
+      return input->minute_of_day;
+  }
+}
+
+static bool during(int32_t minute, int32_t start, int32_t end) {
+  if (minute < 0) {
+    return false;
+  }
+  if (start <= end) {
+    return minute >= start && minute < end;
+  }
+  return minute >= start || minute < end;  // Wraps past midnight
+}
+
+uint8_t rules_eval(rules_program_t* program, const rules_input_t* input) {
+  if (!program || !input) {
+    return 0;
+  }
+  // The compiler proved the depth bound; sp never leaves the array
+  int32_t stack[RULES_STACK_MAX];
+  int sp = 0;
+  uint8_t mask = 0;
+  const uint8_t* code = program->code;
+  uint16_t pc = 0;
+
+  while (pc < program->code_len) {
+    uint8_t op = code[pc++];
+    switch (op) {
+      case OP_PUSH:
+        stack[sp++] = get_i16(&code[pc]);
+        pc += 2;
+        break;
+      case OP_LOAD:
+        stack[sp++] = load(input, code[pc++]);
+        break;
+      case OP_IN:
+        stack[sp++] = count_in(input, &code[pc]);
+        pc += 8;
+        break;
+      case OP_APPROACH:
+        stack[sp++] = (input->approach_mask >> code[pc++]) & 1;
+        break;
+      case OP_DURING:
+        stack[sp++] = during(input->minute_of_day,
+                             (uint16_t)get_i16(&code[pc]),
+                             (uint16_t)get_i16(&code[pc + 2]));
+        pc += 4;
+        break;
+      case OP_NOT:
+        stack[sp - 1] = !stack[sp - 1];
+        break;
+      case OP_STORE: {
+        uint8_t output = code[pc];
+        uint8_t rule = code[pc + 1];
+        pc += 2;
+        bool on = stack[--sp] != 0;
+        if (on) {
+          program->was_true[rule] = true;
+          program->last_true_us[rule] = input->now_us;
+        } else if (program->was_true[rule] &&
+                   input->now_us - program->last_true_us[rule] <
+                       (int64_t)program->hold_s[rule] * 1000000) {
+          on = true;
+        }
+        mask |= on ? (uint8_t)(1u << output) : 0;
+        break;
+      }
+      default: {
+        int32_t b = stack[--sp];
+        int32_t a = stack[sp - 1];
+        int32_t r;
+        switch (op) {
+          case OP_AND:
+            r = a && b;
+            break;
+          case OP_OR:
+            r = a || b;
+            break;
+          case OP_LT:
+            r = a < b;
+            break;
+          case OP_LE:
+            r = a <= b;
+            break;
+          case OP_GT:
+            r = a > b;
+            break;
+          case OP_GE:
+            r = a >= b;
+            break;
+          case OP_EQ:
+            r = a == b;
+            break;
+          default:
+            r = a != b;
+            break;
+        }
+        stack[sp - 1] = r;
+        break;
+      }
+    }
+  }
+  return mask;
+}
+
+int rules_disassemble(const rules_program_t* program, char* buf, size_t len) {
+  if (!program || !buf || len == 0) {
+    return 0;
+  }
+  size_t used = 0;
+  buf[0] = '\0';
+  uint16_t pc = 0;
+  while (pc < program->code_len && used < len) {
+    uint8_t op = program->code[pc];
+    const uint8_t* a = &program->code[pc + 1];
+    const char* name = op < sizeof(s_op_names) / sizeof(s_op_names[0])
+                           ? s_op_names[op]
+                           : "?";
+    int n;
+    switch (op) {
+      case OP_PUSH:
+        n = snprintf(buf + used, len - used, "%3u %s %d\n", pc, name,
+                     get_i16(a));
+        pc += 3;
+        break;
+      case OP_LOAD:
+        n = snprintf(buf + used, len - used, "%3u %s %s\n", pc, name,
+                     a[0] < sizeof(s_var_names) / sizeof(s_var_names[0])
+                         ? s_var_names[a[0]]
+                         : "?");
+        pc += 2;
+        break;
+      case OP_IN:
+        n = snprintf(buf + used, len - used, "%3u %s %d,%d %d,%d\n", pc, name,
+                     get_i16(&a[0]), get_i16(&a[2]), get_i16(&a[4]),
+                     get_i16(&a[6]));
+        pc += 9;
+        break;
+      case OP_APPROACH:
+        n = snprintf(buf + used, len - used, "%3u %s %u\n", pc, name,
+                     a[0] + 1u);
+        pc += 2;
+        break;
+      case OP_DURING: {
+        unsigned start = (uint16_t)get_i16(&a[0]);
+        unsigned end = (uint16_t)get_i16(&a[2]);
+        n = snprintf(buf + used, len - used, "%3u %s %02u:%02u-%02u:%02u\n",
+                     pc, name, start / 60, start % 60, end / 60, end % 60);
+        pc += 5;
+        break;
+      }
+      case OP_STORE:
+        n = snprintf(buf + used, len - used, "%3u %s relay%u hold %lus\n", pc,
+                     name, a[0] + 1u,
+                     (unsigned long)program->hold_s[a[1]]);
+        pc += 3;
+        break;
+      default:
+        n = snprintf(buf + used, len - used, "%3u %s\n", pc, name);
+        pc += 1;
+        break;
+    }
+    if (n < 0) {
+      break;
+    }
+    used += (size_t)n;
+  }
+  return (int)(used < len ? used : len - 1);
+}
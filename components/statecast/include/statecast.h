@@ -0,0 +1,125 @@
+#ifndef STATECAST_H
+#define STATECAST_H
+
+// Binary presence and target packets for LAN listeners (wall displays,
+// HVAC controllers) that need the room state within a frame, plus the
+// receive-side loss accounting. All fields are little-endian:
+//
+//   0  u8[2] magic "RW"          16 u32 sequence, +1 per packet
+//   2  u8    version (1)         20 u32 sender clock at send (us, low 32)
+//   3  u8    flags               24 u16 state age at send (ms)
+//   4  u8[6] device (WiFi MAC)   26 u8  relay mask
+//   10 u8    target count        27 u8  targets within presence range
+//   11 u8    doorways approached 28 u8[4] reserved, 0
+//   12 u32   boot id
+//   32 targets, 8 bytes each: i16 x mm, i16 y mm, i16 speed cm/s,
+//      u8 sensor mask, u8 reserved
+//
+// A new boot id restarts the sequence. Plain C with no ESP-IDF
+// dependencies; tools/statecast_listen decodes and measures the stream.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATECAST_VERSION 1
+#define STATECAST_HEADER_SIZE 32
+#define STATECAST_TARGET_SIZE 8
+#define STATECAST_MAX_TARGETS 12
+#define STATECAST_PACKET_MAX \
+  (STATECAST_HEADER_SIZE + STATECAST_MAX_TARGETS * STATECAST_TARGET_SIZE)
+
+#define STATECAST_FLAG_CHANGE 0x01     ///< Relays or presence changed
+#define STATECAST_FLAG_HEARTBEAT 0x02  ///< Sent because nothing else was
+#define STATECAST_FLAG_TARGETS 0x04    ///< Target positions moved
+
+/**
+ * @brief Target in the room frame
+ */
+typedef struct {
+  int16_t x_mm;
+  int16_t y_mm;
+  int16_t speed_cm_s;
+  uint8_t sensor_mask;  ///< Bit n set when radar n saw the target
+} statecast_target_t;
+
+/**
+ * @brief Decoded packet
+ */
+typedef struct {
+  uint8_t flags;  ///< STATECAST_FLAG_* bits
+  uint8_t device[6];
+  uint32_t boot_id;
+  uint32_t sequence;
+  uint32_t sent_us;  ///< Sender clock when the packet was built
+  uint16_t age_ms;   ///< How old the state was by then
+  uint8_t relay_mask;
+  uint8_t present;
+  uint8_t entry_mask;
+  uint8_t target_count;
+  statecast_target_t targets[STATECAST_MAX_TARGETS];
+} statecast_packet_t;
+
+/**
+ * @brief Loss accounting for one sender
+ */
+typedef struct {
+  uint8_t device[6];
+  uint32_t boot_id;
+  uint32_t last_sequence;
+  bool started;
+  uint32_t received;
+  uint32_t lost;      ///< Sequence numbers skipped
+  uint32_t late;      ///< Duplicate or out-of-order packets
+  uint32_t restarts;  ///< Boot id changes
+} statecast_rx_t;
+
+/**
+ * @brief Build the wire form of a packet
+ *
+ * Targets beyond STATECAST_MAX_TARGETS are left out.
+ *
+ * @param packet Packet to encode
+ * @param buf Destination
+ * @param size Size of buf
+ * @return Bytes written, -1 when buf is too small
+ */
+int statecast_encode(const statecast_packet_t* packet, uint8_t* buf,
+                     size_t size);
+
+/**
+ * @brief Parse a received datagram
+ *
+ * @param buf Datagram
+ * @param len Its length
+ * @param out Decoded packet
+ * @return true for a well-formed packet of this version
+ */
+bool statecast_decode(const uint8_t* buf, size_t len, statecast_packet_t* out);
+
+/**
+ * @brief Start loss accounting with no sender seen
+ *
+ * @param rx Receiver state
+ */
+void statecast_rx_init(statecast_rx_t* rx);
+
+/**
+ * @brief Account for one packet from the sender
+ *
+ * @param rx Receiver state
+ * @param packet Decoded packet
+ * @return Packets lost just before this one
+ */
+uint32_t statecast_rx_update(statecast_rx_t* rx,
+                             const statecast_packet_t* packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STATECAST_H
@@ -0,0 +1,118 @@
+#include "statecast.h"
+
+#include <string.h>
+
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+int statecast_encode(const statecast_packet_t* packet, uint8_t* buf,
+                     size_t size) {
+  size_t count = packet->target_count < STATECAST_MAX_TARGETS
+                     ? packet->target_count
+                     : STATECAST_MAX_TARGETS;
+  size_t len = STATECAST_HEADER_SIZE + count * STATECAST_TARGET_SIZE;
+  if (size < len) {
+    return -1;
+  }
+
+  buf[0] = 'R';
+  buf[1] = 'W';
+  buf[2] = STATECAST_VERSION;
+  buf[3] = packet->flags;
+  memcpy(buf + 4, packet->device, sizeof(packet->device));
+  buf[10] = (uint8_t)count;
+  buf[11] = packet->entry_mask;
+  put_u32(buf + 12, packet->boot_id);
+  put_u32(buf + 16, packet->sequence);
+  put_u32(buf + 20, packet->sent_us);
+  put_u16(buf + 24, packet->age_ms);
+  buf[26] = packet->relay_mask;
+  buf[27] = packet->present;
+  memset(buf + 28, 0, 4);
+
+  uint8_t* p = buf + STATECAST_HEADER_SIZE;
+  for (size_t i = 0; i < count; i++, p += STATECAST_TARGET_SIZE) {
+    const statecast_target_t* t = &packet->targets[i];
+    put_u16(p, (uint16_t)t->x_mm);
+    put_u16(p + 2, (uint16_t)t->y_mm);
+    put_u16(p + 4, (uint16_t)t->speed_cm_s);
+    p[6] = t->sensor_mask;
+    p[7] = 0;
+  }
+  return (int)len;
+}
+
+bool statecast_decode(const uint8_t* buf, size_t len, statecast_packet_t* out) {
+  if (len < STATECAST_HEADER_SIZE || buf[0] != 'R' || buf[1] != 'W' ||
+      buf[2] != STATECAST_VERSION) {
+    return false;
+  }
+  size_t count = buf[10];
+  if (count > STATECAST_MAX_TARGETS ||
+      len < STATECAST_HEADER_SIZE + count * STATECAST_TARGET_SIZE) {
+    return false;
+  }
+
+  out->flags = buf[3];
+  memcpy(out->device, buf + 4, sizeof(out->device));
+  out->target_count = (uint8_t)count;
+  out->entry_mask = buf[11];
+  out->boot_id = get_u32(buf + 12);
+  out->sequence = get_u32(buf + 16);
+  out->sent_us = get_u32(buf + 20);
+  out->age_ms = get_u16(buf + 24);
+  out->relay_mask = buf[26];
+  out->present = buf[27];
+
+  const uint8_t* p = buf + STATECAST_HEADER_SIZE;
+  for (size_t i = 0; i < count; i++, p += STATECAST_TARGET_SIZE) {
+    statecast_target_t* t = &out->targets[i];
+    t->x_mm = (int16_t)get_u16(p);
+    t->y_mm = (int16_t)get_u16(p + 2);
+    t->speed_cm_s = (int16_t)get_u16(p + 4);
+    t->sensor_mask = p[6];
+  }
+  return true;
+}
+
+void statecast_rx_init(statecast_rx_t* rx) { memset(rx, 0, sizeof(*rx)); }
+
+uint32_t statecast_rx_update(statecast_rx_t* rx,
+                             const statecast_packet_t* packet) {
+  rx->received++;
+  if (!rx->started || packet->boot_id != rx->boot_id) {
+    if (rx->started) {
+      rx->restarts++;
+    }
+    memcpy(rx->device, packet->device, sizeof(rx->device));
+    rx->boot_id = packet->boot_id;
+    rx->last_sequence = packet->sequence;
+    rx->started = true;
+    return 0;
+  }
+
+  // Serial number arithmetic: a gap of 2^31 or more reads as old
+  uint32_t gap = packet->sequence - rx->last_sequence;
+  if (gap == 0 || gap >= 0x80000000u) {
+    rx->late++;
+    return 0;
+  }
+  rx->last_sequence = packet->sequence;
+  rx->lost += gap - 1;
+  return gap - 1;
+}
@@ -0,0 +1,140 @@
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming LZSS for upload bodies, with a text-safe output stage for form
+ * fields. Input is fed in pieces of any size and compressed output leaves
+ * through a sink 17 bytes at a time, so neither side needs a full copy of
+ * the uncompressed body. Plain C with no ESP-IDF dependencies;
+ * tools/lzss_bench measures it on the host and appscript.js decodes it.
+ *
+ * Format: groups of one flag byte followed by up to eight items, flag bit 0
+ * first. A set bit is a literal byte; a clear bit is a big-endian 16-bit
+ * match, (offset - 1) << 7 | (length - 3), copying length bytes starting
+ * offset bytes back (the copy may overlap its own output). The stream ends
+ * with the input; unused flag bits of the last group are ignored.
+ */
+
+#define LZSS_WINDOW 512  ///< Farthest match offset
+#define LZSS_MIN_MATCH 3
+#define LZSS_MAX_MATCH 130  ///< 7-bit length field
+#define LZSS_HASH_SIZE 256
+#define LZSS_CHAIN_DEPTH 16  ///< Candidates tried per position
+
+/**
+ * @brief Receives compressed output
+ *
+ * @return false to abort; the encoder then fails every later call
+ */
+typedef bool (*lzss_sink_t)(void* ctx, const uint8_t* data, size_t len);
+
+/**
+ * @brief Encoder state, about 3.6 KB; keep it static
+ */
+typedef struct {
+  uint8_t buf[2 * LZSS_WINDOW];    ///< History window followed by lookahead
+  uint16_t prev[2 * LZSS_WINDOW];  ///< Hash chain links by buffer position
+  uint16_t head[LZSS_HASH_SIZE];   ///< Newest position per hash
+  size_t fill;                     ///< Bytes in buf
+  size_t pos;                      ///< Next byte to encode
+  uint8_t group[1 + 8 * 2];        ///< Flag byte and up to eight items
+  size_t group_len;
+  uint8_t group_items;
+  lzss_sink_t sink;
+  void* ctx;
+  uint32_t in_bytes;   ///< Uncompressed bytes accepted
+  uint32_t out_bytes;  ///< Compressed bytes passed to the sink
+  bool failed;
+} lzss_encoder_t;
+
+/**
+ * @brief Start a stream
+ *
+ * @param enc Encoder
+ * @param sink Receives compressed output in order
+ * @param ctx Passed to sink
+ */
+void lzss_encoder_init(lzss_encoder_t* enc, lzss_sink_t sink, void* ctx);
+
+/**
+ * @brief Compress the next piece of input
+ *
+ * The last LZSS_MAX_MATCH bytes are held back as lookahead until more input
+ * or lzss_encoder_finish() arrives. Hash chain search, O(len * depth).
+ *
+ * @param enc Encoder
+ * @param data Input
+ * @param len Input length
+ * @return false if the sink refused output
+ */
+bool lzss_encoder_write(lzss_encoder_t* enc, const void* data, size_t len);
+
+/**
+ * @brief Encode the held-back input and flush the last group
+ *
+ * @param enc Encoder
+ * @return false if the sink refused output
+ */
+bool lzss_encoder_finish(lzss_encoder_t* enc);
+
+/**
+ * @brief Decode a whole stream, for host tools
+ *
+ * @param in Compressed stream
+ * @param in_len Stream length
+ * @param out Destination
+ * @param out_len Destination size
+ * @return Decoded length, or -1 if the stream is corrupt or does not fit
+ */
+int lzss_decode(const uint8_t* in, size_t in_len, uint8_t* out,
+                size_t out_len);
+
+/**
+ * @brief Base64url (RFC 4648 section 5, no padding) text writer, usable as
+ *        an lzss_sink_t so compressed output can go into a form field
+ */
+typedef struct {
+  char* buf;
+  size_t len;   ///< Destination size
+  size_t used;  ///< Characters written, kept terminated
+  uint8_t carry[3];
+  uint8_t carry_len;
+} lzss_b64_writer_t;
+
+/**
+ * @brief Start writing at buf
+ *
+ * @param out Writer
+ * @param buf Destination
+ * @param len Destination size, including the terminator
+ */
+void lzss_b64_init(lzss_b64_writer_t* out, char* buf, size_t len);
+
+/**
+ * @brief lzss_sink_t that appends the encoding of data
+ *
+ * @return false if the destination is full
+ */
+bool lzss_b64_sink(void* ctx, const uint8_t* data, size_t len);
+
+/**
+ * @brief Write the final partial group
+ *
+ * @param out Writer
+ * @return Characters written in total, or -1 if they did not fit
+ */
+int lzss_b64_finish(lzss_b64_writer_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LZSS_H
@@ -0,0 +1,172 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Outbound data in two priority classes with fixed storage. Producers push
+ * from any task; the uploader takes the head of the most urgent class,
+ * sends it and removes it only once the send succeeded, so a retry resends
+ * the same item with the same id. The queue core has no ESP-IDF
+ * dependencies; off target it is single threaded.
+ */
+
+#ifndef CONFIG_UPLINK_STATE_SLOTS
+#define CONFIG_UPLINK_STATE_SLOTS 8
+#endif
+#ifndef CONFIG_UPLINK_BULK_SLOTS
+#define CONFIG_UPLINK_BULK_SLOTS 8
+#endif
+
+/** Largest payload stored with an item */
+#define UPLINK_ITEM_DATA_MAX 96
+
+typedef enum {
+  UPLINK_CLASS_STATE,  ///< Latency critical, never evicted by bulk data
+  UPLINK_CLASS_BULK,   ///< Telemetry sent while no state change waits
+  UPLINK_CLASS_COUNT,
+} uplink_class_t;
+
+/**
+ * @brief One queued upload
+ */
+typedef struct {
+  uint32_t id;        ///< Unique per push and increasing within a class
+  uint16_t kind;      ///< Caller-defined item type
+  uint16_t len;       ///< Bytes used in data
+  int64_t queued_us;  ///< Enqueue time
+  uint8_t data[UPLINK_ITEM_DATA_MAX];
+} uplink_item_t;
+
+/**
+ * @brief Counters for one class
+ */
+typedef struct {
+  uint32_t depth;          ///< Items waiting now
+  uint32_t capacity;       ///< Slots reserved for the class
+  uint32_t high_water;     ///< Deepest the queue has been
+  uint32_t oldest_age_ms;  ///< Age of the head item, 0 when empty
+  uint32_t queued;         ///< Items accepted since boot
+  uint32_t sent;           ///< Items removed after a successful send
+  uint32_t dropped;        ///< Oldest items evicted to make room (bulk)
+  uint32_t coalesced;      ///< Items replaced by a newer one (state)
+} uplink_class_stats_t;
+
+/**
+ * @brief Empty both classes and clear the counters
+ */
+void uplink_init(void);
+
+/**
+ * @brief Queue an item
+ *
+ * Never blocks. A full state class replaces its newest item with this one;
+ * a full bulk class drops its oldest item.
+ *
+ * @param cls Priority class
+ * @param kind Caller-defined item type
+ * @param data Payload, copied (may be NULL when len is 0)
+ * @param len Payload size, at most UPLINK_ITEM_DATA_MAX
+ * @param now_us Enqueue time
+ * @return false only for an invalid class or oversized payload
+ */
+bool uplink_push(uplink_class_t cls, uint16_t kind, const void* data,
+                 size_t len, int64_t now_us);
+
+/**
+ * @brief Copy the item to send next: the oldest state change, otherwise the
+ *        oldest bulk item
+ *
+ * @param out Destination item
+ * @param cls Class the item belongs to
+ * @return false when both classes are empty
+ */
+bool uplink_peek(uplink_item_t* out, uplink_class_t* cls);
+
+/**
+ * @brief Remove a sent item
+ *
+ * Does nothing when the item is no longer the head of its class (it was
+ * evicted or replaced while being sent).
+ *
+ * @param cls Class passed back by uplink_peek()
+ * @param id Item id passed back by uplink_peek()
+ */
+void uplink_pop(uplink_class_t cls, uint32_t id);
+
+/**
+ * @brief Whether a state change is waiting
+ *
+ * @return true if the state class is not empty
+ */
+bool uplink_state_pending(void);
+
+/**
+ * @brief Delay between upload attempts after failures
+ */
+typedef struct {
+  uint32_t min_ms;    ///< Delay ceiling after the first failure
+  uint32_t max_ms;    ///< Delay ceiling after many failures
+  uint32_t failures;  ///< Consecutive failures
+  uint32_t rng;       ///< Jitter state
+} uplink_backoff_t;
+
+/**
+ * @brief Start with no failures
+ *
+ * @param backoff Backoff state
+ * @param min_ms First ceiling
+ * @param max_ms Largest ceiling
+ * @param seed Jitter seed, so a fleet does not retry in lockstep
+ */
+void uplink_backoff_init(uplink_backoff_t* backoff, uint32_t min_ms,
+                         uint32_t max_ms, uint32_t seed);
+
+/**
+ * @brief Record a failure and return the delay before the next attempt
+ *
+ * The ceiling doubles with each consecutive failure from min_ms up to
+ * max_ms; the delay is drawn from the upper half of the ceiling.
+ *
+ * @param backoff Backoff state
+ * @return Delay in milliseconds
+ */
+uint32_t uplink_backoff_next(uplink_backoff_t* backoff);
+
+/**
+ * @brief Record a success: the next failure starts from min_ms again
+ *
+ * @param backoff Backoff state
+ */
+void uplink_backoff_reset(uplink_backoff_t* backoff);
+
+/**
+ * @brief Copy the counters of every class
+ *
+ * @param out UPLINK_CLASS_COUNT entries, indexed by uplink_class_t
+ * @param now_us Current time, for the age of the oldest items
+ */
+void uplink_get_stats(uplink_class_stats_t* out, int64_t now_us);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Log depth, oldest age and drop counts of every class
+ */
+void uplink_log_summary(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // UPLINK_H
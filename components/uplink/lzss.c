@@ -0,0 +1,255 @@
+#include "lzss.h"
+
+#include <string.h>
+
+#define LZSS_NIL 0xFFFF
+#define LZSS_BUFFER (2 * LZSS_WINDOW)
+
+static const char s_b64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static uint32_t hash3(const uint8_t* p) {
+  return ((uint32_t)p[0] << 5 ^ (uint32_t)p[1] << 2 ^ p[2]) &
+         (LZSS_HASH_SIZE - 1);
+}
+
+void lzss_encoder_init(lzss_encoder_t* enc, lzss_sink_t sink, void* ctx) {
+  if (!enc) {
+    return;
+  }
+  memset(enc, 0, sizeof(*enc));
+  memset(enc->head, 0xFF, sizeof(enc->head));
+  enc->group_len = 1;
+  enc->sink = sink;
+  enc->ctx = ctx;
+}
+
+static void flush_group(lzss_encoder_t* enc) {
+  if (enc->group_items == 0 || enc->failed) {
+    return;
+  }
+  if (!enc->sink(enc->ctx, enc->group, enc->group_len)) {
+    enc->failed = true;
+  }
+  enc->out_bytes += (uint32_t)enc->group_len;
+  enc->group[0] = 0;
+  enc->group_len = 1;
+  enc->group_items = 0;
+}
+
+static void emit_literal(lzss_encoder_t* enc, uint8_t byte) {
+  enc->group[0] |= (uint8_t)(1u << enc->group_items);
+  enc->group[enc->group_len++] = byte;
+  if (++enc->group_items == 8) {
+    flush_group(enc);
+  }
+}
+
+static void emit_match(lzss_encoder_t* enc, size_t offset, size_t length) {
+  uint16_t word =
+      (uint16_t)((offset - 1) << 7 | (length - LZSS_MIN_MATCH));
+  enc->group[enc->group_len++] = (uint8_t)(word >> 8);
+  enc->group[enc->group_len++] = (uint8_t)word;
+  if (++enc->group_items == 8) {
+    flush_group(enc);
+  }
+}
+
+// Link position p into its hash chain; needs three bytes from p
+static void insert(lzss_encoder_t* enc, size_t p) {
+  if (p + LZSS_MIN_MATCH > enc->fill) {
+    return;
+  }
+  uint32_t h = hash3(&enc->buf[p]);
+  enc->prev[p] = enc->head[h];
+  enc->head[h] = (uint16_t)p;
+}
+
+// Longest earlier match for the bytes at pos within the window
+static size_t find_match(const lzss_encoder_t* enc, size_t* offset) {
+  size_t avail = enc->fill - enc->pos;
+  if (avail < LZSS_MIN_MATCH) {
+    return 0;
+  }
+  size_t limit = avail < LZSS_MAX_MATCH ? avail : LZSS_MAX_MATCH;
+  const uint8_t* cur = &enc->buf[enc->pos];
+  size_t best = 0;
+  uint16_t cand = enc->head[hash3(cur)];
+  for (int depth = 0; cand != LZSS_NIL && depth < LZSS_CHAIN_DEPTH;
+       depth++) {
+    if (cand >= enc->pos || enc->pos - cand > LZSS_WINDOW) {
+      break;
+    }
+    const uint8_t* p = &enc->buf[cand];
+    size_t len = 0;
+    while (len < limit && p[len] == cur[len]) {
+      len++;
+    }
+    if (len > best) {
+      best = len;
+      *offset = enc->pos - cand;
+      if (len == limit) {
+        break;
+      }
+    }
+    cand = enc->prev[cand];
+  }
+  return best >= LZSS_MIN_MATCH ? best : 0;
+}
+
+// Encode buffered input, keeping a full lookahead unless this is the end
+static void encode(lzss_encoder_t* enc, bool final) {
+  while (!enc->failed && enc->pos < enc->fill &&
+         (final || enc->fill - enc->pos >= LZSS_MAX_MATCH)) {
+    size_t offset = 0;
+    size_t len = find_match(enc, &offset);
+    if (len == 0) {
+      emit_literal(enc, enc->buf[enc->pos]);
+      len = 1;
+    } else {
+      emit_match(enc, offset, len);
+    }
+    for (size_t i = 0; i < len; i++) {
+      insert(enc, enc->pos++);
+    }
+  }
+}
+
+// Drop the oldest half of the buffer; positions and chain links move with it
+static void slide(lzss_encoder_t* enc) {
+  memmove(enc->buf, enc->buf + LZSS_WINDOW, LZSS_WINDOW);
+  for (size_t i = 0; i < LZSS_HASH_SIZE; i++) {
+    uint16_t v = enc->head[i];
+    enc->head[i] = v != LZSS_NIL && v >= LZSS_WINDOW
+                       ? (uint16_t)(v - LZSS_WINDOW)
+                       : LZSS_NIL;
+  }
+  for (size_t i = 0; i < LZSS_WINDOW; i++) {
+    uint16_t v = enc->prev[i + LZSS_WINDOW];
+    enc->prev[i] = v != LZSS_NIL && v >= LZSS_WINDOW
+                       ? (uint16_t)(v - LZSS_WINDOW)
+                       : LZSS_NIL;
+  }
+  enc->fill -= LZSS_WINDOW;
+  enc->pos -= LZSS_WINDOW;
+}
+
+bool lzss_encoder_write(lzss_encoder_t* enc, const void* data, size_t len) {
+  if (!enc || enc->failed || (len > 0 && !data)) {
+    return false;
+  }
+  const uint8_t* in = (const uint8_t*)data;
+  while (len > 0) {
+    // encode() leaves less than LZSS_MAX_MATCH unencoded, so pos is past
+    // the first half whenever the buffer is full
+    if (enc->fill == LZSS_BUFFER) {
+      slide(enc);
+    }
+    size_t take = LZSS_BUFFER - enc->fill;
+    take = len < take ? len : take;
+    memcpy(enc->buf + enc->fill, in, take);
+    enc->fill += take;
+    enc->in_bytes += (uint32_t)take;
+    in += take;
+    len -= take;
+    encode(enc, false);
+  }
+  return !enc->failed;
+}
+
+bool lzss_encoder_finish(lzss_encoder_t* enc) {
+  if (!enc || enc->failed) {
+    return false;
+  }
+  encode(enc, true);
+  flush_group(enc);
+  return !enc->failed;
+}
+
+int lzss_decode(const uint8_t* in, size_t in_len, uint8_t* out,
+                size_t out_len) {
+  if (!in || !out) {
+    return -1;
+  }
+  size_t i = 0;
+  size_t used = 0;
+  while (i < in_len) {
+    uint8_t flags = in[i++];
+    for (int bit = 0; bit < 8 && i < in_len; bit++) {
+      if (flags & (1u << bit)) {
+        if (used >= out_len) {
+          return -1;
+        }
+        out[used++] = in[i++];
+        continue;
+      }
+      if (i + 1 >= in_len) {
+        return -1;
+      }
+      uint16_t word = (uint16_t)(in[i] << 8 | in[i + 1]);
+      i += 2;
+      size_t offset = (size_t)(word >> 7) + 1;
+      size_t length = (size_t)(word & 0x7F) + LZSS_MIN_MATCH;
+      if (offset > used || used + length > out_len) {
+        return -1;
+      }
+      for (size_t k = 0; k < length; k++, used++) {
+        out[used] = out[used - offset];
+      }
+    }
+  }
+  return (int)used;
+}
+
+void lzss_b64_init(lzss_b64_writer_t* out, char* buf, size_t len) {
+  if (!out) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  out->buf = buf;
+  out->len = len;
+  if (buf && len > 0) {
+    buf[0] = '\0';
+  }
+}
+
+// Append the characters for carry[0..count), count 1..3
+static bool b64_put(lzss_b64_writer_t* out, size_t count) {
+  size_t chars = count + 1;
+  if (!out->buf || out->used + chars >= out->len) {
+    return false;
+  }
+  uint32_t v = (uint32_t)out->carry[0] << 16 |
+               (count > 1 ? (uint32_t)out->carry[1] << 8 : 0) |
+               (count > 2 ? out->carry[2] : 0);
+  for (size_t c = 0; c < chars; c++) {
+    out->buf[out->used++] = s_b64[(v >> (18 - 6 * c)) & 0x3F];
+  }
+  out->buf[out->used] = '\0';
+  return true;
+}
+
+bool lzss_b64_sink(void* ctx, const uint8_t* data, size_t len) {
+  lzss_b64_writer_t* out = (lzss_b64_writer_t*)ctx;
+  for (size_t i = 0; i < len; i++) {
+    out->carry[out->carry_len++] = data[i];
+    if (out->carry_len == 3) {
+      if (!b64_put(out, 3)) {
+        return false;
+      }
+      out->carry_len = 0;
+    }
+  }
+  return true;
+}
+
+int lzss_b64_finish(lzss_b64_writer_t* out) {
+  if (!out) {
+    return -1;
+  }
+  if (out->carry_len > 0 && !b64_put(out, out->carry_len)) {
+    return -1;
+  }
+  out->carry_len = 0;
+  return (int)out->used;
+}
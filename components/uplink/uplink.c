@@ -0,0 +1,198 @@
+#include "uplink.h"
+
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static const char* TAG = "UPLINK";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+#define UPLINK_LOCK() portENTER_CRITICAL_SAFE(&s_lock)
+#define UPLINK_UNLOCK() portEXIT_CRITICAL_SAFE(&s_lock)
+#else
+// Host build: single threaded
+#define UPLINK_LOCK()
+#define UPLINK_UNLOCK()
+#endif
+
+// Fixed ring per class; head is the oldest item
+typedef struct {
+  uplink_item_t* items;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t depth;
+  uplink_class_stats_t stats;
+} uplink_ring_t;
+
+static uplink_item_t s_state_items[CONFIG_UPLINK_STATE_SLOTS];
+static uplink_item_t s_bulk_items[CONFIG_UPLINK_BULK_SLOTS];
+static uplink_ring_t s_rings[UPLINK_CLASS_COUNT] = {
+    {s_state_items, CONFIG_UPLINK_STATE_SLOTS, 0, 0, {0}},
+    {s_bulk_items, CONFIG_UPLINK_BULK_SLOTS, 0, 0, {0}},
+};
+static uint32_t s_next_id = 1;
+
+void uplink_init(void) {
+  UPLINK_LOCK();
+  for (int c = 0; c < UPLINK_CLASS_COUNT; c++) {
+    s_rings[c].head = 0;
+    s_rings[c].depth = 0;
+    memset(&s_rings[c].stats, 0, sizeof(s_rings[c].stats));
+  }
+  UPLINK_UNLOCK();
+}
+
+bool uplink_push(uplink_class_t cls, uint16_t kind, const void* data,
+                 size_t len, int64_t now_us) {
+  if (cls < 0 || cls >= UPLINK_CLASS_COUNT || len > UPLINK_ITEM_DATA_MAX ||
+      (len > 0 && !data)) {
+    return false;
+  }
+
+  UPLINK_LOCK();
+  uplink_ring_t* ring = &s_rings[cls];
+  uint32_t slot;
+  if (ring->depth < ring->capacity) {
+    slot = (ring->head + ring->depth) % ring->capacity;
+    ring->depth++;
+  } else if (cls == UPLINK_CLASS_STATE) {
+    // Full: the newest change supersedes the newest queued one, so the
+    // last state sent is always the current one
+    slot = (ring->head + ring->depth - 1) % ring->capacity;
+    ring->stats.coalesced++;
+  } else {
+    // Full: make room by dropping the oldest telemetry
+    slot = (ring->head + ring->depth) % ring->capacity;
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->stats.dropped++;
+  }
+
+  uplink_item_t* item = &ring->items[slot];
+  item->id = s_next_id++;
+  item->kind = kind;
+  item->len = (uint16_t)len;
+  item->queued_us = now_us;
+  if (len > 0) {
+    memcpy(item->data, data, len);
+  }
+  ring->stats.queued++;
+  if (ring->depth > ring->stats.high_water) {
+    ring->stats.high_water = ring->depth;
+  }
+  UPLINK_UNLOCK();
+  return true;
+}
+
+bool uplink_peek(uplink_item_t* out, uplink_class_t* cls) {
+  if (!out || !cls) {
+    return false;
+  }
+  bool found = false;
+  UPLINK_LOCK();
+  for (int c = 0; c < UPLINK_CLASS_COUNT; c++) {
+    const uplink_ring_t* ring = &s_rings[c];
+    if (ring->depth > 0) {
+      *out = ring->items[ring->head];
+      *cls = (uplink_class_t)c;
+      found = true;
+      break;
+    }
+  }
+  UPLINK_UNLOCK();
+  return found;
+}
+
+void uplink_pop(uplink_class_t cls, uint32_t id) {
+  if (cls < 0 || cls >= UPLINK_CLASS_COUNT) {
+    return;
+  }
+  UPLINK_LOCK();
+  uplink_ring_t* ring = &s_rings[cls];
+  if (ring->depth > 0 && ring->items[ring->head].id == id) {
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->depth--;
+    ring->stats.sent++;
+  }
+  UPLINK_UNLOCK();
+}
+
+bool uplink_state_pending(void) {
+  return __atomic_load_n(&s_rings[UPLINK_CLASS_STATE].depth,
+                         __ATOMIC_RELAXED) > 0;
+}
+
+void uplink_get_stats(uplink_class_stats_t* out, int64_t now_us) {
+  if (!out) {
+    return;
+  }
+  UPLINK_LOCK();
+  for (int c = 0; c < UPLINK_CLASS_COUNT; c++) {
+    const uplink_ring_t* ring = &s_rings[c];
+    out[c] = ring->stats;
+    out[c].depth = ring->depth;
+    out[c].capacity = ring->capacity;
+    int64_t age_us =
+        ring->depth > 0 ? now_us - ring->items[ring->head].queued_us : 0;
+    out[c].oldest_age_ms = age_us > 0 ? (uint32_t)(age_us / 1000) : 0;
+  }
+  UPLINK_UNLOCK();
+}
+
+void uplink_backoff_init(uplink_backoff_t* backoff, uint32_t min_ms,
+                         uint32_t max_ms, uint32_t seed) {
+  if (!backoff) {
+    return;
+  }
+  backoff->min_ms = min_ms > 0 ? min_ms : 1;
+  backoff->max_ms = max_ms > backoff->min_ms ? max_ms : backoff->min_ms;
+  backoff->failures = 0;
+  backoff->rng = seed ? seed : 1;
+}
+
+uint32_t uplink_backoff_next(uplink_backoff_t* backoff) {
+  if (!backoff) {
+    return 0;
+  }
+  uint32_t ceiling = backoff->min_ms;
+  for (uint32_t i = 0; i < backoff->failures && ceiling < backoff->max_ms;
+       i++) {
+    ceiling *= 2;
+  }
+  if (ceiling > backoff->max_ms) {
+    ceiling = backoff->max_ms;
+  }
+  backoff->failures++;
+
+  // xorshift32 jitter over the upper half of the ceiling
+  uint32_t x = backoff->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  backoff->rng = x;
+  return ceiling - ceiling / 2 + x % (ceiling / 2 + 1);
+}
+
+void uplink_backoff_reset(uplink_backoff_t* backoff) {
+  if (backoff) {
+    backoff->failures = 0;
+  }
+}
+
+#ifdef ESP_PLATFORM
+void uplink_log_summary(void) {
+  static const char* const names[UPLINK_CLASS_COUNT] = {"state", "bulk"};
+  uplink_class_stats_t stats[UPLINK_CLASS_COUNT];
+  uplink_get_stats(stats, esp_timer_get_time());
+  for (int c = 0; c < UPLINK_CLASS_COUNT; c++) {
+    ESP_LOGI(TAG,
+             "Uplink %s - Depth: %lu/%lu (max %lu), Oldest: %lu ms, Sent: "
+             "%lu/%lu, Dropped: %lu, Coalesced: %lu",
+             names[c], stats[c].depth, stats[c].capacity, stats[c].high_water,
+             stats[c].oldest_age_ms, stats[c].sent, stats[c].queued,
+             stats[c].dropped, stats[c].coalesced);
+  }
+}
+#endif
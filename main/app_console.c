@@ -0,0 +1,34 @@
+#include "app_console.h"
+#include "app_config.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "health_monitor.h"
+#include "metrics.h"
+#include "radar_reader.h"
+#include "rule_policy.h"
+
+static const char* TAG = "APP_CONSOLE";
+
+esp_err_t app_console_start(void) {
+  esp_console_repl_t* repl = NULL;
+  esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+  repl_config.prompt = "radar>";
+  repl_config.task_stack_size = 4096;
+
+  esp_console_dev_uart_config_t uart_config =
+      ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+  esp_err_t ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create console REPL: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  esp_console_register_help_command();
+  app_config_register_console_cmd();
+  health_monitor_register_console_cmd();
+  metrics_register_console_cmd();
+  radar_reader_register_console_cmd();
+  rule_policy_register_console_cmd();
+
+  return esp_console_start_repl(repl);
+}
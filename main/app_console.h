@@ -0,0 +1,13 @@
+#ifndef APP_CONSOLE_H
+#define APP_CONSOLE_H
+
+#include "esp_err.h"
+
+/**
+ * @brief Start the UART console REPL and register all diagnostic commands
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t app_console_start(void);
+
+#endif  // APP_CONSOLE_H
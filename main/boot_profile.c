@@ -0,0 +1,77 @@
+#include "boot_profile.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char* TAG = "BOOT";
+
+#define BOOT_WAIT_POLL_MS 10
+
+static const char* const phase_names[BOOT_PHASE_COUNT] = {
+    "app_main",       "relays safe",    "config loaded",
+    "radar started",  "first frame",    "first relay decision",
+    "network start",  "wifi connected", "first upload",
+};
+
+// Written once per phase; esp_timer time, 0 while pending
+static int64_t s_phase_us[BOOT_PHASE_COUNT];
+static portMUX_TYPE s_phase_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool boot_profile_mark(boot_phase_t phase) {
+  if (phase >= BOOT_PHASE_COUNT || s_phase_us[phase] != 0) {
+    return false;
+  }
+
+  int64_t now_us = esp_timer_get_time();
+  bool recorded = false;
+  portENTER_CRITICAL(&s_phase_lock);
+  if (s_phase_us[phase] == 0) {
+    s_phase_us[phase] = now_us > 0 ? now_us : 1;
+    recorded = true;
+  }
+  portEXIT_CRITICAL(&s_phase_lock);
+  return recorded;
+}
+
+int64_t boot_profile_get(boot_phase_t phase) {
+  if (phase >= BOOT_PHASE_COUNT) {
+    return 0;
+  }
+  portENTER_CRITICAL(&s_phase_lock);
+  int64_t us = s_phase_us[phase];
+  portEXIT_CRITICAL(&s_phase_lock);
+  return us;
+}
+
+bool boot_profile_wait(boot_phase_t phase, uint32_t timeout_ms) {
+  // Polled: only used once per boot, not worth an event group
+  for (uint32_t waited = 0; boot_profile_get(phase) == 0;
+       waited += BOOT_WAIT_POLL_MS) {
+    if (waited >= timeout_ms) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(BOOT_WAIT_POLL_MS));
+  }
+  return true;
+}
+
+void boot_profile_log(void) {
+  ESP_LOGI(TAG, "Reset reason: %d", (int)esp_reset_reason());
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    int64_t us = boot_profile_get((boot_phase_t)i);
+    if (us) {
+      ESP_LOGI(TAG, "  %-22s %6lld.%03lld ms", phase_names[i], us / 1000,
+               us % 1000);
+    } else {
+      ESP_LOGI(TAG, "  %-22s pending", phase_names[i]);
+    }
+  }
+
+  int64_t decision_us = boot_profile_get(BOOT_PHASE_FIRST_DECISION);
+  int64_t upload_us = boot_profile_get(BOOT_PHASE_FIRST_UPLOAD);
+  ESP_LOGI(TAG, "Time to first relay decision: %lld ms, first upload: %lld ms",
+           decision_us ? decision_us / 1000 : -1LL,
+           upload_us ? upload_us / 1000 : -1LL);
+}
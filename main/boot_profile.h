@@ -0,0 +1,56 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Startup milestones, in the order they normally happen
+ */
+typedef enum {
+  BOOT_PHASE_APP_MAIN,         ///< app_main entered
+  BOOT_PHASE_RELAYS_SAFE,      ///< Relays driven to a known state
+  BOOT_PHASE_CONFIG_LOADED,    ///< Runtime configuration read from NVS
+  BOOT_PHASE_RADAR_STARTED,    ///< Radar UARTs running
+  BOOT_PHASE_FIRST_FRAME,      ///< First radar frame parsed
+  BOOT_PHASE_FIRST_DECISION,   ///< Relays set from radar data
+  BOOT_PHASE_NETWORK_START,    ///< Network stack bring-up started
+  BOOT_PHASE_WIFI_CONNECTED,   ///< Station got an IP address
+  BOOT_PHASE_FIRST_UPLOAD,     ///< First status upload accepted
+  BOOT_PHASE_COUNT
+} boot_phase_t;
+
+/**
+ * @brief Record the time a phase was reached; later calls are ignored
+ *
+ * Cheap once the phase is set, so it can sit on per-frame paths.
+ *
+ * @param phase Phase reached
+ * @return true if this call recorded the phase
+ */
+bool boot_profile_mark(boot_phase_t phase);
+
+/**
+ * @brief Time a phase was reached
+ *
+ * @param phase Phase to look up
+ * @return Microseconds since boot, 0 if not reached yet
+ */
+int64_t boot_profile_get(boot_phase_t phase);
+
+/**
+ * @brief Block until a phase is reached or the timeout expires
+ *
+ * @param phase Phase to wait for
+ * @param timeout_ms Maximum wait
+ * @return true if the phase was reached
+ */
+bool boot_profile_wait(boot_phase_t phase, uint32_t timeout_ms);
+
+/**
+ * @brief Log the reset reason and every phase reached so far, with
+ *        time-to-first-relay-decision and time-to-first-upload
+ */
+void boot_profile_log(void);
+
+#endif  // BOOT_PROFILE_H
@@ -0,0 +1,346 @@
+#include "health_monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "app_config.h"
+#include "esp_attr.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "gsheet_client.h"
+#include "health.h"
+#include "radar_reader.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "HEALTH";
+
+// Time each recovery step gets before the next one is tried
+#define RADAR_RESYNC_MS 2000
+#define RADAR_REINSTALL_MS 3000
+#define WIFI_RESTART_MS 60000
+
+// The relay loop runs at least once per sensor period, even with no radar
+// reporting; this many periods without an iteration is a stall
+#define LOOP_PERIODS 3
+#define LOOP_MARGIN_MS 2000
+
+// Grace after the watchdog should have fired, for builds where its panic
+// is disabled
+#define REBOOT_FALLBACK_MS 2000
+
+#define RADAR_SLOTS 2
+
+#ifdef CONFIG_ESP_TASK_WDT_CHECK_IDLE_TASK_CPU0
+#define WDT_IDLE_CPU0 (1u << 0)
+#else
+#define WDT_IDLE_CPU0 0
+#endif
+#ifdef CONFIG_ESP_TASK_WDT_CHECK_IDLE_TASK_CPU1
+#define WDT_IDLE_CPU1 (1u << 1)
+#else
+#define WDT_IDLE_CPU1 0
+#endif
+
+// Watchdog user names are kept by pointer
+static const char* const s_radar_names[RADAR_SLOTS][2] = {
+    {"radar0_bytes", "radar0_frames"},
+    {"radar1_bytes", "radar1_frames"},
+};
+
+// Why the last supervisor restart happened, kept across the reset
+#define HEALTH_RTC_MAGIC 0x484c5448  // "HLTH"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t restarts;  // Supervisor restarts since power-on
+  char stage[16];     // Stage that caused the last one, empty once reported
+} health_rtc_state_t;
+
+static RTC_NOINIT_ATTR health_rtc_state_t s_rtc;
+
+// Supervisor state; the monitor task writes it, the console only reads
+// counters
+static health_t s_health;
+static esp_task_wdt_user_handle_t s_wdt_users[HEALTH_MAX_STAGES];
+static int8_t s_stage_radar[HEALTH_MAX_STAGES];  // -1 for non-radar stages
+static int s_radar_stage[RADAR_SLOTS] = {-1, -1};  // Bytes stage
+static int s_loop_stage = -1;
+static int s_uploader_stage = -1;
+static uint32_t s_beats[HEALTH_BEAT_COUNT];
+static bool s_wdt_ready;
+static int s_reboot_stage = -1;
+static int64_t s_reboot_deadline_us;
+
+void health_monitor_beat(health_beat_t beat) {
+  __atomic_fetch_add(&s_beats[beat], 1, __ATOMIC_RELAXED);
+}
+
+static uint32_t loop_timeout_ms(const app_config_t* cfg) {
+  return cfg->sensor_period_ms * LOOP_PERIODS + LOOP_MARGIN_MS;
+}
+
+// Report a supervisor restart from the previous boot
+static void check_previous_reset(void) {
+  esp_reset_reason_t reason = esp_reset_reason();
+  bool retained = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT &&
+                  reason != ESP_RST_UNKNOWN;
+  if (!retained || s_rtc.magic != HEALTH_RTC_MAGIC) {
+    memset(&s_rtc, 0, sizeof(s_rtc));
+    s_rtc.magic = HEALTH_RTC_MAGIC;
+    return;
+  }
+  s_rtc.stage[sizeof(s_rtc.stage) - 1] = '\0';
+  if (s_rtc.stage[0]) {
+    ESP_LOGW(TAG, "Restarted by the supervisor: %s stalled (%lu since "
+                  "power-on)",
+             s_rtc.stage, s_rtc.restarts);
+    s_rtc.stage[0] = '\0';
+  }
+}
+
+static esp_err_t wdt_configure(void) {
+  esp_task_wdt_config_t config = {
+      .timeout_ms = CONFIG_HEALTH_WDT_TIMEOUT_S * 1000,
+      .idle_core_mask = WDT_IDLE_CPU0 | WDT_IDLE_CPU1,
+      .trigger_panic = true,
+  };
+  // Started at boot unless disabled in menuconfig
+  esp_err_t ret = esp_task_wdt_reconfigure(&config);
+  if (ret == ESP_ERR_INVALID_STATE) {
+    ret = esp_task_wdt_init(&config);
+  }
+  if (ret == ESP_OK) {
+    ret = esp_task_wdt_add(NULL);
+  }
+  return ret;
+}
+
+static int add_stage(const health_stage_config_t* config, int radar) {
+  int stage = health_add_stage(&s_health, config, esp_timer_get_time());
+  if (stage < 0) {
+    return stage;
+  }
+  s_stage_radar[stage] = (int8_t)radar;
+  if (s_wdt_ready &&
+      esp_task_wdt_add_user(config->name, &s_wdt_users[stage]) != ESP_OK) {
+    ESP_LOGW(TAG, "No watchdog entry for %s", config->name);
+    s_wdt_users[stage] = NULL;
+  }
+  return stage;
+}
+
+// Radars are supervised once the reader has started them, so a slot that
+// failed to start is not retried forever
+static void add_radar_stages(size_t index) {
+  health_stage_config_t bytes = {
+      .name = s_radar_names[index][0],
+      .timeout_ms = CONFIG_HEALTH_RADAR_TIMEOUT_MS,
+      .depends_on = -1,
+      .step_count = 3,
+      .steps = {HEALTH_ACTION_REINSTALL, HEALTH_ACTION_REINSTALL,
+                HEALTH_ACTION_REBOOT},
+      .step_ms = {RADAR_REINSTALL_MS, RADAR_REINSTALL_MS, RADAR_REINSTALL_MS},
+  };
+  int stage = add_stage(&bytes, (int)index);
+  if (stage < 0) {
+    return;
+  }
+  s_radar_stage[index] = stage;
+
+  // Bytes without frames: lost sync, a wrong baud rate or a wedged driver
+  health_stage_config_t frames = {
+      .name = s_radar_names[index][1],
+      .timeout_ms = CONFIG_HEALTH_RADAR_TIMEOUT_MS,
+      .depends_on = (int8_t)stage,
+      .step_count = 3,
+      .steps = {HEALTH_ACTION_RESYNC, HEALTH_ACTION_REINSTALL,
+                HEALTH_ACTION_REBOOT},
+      .step_ms = {RADAR_RESYNC_MS, RADAR_REINSTALL_MS, RADAR_REINSTALL_MS},
+  };
+  add_stage(&frames, (int)index);
+}
+
+void health_monitor_start(void) {
+  check_previous_reset();
+  health_init(&s_health);
+
+  esp_err_t ret = wdt_configure();
+  s_wdt_ready = ret == ESP_OK;
+  if (!s_wdt_ready) {
+    ESP_LOGW(TAG, "Task watchdog unavailable (%s), stalls are only recovered "
+                  "in software",
+             esp_err_to_name(ret));
+  }
+
+  // Only a restart gets a hung relay loop back
+  const app_config_t* cfg = app_config_get();
+  health_stage_config_t loop = {
+      .name = "relay_loop",
+      .timeout_ms = loop_timeout_ms(cfg),
+      .depends_on = -1,
+      .step_count = 1,
+      .steps = {HEALTH_ACTION_REBOOT},
+      .step_ms = {CONFIG_HEALTH_WDT_TIMEOUT_S * 1000},
+  };
+  app_config_release(cfg);
+  s_loop_stage = add_stage(&loop, -1);
+
+  // The uploader loops while the network is down too, so an unreachable AP
+  // or script is never a stall; a task stuck in the driver or a request is
+  health_stage_config_t uploader = {
+      .name = "uploader",
+      .timeout_ms = CONFIG_HEALTH_UPLOADER_TIMEOUT_S * 1000,
+      .depends_on = -1,
+      .step_count = 2,
+      .steps = {HEALTH_ACTION_RESTART_WIFI, HEALTH_ACTION_REBOOT},
+      .step_ms = {WIFI_RESTART_MS, CONFIG_HEALTH_WDT_TIMEOUT_S * 1000},
+  };
+  s_uploader_stage = add_stage(&uploader, -1);
+
+  ESP_LOGI(TAG, "Supervising relay loop and uploader, watchdog %d s",
+           CONFIG_HEALTH_WDT_TIMEOUT_S);
+#if !CONFIG_HEALTH_RECOVERY
+  ESP_LOGW(TAG, "Recovery disabled, stalls are only logged");
+#endif
+}
+
+static void recover(int stage, health_action_t action, int64_t now_us) {
+  const health_stage_t* s = &s_health.stages[stage];
+  ESP_LOGW(TAG, "%s without progress for %lu ms: %s", s->config.name,
+           (uint32_t)((now_us - s->progress_us) / 1000),
+           health_action_name(action));
+
+#if CONFIG_HEALTH_RECOVERY
+  switch (action) {
+    case HEALTH_ACTION_RESYNC:
+    case HEALTH_ACTION_REINSTALL:
+      radar_reader_recover((size_t)s_stage_radar[stage], action);
+      break;
+    case HEALTH_ACTION_RESTART_WIFI:
+      gsheet_client_wifi_abort();
+      break;
+    case HEALTH_ACTION_REBOOT:
+      if (s_reboot_stage >= 0) {
+        break;
+      }
+      // Relay state is already mirrored in RTC memory and restored by
+      // app_main. Letting the stage's watchdog entry run out gives a panic
+      // report with every task's backtrace before the reset.
+      s_rtc.restarts++;
+      strncpy(s_rtc.stage, s->config.name, sizeof(s_rtc.stage) - 1);
+      s_rtc.stage[sizeof(s_rtc.stage) - 1] = '\0';
+      s_reboot_stage = stage;
+      s_reboot_deadline_us =
+          now_us +
+          (int64_t)(CONFIG_HEALTH_WDT_TIMEOUT_S * 1000 + REBOOT_FALLBACK_MS) *
+              1000;
+      ESP_LOGE(TAG, "Restarting through the task watchdog");
+      break;
+    default:
+      break;
+  }
+#endif
+}
+
+void health_monitor_tick(void) {
+  int64_t now_us = esp_timer_get_time();
+
+  for (size_t i = 0; i < radar_reader_radar_count() && i < RADAR_SLOTS;
+       i++) {
+    uint32_t bytes;
+    uint32_t frames;
+    if (!radar_reader_progress(i, &bytes, &frames)) {
+      continue;
+    }
+    if (s_radar_stage[i] < 0) {
+      add_radar_stages(i);
+      continue;
+    }
+    health_observe(&s_health, s_radar_stage[i], bytes, now_us);
+    health_observe(&s_health, s_radar_stage[i] + 1, frames, now_us);
+  }
+
+  const app_config_t* cfg = app_config_get();
+  health_set_timeout(&s_health, s_loop_stage, loop_timeout_ms(cfg));
+  app_config_release(cfg);
+  health_observe(&s_health, s_loop_stage,
+                 __atomic_load_n(&s_beats[HEALTH_BEAT_RELAY_LOOP],
+                                 __ATOMIC_RELAXED),
+                 now_us);
+  health_observe(&s_health, s_uploader_stage,
+                 __atomic_load_n(&s_beats[HEALTH_BEAT_UPLOADER],
+                                 __ATOMIC_RELAXED),
+                 now_us);
+
+  int stage;
+  health_action_t action;
+  while ((action = health_check(&s_health, now_us, &stage)) !=
+         HEALTH_ACTION_NONE) {
+    recover(stage, action, now_us);
+  }
+
+  // Every stage but one being given up on keeps its watchdog entry fed
+  if (s_wdt_ready) {
+    esp_task_wdt_reset();
+    for (size_t i = 0; i < s_health.count; i++) {
+      if ((int)i != s_reboot_stage && s_wdt_users[i]) {
+        esp_task_wdt_reset_user(s_wdt_users[i]);
+      }
+    }
+  }
+  if (s_reboot_stage >= 0 && now_us >= s_reboot_deadline_us) {
+    esp_restart();
+  }
+}
+
+void health_monitor_log_summary(void) {
+  uint32_t stalls = 0;
+  for (size_t i = 0; i < s_health.count; i++) {
+    const health_stage_t* s = &s_health.stages[i];
+    if (s->stalls == 0) {
+      continue;
+    }
+    stalls += s->stalls;
+    ESP_LOGI(TAG,
+             "%s - Stalls: %lu, Recovered: %lu, Last outage: %lu ms, Max: "
+             "%lu ms, Last step: %s%s",
+             s->config.name, s->stalls, s->recoveries, s->last_outage_ms,
+             s->max_outage_ms, health_action_name(s->last_action),
+             s->stalled_us ? " (stalled)" : "");
+  }
+  if (stalls == 0) {
+    ESP_LOGI(TAG, "Health - %u stages progressing, no stalls since boot",
+             (unsigned)s_health.count);
+  }
+}
+
+static int cmd_health(int argc, char** argv) {
+  int64_t now_us = esp_timer_get_time();
+  printf("watchdog %d s%s, %lu supervisor restarts since power-on\n",
+         CONFIG_HEALTH_WDT_TIMEOUT_S, s_wdt_ready ? "" : " (unavailable)",
+         s_rtc.restarts);
+  printf("%-14s %-8s %8s %6s %9s %8s %8s  %s\n", "stage", "state", "idle ms",
+         "stalls", "recovered", "last ms", "max ms", "last step");
+  for (size_t i = 0; i < s_health.count; i++) {
+    const health_stage_t* s = &s_health.stages[i];
+    printf("%-14s %-8s %8lu %6lu %9lu %8lu %8lu  %s\n", s->config.name,
+           s->stalled_us ? "stalled" : "ok",
+           (uint32_t)((now_us - s->progress_us) / 1000), s->stalls,
+           s->recoveries, s->last_outage_ms, s->max_outage_ms,
+           s->stalls ? health_action_name(s->last_action) : "-");
+  }
+  return 0;
+}
+
+void health_monitor_register_console_cmd(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "health",
+      .help = "Show pipeline stages, their stalls and how they were "
+              "recovered",
+      .hint = NULL,
+      .func = &cmd_health,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
@@ -0,0 +1,48 @@
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <stdint.h>
+
+/**
+ * @brief Loops that report progress with health_monitor_beat(); the radar
+ *        stages follow the reader's byte and frame counters instead
+ */
+typedef enum {
+  HEALTH_BEAT_RELAY_LOOP,  ///< Sensor task iteration
+  HEALTH_BEAT_UPLOADER,    ///< WiFi task iteration or finished request
+  HEALTH_BEAT_COUNT,
+} health_beat_t;
+
+/**
+ * @brief Count one unit of progress (any task, lock-free)
+ *
+ * @param beat Loop that made progress
+ */
+void health_monitor_beat(health_beat_t beat);
+
+/**
+ * @brief Set up the supervised stages and the task watchdog
+ *
+ * Called once by the system monitor task, which is subscribed to the task
+ * watchdog and must call health_monitor_tick() every second from then on.
+ * Each stage is a watchdog user that only the supervisor resets, so a
+ * stage given up on shows by name in the watchdog report.
+ */
+void health_monitor_start(void);
+
+/**
+ * @brief Check every stage and carry out due recovery steps (monitor task)
+ */
+void health_monitor_tick(void);
+
+/**
+ * @brief Log stalls and recoveries since boot
+ */
+void health_monitor_log_summary(void);
+
+/**
+ * @brief Register the "health" console command
+ */
+void health_monitor_register_console_cmd(void);
+
+#endif  // HEALTH_MONITOR_H
@@ -1,47 +1,192 @@
 #include <stdio.h>
+#include <string.h>
+#include "app_config.h"
+#include "app_console.h"
+#include "boot_profile.h"
+#include "dlog.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "gsheet_client.h"
-#include "radar_sensor.h"
+#include "handoff.h"
+#include "health_monitor.h"
+#include "lzss.h"
+#include "mem_pool.h"
+#include "metrics.h"
+#include "occupancy.h"
+#include "power_mgr.h"
+#include "radar_reader.h"
+#include "rule_policy.h"
+#include "state_broadcast.h"
+#include "task_stats.h"
+#include "uplink.h"
 
 static const char* TAG = "RADAR_WATCH";
 
-#define RELAY_CH_1 GPIO_NUM_21
-#define RELAY_CH_2 GPIO_NUM_22
-#define RADAR_TX GPIO_NUM_16
-#define RADAR_RX GPIO_NUM_17
+// Credentials, URL, relay pins, baud rate and timings are runtime settings
+// (see app_config / "config" console command)
 
-// Configuration - Update these with your credentials
-#define WIFI_SSID "CAMPHIGH"
-#define WIFI_PASSWORD "samcam69"
-#define APPS_SCRIPT_URL                                                        \
-  "https://script.google.com/macros/s/"                                        \
-  "AKfycbwd8KMu5JVEsqry8rbqsiSqWbO00Sv6HHCZ6Zlpt5JRg5z4vsRBpr2WbvyK6jmqO4szfw" \
-  "/exec"
+// Upload kinds (uplink_item_t.kind). Relay transitions go in the state
+// class, closed occupancy intervals in the bulk class; see the uplink
+// component for queue sizes and drop policy.
+#define UPLOAD_STATUS 0
+#define UPLOAD_SUMMARY 1
 
-#define WIFI_RECONNECT_INTERVAL_MS 5000  // 5 seconds
-#define STATUS_QUEUE_SIZE 10
+// Bulk items sent per uploader pass before config and link are re-checked
+#define UPLOAD_BULK_BATCH 4
+
+// Retry delay after a failed upload: doubles per consecutive failure
+// between these bounds, with jitter so a fleet does not retry in step
+#define UPLOAD_RETRY_MIN_MS 2000
+#define UPLOAD_RETRY_MAX_MS 60000
+
+// Longest the uploader sleeps; queued state changes wake it at once
+#define UPLOAD_POLL_MS 1000
+
+// Frame gaps longer than this (radar silent) do not count as occupied time
+#define OCCUPANCY_MAX_GAP_MS 2000
+
+// Worst-case heatmap export: three characters per cell plus the header
+#define HEATMAP_BODY_SIZE (HEATMAP_CELLS * 3 + 128)
+
+// Retry delay after a failed heatmap upload
+#define HEATMAP_RETRY_MS 60000
+
+// Retry delay after a failed rules download
+#define RULES_RETRY_MS 60000
+
+_Static_assert(sizeof(occupancy_summary_t) <= UPLINK_ITEM_DATA_MAX,
+               "occupancy summary does not fit an uplink item");
+
+// Task stack sizes in bytes
+#define MONITOR_STACK_SIZE 4096
+#define WIFI_STACK_SIZE 8192
+#define READER_STACK_SIZE 4096
+#define SENSOR_STACK_SIZE 4096
+#define AGGREGATOR_STACK_SIZE 3072
+
+// Core 1 -> Core 0 handoff rings (see the handoff component): published
+// frames from the radar reader, relay changes from the sensor task. Sized
+// for over a second of frames from every radar at the full rate.
+#define FRAME_SLOTS 32
+#define DECISION_SLOTS 16
+
+// Longest the aggregator sleeps; a relay change or a half-full frame ring
+// wakes it at once
+#define AGGREGATOR_POLL_MS 100
+
+// Allocation counters start after this many monitor intervals, once WiFi,
+// TLS and the radars have done their one-time setup
+#define ALLOC_WARMUP_INTERVALS 2
+
+// System monitor report interval; the health supervisor runs every second
+#define MONITOR_REPORT_S 30
 
 // Global variables
 static gsheet_client_t gsheet_client;
-static QueueHandle_t status_queue;
 static SemaphoreHandle_t wifi_status_mutex;
 static bool wifi_connected = false;
 
-// Status message structure for queue
+// Long-lived tasks and IPC objects are statically allocated: nothing on the
+// steady-state path depends on heap state
+static StackType_t monitor_stack[MONITOR_STACK_SIZE];
+static StackType_t wifi_stack[WIFI_STACK_SIZE];
+static StackType_t reader_stack[READER_STACK_SIZE];
+static StackType_t sensor_stack[SENSOR_STACK_SIZE];
+static StackType_t aggregator_stack[AGGREGATOR_STACK_SIZE];
+static StaticTask_t monitor_tcb;
+static StaticTask_t wifi_tcb;
+static StaticTask_t reader_tcb;
+static StaticTask_t sensor_tcb;
+static StaticTask_t aggregator_tcb;
+static TaskHandle_t wifi_task_handle;
+static TaskHandle_t reader_task_handle;
+static TaskHandle_t sensor_task_handle;
+static TaskHandle_t aggregator_task_handle;
+static StaticSemaphore_t wifi_status_mutex_buf;
+
+// Relay change handed from the sensor task to the aggregator
+typedef struct {
+  int64_t timestamp_us;  // Frame (or loop start) the relays changed for
+  int64_t posted_us;
+  uint8_t relay_mask;
+} relay_decision_t;
+
+static radar_frame_msg_t frame_slots[FRAME_SLOTS];
+static relay_decision_t decision_slots[DECISION_SLOTS];
+static handoff_t frame_ring;
+static handoff_t decision_ring;
+
+// Relay changes replaced by a newer mask while the decision ring was full,
+// so Core 0 never saw them (written by the sensor task, read by monitor)
+static volatile uint32_t decisions_lost;
+
+// Upload attempts (written by WiFi task, read by monitor)
+static volatile uint32_t upload_count;
+
+// Relay channel bits: presence drives both, a predicted entry only the
+// channels configured for its doorway
+#define RELAY_CH1_BIT 0x01
+#define RELAY_CH2_BIT 0x02
+#define RELAY_ALL (RELAY_CH1_BIT | RELAY_CH2_BIT)
+
+// Relay GPIOs and channels currently driven by the sensor task
+static gpio_num_t relay_ch1 = GPIO_NUM_NC;
+static gpio_num_t relay_ch2 = GPIO_NUM_NC;
+static uint8_t relay_mask;
+
+// Relay pins and state mirrored into RTC memory, which keeps its contents
+// across software resets, so app_main can restore them before config load
+#define RELAY_RTC_MAGIC 0x52454c59  // "RELY"
+
 typedef struct {
-  gsheet_status_t status;
-  TickType_t timestamp;
-} status_message_t;
+  uint32_t magic;
+  int8_t ch1;
+  int8_t ch2;
+  uint8_t mask;
+  uint8_t check;
+} relay_rtc_state_t;
+
+static RTC_NOINIT_ATTR relay_rtc_state_t relay_rtc;
+
+// Sensor loop scheduling statistics (written by sensor task, read by monitor)
+typedef struct {
+  uint32_t iterations;
+  uint32_t deadline_misses;  // Overruns and late wake-ups
+  uint32_t max_busy_us;      // Longest loop body
+  uint32_t max_late_us;      // Worst wake-up lateness in periodic mode
+  // Per radar activity regime (radar_regime_t)
+  uint32_t regime_wakeups[RADAR_REGIME_COUNT];
+  uint64_t regime_busy_us[RADAR_REGIME_COUNT];
+} sensor_sched_stats_t;
+
+static volatile sensor_sched_stats_t sensor_sched_stats;
+
+// Predictive switch-on outcomes (written by sensor task, read by monitor)
+typedef struct {
+  uint32_t triggers;   // Relays switched on ahead of presence
+  uint32_t confirmed;  // Presence followed within the hold time
+  uint32_t expired;    // Nobody arrived: false triggers
+} approach_stats_t;
+
+static volatile approach_stats_t approach_stats;
 
 // Helper function to update WiFi status safely
 static void update_wifi_status(bool connected) {
   xSemaphoreTake(wifi_status_mutex, portMAX_DELAY);
   wifi_connected = connected;
   xSemaphoreGive(wifi_status_mutex);
+  if (connected) {
+    boot_profile_mark(BOOT_PHASE_WIFI_CONNECTED);
+  }
 }
 
 // Helper function to get WiFi status safely
@@ -53,52 +198,490 @@ static bool get_wifi_status(void) {
   return status;
 }
 
+static uint8_t relay_rtc_check(const relay_rtc_state_t* state) {
+  return (uint8_t)(state->ch1 ^ state->ch2 ^ state->mask ^ 0xA5);
+}
+
+static void relay_rtc_save(void) {
+  relay_rtc.magic = RELAY_RTC_MAGIC;
+  relay_rtc.ch1 = (int8_t)relay_ch1;
+  relay_rtc.ch2 = (int8_t)relay_ch2;
+  relay_rtc.mask = relay_mask;
+  relay_rtc.check = relay_rtc_check(&relay_rtc);
+}
+
+// Drive the relays (active low), one RELAY_*_BIT per energised channel
+static void set_relays(uint8_t mask) {
+  gpio_set_level(relay_ch1, (mask & RELAY_CH1_BIT) ? 0 : 1);
+  gpio_set_level(relay_ch2, (mask & RELAY_CH2_BIT) ? 0 : 1);
+  if (mask != relay_mask) {
+    relay_mask = mask;
+    relay_rtc_save();
+  }
+}
+
+// (Re)assign relay GPIOs, releasing pins that are no longer used
+static void configure_relays(gpio_num_t ch1, gpio_num_t ch2, uint8_t mask) {
+  gpio_num_t old_pins[] = {relay_ch1, relay_ch2};
+  for (int i = 0; i < 2; i++) {
+    if (old_pins[i] != GPIO_NUM_NC && old_pins[i] != ch1 &&
+        old_pins[i] != ch2) {
+      gpio_set_level(old_pins[i], 1);
+      gpio_reset_pin(old_pins[i]);
+    }
+  }
+
+  relay_ch1 = ch1;
+  relay_ch2 = ch2;
+  // Level first so the pins never glitch to ON while turning into outputs
+  gpio_set_level(relay_ch1, (mask & RELAY_CH1_BIT) ? 0 : 1);
+  gpio_set_level(relay_ch2, (mask & RELAY_CH2_BIT) ? 0 : 1);
+  gpio_set_direction(relay_ch1, GPIO_MODE_OUTPUT);
+  gpio_set_direction(relay_ch2, GPIO_MODE_OUTPUT);
+  relay_mask = mask;
+  relay_rtc_save();
+}
+
+// Put the relays back in their pre-reset state before config is loaded.
+// Returns the channels to keep on; none after power-on, brownout or when
+// disabled.
+static uint8_t relays_restore_early(void) {
+#if CONFIG_BOOT_RESTORE_RELAYS
+  esp_reset_reason_t reason = esp_reset_reason();
+  bool retained = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT &&
+                  reason != ESP_RST_UNKNOWN;
+  if (retained && relay_rtc.magic == RELAY_RTC_MAGIC &&
+      relay_rtc.check == relay_rtc_check(&relay_rtc) &&
+      (relay_rtc.mask & ~RELAY_ALL) == 0 &&
+      GPIO_IS_VALID_OUTPUT_GPIO(relay_rtc.ch1) &&
+      GPIO_IS_VALID_OUTPUT_GPIO(relay_rtc.ch2)) {
+    configure_relays((gpio_num_t)relay_rtc.ch1, (gpio_num_t)relay_rtc.ch2,
+                     relay_rtc.mask);
+    boot_profile_mark(BOOT_PHASE_RELAYS_SAFE);
+    return relay_rtc.mask;
+  }
+#endif
+  return 0;
+}
+
+// Build a gsheet client configuration that points into a config snapshot
+static void gsheet_config_from(const app_config_t* cfg, gsheet_config_t* out) {
+  out->apps_script_url = (char*)cfg->apps_script_url;
+  out->wifi_ssid = (char*)cfg->wifi_ssid;
+  out->wifi_password = (char*)cfg->wifi_password;
+  out->timeout_ms = (int)cfg->http_timeout_ms;
+  out->verify_redirect = cfg->http_verify != 0;
+  out->wifi_listen_interval = power_mgr_wifi_listen_interval();
+}
+
+// Per activity regime since boot: how often the radar reader and the sensor
+// loop wake up and how much CPU time they use, normalised to the time spent
+// in the regime so active and idle can be compared directly
+static void log_regime_stats(void) {
+  static const char* const names[RADAR_REGIME_COUNT] = {"active", "idle"};
+  radar_regime_stats_t reader[RADAR_REGIME_COUNT];
+  radar_reader_regime_stats(reader);
+
+  for (int r = 0; r < RADAR_REGIME_COUNT; r++) {
+    uint64_t time_us = reader[r].time_us;
+    if (time_us == 0) {
+      continue;
+    }
+    uint32_t sensor_wakeups = sensor_sched_stats.regime_wakeups[r];
+    uint64_t sensor_busy_us = sensor_sched_stats.regime_busy_us[r];
+    ESP_LOGI(TAG,
+             "Frame rate %s - %lu s, Reader: %lu wake/min %lu.%lu%% CPU "
+             "%lu/%lu frames processed, Sensor loop: %lu wake/min %lu.%lu%% "
+             "CPU",
+             names[r], (uint32_t)(time_us / 1000000),
+             (uint32_t)(reader[r].wakeups * 60000000ULL / time_us),
+             (uint32_t)(reader[r].busy_us * 1000 / time_us / 10),
+             (uint32_t)(reader[r].busy_us * 1000 / time_us % 10),
+             reader[r].processed, reader[r].frames,
+             (uint32_t)(sensor_wakeups * 60000000ULL / time_us),
+             (uint32_t)(sensor_busy_us * 1000 / time_us / 10),
+             (uint32_t)(sensor_busy_us * 1000 / time_us % 10));
+  }
+}
+
+// Log heap allocations made by the hot-path tasks since warm-up, per frame
+// and per upload; a steady state that allocates shows up as non-zero deltas
+static void log_alloc_counters(void) {
+  static uint32_t intervals;
+  static uint32_t base_reader, base_sensor, base_wifi, base_frames,
+      base_uploads;
+
+  uint32_t reader = mem_pool_task_allocs(reader_task_handle);
+  uint32_t sensor = mem_pool_task_allocs(sensor_task_handle);
+  uint32_t wifi = mem_pool_task_allocs(wifi_task_handle);
+  uint32_t frames = radar_reader_frame_count();
+  uint32_t uploads = upload_count;
+
+  if (intervals < ALLOC_WARMUP_INTERVALS) {
+    if (++intervals == ALLOC_WARMUP_INTERVALS) {
+      base_reader = reader;
+      base_sensor = sensor;
+      base_wifi = wifi;
+      base_frames = frames;
+      base_uploads = uploads;
+    }
+    return;
+  }
+
+  uint32_t frame_delta = frames - base_frames;
+  uint32_t upload_delta = uploads - base_uploads;
+  uint32_t frame_allocs = (reader - base_reader) + (sensor - base_sensor);
+  ESP_LOGI(TAG,
+           "Heap allocs since warm-up - Frames: %lu (%lu allocs), Uploads: "
+           "%lu (%lu allocs, %lu per upload)",
+           frame_delta, frame_allocs, upload_delta, wifi - base_wifi,
+           upload_delta > 0 ? (wifi - base_wifi) / upload_delta : 0);
+}
+
 // System monitoring task function (runs on Core 0)
 void system_monitor_task(void* pvParameters) {
   ESP_LOGI(TAG, "System monitor task started on Core %d", xPortGetCoreID());
+  uint32_t pass = 0;
+
+  // Stage heartbeats and the task watchdog; this task feeds it from now on
+  health_monitor_start();
 
   while (1) {
     // Get system information
     size_t free_heap = esp_get_free_heap_size();
     size_t min_free_heap = esp_get_minimum_free_heap_size();
 
-    // Check queue status
-    UBaseType_t queue_messages = uxQueueMessagesWaiting(status_queue);
-    UBaseType_t queue_spaces = uxQueueSpacesAvailable(status_queue);
-
     // Check WiFi status
     bool current_wifi_status = get_wifi_status();
 
     ESP_LOGI(TAG,
-             "System Status - Free Heap: %d bytes, Min Free: %d bytes, Queue: "
-             "%d/%d, WiFi: %s",
-             free_heap, min_free_heap, queue_messages,
-             queue_messages + queue_spaces,
+             "System Status - Free Heap: %d bytes, Min Free: %d bytes, WiFi: "
+             "%s",
+             free_heap, min_free_heap,
              current_wifi_status ? "Connected" : "Disconnected");
 
-    // Monitor every 30 seconds
-    vTaskDelay(pdMS_TO_TICKS(30000));
+    // Per-class upload queue depth, oldest item age and drops
+    uplink_log_summary();
+
+    // LAN state packets sent per reason
+    state_broadcast_log_summary();
+
+    // Core 1 -> Core 0 handoff depth and messages lost to a full ring. The
+    // reader never retries a frame, so every refused claim is a lost frame;
+    // the sensor task retries decisions, so only replaced ones are lost.
+    handoff_stats_t frames;
+    handoff_stats_t decisions;
+    handoff_get_stats(&frame_ring, &frames);
+    handoff_get_stats(&decision_ring, &decisions);
+    ESP_LOGI(TAG,
+             "Handoff - Frames: %lu (max depth %lu/%lu, dropped %lu), "
+             "Decisions: %lu (max depth %lu/%lu, ring full %lu, lost %lu)",
+             frames.written, frames.max_depth, frames.capacity,
+             frames.claim_failures, decisions.written, decisions.max_depth,
+             decisions.capacity, decisions.claim_failures, decisions_lost);
+
+    // Latency snapshot for the sensor-to-relay and upload pipelines
+    metrics_log_summary();
+
+    dlog_stats_t log_stats;
+    dlog_get_stats(&log_stats);
+    ESP_LOGI(TAG,
+             "Deferred log - Written: %lu, Dropped: %lu, Suppressed: %lu",
+             log_stats.written, log_stats.dropped, log_stats.suppressed);
+
+    ESP_LOGI(TAG,
+             "Sensor loop - Iterations: %lu, Deadline misses: %lu, Max busy: "
+             "%lu us, Max late: %lu us",
+             sensor_sched_stats.iterations, sensor_sched_stats.deadline_misses,
+             sensor_sched_stats.max_busy_us, sensor_sched_stats.max_late_us);
+
+    if (CONFIG_APPROACH_ENTRY_COUNT > 0) {
+      ESP_LOGI(TAG,
+               "Predictive switch-on - Triggers: %lu, Confirmed: %lu, "
+               "False: %lu",
+               approach_stats.triggers, approach_stats.confirmed,
+               approach_stats.expired);
+    }
+
+    // Stalled stages and how they were recovered
+    health_monitor_log_summary();
+
+    // Per-radar frame rate over the last interval
+    radar_reader_log_stats();
+    log_regime_stats();
+
+    // Per-task CPU usage, core load and stack high-water marks
+    task_stats_log();
+
+    // Time held awake by parse/upload work versus light sleep
+    power_mgr_log_summary();
+
+    // Heap allocations on the hot paths once boot-time setup is over
+    log_alloc_counters();
+    mem_pool_log_summary();
+
+    // Boot timeline for installs without network; otherwise the WiFi task
+    // logs it after the first upload
+    if (++pass == 2 && boot_profile_get(BOOT_PHASE_FIRST_UPLOAD) == 0) {
+      boot_profile_log();
+    }
+
+    // Supervise the pipeline every second, report every 30 seconds
+    for (int i = 0; i < MONITOR_REPORT_S; i++) {
+      health_monitor_tick();
+      vTaskDelay(pdMS_TO_TICKS(1000));
+    }
   }
 }
 
+static bool heatmap_to_lzss(void* ctx, const char* text, size_t len) {
+  return lzss_encoder_write((lzss_encoder_t*)ctx, text, len);
+}
+
+// Heatmap body as "type=heatmap&enc=lzss&z=<base64url>". The export is
+// streamed through the encoder, so no uncompressed copy exists. Sets
+// raw_len to the plain body's length and returns the compressed body's, or
+// -1 if it did not fit or is not shorter.
+static int build_heatmap_lzss(const heatmap_t* map, char* body, size_t size,
+                              size_t* raw_len) {
+  static lzss_encoder_t encoder;
+  static const char prefix[] = "type=heatmap&enc=lzss&z=";
+  lzss_b64_writer_t out;
+
+  memcpy(body, prefix, sizeof(prefix) - 1);
+  lzss_b64_init(&out, body + sizeof(prefix) - 1, size - (sizeof(prefix) - 1));
+  lzss_encoder_init(&encoder, lzss_b64_sink, &out);
+  bool ok = heatmap_export_stream(map, heatmap_to_lzss, &encoder) &&
+            lzss_encoder_finish(&encoder);
+  int z_len = ok ? lzss_b64_finish(&out) : -1;
+
+  *raw_len = strlen("type=heatmap&") + encoder.in_bytes;
+  if (z_len < 0) {
+    return -1;
+  }
+  size_t len = sizeof(prefix) - 1 + (size_t)z_len;
+  return len < *raw_len ? (int)len : -1;
+}
+
+// Export the heatmap every heatmap_upload seconds. Snapshot and body are
+// static: together they are several KB, too much for the WiFi task stack.
+static void upload_heatmap(const app_config_t* cfg) {
+  static heatmap_t snapshot;
+  static char body[HEATMAP_BODY_SIZE];
+  static TickType_t next_upload;
+  static bool scheduled;
+
+  TickType_t now = xTaskGetTickCount();
+  if (cfg->heatmap_upload_s == 0) {
+    scheduled = false;
+    return;
+  }
+  if (!scheduled) {
+    next_upload = now + pdMS_TO_TICKS(cfg->heatmap_upload_s * 1000);
+    scheduled = true;
+  }
+  if ((int32_t)(now - next_upload) < 0) {
+    return;
+  }
+
+  radar_reader_heatmap_snapshot(&snapshot);
+  int64_t encode_start = esp_timer_get_time();
+  size_t raw_len = 0;
+  int len = cfg->upload_compress ? build_heatmap_lzss(&snapshot, body,
+                                                      sizeof(body), &raw_len)
+                                 : -1;
+  if (len < 0) {
+    static const char prefix[] = "type=heatmap&";
+    memcpy(body, prefix, sizeof(prefix) - 1);
+    len = heatmap_export(&snapshot, body + sizeof(prefix) - 1,
+                         sizeof(body) - (sizeof(prefix) - 1));
+    if (len < 0) {
+      ESP_LOGE(TAG, "Heatmap export does not fit in %d bytes",
+               HEATMAP_BODY_SIZE);
+      next_upload = now + pdMS_TO_TICKS(cfg->heatmap_upload_s * 1000);
+      return;
+    }
+    len += sizeof(prefix) - 1;
+    raw_len = (size_t)len;
+  }
+  int64_t upload_start = esp_timer_get_time();
+
+  power_mgr_acquire(POWER_LOCK_HTTP);
+  esp_err_t ret = gsheet_client_post(&gsheet_client, body);
+  power_mgr_release(POWER_LOCK_HTTP);
+  upload_count++;
+
+  if (ret == ESP_OK) {
+    // Encode time covers the export as well
+    ESP_LOGI(TAG,
+             "Heatmap uploaded (%d bytes, %u plain, ratio %.2f, encode %lu "
+             "us, upload %lu ms)",
+             len, (unsigned)raw_len, (double)raw_len / len,
+             (unsigned long)(upload_start - encode_start),
+             (unsigned long)((esp_timer_get_time() - upload_start) / 1000));
+    next_upload = now + pdMS_TO_TICKS(cfg->heatmap_upload_s * 1000);
+  } else {
+    ESP_LOGW(TAG, "Failed to upload heatmap: %s", esp_err_to_name(ret));
+    next_upload = now + pdMS_TO_TICKS(HEATMAP_RETRY_MS);
+  }
+}
+
+// Download the rules from the script (doGet type=rules) when due and store
+// them if they compile and changed. The first poll runs right after WiFi
+// comes up, so a replaced device picks up its rules without a console.
+static void poll_rules(const app_config_t* cfg) {
+  static char text[APP_CONFIG_RULES_MAX];
+  static TickType_t next_poll;
+  static bool scheduled;
+
+  TickType_t now = xTaskGetTickCount();
+  if (cfg->rules_poll_s == 0) {
+    scheduled = false;
+    return;
+  }
+  if (scheduled && (int32_t)(now - next_poll) < 0) {
+    return;
+  }
+  scheduled = true;
+
+  power_mgr_acquire(POWER_LOCK_HTTP);
+  esp_err_t ret =
+      gsheet_client_get(&gsheet_client, "type=rules", text, sizeof(text), NULL);
+  power_mgr_release(POWER_LOCK_HTTP);
+
+  if (ret == ESP_OK) {
+    // A rejected text is logged and the rules in force are kept
+    rule_policy_store(text, "script");
+    next_poll = now + pdMS_TO_TICKS(cfg->rules_poll_s * 1000);
+  } else {
+    ESP_LOGW(TAG, "Failed to download rules: %s", esp_err_to_name(ret));
+    next_poll = now + pdMS_TO_TICKS(RULES_RETRY_MS);
+  }
+}
+
+// Queue a relay transition for upload and wake the uploader
+static void queue_status(gsheet_status_t status) {
+  uint8_t value = (uint8_t)status;
+  uplink_push(UPLINK_CLASS_STATE, UPLOAD_STATUS, &value, sizeof(value),
+              esp_timer_get_time());
+  METRICS_TRACE(METRICS_EVT_STATUS_QUEUED, status);
+  TaskHandle_t uploader = __atomic_load_n(&wifi_task_handle, __ATOMIC_ACQUIRE);
+  if (uploader) {
+    xTaskNotifyGive(uploader);
+  }
+}
+
+// Upload identity. A POST that timed out may still have been stored, so
+// every queued item carries device, boot and sequence (its uplink id, which
+// is kept across retries) and the script drops anything it has already
+// seen. The boot id separates this boot's sequence numbers from the last;
+// it is drawn on the first upload, once the radio feeds the RNG.
+static char device_id[13];
+static uint32_t boot_id;
+
+static int format_identity(char* buf, size_t len, uint32_t seq) {
+  if (boot_id == 0) {
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(device_id, sizeof(device_id), "%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    boot_id = esp_random() | 1;
+  }
+  return snprintf(buf, len, "&dev=%s&boot=%08lx&seq=%lu", device_id, boot_id,
+                  seq);
+}
+
+// Send one queued item. Relay transitions carry their age so the sheet
+// records when they happened, not when the link came back; a transition to
+// the state the sheet already shows is skipped.
+static esp_err_t send_upload(const uplink_item_t* item,
+                             gsheet_status_t* last_sent_status) {
+  char body[320];
+  occupancy_summary_t summary;
+  int len;
+
+  if (item->kind == UPLOAD_STATUS) {
+    gsheet_status_t status = (gsheet_status_t)item->data[0];
+    METRICS_HIST_SINCE(METRICS_HIST_QUEUE_RESIDENCY, item->queued_us);
+    METRICS_TRACE(METRICS_EVT_STATUS_DEQUEUED, status);
+    if (status == *last_sent_status) {
+      DLOGI(TAG, "DIAGNOSTIC: Status unchanged (%s), skipping send",
+            (status == GSHEET_STATUS_ON) ? "ON" : "OFF");
+      return ESP_OK;
+    }
+    uint32_t age_ms = (uint32_t)((esp_timer_get_time() - item->queued_us) /
+                                 1000);
+    len = snprintf(body, sizeof(body), "status=%s&age_ms=%lu",
+                   (status == GSHEET_STATUS_ON) ? "ON" : "OFF", age_ms);
+    ESP_LOGI(TAG, "Sending status to Google Sheets: %s (%lu ms old)",
+             (status == GSHEET_STATUS_ON) ? "ON" : "OFF", age_ms);
+  } else if (item->kind == UPLOAD_SUMMARY) {
+    memcpy(&summary, item->data, sizeof(summary));
+    len = occupancy_format(&summary, body, sizeof(body));
+  } else {
+    ESP_LOGE(TAG, "Unknown upload kind %u dropped", item->kind);
+    return ESP_OK;
+  }
+  if (len < 0 || (size_t)len >= sizeof(body) ||
+      format_identity(body + len, sizeof(body) - len, item->id) >=
+          (int)(sizeof(body) - len)) {
+    ESP_LOGE(TAG, "Upload body does not fit, item %lu dropped", item->id);
+    return ESP_OK;
+  }
+
+  TickType_t send_start = xTaskGetTickCount();
+  power_mgr_acquire(POWER_LOCK_HTTP);
+  esp_err_t ret = gsheet_client_post(&gsheet_client, body);
+  power_mgr_release(POWER_LOCK_HTTP);
+  upload_count++;
+  DLOGI(TAG, "DIAGNOSTIC: HTTP request took %lu ms",
+        (xTaskGetTickCount() - send_start) * portTICK_PERIOD_MS);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  if (item->kind == UPLOAD_STATUS) {
+    *last_sent_status = (gsheet_status_t)item->data[0];
+    ESP_LOGI(TAG, "Status updated in Google Sheets successfully");
+  } else {
+    ESP_LOGI(TAG, "Occupancy summary uploaded (%lu s occupied of %lu s)",
+             summary.occupied_ms / 1000,
+             (uint32_t)((summary.end_us - summary.start_us) / 1000000));
+  }
+  if (boot_profile_mark(BOOT_PHASE_FIRST_UPLOAD)) {
+    boot_profile_log();
+  }
+  return ESP_OK;
+}
+
 // WiFi task function (runs on Core 0)
 void wifi_task(void* pvParameters) {
   ESP_LOGI(TAG, "WiFi task started on Core %d", xPortGetCoreID());
 
-  // Initialize Google Sheets client
-  gsheet_config_t gsheet_config = {.apps_script_url = APPS_SCRIPT_URL,
-                                   .wifi_ssid = WIFI_SSID,
-                                   .wifi_password = WIFI_PASSWORD,
-                                   .timeout_ms = 10000};
+  // Initialize Google Sheets client (strings are copied by the client)
+  const app_config_t* cfg = app_config_get();
+  uint32_t applied_config_version = cfg->version;
+  gsheet_config_t gsheet_config;
+  gsheet_config_from(cfg, &gsheet_config);
 
   esp_err_t ret = gsheet_client_init(&gsheet_client, &gsheet_config);
   if (ret != ESP_OK) {
     ESP_LOGE(TAG, "Failed to initialize Google Sheets client: %s",
              esp_err_to_name(ret));
+    app_config_release(cfg);
     vTaskDelete(NULL);
     return;
   }
 
+  // Network bring-up waits until the radars have made the first relay
+  // decision, so the driver and PHY calibration never delay the relays
+  if (!boot_profile_wait(BOOT_PHASE_FIRST_DECISION,
+                         CONFIG_BOOT_NETWORK_DELAY_MS)) {
+    ESP_LOGW(TAG, "No relay decision after %d ms, starting network anyway",
+             CONFIG_BOOT_NETWORK_DELAY_MS);
+  }
+  boot_profile_mark(BOOT_PHASE_NETWORK_START);
+
   // Initial WiFi connection attempt
   ESP_LOGI(TAG, "Attempting initial WiFi connection...");
   ret = gsheet_client_wifi_connect(&gsheet_client);
@@ -106,19 +689,46 @@ void wifi_task(void* pvParameters) {
     update_wifi_status(true);
     ESP_LOGI(TAG, "WiFi connected successfully");
   } else {
-    ESP_LOGE(TAG,
-             "Initial WiFi connection failed, will retry every 30 seconds");
+    ESP_LOGE(TAG, "Initial WiFi connection failed, will retry every %lu ms",
+             cfg->wifi_reconnect_ms);
     update_wifi_status(false);
   }
 
-  status_message_t status_msg;
   // FIXED: Initialize to invalid state so first message always gets sent
   gsheet_status_t last_sent_status = (gsheet_status_t)-1;  // Invalid state
   TickType_t last_wifi_attempt = xTaskGetTickCount();
+  TickType_t retry_at = last_wifi_attempt;
+  uplink_backoff_t backoff;
+  uplink_backoff_init(&backoff, UPLOAD_RETRY_MIN_MS, UPLOAD_RETRY_MAX_MS,
+                      esp_random());
   bool wifi_init_done = (ret == ESP_OK);
 
   while (1) {
     TickType_t current_time = xTaskGetTickCount();
+    health_monitor_beat(HEALTH_BEAT_UPLOADER);
+
+    // Pick up configuration changes without restarting the task
+    cfg = app_config_refresh(cfg);
+    if (cfg->version != applied_config_version) {
+      bool credentials_changed =
+          strcmp(cfg->wifi_ssid, gsheet_client.config.wifi_ssid) != 0 ||
+          strcmp(cfg->wifi_password, gsheet_client.config.wifi_password) != 0;
+
+      gsheet_config_from(cfg, &gsheet_config);
+      if (gsheet_client_set_config(&gsheet_client, &gsheet_config) == ESP_OK) {
+        applied_config_version = cfg->version;
+        ESP_LOGI(TAG, "Uploader configuration updated (version %lu)",
+                 cfg->version);
+
+        if (credentials_changed) {
+          ESP_LOGI(TAG, "WiFi credentials changed, reconnecting...");
+          ret = gsheet_client_wifi_connect(&gsheet_client);
+          update_wifi_status(ret == ESP_OK);
+          wifi_init_done = wifi_init_done || (ret == ESP_OK);
+          last_wifi_attempt = xTaskGetTickCount();
+        }
+      }
+    }
 
     // Check WiFi connection status from gsheet_client (more accurate)
     bool gsheet_wifi_status = gsheet_client_is_wifi_connected(&gsheet_client);
@@ -134,10 +744,10 @@ void wifi_task(void* pvParameters) {
       current_wifi_status = gsheet_wifi_status;
     }
 
-    // If WiFi is not connected, try to reconnect only every 30 seconds
+    // If WiFi is not connected, try to reconnect at the configured interval
     if (!current_wifi_status) {
       if (current_time - last_wifi_attempt >=
-          pdMS_TO_TICKS(WIFI_RECONNECT_INTERVAL_MS)) {
+          pdMS_TO_TICKS(cfg->wifi_reconnect_ms)) {
         ESP_LOGI(TAG, "Attempting WiFi reconnection...");
         ret = gsheet_client_wifi_connect(&gsheet_client);
 
@@ -148,279 +758,585 @@ void wifi_task(void* pvParameters) {
           ESP_LOGI(TAG, "WiFi reconnected successfully");
           wifi_init_done = true;
         } else {
-          ESP_LOGW(TAG, "WiFi reconnection failed, will retry in 30 seconds");
+          ESP_LOGW(TAG, "WiFi reconnection failed, will retry in %lu ms",
+                   cfg->wifi_reconnect_ms);
         }
 
         last_wifi_attempt = current_time;
       }
 
-      // Clear the queue if WiFi is not connected to prevent buildup
-      status_message_t dummy_msg;
-      int dropped_count = 0;
-      while (xQueueReceive(status_queue, &dummy_msg, 0) == pdTRUE) {
-        dropped_count++;
-      }
-      if (dropped_count > 0) {
-        ESP_LOGI(TAG, "Dropped %d queued messages while WiFi disconnected",
-                 dropped_count);
-      }
-
-      // Short delay and continue loop
+      // Queued uploads are kept: state changes are never dropped and bulk
+      // telemetry evicts its own oldest items once full
       vTaskDelay(pdMS_TO_TICKS(1000));
       continue;
     }
 
-    // WiFi is connected - process status messages from queue
-    if (wifi_init_done && current_wifi_status) {
-      // DIAGNOSTIC: Check queue status before processing
-      UBaseType_t queue_count = uxQueueMessagesWaiting(status_queue);
-      if (queue_count > 0) {
-        ESP_LOGI(TAG, "DIAGNOSTIC: Queue has %d messages waiting", queue_count);
-      }
-
-      // Process all messages in queue and keep the latest one
-      status_message_t latest_msg;
-      bool got_message = false;
-      int processed_count = 0;
-
-      // Get all messages from queue and keep the latest
-      while (xQueueReceive(status_queue, &latest_msg, 0) == pdTRUE) {
-        status_msg = latest_msg;  // Keep overwriting with latest
-        got_message = true;
-        processed_count++;
-        ESP_LOGI(TAG,
-                 "DIAGNOSTIC: Processed queue message %d: %s (timestamp: %lu)",
-                 processed_count,
-                 (latest_msg.status == GSHEET_STATUS_ON) ? "ON" : "OFF",
-                 latest_msg.timestamp);
-      }
-
-      if (got_message) {
-        ESP_LOGI(TAG, "DIAGNOSTIC: Will send status %s (last_sent was %s)",
-                 (status_msg.status == GSHEET_STATUS_ON) ? "ON" : "OFF",
-                 (last_sent_status == GSHEET_STATUS_ON)    ? "ON"
-                 : (last_sent_status == GSHEET_STATUS_OFF) ? "OFF"
-                                                           : "NONE");
-
-        // FIXED: Send if status has changed OR if this is the first message
-        if (status_msg.status != last_sent_status ||
-            last_sent_status == (gsheet_status_t)-1) {
-          // Double-check WiFi status right before sending
-          if (!gsheet_client_is_wifi_connected(&gsheet_client)) {
+    // Wall-clock time for time-of-day rules and the LAN state publisher
+    // (once per boot)
+    rule_policy_time_start();
+    state_broadcast_start();
+
+    // WiFi is connected: state changes first, then bulk telemetry while no
+    // state change is waiting. The uplink queue re-checks priority before
+    // every send, so a relay transition never waits behind more than the
+    // one bulk request already in flight.
+    if (wifi_init_done && (int32_t)(xTaskGetTickCount() - retry_at) >= 0) {
+      uplink_item_t item;
+      uplink_class_t cls;
+      int bulk_sent = 0;
+      ret = ESP_OK;
+      while (uplink_peek(&item, &cls)) {
+        if (cls == UPLINK_CLASS_BULK && bulk_sent++ >= UPLOAD_BULK_BATCH) {
+          break;
+        }
+        ret = send_upload(&item, &last_sent_status);
+        health_monitor_beat(HEALTH_BEAT_UPLOADER);
+        if (ret != ESP_OK) {
+          // The item stays at the head of its class and is resent with the
+          // same sequence number; the script drops it if the failed
+          // attempt was stored after all
+          uint32_t delay_ms = uplink_backoff_next(&backoff);
+          ESP_LOGW(TAG, "Upload failed, item %lu kept for retry in %lu ms: %s",
+                   item.id, delay_ms, esp_err_to_name(ret));
+          retry_at = xTaskGetTickCount() + pdMS_TO_TICKS(delay_ms);
+
+          // A timeout says nothing about the link (the script may just be
+          // slow); only failures to connect trigger a reconnect
+          if (ret == ESP_ERR_HTTP_CONNECT || ret == ESP_ERR_INVALID_STATE) {
             ESP_LOGW(TAG,
-                     "WiFi disconnected just before sending, updating status");
+                     "Connection issue detected, marking WiFi as disconnected");
             update_wifi_status(false);
-            continue;  // Skip this iteration and go back to reconnection logic
-          }
-
-          ESP_LOGI(TAG, "Sending status to Google Sheets: %s",
-                   (status_msg.status == GSHEET_STATUS_ON) ? "ON" : "OFF");
-
-          TickType_t send_start = xTaskGetTickCount();
-          ret = gsheet_client_send_status(&gsheet_client, status_msg.status);
-          TickType_t send_end = xTaskGetTickCount();
-
-          ESP_LOGI(TAG, "DIAGNOSTIC: HTTP request took %lu ms",
-                   (send_end - send_start) * portTICK_PERIOD_MS);
-
-          if (ret == ESP_OK) {
-            last_sent_status = status_msg.status;
-            ESP_LOGI(TAG, "Status updated in Google Sheets successfully");
-          } else {
-            ESP_LOGW(TAG, "Failed to send status to Google Sheets: %s",
-                     esp_err_to_name(ret));
-
-            // Check if this is a connection issue
-            if (ret == ESP_ERR_HTTP_CONNECT || ret == ESP_ERR_TIMEOUT ||
-                ret == ESP_ERR_INVALID_STATE) {
-              ESP_LOGW(
-                  TAG,
-                  "Connection issue detected, marking WiFi as disconnected");
-              update_wifi_status(false);
-              last_wifi_attempt = xTaskGetTickCount() -
-                                  pdMS_TO_TICKS(WIFI_RECONNECT_INTERVAL_MS);
-            }
+            last_wifi_attempt =
+                xTaskGetTickCount() - pdMS_TO_TICKS(cfg->wifi_reconnect_ms);
           }
-        } else {
-          ESP_LOGI(TAG, "DIAGNOSTIC: Status unchanged (%s), skipping send",
-                   (status_msg.status == GSHEET_STATUS_ON) ? "ON" : "OFF");
+          break;
         }
+        uplink_backoff_reset(&backoff);
+        uplink_pop(cls, item.id);
+      }
+
+      // The heatmap is built at send time, so it only goes out once the
+      // queues have nothing more urgent; rule downloads likewise. Each
+      // reads the configuration as it is after the posts before it.
+      if (ret == ESP_OK && !uplink_state_pending()) {
+        cfg = app_config_refresh(cfg);
+        upload_heatmap(cfg);
+        health_monitor_beat(HEALTH_BEAT_UPLOADER);
+      }
+      if (ret == ESP_OK && !uplink_state_pending()) {
+        cfg = app_config_refresh(cfg);
+        poll_rules(cfg);
       }
     }
 
-    // Check for queued messages more frequently
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Sleep until a state change is queued or the poll interval ends
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPLOAD_POLL_MS));
   }
 }
 
-// Sensor task function (runs on Core 1)
-void sensor_task(void* pvParameters) {
-  ESP_LOGI(TAG, "Sensor task started on Core %d", xPortGetCoreID());
-
-  radar_sensor_t radar_sensor;
-  gsheet_status_t last_status = GSHEET_STATUS_OFF;
+// Targets close enough to the room origin to count as presence
+static size_t presence_count(const radar_view_t* view, uint32_t range_mm) {
+  if (range_mm == 0) {
+    return view->count;
+  }
+  float range_sq = (float)range_mm * (float)range_mm;
+  size_t present = 0;
+  for (size_t i = 0; i < view->count; i++) {
+    const radar_fused_target_t* t = &view->targets[i];
+    if (t->x * t->x + t->y * t->y <= range_sq) {
+      present++;
+    }
+  }
+  return present;
+}
 
-  // Initialize radar sensor
-  esp_err_t ret =
-      radar_sensor_init(&radar_sensor, UART_NUM_1, RADAR_TX, RADAR_RX);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to initialize radar sensor: %s",
-             esp_err_to_name(ret));
-    vTaskDelete(NULL);
-    return;
+// Block until wake_tick, returning early (true) when the radar reader
+// signals a predicted room entry
+static bool sensor_sleep_until(TickType_t wake_tick) {
+  TickType_t remaining = wake_tick - xTaskGetTickCount();
+  if ((int32_t)remaining <= 0) {
+    return false;
   }
+  return ulTaskNotifyTake(pdTRUE, remaining) > 0;
+}
 
-  ret = radar_sensor_begin(&radar_sensor, 256000);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to begin radar sensor communication: %s",
-             esp_err_to_name(ret));
-    radar_sensor_deinit(&radar_sensor);
-    vTaskDelete(NULL);
-    return;
+// Hand a relay change to the aggregator task. Returns false when the ring
+// is full.
+static bool post_decision(uint8_t mask, int64_t timestamp_us) {
+  relay_decision_t* msg = handoff_claim(&decision_ring);
+  if (!msg) {
+    return false;
+  }
+  msg->timestamp_us = timestamp_us;
+  msg->relay_mask = mask;
+  msg->posted_us = esp_timer_get_time();
+  handoff_commit(&decision_ring);
+  TaskHandle_t task =
+      __atomic_load_n(&aggregator_task_handle, __ATOMIC_ACQUIRE);
+  if (task) {
+    xTaskNotifyGive(task);
   }
+  return true;
+}
 
-  ESP_LOGI(TAG, "Radar sensor initialized successfully");
+// Sensor task function (runs on Core 1)
+void sensor_task(void* pvParameters) {
+  ESP_LOGI(TAG, "Sensor task started on Core %d", xPortGetCoreID());
 
-  // Initialize GPIO for relays
-  gpio_set_direction(RELAY_CH_1, GPIO_MODE_OUTPUT);
-  gpio_set_direction(RELAY_CH_2, GPIO_MODE_OUTPUT);
-  gpio_set_level(RELAY_CH_1, 1);  // Initially OFF (active low)
-  gpio_set_level(RELAY_CH_2, 1);  // Initially OFF (active low)
+  // Relays were put in a safe or restored state by app_main, which the
+  // aggregator starts from as well
+  uint8_t posted_mask = relay_mask;
+  // Change the decision ring refused, retried on the next iteration
+  bool decision_pending = false;
+  uint8_t pending_mask = 0;
+  const app_config_t* cfg = app_config_get();
+  uint32_t applied_config_version = cfg->version;
+  uint32_t seen_sequence = 0;
+  radar_view_t view;
+
+  // Configured rules replace the built-in policy below
+  bool rules_active = rule_policy_update(cfg);
+
+  // Channels switched on ahead of presence, kept until the hold runs out
+  uint8_t predicted_mask = 0;
+  int64_t predicted_at_us = 0;
+  int64_t predicted_until_us = 0;
 
   ESP_LOGI(TAG,
            "Sensor task ready - relays will switch regardless of WiFi status");
 
+  // Periodic mode releases the loop on a fixed tick grid anchored here
+  TickType_t last_wake = xTaskGetTickCount();
+  uint32_t sched_period_ms = cfg->sensor_period_ms;
+  TickType_t next_wake = last_wake + pdMS_TO_TICKS(sched_period_ms);
+  TickType_t delay_deadline = last_wake;
+  bool periodic = cfg->sensor_sched_mode == APP_CONFIG_SCHED_PERIODIC;
+  // Woken by a predicted entry rather than the schedule
+  bool woke_early = false;
+
   while (1) {
-    gsheet_status_t current_status = GSHEET_STATUS_OFF;
+    int64_t loop_start = esp_timer_get_time();
+
+    if (periodic && !woke_early) {
+      TickType_t late_ticks = xTaskGetTickCount() - last_wake;
+      uint32_t late_us = late_ticks * portTICK_PERIOD_MS * 1000;
+      if (late_us > sensor_sched_stats.max_late_us) {
+        sensor_sched_stats.max_late_us = late_us;
+      }
+      // One tick of slack for tick-boundary rounding
+      if (late_ticks > 1) {
+        sensor_sched_stats.deadline_misses++;
+      }
+    }
+
+    // Lock-free config read; apply relay pin changes in place
+    cfg = app_config_refresh(cfg);
+    if (cfg->version != applied_config_version) {
+      if (cfg->relay_ch1_gpio != relay_ch1 ||
+          cfg->relay_ch2_gpio != relay_ch2) {
+        configure_relays((gpio_num_t)cfg->relay_ch1_gpio,
+                         (gpio_num_t)cfg->relay_ch2_gpio, relay_mask);
+        DLOGI(TAG, "Relays moved to GPIO %d/%d", relay_ch1, relay_ch2);
+      }
+      rules_active = rule_policy_update(cfg);
+      if (rules_active) {
+        predicted_mask = 0;  // Rules decide about predicted entries too
+      }
+      applied_config_version = cfg->version;
+    }
 
-    // Update radar sensor
-    if (radar_sensor_update(&radar_sensor)) {
-      radar_target_t target = radar_sensor_get_target(&radar_sensor);
+    radar_reader_get_view(&view);
+    size_t present = presence_count(&view, cfg->presence_range_mm);
+
+    // Act on the fused room view if any radar delivered a frame since the
+    // last iteration
+    bool new_frame = view.sequence != seen_sequence;
+    if (new_frame) {
+      seen_sequence = view.sequence;
+      if (boot_profile_mark(BOOT_PHASE_FIRST_DECISION)) {
+        DLOGI(TAG, "First relay decision %lu ms after boot",
+              (uint32_t)(boot_profile_get(BOOT_PHASE_FIRST_DECISION) / 1000));
+      }
+    }
 
-      if (target.detected) {
-        ESP_LOGI(TAG,
-                 "Target detected - X: %.2f mm, Y: %.2f mm, Speed: %.2f cm/s, "
-                 "Distance: %.2f mm, Angle: %.2f°",
-                 target.x, target.y, target.speed, target.distance,
-                 target.angle);
+    if (rules_active) {
+      // Evaluated on every iteration, not only on new frames, so hold times
+      // and time windows run out on schedule. Only the two relay channels
+      // of this board are driven.
+      uint8_t mask =
+          rule_policy_eval(view.targets, view.count, present, view.entry_mask,
+                           loop_start) &
+          RELAY_ALL;
+      if (mask != relay_mask) {
+        METRICS_TRACE(METRICS_EVT_RELAY_SET, mask ? 1 : 0);
+      }
+      set_relays(mask);
+      if (new_frame) {
+        METRICS_HIST_SINCE(METRICS_HIST_FRAME_TO_RELAY,
+                           view.frame_timestamp_us);
+      }
+    } else if (new_frame) {
+      if (present > 0) {
+        const radar_fused_target_t* target = &view.targets[0];
+        // Deferred and rate limited: float formatting stays off this core
+        DLOGI_RATE(TAG, 1000,
+                   "Target detected - X: %.2f mm, Y: %.2f mm, Speed: %.2f "
+                   "cm/s, Targets: %d, Sensors: 0x%x",
+                   target->x, target->y, target->speed, (int)view.count,
+                   target->sensor_mask);
+
+        if (predicted_mask) {
+          // The predicted entry arrived: time gained over waiting for it
+          approach_stats.confirmed++;
+          METRICS_HIST_RECORD(
+              METRICS_HIST_APPROACH_LEAD,
+              (uint32_t)(view.frame_timestamp_us - predicted_at_us));
+          predicted_mask = 0;
+        }
 
         // Turn relays ON (active low) - THIS HAPPENS REGARDLESS OF WiFi STATUS
-        gpio_set_level(RELAY_CH_1, 0);
-        gpio_set_level(RELAY_CH_2, 0);
-        current_status = GSHEET_STATUS_ON;
+        set_relays(RELAY_ALL);
+        METRICS_HIST_SINCE(METRICS_HIST_FRAME_TO_RELAY,
+                           view.frame_timestamp_us);
+        METRICS_TRACE(METRICS_EVT_RELAY_SET, 1);
       } else {
-        ESP_LOGI(TAG, "No target detected");
+        if (view.approach_mask) {
+          // Someone is heading for a doorway: switch its channels on now
+          if (!predicted_mask) {
+            predicted_at_us = view.frame_timestamp_us;
+            approach_stats.triggers++;
+            DLOGI(TAG, "Entry predicted, relay channels 0x%x on",
+                  view.approach_mask);
+          }
+          predicted_mask |= view.approach_mask;
+          predicted_until_us =
+              view.frame_timestamp_us + CONFIG_APPROACH_HOLD_MS * 1000LL;
+        } else {
+          DLOGI_RATE(TAG, 1000, "No target detected");
+        }
 
-        // Turn relays OFF (active low) - THIS HAPPENS REGARDLESS OF WiFi STATUS
-        gpio_set_level(RELAY_CH_1, 1);
-        gpio_set_level(RELAY_CH_2, 1);
-        current_status = GSHEET_STATUS_OFF;
+        // Turn relays OFF (active low) unless an entry is predicted - THIS
+        // HAPPENS REGARDLESS OF WiFi STATUS
+        set_relays(predicted_mask);
+        METRICS_HIST_SINCE(METRICS_HIST_FRAME_TO_RELAY,
+                           view.frame_timestamp_us);
+        METRICS_TRACE(METRICS_EVT_RELAY_SET, predicted_mask ? 1 : 0);
       }
     }
 
-    // Queue status for Google Sheets only if status changed
-    if (current_status != last_status) {
-      status_message_t status_msg = {.status = current_status,
-                                     .timestamp = xTaskGetTickCount()};
+    // Predicted entry that never turned into presence: a false trigger
+    if (predicted_mask && loop_start >= predicted_until_us) {
+      approach_stats.expired++;
+      predicted_mask = 0;
+      set_relays(0);
+      METRICS_TRACE(METRICS_EVT_RELAY_SET, 0);
+      DLOGI(TAG, "Predicted entry did not happen, relays off");
+    }
 
-      // Try to send to queue (non-blocking)
-      if (xQueueSend(status_queue, &status_msg, 0) == pdTRUE) {
-        ESP_LOGI(TAG, "Status queued for upload: %s (relays already switched)",
-                 (current_status == GSHEET_STATUS_ON) ? "ON" : "OFF");
+    // Occupancy accounting and the status upload happen on Core 0. A full
+    // ring leaves posted_mask behind, so the change goes out next time; a
+    // waiting change that a newer mask replaces is lost to Core 0.
+    if (decision_pending && relay_mask != pending_mask) {
+      decisions_lost++;
+      decision_pending = false;
+    }
+    if (relay_mask != posted_mask) {
+      if (post_decision(relay_mask,
+                        new_frame ? view.frame_timestamp_us : loop_start)) {
+        posted_mask = relay_mask;
+        decision_pending = false;
       } else {
-        ESP_LOGW(TAG,
-                 "Status queue full, dropping message (relays still switched)");
+        decision_pending = true;
+        pending_mask = relay_mask;
       }
+    }
 
-      last_status = current_status;
+    // LAN listeners get the new state from Core 0; this only notifies
+    state_broadcast_update(relay_mask, (uint8_t)present, new_frame);
+
+    uint32_t busy_us = (uint32_t)(esp_timer_get_time() - loop_start);
+    METRICS_HIST_RECORD(METRICS_HIST_SENSOR_LOOP, busy_us);
+    sensor_sched_stats.iterations++;
+    health_monitor_beat(HEALTH_BEAT_RELAY_LOOP);
+    if (busy_us > sensor_sched_stats.max_busy_us) {
+      sensor_sched_stats.max_busy_us = busy_us;
+    }
+    radar_regime_t regime = radar_reader_regime();
+    sensor_sched_stats.regime_wakeups[regime]++;
+    sensor_sched_stats.regime_busy_us[regime] += busy_us;
+
+    // Run sensor task at the configured rate (or per published frame when
+    // frame driven). A predicted entry ends the wait early; the schedule
+    // itself is left as it was.
+    bool want_periodic = cfg->sensor_sched_mode == APP_CONFIG_SCHED_PERIODIC;
+    if (want_periodic &&
+        (!periodic || cfg->sensor_period_ms != sched_period_ms)) {
+      // Mode or rate changed: start a new grid from now
+      sched_period_ms = cfg->sensor_period_ms;
+      last_wake = xTaskGetTickCount();
+      next_wake = last_wake + pdMS_TO_TICKS(sched_period_ms);
+      woke_early = false;
     }
+    periodic = want_periodic;
+
+    if (cfg->sensor_sched_mode == APP_CONFIG_SCHED_FRAME_DRIVEN) {
+      // The reader notifies once per published view, at the full frame rate
+      // while the room is active and the idle rate once it is empty. The
+      // period only bounds the wait when no radar is reporting.
+      woke_early = false;
+      sensor_sleep_until(xTaskGetTickCount() +
+                         pdMS_TO_TICKS(cfg->sensor_period_ms));
+    } else if (periodic) {
+      if (!woke_early && (int32_t)(next_wake - xTaskGetTickCount()) < 0) {
+        // Overran the period: count it and re-anchor instead of bursting,
+        // then still sleep one period so the next pass is not back to back
+        sensor_sched_stats.deadline_misses++;
+        last_wake = xTaskGetTickCount();
+        next_wake = last_wake + pdMS_TO_TICKS(sched_period_ms);
+      }
+      woke_early = sensor_sleep_until(next_wake);
+      if (!woke_early) {
+        last_wake = next_wake;
+        next_wake += pdMS_TO_TICKS(sched_period_ms);
+      }
+    } else {
+      if (!woke_early) {
+        if (busy_us > cfg->sensor_period_ms * 1000) {
+          sensor_sched_stats.deadline_misses++;
+        }
+        delay_deadline =
+            xTaskGetTickCount() + pdMS_TO_TICKS(cfg->sensor_period_ms);
+      }
+      woke_early = sensor_sleep_until(delay_deadline);
+    }
+  }
+}
 
-    // Run sensor task at 1Hz
-    vTaskDelay(pdMS_TO_TICKS(1000));
+// Start an occupancy summary interval with the relays as they are
+static void start_interval(occupancy_t* occ, uint8_t mask, int64_t now_us) {
+  occupancy_init(occ, now_us, OCCUPANCY_MAX_GAP_MS * 1000LL);
+  for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+    occupancy_set_relay(occ, ch, (mask >> ch) & 1, now_us);
   }
+}
 
-  // Cleanup (won't be reached in this example)
-  radar_sensor_deinit(&radar_sensor);
+// Frames the reader could not hand off since boot. It never retries a
+// frame, so each refused claim is a frame lost to the heatmap and summary.
+static uint32_t frames_dropped(void) {
+  handoff_stats_t stats;
+  handoff_get_stats(&frame_ring, &stats);
+  return stats.claim_failures;
+}
+
+// Aggregator task function (runs on Core 0): everything the relays do not
+// wait for. Drains the frames and relay changes handed off by Core 1 in
+// timestamp order into the heatmap and the occupancy summary, and queues
+// summaries and relay transitions for the uploader.
+void aggregator_task(void* pvParameters) {
+  ESP_LOGI(TAG, "Aggregator task started on Core %d", xPortGetCoreID());
+
+  // Occupancy statistics for the current summary interval
+  static occupancy_t occupancy;
+  const app_config_t* cfg = app_config_get();
+  uint32_t agg_interval_s = cfg->agg_interval_s;
+  uint8_t mask = relay_mask;
+  gsheet_status_t last_status = mask ? GSHEET_STATUS_ON : GSHEET_STATUS_OFF;
+  start_interval(&occupancy, mask, esp_timer_get_time());
+  // Ring drops at the start of the interval; the summary reports the rest
+  uint32_t dropped_at_start = frames_dropped();
+
+  while (1) {
+    cfg = app_config_refresh(cfg);
+    if (cfg->agg_interval_s != agg_interval_s) {
+      // New interval length: drop the partial interval and start over
+      agg_interval_s = cfg->agg_interval_s;
+      start_interval(&occupancy, mask, esp_timer_get_time());
+      dropped_at_start = frames_dropped();
+    }
+
+    while (1) {
+      const radar_frame_msg_t* frame = handoff_peek(&frame_ring);
+      const relay_decision_t* decision = handoff_peek(&decision_ring);
+      if (!frame && !decision) {
+        break;
+      }
+      int64_t start_us = esp_timer_get_time();
+      if (decision &&
+          (!frame || decision->timestamp_us <= frame->frame_timestamp_us)) {
+        METRICS_HIST_RECORD(METRICS_HIST_HANDOFF,
+                            (uint32_t)(start_us - decision->posted_us));
+        mask = decision->relay_mask;
+        if (agg_interval_s > 0) {
+          for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+            occupancy_set_relay(&occupancy, ch, (mask >> ch) & 1,
+                                decision->timestamp_us);
+          }
+        }
+        handoff_release(&decision_ring);
+
+        // Queue status for Google Sheets only if status changed (and raw
+        // transitions are wanted next to the summaries)
+        gsheet_status_t status = mask ? GSHEET_STATUS_ON : GSHEET_STATUS_OFF;
+        if (status != last_status && cfg->raw_uploads) {
+          // Never blocks or fails; a full queue folds older transitions
+          queue_status(status);
+          DLOGI(TAG, "Status queued for upload: %s (relays already switched)",
+                (status == GSHEET_STATUS_ON) ? "ON" : "OFF");
+        }
+        last_status = status;
+      } else {
+        METRICS_HIST_RECORD(METRICS_HIST_HANDOFF,
+                            (uint32_t)(start_us - frame->posted_us));
+        radar_reader_heatmap_add(frame);
+        if (agg_interval_s > 0) {
+          occupancy_update(&occupancy, frame->targets, frame->count,
+                           frame->frame_timestamp_us);
+        }
+        handoff_release(&frame_ring);
+      }
+      METRICS_HIST_SINCE(METRICS_HIST_AGGREGATE, start_us);
+    }
+
+    // Close the summary interval; the WiFi task uploads it
+    int64_t now_us = esp_timer_get_time();
+    if (agg_interval_s > 0 && now_us - occupancy.current.start_us >=
+                                  (int64_t)agg_interval_s * 1000000) {
+      occupancy_summary_t summary;
+      occupancy_close(&occupancy, now_us, &summary);
+      uint32_t dropped = frames_dropped();
+      summary.frames_dropped = dropped - dropped_at_start;
+      dropped_at_start = dropped;
+      if (summary.frames_dropped > 0) {
+        ESP_LOGW(TAG, "Summary interval lost %lu frames to a full ring",
+                 summary.frames_dropped);
+      }
+      uplink_push(UPLINK_CLASS_BULK, UPLOAD_SUMMARY, &summary,
+                  sizeof(summary), now_us);
+    }
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AGGREGATOR_POLL_MS));
+  }
 }
 
 void app_main(void) {
-  ESP_LOGI(TAG, "Application starting...");
-  ESP_LOGI(TAG, "System will work as follows:");
-  ESP_LOGI(TAG,
-           "1. Sensor task (Core 1) - Always switches relays based on radar "
-           "detection");
-  ESP_LOGI(TAG,
-           "2. WiFi task (Core 0) - Connects to WiFi and sends data to Google "
-           "Sheets");
-  ESP_LOGI(TAG,
-           "3. Relays work immediately, Google Sheets updates only when WiFi "
-           "is connected");
-  ESP_LOGI(TAG,
-           "4. WiFi reconnection attempts every 30 seconds if disconnected");
+  boot_profile_mark(BOOT_PHASE_APP_MAIN);
 
-  // Create queue for status messages
-  status_queue = xQueueCreate(STATUS_QUEUE_SIZE, sizeof(status_message_t));
-  if (status_queue == NULL) {
-    ESP_LOGE(TAG, "Failed to create status queue");
+  // Relays first: back to their pre-reset state before anything else runs
+  uint8_t restored_mask = relays_restore_early();
+
+  // Load runtime configuration (NVS, falling back to defaults)
+  if (app_config_init() != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to load configuration");
     return;
   }
+  boot_profile_mark(BOOT_PHASE_CONFIG_LOADED);
+
+  // Configured relay pins, keeping the restored state (OFF on a cold boot)
+  const app_config_t* cfg = app_config_get();
+  configure_relays((gpio_num_t)cfg->relay_ch1_gpio,
+                   (gpio_num_t)cfg->relay_ch2_gpio, restored_mask);
+  app_config_release(cfg);
+  boot_profile_mark(BOOT_PHASE_RELAYS_SAFE);
+  if (restored_mask) {
+    ESP_LOGI(TAG, "Relays restored ON after reset");
+  }
 
-  // Create mutex for WiFi status
-  wifi_status_mutex = xSemaphoreCreateMutex();
-  if (wifi_status_mutex == NULL) {
-    ESP_LOGE(TAG, "Failed to create WiFi status mutex");
-    vQueueDelete(status_queue);
-    return;
+  // Frequency scaling and light sleep, before any task takes a PM lock
+  if (power_mgr_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Power management unavailable, running at full power");
   }
 
-  // Create system monitor task on Core 0 (monitors system health)
-  BaseType_t monitor_task_created =
-      xTaskCreatePinnedToCore(system_monitor_task, "system_monitor", 4096, NULL,
-                              1,  // Low priority for monitoring
-                              NULL,
-                              0  // Pin to Core 0
-      );
-
-  if (monitor_task_created != pdPASS) {
-    ESP_LOGE(TAG, "Failed to create system monitor task");
-    vQueueDelete(status_queue);
-    vSemaphoreDelete(wifi_status_mutex);
+  // Start the deferred log formatter before any task uses DLOG*
+  if (dlog_init() != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to start deferred logging task");
     return;
   }
 
-  // Create WiFi task on Core 0 (handles network operations)
-  BaseType_t wifi_task_created = xTaskCreatePinnedToCore(
-      wifi_task, "wifi_task", 8192, NULL,  // Increased stack size
-      5,                                   // Higher priority for WiFi task
-      NULL,
+  // Prioritised upload queues (static storage, cannot fail)
+  uplink_init();
+
+  // Create mutex for WiFi status
+  wifi_status_mutex = xSemaphoreCreateMutexStatic(&wifi_status_mutex_buf);
+
+  // Aggregator on Core 0 before the radars, so the reader has somewhere to
+  // hand its frames. Above the WiFi task so a TLS handshake cannot back up
+  // the rings; it needs a few microseconds per message.
+  handoff_init(&frame_ring, frame_slots, sizeof(frame_slots[0]), FRAME_SLOTS);
+  handoff_init(&decision_ring, decision_slots, sizeof(decision_slots[0]),
+               DECISION_SLOTS);
+  aggregator_task_handle = xTaskCreateStaticPinnedToCore(
+      aggregator_task, "aggregator", AGGREGATOR_STACK_SIZE, NULL,
+      6,  // Above the WiFi task
+      aggregator_stack, &aggregator_tcb,
       0  // Pin to Core 0
   );
-
-  if (wifi_task_created != pdPASS) {
-    ESP_LOGE(TAG, "Failed to create WiFi task");
-    vQueueDelete(status_queue);
-    vSemaphoreDelete(wifi_status_mutex);
-    return;
-  }
+  radar_reader_set_frame_sink(&frame_ring, aggregator_task_handle);
+
+  // Radars before any network work: create radar reader task on Core 1
+  // (parses frames as they arrive and fuses all radars); above the sensor
+  // task so frames are never delayed
+  reader_task_handle = xTaskCreateStaticPinnedToCore(
+      radar_reader_task, "radar_reader", READER_STACK_SIZE, NULL,
+      5,  // Highest priority on Core 1
+      reader_stack, &reader_tcb,
+      1  // Pin to Core 1
+  );
 
   // Create sensor task on Core 1 (handles real-time sensor operations)
-  BaseType_t sensor_task_created =
-      xTaskCreatePinnedToCore(sensor_task, "sensor_task", 4096, NULL,
-                              4,  // High priority for sensor task (real-time)
-                              NULL,
-                              1  // Pin to Core 1
-      );
-
-  if (sensor_task_created != pdPASS) {
-    ESP_LOGE(TAG, "Failed to create sensor task");
-    vQueueDelete(status_queue);
-    vSemaphoreDelete(wifi_status_mutex);
-    return;
-  }
+  sensor_task_handle = xTaskCreateStaticPinnedToCore(
+      sensor_task, "sensor_task", SENSOR_STACK_SIZE, NULL,
+      4,  // High priority for sensor task (real-time)
+      sensor_stack, &sensor_tcb,
+      1  // Pin to Core 1
+  );
+  // Predicted room entries wake the sensor task between its periodic runs
+  radar_reader_set_wake_task(sensor_task_handle);
+
+  // Create system monitor task on Core 0 (monitors system health)
+  xTaskCreateStaticPinnedToCore(system_monitor_task, "system_monitor",
+                                MONITOR_STACK_SIZE, NULL,
+                                1,  // Low priority for monitoring
+                                monitor_stack, &monitor_tcb,
+                                0  // Pin to Core 0
+  );
+
+  // Create WiFi task on Core 0 (handles network operations); it brings the
+  // network stack up in the background once the relays are running
+  wifi_task_handle = xTaskCreateStaticPinnedToCore(
+      wifi_task, "wifi_task", WIFI_STACK_SIZE, NULL,
+      5,  // Higher priority for WiFi task
+      wifi_stack, &wifi_tcb,
+      0  // Pin to Core 0
+  );
 
+  // Count heap allocations made by the hot-path tasks
+  mem_pool_watch_task(wifi_task_handle);
+  mem_pool_watch_task(reader_task_handle);
+  mem_pool_watch_task(sensor_task_handle);
+
+  ESP_LOGI(TAG, "Application started (%lld ms after boot)",
+           esp_timer_get_time() / 1000);
+  ESP_LOGI(TAG, "System will work as follows:");
+  ESP_LOGI(TAG,
+           "1. Sensor task (Core 1) - Always switches relays based on radar "
+           "detection");
+  ESP_LOGI(TAG,
+           "2. WiFi task (Core 0) - Connects to WiFi and sends data to Google "
+           "Sheets");
+  ESP_LOGI(TAG,
+           "3. Relays work immediately, Google Sheets updates only when WiFi "
+           "is connected");
+  ESP_LOGI(TAG,
+           "4. WiFi reconnection attempts at the configured interval if "
+           "disconnected");
   ESP_LOGI(TAG, "All tasks created successfully");
-  ESP_LOGI(TAG, "Core 0: WiFi task + System monitor task");
-  ESP_LOGI(TAG, "Core 1: Sensor task (real-time relay control)");
+  ESP_LOGI(TAG, "Core 0: WiFi task + Aggregator + System monitor task");
+  ESP_LOGI(TAG, "Core 1: Radar reader + Sensor task (real-time relay control)");
+
+  // Diagnostic console ("help" lists commands, "metrics" dumps latencies)
+  if (app_console_start() != ESP_OK) {
+    ESP_LOGW(TAG, "Console unavailable, continuing without it");
+  }
 
   // app_main runs on Core 0, so we can add a simple alive indicator
   while (1) {
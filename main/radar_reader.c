@@ -0,0 +1,852 @@
+#include "radar_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "app_config.h"
+#include "approach.h"
+#include "boot_profile.h"
+#include "clutter.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "heatmap.h"
+#include "metrics.h"
+#include "power_mgr.h"
+#include "radar_sensor.h"
+
+static const char* TAG = "RADAR_READER";
+
+#define RADAR_TX GPIO_NUM_16
+#define RADAR_RX GPIO_NUM_17
+
+// Upper bound on how long the reader waits before re-checking config and
+// command timeouts
+#define RADAR_CONFIG_POLL_MS 200
+// Same while idle with no module command in flight
+#define RADAR_IDLE_POLL_MS 1000
+
+// Module commands waiting to run, one bit each, lowest bit first
+#define RADAR_REQ_FIRMWARE (1u << 0)
+#define RADAR_REQ_TRACKING (1u << 1)
+#define RADAR_REQ_BAUD (1u << 2)
+#define RADAR_REQ_RESET (1u << 3)
+
+// Recovery steps asked for by the health supervisor, serviced at the top of
+// the next reader iteration ahead of module commands
+#define RADAR_RECOVER_RESYNC (1u << 0)
+#define RADAR_RECOVER_REINSTALL (1u << 1)
+
+// Radars on this controller; the index is also the fusion sensor index.
+// RADAR_TX/RX name the module's pins, so RADAR_TX is the ESP32's RX line.
+typedef struct {
+  uart_port_t port;
+  gpio_num_t radar_tx;
+  gpio_num_t radar_rx;
+  radar_mount_t mount;
+} radar_slot_t;
+
+static const radar_slot_t radar_slots[] = {
+    {UART_NUM_1,
+     RADAR_TX,
+     RADAR_RX,
+     {CONFIG_RADAR1_MOUNT_X_MM, CONFIG_RADAR1_MOUNT_Y_MM,
+      CONFIG_RADAR1_MOUNT_ROTATION_DEG}},
+#if CONFIG_RADAR_COUNT > 1
+    {UART_NUM_2,
+     CONFIG_RADAR2_TX_GPIO,
+     CONFIG_RADAR2_RX_GPIO,
+     {CONFIG_RADAR2_MOUNT_X_MM, CONFIG_RADAR2_MOUNT_Y_MM,
+      CONFIG_RADAR2_MOUNT_ROTATION_DEG}},
+#endif
+};
+
+#define RADAR_COUNT (sizeof(radar_slots) / sizeof(radar_slots[0]))
+
+// Owned by the reader task; the monitor and console only read counters
+static radar_sensor_t radars[RADAR_COUNT];
+static bool radar_active[RADAR_COUNT];
+static radar_fusion_t radar_fusion;
+static uint32_t radar_requests[RADAR_COUNT];
+static uint32_t radar_recovery[RADAR_COUNT];
+static char radar_firmware[RADAR_COUNT][24];
+// Frame count when the module was told to restart; commands wait for the
+// first frame after it so they are not sent while the module boots
+static uint32_t radar_restart_mark[RADAR_COUNT];
+static bool radar_restarting[RADAR_COUNT];
+// Frames the UART driver currently collects per data event
+static uint8_t radar_rx_batch[RADAR_COUNT];
+
+static radar_view_t fused_view;
+static portMUX_TYPE fused_view_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Where people spend time, counted per fused frame by the frame sink's task
+// on Core 0. Whole-grid operations (decay, snapshot, reset) take a few
+// microseconds under the lock.
+static heatmap_t heatmap;
+static portMUX_TYPE heatmap_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Learnt background (fans, curtains, reflections) on the heatmap grid.
+// Updated by the reader task; the console copies or resets it.
+static clutter_t clutter;
+static portMUX_TYPE clutter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Doorway approach predictor; reader task only
+static approach_t approach;
+static uint8_t approach_last_mask;
+static TaskHandle_t wake_task;
+
+// Aggregation runs on the frame sink's task; the reader only fills a slot
+static handoff_t* frame_sink;
+static TaskHandle_t frame_sink_task;
+
+#if CONFIG_APPROACH_ENTRY_COUNT > 0
+static const approach_entry_t approach_entries[CONFIG_APPROACH_ENTRY_COUNT] = {
+    {CONFIG_APPROACH_ENTRY1_X_MM, CONFIG_APPROACH_ENTRY1_Y_MM,
+     CONFIG_APPROACH_ENTRY1_HEADING_DEG, CONFIG_APPROACH_RADIUS_MM,
+     CONFIG_APPROACH_ENTRY1_RELAYS},
+#if CONFIG_APPROACH_ENTRY_COUNT > 1
+    {CONFIG_APPROACH_ENTRY2_X_MM, CONFIG_APPROACH_ENTRY2_Y_MM,
+     CONFIG_APPROACH_ENTRY2_HEADING_DEG, CONFIG_APPROACH_RADIUS_MM,
+     CONFIG_APPROACH_ENTRY2_RELAYS},
+#endif
+};
+#else
+static const approach_entry_t* const approach_entries = NULL;
+#endif
+
+// Activity regime. Every byte is parsed in both regimes so frame sync is
+// never lost; idle only skips fusion and everything downstream of it.
+// Written by the reader task under regime_lock; the stats are read by the
+// monitor.
+static radar_regime_t regime;
+static int64_t regime_since_us;
+static int64_t last_presence_us;
+static int64_t last_publish_us;
+static radar_regime_stats_t regime_stats[RADAR_REGIME_COUNT];
+static portMUX_TYPE regime_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Hand a published frame to the aggregator. A full ring loses the frame
+// for both the heatmap and the occupancy summary; the handoff counts it and
+// the aggregator reports the count with each summary.
+static void post_frame(const radar_fused_target_t* merged, size_t count,
+                       int64_t frame_timestamp_us) {
+  if (!frame_sink) {
+    return;
+  }
+  radar_frame_msg_t* msg = handoff_claim(frame_sink);
+  if (!msg) {
+    return;
+  }
+  msg->frame_timestamp_us = frame_timestamp_us;
+  msg->count = count;
+  memcpy(msg->targets, merged, count * sizeof(merged[0]));
+  msg->posted_us = esp_timer_get_time();
+  uint32_t depth = handoff_commit(frame_sink);
+  if (frame_sink_task && depth == (frame_sink->mask + 1) / 2) {
+    xTaskNotifyGive(frame_sink_task);
+  }
+}
+
+// Merge all radars into the room frame and publish for the sensor task.
+// Returns the number of targets published.
+static size_t publish_fused_view(int64_t frame_timestamp_us,
+                                 bool notify_every_frame) {
+  radar_fused_target_t merged[RADAR_FUSION_MAX_TARGETS];
+
+  int64_t fusion_start = METRICS_NOW_US();
+  size_t count = radar_fusion_merge(&radar_fusion, frame_timestamp_us, merged,
+                                    RADAR_FUSION_MAX_TARGETS);
+  METRICS_HIST_SINCE(METRICS_HIST_FUSION, fusion_start);
+
+  // Drop slow targets in clutter cells before anything downstream sees them
+  portENTER_CRITICAL(&clutter_lock);
+  count = clutter_filter(&clutter, merged, count);
+  portEXIT_CRITICAL(&clutter_lock);
+
+  post_frame(merged, count, frame_timestamp_us);
+
+  uint8_t approach_mask =
+      approach_update(&approach, merged, count, frame_timestamp_us);
+
+  portENTER_CRITICAL(&fused_view_lock);
+  memcpy(fused_view.targets, merged, count * sizeof(merged[0]));
+  fused_view.count = count;
+  fused_view.frame_timestamp_us = frame_timestamp_us;
+  fused_view.approach_mask = approach_mask;
+  fused_view.entry_mask = approach.entry_mask;
+  fused_view.sequence++;
+  portEXIT_CRITICAL(&fused_view_lock);
+
+  // The sensor task may be asleep for most of its period: wake it as soon as
+  // a new doorway approach is seen, or for every frame when it is frame
+  // driven
+  TaskHandle_t task = __atomic_load_n(&wake_task, __ATOMIC_ACQUIRE);
+  if ((notify_every_frame || (approach_mask & ~approach_last_mask)) && task) {
+    xTaskNotifyGive(task);
+  }
+  approach_last_mask = approach_mask;
+  return count;
+}
+
+static void set_regime(radar_regime_t next, int64_t now_us) {
+  portENTER_CRITICAL(&regime_lock);
+  regime_stats[regime].time_us += now_us - regime_since_us;
+  regime_since_us = now_us;
+  __atomic_store_n(&regime, next, __ATOMIC_RELAXED);
+  portEXIT_CRITICAL(&regime_lock);
+  ESP_LOGI(TAG, "Room %s: %s", next == RADAR_REGIME_IDLE ? "idle" : "active",
+           next == RADAR_REGIME_IDLE ? "frames decimated" : "full frame rate");
+}
+
+// Whether a newly parsed frame is fused. Idle skips frames until the idle
+// period has passed, except one that reports a target, which is taken at
+// once so the first detection is not delayed.
+static bool frame_wanted(bool has_target, int64_t now_us,
+                         const app_config_t* cfg) {
+  return regime == RADAR_REGIME_ACTIVE || has_target ||
+         now_us - last_publish_us >= (int64_t)cfg->idle_period_ms * 1000;
+}
+
+// Regime change after a published frame: any target restores the full
+// rate, idle_after_s without one drops to the idle rate
+static void update_regime(size_t count, int64_t now_us,
+                          const app_config_t* cfg) {
+  last_publish_us = now_us;
+  if (count > 0) {
+    last_presence_us = now_us;
+    if (regime == RADAR_REGIME_IDLE) {
+      set_regime(RADAR_REGIME_ACTIVE, now_us);
+    }
+  } else if (regime == RADAR_REGIME_ACTIVE && cfg->idle_after_s > 0 &&
+             now_us - last_presence_us >=
+                 (int64_t)cfg->idle_after_s * 1000000) {
+    set_regime(RADAR_REGIME_IDLE, now_us);
+  }
+}
+
+// A module command is queued, in flight or waiting for the module to boot
+static bool radar_busy(size_t index) {
+  return radars[index].cmd.state != RADAR_CMD_IDLE ||
+         radar_restarting[index] ||
+         __atomic_load_n(&radar_requests[index], __ATOMIC_RELAXED) != 0;
+}
+
+// While idle, let the UART collect several frames per event. A busy radar
+// keeps an event per frame so command replies are not held back.
+static void update_rx_batch(size_t index) {
+  uint8_t batch = regime == RADAR_REGIME_IDLE && !radar_busy(index)
+                      ? CONFIG_RADAR_IDLE_RX_BATCH
+                      : 1;
+  if (batch != radar_rx_batch[index] &&
+      radar_sensor_set_rx_batch(&radars[index], batch) == ESP_OK) {
+    radar_rx_batch[index] = batch;
+  }
+}
+
+radar_regime_t radar_reader_regime(void) {
+  return __atomic_load_n(&regime, __ATOMIC_RELAXED);
+}
+
+void radar_reader_regime_stats(radar_regime_stats_t* out) {
+  int64_t now_us = esp_timer_get_time();
+  portENTER_CRITICAL(&regime_lock);
+  memcpy(out, regime_stats, sizeof(regime_stats));
+  out[regime].time_us += now_us - regime_since_us;
+  portEXIT_CRITICAL(&regime_lock);
+}
+
+void radar_reader_set_wake_task(TaskHandle_t task) {
+  __atomic_store_n(&wake_task, task, __ATOMIC_RELEASE);
+}
+
+void radar_reader_set_frame_sink(handoff_t* ring, TaskHandle_t task) {
+  frame_sink_task = task;
+  frame_sink = ring;
+}
+
+void radar_reader_get_view(radar_view_t* out) {
+  portENTER_CRITICAL(&fused_view_lock);
+  memcpy(out, &fused_view, sizeof(*out));
+  portEXIT_CRITICAL(&fused_view_lock);
+}
+
+// Halve the heatmap every CONFIG_OCCUPANCY_HEATMAP_DECAY_S
+static void heatmap_maybe_decay(void) {
+#if CONFIG_OCCUPANCY_HEATMAP_DECAY_S > 0
+  static int64_t last_decay_us;
+  int64_t now_us = esp_timer_get_time();
+  if (now_us - last_decay_us <
+      (int64_t)CONFIG_OCCUPANCY_HEATMAP_DECAY_S * 1000000) {
+    return;
+  }
+  last_decay_us = now_us;
+  portENTER_CRITICAL(&heatmap_lock);
+  heatmap_decay(&heatmap, 1);
+  portEXIT_CRITICAL(&heatmap_lock);
+  METRICS_HIST_SINCE(METRICS_HIST_HEATMAP, now_us);
+#endif
+}
+
+void radar_reader_heatmap_snapshot(heatmap_t* out) {
+  int64_t start_us = METRICS_NOW_US();
+  portENTER_CRITICAL(&heatmap_lock);
+  memcpy(out, &heatmap, sizeof(*out));
+  portEXIT_CRITICAL(&heatmap_lock);
+  METRICS_HIST_SINCE(METRICS_HIST_HEATMAP, start_us);
+}
+
+void radar_reader_heatmap_add(const radar_frame_msg_t* msg) {
+  portENTER_CRITICAL(&heatmap_lock);
+  heatmap_add(&heatmap, msg->targets, msg->count);
+  portEXIT_CRITICAL(&heatmap_lock);
+  heatmap_maybe_decay();
+}
+
+void radar_reader_heatmap_reset(void) {
+  portENTER_CRITICAL(&heatmap_lock);
+  heatmap_reset(&heatmap);
+  portEXIT_CRITICAL(&heatmap_lock);
+}
+
+void radar_reader_clutter_snapshot(clutter_t* out) {
+  portENTER_CRITICAL(&clutter_lock);
+  memcpy(out, &clutter, sizeof(*out));
+  portEXIT_CRITICAL(&clutter_lock);
+}
+
+void radar_reader_clutter_reset(void) {
+  portENTER_CRITICAL(&clutter_lock);
+  clutter_init(&clutter, clutter.learn_s, clutter.forget_s,
+               (uint32_t)clutter.motion_cm_s);
+  portEXIT_CRITICAL(&clutter_lock);
+}
+
+static void clutter_apply_config(const app_config_t* cfg) {
+  portENTER_CRITICAL(&clutter_lock);
+  clutter_set_rates(&clutter, cfg->clutter_learn_s, cfg->clutter_forget_s,
+                    cfg->clutter_motion);
+  portEXIT_CRITICAL(&clutter_lock);
+}
+
+// Once a second: score cells that held slow targets, age the rest
+static void clutter_maybe_sweep(void) {
+  int64_t now_us = esp_timer_get_time();
+  portENTER_CRITICAL(&clutter_lock);
+  clutter_sweep(&clutter, now_us);
+  portEXIT_CRITICAL(&clutter_lock);
+}
+
+static void request(size_t index, uint32_t requests) {
+  __atomic_fetch_or(&radar_requests[index], requests, __ATOMIC_RELAXED);
+}
+
+// Start the next queued module command if the radar's engine is free
+static void start_next_command(size_t index, const app_config_t* cfg) {
+  radar_sensor_t* radar = &radars[index];
+  uint32_t pending =
+      __atomic_load_n(&radar_requests[index], __ATOMIC_RELAXED);
+  if (pending == 0 || radar->cmd.state != RADAR_CMD_IDLE) {
+    return;
+  }
+  if (radar_restarting[index]) {
+    if (radar->frame_count == radar_restart_mark[index]) {
+      return;
+    }
+    radar_restarting[index] = false;
+  }
+
+  uint32_t req = pending & -pending;
+  __atomic_fetch_and(&radar_requests[index], ~req, __ATOMIC_RELAXED);
+
+  esp_err_t ret = ESP_OK;
+  switch (req) {
+    case RADAR_REQ_FIRMWARE:
+      ret = radar_sensor_query_firmware(radar);
+      break;
+    case RADAR_REQ_TRACKING:
+      ret = radar_sensor_set_tracking_mode(
+          radar, cfg->radar_tracking == APP_CONFIG_RADAR_SINGLE_TARGET);
+      break;
+    case RADAR_REQ_BAUD:
+      ret = radar_sensor_change_module_baud(radar, cfg->radar_baud);
+      if (ret != ESP_OK) {
+        // Rate the module cannot be set to: only move the ESP32 side
+        radar_sensor_set_baud_rate(radar, cfg->radar_baud);
+      }
+      break;
+    case RADAR_REQ_RESET:
+      ret = radar_sensor_factory_reset(radar);
+      break;
+  }
+
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Radar %u: command request 0x%lx not started: %s",
+             (unsigned)index, req, esp_err_to_name(ret));
+  }
+}
+
+static void handle_command_result(size_t index,
+                                  const radar_cmd_result_t* result,
+                                  const app_config_t* cfg) {
+  if (result->error != ESP_OK) {
+    ESP_LOGW(TAG, "Radar %u: command 0x%04x failed: %s (status %u)",
+             (unsigned)index, result->command, esp_err_to_name(result->error),
+             result->status);
+    if (result->command == RADAR_CMD_SET_BAUD) {
+      // Keep the ESP32 UART at the configured rate either way
+      radar_sensor_set_baud_rate(&radars[index], cfg->radar_baud);
+    }
+    return;
+  }
+
+  switch (result->command) {
+    case RADAR_CMD_READ_FIRMWARE:
+      radar_sensor_format_firmware(result, radar_firmware[index],
+                                   sizeof(radar_firmware[index]));
+      ESP_LOGI(TAG, "Radar %u: firmware %s (%lu us)", (unsigned)index,
+               radar_firmware[index], result->round_trip_us);
+      break;
+    case RADAR_CMD_SINGLE_TARGET:
+    case RADAR_CMD_MULTI_TARGET:
+      ESP_LOGI(TAG, "Radar %u: %s-target tracking (%lu us)", (unsigned)index,
+               result->command == RADAR_CMD_SINGLE_TARGET ? "single" : "multi",
+               result->round_trip_us);
+      break;
+    case RADAR_CMD_SET_BAUD:
+      radar_restarting[index] = true;
+      radar_restart_mark[index] = radars[index].frame_count;
+      ESP_LOGI(TAG, "Radar %u: module restarted at %lu baud (%lu us)",
+               (unsigned)index, cfg->radar_baud, result->round_trip_us);
+      break;
+    case RADAR_CMD_FACTORY_RESET:
+      ESP_LOGI(TAG, "Radar %u: factory defaults restored (%lu us)",
+               (unsigned)index, result->round_trip_us);
+      // Bring the module back to the configured mode and rate once it is up
+      radar_restarting[index] = true;
+      radar_restart_mark[index] = radars[index].frame_count;
+      request(index, RADAR_REQ_TRACKING);
+      if (cfg->radar_baud != RADAR_DEFAULT_BAUD) {
+        request(index, RADAR_REQ_BAUD);
+      }
+      break;
+  }
+}
+
+// Carry out the recovery the health supervisor asked for. A queue can only
+// leave its set while empty, so it is reset first; set entries left behind
+// for the old queue match no radar and are skipped by the loop.
+static void service_recovery(size_t index, QueueSetHandle_t radar_events,
+                             uint32_t baud_rate) {
+  uint32_t req =
+      __atomic_exchange_n(&radar_recovery[index], 0, __ATOMIC_RELAXED);
+  if (req == 0) {
+    return;
+  }
+  radar_sensor_t* radar = &radars[index];
+
+  if (req & RADAR_RECOVER_REINSTALL) {
+    if (radar->uart_queue) {
+      xQueueReset(radar->uart_queue);
+      xQueueRemoveFromSet(radar->uart_queue, radar_events);
+    }
+    esp_err_t ret = radar_sensor_reinstall(radar, baud_rate);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Radar %u: UART driver reinstall failed: %s",
+               (unsigned)index, esp_err_to_name(ret));
+      return;
+    }
+    xQueueAddToSet(radar->uart_queue, radar_events);
+    power_mgr_enable_uart_wakeup(radar_slots[index].port, radar->rx_pin);
+    // A new driver starts with an event per frame
+    radar_rx_batch[index] = 1;
+    ESP_LOGW(TAG, "Radar %u: UART driver reinstalled", (unsigned)index);
+  } else if (req & RADAR_RECOVER_RESYNC) {
+    radar_sensor_resync(radar);
+    ESP_LOGW(TAG, "Radar %u: frame sync reset", (unsigned)index);
+  }
+}
+
+// Radar reader task (runs on Core 1): one task services every radar by
+// blocking on a queue set of their UART event queues
+void radar_reader_task(void* pvParameters) {
+  ESP_LOGI(TAG, "Radar reader task started on Core %d", xPortGetCoreID());
+
+  const app_config_t* cfg = app_config_get();
+  uint32_t applied_config_version = cfg->version;
+  uint32_t baud_rate = cfg->radar_baud;
+  uint32_t tracking = cfg->radar_tracking;
+  size_t active_count = 0;
+
+  radar_fusion_init(&radar_fusion, CONFIG_RADAR_FUSION_MERGE_MM,
+                    CONFIG_RADAR_FUSION_MAX_AGE_MS * 1000LL);
+  clutter_init(&clutter, cfg->clutter_learn_s, cfg->clutter_forget_s,
+               cfg->clutter_motion);
+  approach_init(&approach, approach_entries, CONFIG_APPROACH_ENTRY_COUNT,
+                CONFIG_APPROACH_MIN_SPEED_CM_S, CONFIG_APPROACH_CONFIRM_FRAMES);
+  regime_since_us = esp_timer_get_time();
+  last_presence_us = regime_since_us;
+
+  QueueSetHandle_t radar_events =
+      xQueueCreateSet(RADAR_COUNT * RADAR_UART_EVENT_QUEUE_LEN);
+  if (radar_events == NULL) {
+    ESP_LOGE(TAG, "Failed to create radar queue set");
+    app_config_release(cfg);
+    vTaskDelete(NULL);
+    return;
+  }
+
+  for (size_t i = 0; i < RADAR_COUNT; i++) {
+    const radar_slot_t* slot = &radar_slots[i];
+
+    // Register every slot so fusion indices match radar indices
+    radar_fusion_add_sensor(&radar_fusion, &slot->mount);
+    strcpy(radar_firmware[i], "unknown");
+
+    esp_err_t ret = radar_sensor_init(&radars[i], slot->port, slot->radar_tx,
+                                      slot->radar_rx);
+    if (ret == ESP_OK) {
+      ret = radar_sensor_begin(&radars[i], baud_rate);
+    }
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to start radar %u on UART%d: %s", (unsigned)i,
+               slot->port, esp_err_to_name(ret));
+      continue;
+    }
+
+    xQueueAddToSet(radars[i].uart_queue, radar_events);
+
+    // Radar traffic wakes the chip when light sleep is enabled
+    power_mgr_enable_uart_wakeup(slot->port, radars[i].rx_pin);
+
+    // Identify the module and bring its tracking mode in line with config
+    request(i, RADAR_REQ_FIRMWARE | RADAR_REQ_TRACKING);
+
+    radar_active[i] = true;
+    radar_rx_batch[i] = 1;
+    active_count++;
+  }
+
+  if (active_count == 0) {
+    ESP_LOGE(TAG, "No radar sensor could be started");
+    app_config_release(cfg);
+    vTaskDelete(NULL);
+    return;
+  }
+
+  ESP_LOGI(TAG, "%u of %u radar sensors initialized successfully",
+           (unsigned)active_count, (unsigned)RADAR_COUNT);
+  boot_profile_mark(BOOT_PHASE_RADAR_STARTED);
+
+  uint32_t poll_ms = RADAR_CONFIG_POLL_MS;
+  while (1) {
+    QueueSetMemberHandle_t member =
+        xQueueSelectFromSet(radar_events, pdMS_TO_TICKS(poll_ms));
+    int64_t wake_us = esp_timer_get_time();
+    uint32_t frames = 0;
+    uint32_t processed = 0;
+
+    // Lock-free config read; radar settings are applied here because this
+    // task is the only one touching the radar UARTs
+    cfg = app_config_refresh(cfg);
+    if (cfg->version != applied_config_version) {
+      uint32_t changed = 0;
+      if (cfg->radar_baud != baud_rate) {
+        changed |= RADAR_REQ_BAUD;
+        baud_rate = cfg->radar_baud;
+      }
+      if (cfg->radar_tracking != tracking) {
+        changed |= RADAR_REQ_TRACKING;
+        tracking = cfg->radar_tracking;
+      }
+      for (size_t i = 0; i < RADAR_COUNT && changed; i++) {
+        if (radar_active[i]) {
+          request(i, changed);
+        }
+      }
+      clutter_apply_config(cfg);
+      if (cfg->idle_after_s == 0 && regime == RADAR_REGIME_IDLE) {
+        set_regime(RADAR_REGIME_ACTIVE, wake_us);
+      }
+      applied_config_version = cfg->version;
+    }
+
+    for (size_t i = 0; i < RADAR_COUNT; i++) {
+      if (radar_active[i]) {
+        service_recovery(i, radar_events, baud_rate);
+      }
+    }
+
+    for (size_t i = 0; member != NULL && i < RADAR_COUNT; i++) {
+      if (!radar_active[i] || member != radars[i].uart_queue) {
+        continue;
+      }
+
+      uart_event_t event;
+      // An overflow resets the queue, leaving stale set entries behind
+      if (xQueueReceive(member, &event, 0) != pdTRUE) {
+        break;
+      }
+
+      // Full speed and no light sleep only while frames are being parsed
+      power_mgr_acquire(POWER_LOCK_PARSE);
+      uint32_t target_frames = radars[i].target_frame_count;
+      int parsed = radar_sensor_handle_event(&radars[i], &event);
+      if (parsed > 0) {
+        int64_t frame_us = radars[i].frame_timestamp_us;
+        frames += (uint32_t)parsed;
+        // Fusion always holds each radar's newest frame, so a decimated
+        // view is never built from stale targets
+        radar_fusion_update(&radar_fusion, (int)i, radars[i].targets,
+                            frame_us);
+        // Any frame in a batch with a target counts, not just the newest
+        if (frame_wanted(radars[i].target_frame_count != target_frames,
+                         frame_us, cfg)) {
+          size_t count = publish_fused_view(
+              frame_us,
+              cfg->sensor_sched_mode == APP_CONFIG_SCHED_FRAME_DRIVEN);
+          update_regime(count, frame_us, cfg);
+          processed++;
+        }
+        boot_profile_mark(BOOT_PHASE_FIRST_FRAME);
+      }
+      power_mgr_release(POWER_LOCK_PARSE);
+      break;
+    }
+
+    clutter_maybe_sweep();
+
+    // Command replies are completed by the parser; collect results, enforce
+    // timeouts and start whatever is queued next
+    bool busy = false;
+    for (size_t i = 0; i < RADAR_COUNT; i++) {
+      if (!radar_active[i]) {
+        continue;
+      }
+      radar_cmd_result_t result;
+      if (radar_sensor_cmd_poll(&radars[i], &result)) {
+        handle_command_result(i, &result, cfg);
+      }
+      start_next_command(i, cfg);
+      update_rx_batch(i);
+      if (radar_busy(i)) {
+        busy = true;
+      }
+    }
+    // Command timeouts need the short poll; otherwise idle can sleep longer
+    poll_ms = regime == RADAR_REGIME_IDLE && !busy ? RADAR_IDLE_POLL_MS
+                                                   : RADAR_CONFIG_POLL_MS;
+
+    int64_t done_us = esp_timer_get_time();
+    portENTER_CRITICAL(&regime_lock);
+    radar_regime_stats_t* stats = &regime_stats[regime];
+    stats->busy_us += done_us - wake_us;
+    stats->wakeups++;
+    stats->frames += frames;
+    stats->processed += processed;
+    portEXIT_CRITICAL(&regime_lock);
+  }
+}
+
+uint32_t radar_reader_frame_count(void) {
+  uint32_t frames = 0;
+  for (size_t i = 0; i < RADAR_COUNT; i++) {
+    frames += radars[i].frame_count;
+  }
+  return frames;
+}
+
+size_t radar_reader_radar_count(void) { return RADAR_COUNT; }
+
+bool radar_reader_progress(size_t index, uint32_t* bytes, uint32_t* frames) {
+  if (index >= RADAR_COUNT || !radar_active[index]) {
+    return false;
+  }
+  *bytes = radars[index].byte_count;
+  *frames = radars[index].frame_count;
+  return true;
+}
+
+void radar_reader_recover(size_t index, health_action_t action) {
+  if (index >= RADAR_COUNT) {
+    return;
+  }
+  uint32_t req = 0;
+  if (action == HEALTH_ACTION_RESYNC) {
+    req = RADAR_RECOVER_RESYNC;
+  } else if (action == HEALTH_ACTION_REINSTALL) {
+    req = RADAR_RECOVER_REINSTALL;
+  }
+  __atomic_fetch_or(&radar_recovery[index], req, __ATOMIC_RELAXED);
+}
+
+void radar_reader_log_stats(void) {
+  static uint32_t last_frames[RADAR_COUNT];
+  static int64_t last_sample_us;
+
+  int64_t now_us = esp_timer_get_time();
+  int64_t interval_ms = (now_us - last_sample_us) / 1000;
+  for (size_t i = 0; i < RADAR_COUNT; i++) {
+    uint32_t frames = radars[i].frame_count;
+    uint32_t rate_x10 =
+        interval_ms > 0
+            ? (uint32_t)((int64_t)(frames - last_frames[i]) * 10000 /
+                         interval_ms)
+            : 0;
+    ESP_LOGI(TAG, "Radar %u - %lu.%lu frames/s, Overflows: %lu, Firmware: %s",
+             (unsigned)i, rate_x10 / 10, rate_x10 % 10,
+             radars[i].overflow_count, radar_firmware[i]);
+    last_frames[i] = frames;
+  }
+  last_sample_us = now_us;
+}
+
+static int cmd_radar(int argc, char** argv) {
+  if (argc < 2) {
+    for (size_t i = 0; i < RADAR_COUNT; i++) {
+      printf("radar %u: %s, UART%d, %lu frames, %lu overflows, firmware %s\n",
+             (unsigned)i, radar_active[i] ? "active" : "not started",
+             radar_slots[i].port, radars[i].frame_count,
+             radars[i].overflow_count, radar_firmware[i]);
+    }
+    return 0;
+  }
+
+  uint32_t req;
+  if (strcmp(argv[1], "version") == 0) {
+    req = RADAR_REQ_FIRMWARE;
+  } else if (strcmp(argv[1], "reset") == 0) {
+    req = RADAR_REQ_RESET;
+  } else {
+    printf("usage: radar [version|reset] [index]\n");
+    return 1;
+  }
+
+  size_t first = 0;
+  size_t last = RADAR_COUNT - 1;
+  if (argc > 2) {
+    first = last = (size_t)strtoul(argv[2], NULL, 10);
+    if (first >= RADAR_COUNT) {
+      printf("no radar %u\n", (unsigned)first);
+      return 1;
+    }
+  }
+
+  for (size_t i = first; i <= last; i++) {
+    if (radar_active[i]) {
+      request(i, req);
+    }
+  }
+  printf("queued, result is logged by the radar reader\n");
+  return 0;
+}
+
+// Print the heatmap far edge first, so it reads like a floor plan seen from
+// above with the radar at the bottom
+static int cmd_heatmap(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    radar_reader_heatmap_reset();
+    printf("heatmap cleared\n");
+    return 0;
+  }
+  if (argc > 1) {
+    printf("usage: heatmap [reset]\n");
+    return 1;
+  }
+
+  static heatmap_t snapshot;
+  static const char shades[] = " .:-=+*#%@";
+  radar_reader_heatmap_snapshot(&snapshot);
+  uint16_t peak = heatmap_max(&snapshot);
+
+  printf("%d x %d cells of %d mm from (%d, %d), peak %u, %lu samples, "
+         "%lu out of range\n",
+         HEATMAP_COLS, HEATMAP_ROWS, HEATMAP_CELL_MM, HEATMAP_X_MIN_MM,
+         HEATMAP_Y_MIN_MM, peak, snapshot.samples, snapshot.out_of_range);
+  for (int row = HEATMAP_ROWS - 1; row >= 0; row--) {
+    char line[HEATMAP_COLS + 1];
+    for (int col = 0; col < HEATMAP_COLS; col++) {
+      uint16_t v = snapshot.cells[row * HEATMAP_COLS + col];
+      int shade = peak ? (int)((uint32_t)v * (sizeof(shades) - 2) / peak) : 0;
+      line[col] = shades[v && !shade ? 1 : shade];
+    }
+    line[HEATMAP_COLS] = '\0';
+    printf("|%s|\n", line);
+  }
+  return 0;
+}
+
+// Same layout as the heatmap: '#' suppresses slow targets, 1-9 is learning
+// progress towards that
+static int cmd_clutter(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    radar_reader_clutter_reset();
+    printf("clutter model cleared\n");
+    return 0;
+  }
+  if (argc > 1) {
+    printf("usage: clutter [reset]\n");
+    return 1;
+  }
+
+  static clutter_t snapshot;
+  radar_reader_clutter_snapshot(&snapshot);
+
+  if (snapshot.learn_s == 0) {
+    printf("clutter suppression off (config set clutter_learn <s>)\n");
+    return 0;
+  }
+  printf("learn %lu s, forget %lu s, motion %.0f cm/s: %lu clutter cells, "
+         "%lu targets suppressed\n",
+         snapshot.learn_s, snapshot.forget_s, snapshot.motion_cm_s,
+         snapshot.clutter_cells, snapshot.suppressed);
+  for (int row = HEATMAP_ROWS - 1; row >= 0; row--) {
+    char line[HEATMAP_COLS + 1];
+    for (int col = 0; col < HEATMAP_COLS; col++) {
+      int index = row * HEATMAP_COLS + col;
+      uint32_t tenths = (uint32_t)snapshot.score[index] * 10 /
+                        (CLUTTER_SCORE_MAX + 1);
+      if (clutter_is_clutter(&snapshot, index)) {
+        line[col] = '#';
+      } else {
+        line[col] = tenths ? (char)('0' + tenths) : ' ';
+      }
+    }
+    line[HEATMAP_COLS] = '\0';
+    printf("|%s|\n", line);
+  }
+  return 0;
+}
+
+void radar_reader_register_console_cmd(void) {
+  const esp_console_cmd_t clutter_cmd = {
+      .command = "clutter",
+      .help = "Show cells learnt as static clutter (fans, curtains); "
+              "'reset' forgets them",
+      .hint = "[reset]",
+      .func = &cmd_clutter,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&clutter_cmd));
+
+  const esp_console_cmd_t heatmap_cmd = {
+      .command = "heatmap",
+      .help = "Show where targets spent time in the room frame; 'reset' "
+              "clears it",
+      .hint = "[reset]",
+      .func = &cmd_heatmap,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&heatmap_cmd));
+
+  const esp_console_cmd_t cmd = {
+      .command = "radar",
+      .help = "Show radar status; 'version' queries firmware, 'reset' "
+              "restores module factory defaults (tracking mode and baud "
+              "follow the 'radar_track' and 'radar_baud' config keys)",
+      .hint = "[version|reset] [index]",
+      .func = &cmd_radar,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
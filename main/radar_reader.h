@@ -0,0 +1,188 @@
+#ifndef RADAR_READER_H
+#define RADAR_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "approach.h"
+#include "clutter.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "handoff.h"
+#include "health.h"
+#include "heatmap.h"
+#include "radar_fusion.h"
+
+/**
+ * @brief Latest fused room view published by the radar reader task
+ */
+typedef struct {
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+  size_t count;
+  uint32_t sequence;           ///< Incremented on every published frame
+  int64_t frame_timestamp_us;  ///< Completion time of the newest frame
+  uint8_t approach_mask;       ///< Relay channels of doorways being approached
+  uint8_t entry_mask;          ///< Doorways being approached, bit 0 = entry 1
+} radar_view_t;
+
+/**
+ * @brief Published frame handed to the aggregator task on Core 0
+ */
+typedef struct {
+  int64_t frame_timestamp_us;  ///< Completion time of the newest frame
+  int64_t posted_us;           ///< When the reader handed it off
+  size_t count;
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+} radar_frame_msg_t;
+
+/**
+ * @brief How much of the radar stream the reader acts on
+ */
+typedef enum {
+  RADAR_REGIME_ACTIVE,  ///< Every frame fused and published
+  RADAR_REGIME_IDLE,    ///< Room empty: one frame per idle period
+  RADAR_REGIME_COUNT,
+} radar_regime_t;
+
+/**
+ * @brief Reader work in one regime since boot
+ */
+typedef struct {
+  uint64_t time_us;    ///< Time spent in the regime
+  uint64_t busy_us;    ///< Reader CPU time (wake-up to blocking again)
+  uint32_t wakeups;    ///< Reader task wake-ups
+  uint32_t frames;     ///< Frames parsed
+  uint32_t processed;  ///< Frames fused and published
+} radar_regime_stats_t;
+
+/**
+ * @brief Radar reader task: starts every configured radar, parses frames as
+ *        they arrive, fuses them and runs module commands
+ *
+ * @param pvParameters Unused
+ */
+void radar_reader_task(void* pvParameters);
+
+/**
+ * @brief Task to notify (xTaskNotifyGive) when a room entry is predicted,
+ *        and for every published frame when sensor_sched is frame driven
+ *
+ * @param task Task handle, NULL to stop notifying
+ */
+void radar_reader_set_wake_task(TaskHandle_t task);
+
+/**
+ * @brief Ring to post every published frame to, and the task to notify
+ *        once it is half full
+ *
+ * Set before the reader task starts. The reader only fills a slot; the
+ * heatmap and everything else that aggregates frames runs on the consumer,
+ * which calls radar_reader_heatmap_add() for each message.
+ *
+ * @param ring Ring of radar_frame_msg_t slots, NULL to post nothing
+ * @param task Consumer task, or NULL to leave it to poll
+ */
+void radar_reader_set_frame_sink(handoff_t* ring, TaskHandle_t task);
+
+/**
+ * @brief Copy the latest fused view
+ *
+ * @param out Destination view
+ */
+void radar_reader_get_view(radar_view_t* out);
+
+/**
+ * @brief Copy the occupancy heatmap
+ *
+ * @param out Destination
+ */
+void radar_reader_heatmap_snapshot(heatmap_t* out);
+
+/**
+ * @brief Count a handed-off frame in the occupancy heatmap
+ *
+ * Frame sink consumer only. Also halves the map once every
+ * CONFIG_OCCUPANCY_HEATMAP_DECAY_S.
+ *
+ * @param msg Frame posted by the reader
+ */
+void radar_reader_heatmap_add(const radar_frame_msg_t* msg);
+
+/**
+ * @brief Clear the occupancy heatmap
+ */
+void radar_reader_heatmap_reset(void);
+
+/**
+ * @brief Copy the clutter model
+ *
+ * @param out Destination
+ */
+void radar_reader_clutter_snapshot(clutter_t* out);
+
+/**
+ * @brief Forget every learnt clutter cell, keeping the configured rates
+ */
+void radar_reader_clutter_reset(void);
+
+/**
+ * @brief Total frames parsed across all radars since boot
+ *
+ * @return Frame count
+ */
+uint32_t radar_reader_frame_count(void);
+
+/**
+ * @brief Number of radar slots on this controller
+ *
+ * @return Slot count, including radars that failed to start
+ */
+size_t radar_reader_radar_count(void);
+
+/**
+ * @brief Read one radar's progress counters, for the health supervisor
+ *
+ * @param index Radar index
+ * @param bytes Bytes received since boot
+ * @param frames Frames parsed since boot
+ * @return false when the radar is not running
+ */
+bool radar_reader_progress(size_t index, uint32_t* bytes, uint32_t* frames);
+
+/**
+ * @brief Ask the reader task to resync a radar's parser or reinstall its
+ *        UART driver
+ *
+ * Returns at once; the reader carries it out within one poll period.
+ *
+ * @param index Radar index
+ * @param action HEALTH_ACTION_RESYNC or HEALTH_ACTION_REINSTALL, others are
+ *        ignored
+ */
+void radar_reader_recover(size_t index, health_action_t action);
+
+/**
+ * @brief Current activity regime
+ *
+ * @return RADAR_REGIME_ACTIVE or RADAR_REGIME_IDLE
+ */
+radar_regime_t radar_reader_regime(void);
+
+/**
+ * @brief Copy per-regime reader statistics, time counted up to now
+ *
+ * @param out RADAR_REGIME_COUNT entries, indexed by radar_regime_t
+ */
+void radar_reader_regime_stats(radar_regime_stats_t* out);
+
+/**
+ * @brief Log per-radar frame rate and overflow counts since the last call
+ */
+void radar_reader_log_stats(void);
+
+/**
+ * @brief Register the "radar", "heatmap" and "clutter" console commands
+ */
+void radar_reader_register_console_cmd(void);
+
+#endif  // RADAR_READER_H
@@ -0,0 +1,260 @@
+#include "rule_policy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dlog.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "esp_timer.h"
+#include "rules.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "RULES";
+
+// Earlier wall-clock time is the boot default, not synchronised time
+#define TIME_VALID_AFTER 1704067200  // 2024-01-01
+
+#if RULES_TEXT_MAX < APP_CONFIG_RULES_MAX
+#error "The rules config key holds more text than the compiler accepts"
+#endif
+
+// Compiled program and the text it came from; only the sensor task uses them
+static rules_program_t s_program;
+static rules_program_t s_scratch;  // Compile target, copied in on success
+static char s_loaded[APP_CONFIG_RULES_MAX];
+static bool s_active;
+
+// Local minute of day, recomputed when the wall clock enters a new minute
+static time_t s_minute_epoch = -1;
+static int32_t s_minute_of_day = -1;
+
+static volatile rule_policy_stats_t s_stats;
+static bool s_time_started;
+
+static int32_t local_minute(time_t now) {
+  if (now < TIME_VALID_AFTER) {
+    return -1;
+  }
+  struct tm local;
+  localtime_r(&now, &local);
+  return local.tm_hour * 60 + local.tm_min;
+}
+
+// Sensor task: localtime_r only once a minute
+static int32_t minute_of_day(void) {
+  time_t now = time(NULL);
+  if (now / 60 != s_minute_epoch) {
+    s_minute_epoch = now / 60;
+    s_minute_of_day = local_minute(now);
+  }
+  return s_minute_of_day;
+}
+
+bool rule_policy_update(const app_config_t* cfg) {
+  if (strcmp(cfg->rules, s_loaded) == 0) {
+    return s_active;
+  }
+  memcpy(s_loaded, cfg->rules, sizeof(s_loaded));
+
+  rules_error_t error;
+  if (!rules_compile(&s_scratch, s_loaded, &error)) {
+    s_stats.compile_failures++;
+    DLOGE(TAG, "Rules rejected at offset %u: %s, keeping %s",
+          (unsigned)error.offset, error.message,
+          s_active ? "previous rules" : "built-in policy");
+  } else {
+    memcpy(&s_program, &s_scratch, sizeof(s_program));
+    s_active = s_program.rule_count > 0;
+    if (s_active) {
+      DLOGI(TAG, "%u rules loaded, %u bytes, at most %u operations per frame",
+            s_program.rule_count, s_program.code_len, s_program.cost);
+    } else {
+      DLOGI(TAG, "No rules, using built-in policy");
+    }
+  }
+  s_stats.active = s_active;
+  s_stats.rule_count = s_program.rule_count;
+  s_stats.cost = s_program.cost;
+  return s_active;
+}
+
+uint8_t rule_policy_eval(const radar_fused_target_t* targets, size_t count,
+                         uint32_t present, uint8_t entry_mask,
+                         int64_t now_us) {
+  rules_input_t input = {
+      .targets = targets,
+      .count = count,
+      .present = present,
+      .approach_mask = entry_mask,
+      .minute_of_day = minute_of_day(),
+      .now_us = now_us,
+  };
+  int64_t start = esp_timer_get_time();
+  uint8_t mask = rules_eval(&s_program, &input);
+  uint32_t took_us = (uint32_t)(esp_timer_get_time() - start);
+
+  s_stats.last_mask = mask;
+  s_stats.evaluations++;
+  s_stats.total_eval_us += took_us;
+  if (took_us > s_stats.max_eval_us) {
+    s_stats.max_eval_us = took_us;
+  }
+  return mask;
+}
+
+esp_err_t rule_policy_store(const char* text, const char* source) {
+  if (!text) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const app_config_t* cfg = app_config_get();
+  bool unchanged = strcmp(text, cfg->rules) == 0;
+  app_config_release(cfg);
+  if (unchanged) {
+    return ESP_OK;
+  }
+  if (strlen(text) >= APP_CONFIG_RULES_MAX) {
+    ESP_LOGW(TAG, "Rules from %s longer than %d characters", source,
+             APP_CONFIG_RULES_MAX - 1);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // Checked here so a bad download never replaces working rules. Called
+  // from the console and the uploader, so the scratch program is on the
+  // caller's stack (about 0.5 KB) rather than shared
+  rules_program_t check;
+  rules_error_t error;
+  if (!rules_compile(&check, text, &error)) {
+    ESP_LOGW(TAG, "Rules from %s rejected at offset %u: %s", source,
+             (unsigned)error.offset, error.message);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t ret = app_config_set("rules", text);
+  if (ret == ESP_OK) {
+    ESP_LOGI(TAG, "Rules from %s stored", source);
+  }
+  return ret;
+}
+
+void rule_policy_time_start(void) {
+  if (s_time_started) {
+    return;
+  }
+  setenv("TZ", CONFIG_RULES_TIMEZONE, 1);
+  tzset();
+  esp_sntp_config_t config =
+      ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_RULES_SNTP_SERVER);
+  esp_err_t ret = esp_netif_sntp_init(&config);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "SNTP unavailable (%s), time-of-day rules stay false",
+             esp_err_to_name(ret));
+    return;
+  }
+  s_time_started = true;
+}
+
+void rule_policy_get_stats(rule_policy_stats_t* out) {
+  out->active = s_stats.active;
+  out->rule_count = s_stats.rule_count;
+  out->cost = s_stats.cost;
+  out->last_mask = s_stats.last_mask;
+  out->evaluations = s_stats.evaluations;
+  out->max_eval_us = s_stats.max_eval_us;
+  out->total_eval_us = s_stats.total_eval_us;
+  out->compile_failures = s_stats.compile_failures;
+}
+
+// Console arguments from argv[first] on, joined with single spaces
+static void join_args(int argc, char** argv, int first, char* out,
+                      size_t size) {
+  size_t used = 0;
+  out[0] = '\0';
+  for (int i = first; i < argc && used < size; i++) {
+    int n = snprintf(out + used, size - used, "%s%s", i > first ? " " : "",
+                     argv[i]);
+    if (n < 0) {
+      break;
+    }
+    used += (size_t)n;
+  }
+}
+
+// Compile text and print the bytecode listing or the error position
+static int print_program(const char* text) {
+  static rules_program_t program;
+  static char listing[2048];
+  rules_error_t error;
+  if (!rules_compile(&program, text, &error)) {
+    printf("%s\n%*s^ %s\n", text, (int)error.offset, "", error.message);
+    return 1;
+  }
+  rules_disassemble(&program, listing, sizeof(listing));
+  printf("%u rules, %u bytes, at most %u operations per frame\n%s",
+         program.rule_count, program.code_len, program.cost, listing);
+  return 0;
+}
+
+static int cmd_rules(int argc, char** argv) {
+  // Console task only
+  static char text[APP_CONFIG_RULES_MAX];
+
+  if (argc < 2) {
+    rule_policy_stats_t stats;
+    rule_policy_get_stats(&stats);
+    const app_config_t* cfg = app_config_get();
+    memcpy(text, cfg->rules, sizeof(text));
+    app_config_release(cfg);
+    int32_t minute = local_minute(time(NULL));
+    printf("%s, %lu evaluations, avg %lu us, max %lu us, last relays 0x%x, "
+           "%lu rejected\n",
+           stats.active ? "rules active" : "built-in policy",
+           stats.evaluations,
+           stats.evaluations
+               ? (uint32_t)(stats.total_eval_us / stats.evaluations)
+               : 0,
+           stats.max_eval_us, stats.last_mask, stats.compile_failures);
+    if (minute >= 0) {
+      printf("local time %02ld:%02ld\n", minute / 60, minute % 60);
+    } else {
+      printf("local time unknown\n");
+    }
+    if (text[0]) {
+      return print_program(text);
+    }
+    return 0;
+  }
+
+  if (strcmp(argv[1], "check") == 0 && argc > 2) {
+    join_args(argc, argv, 2, text, sizeof(text));
+    return print_program(text);
+  }
+
+  if (strcmp(argv[1], "set") == 0 && argc > 2) {
+    join_args(argc, argv, 2, text, sizeof(text));
+    if (print_program(text) != 0) {
+      return 1;
+    }
+    return rule_policy_store(text, "console") == ESP_OK ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "clear") == 0) {
+    return rule_policy_store("", "console") == ESP_OK ? 0 : 1;
+  }
+
+  printf("usage: rules [check <rules>|set <rules>|clear]\n");
+  return 1;
+}
+
+void rule_policy_register_console_cmd(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "rules",
+      .help = "Show the relay rules and their cost; 'check' compiles rules "
+              "without storing them, 'set' stores them, 'clear' restores "
+              "the built-in presence policy",
+      .hint = "[check <rules>|set <rules>|clear]",
+      .func = &cmd_rules,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
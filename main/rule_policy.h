@@ -0,0 +1,77 @@
+#ifndef RULE_POLICY_H
+#define RULE_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "app_config.h"
+#include "esp_err.h"
+#include "radar_fusion.h"
+
+/**
+ * @brief Rule engine activity (written by the sensor task, read by console)
+ */
+typedef struct {
+  bool active;  ///< Rules in force instead of the built-in policy
+  uint8_t rule_count;
+  uint16_t cost;      ///< Worst-case operations per frame
+  uint8_t last_mask;  ///< Relays the last evaluation asked for
+  uint32_t evaluations;
+  uint32_t max_eval_us;
+  uint64_t total_eval_us;
+  uint32_t compile_failures;  ///< Rule texts rejected since boot
+} rule_policy_stats_t;
+
+/**
+ * @brief Recompile when the configured rule text changed (sensor task only)
+ *
+ * Hold timers survive config changes that leave the text alone. Text that
+ * does not compile is logged and the previous program, or the built-in
+ * policy when there is none, stays in force.
+ *
+ * @param cfg Current snapshot
+ * @return true while rules are in force
+ */
+bool rule_policy_update(const app_config_t* cfg);
+
+/**
+ * @brief Evaluate the rules for one frame (sensor task only)
+ *
+ * @param targets Fused room frame
+ * @param count Number of targets
+ * @param present Targets within the presence range
+ * @param entry_mask Doorways being approached, bit 0 = entry 1
+ * @param now_us Current time
+ * @return Relay mask, bit 0 = channel 1
+ */
+uint8_t rule_policy_eval(const radar_fused_target_t* targets, size_t count,
+                         uint32_t present, uint8_t entry_mask, int64_t now_us);
+
+/**
+ * @brief Check rule text and store it as the "rules" config key
+ *
+ * @param text Rule text, empty for the built-in policy
+ * @param source Where the text came from, for the log
+ * @return ESP_OK when stored or unchanged, ESP_ERR_INVALID_ARG when it does
+ *         not compile, error code otherwise
+ */
+esp_err_t rule_policy_store(const char* text, const char* source);
+
+/**
+ * @brief Start SNTP for the time-of-day inputs (once the network is up)
+ */
+void rule_policy_time_start(void);
+
+/**
+ * @brief Get the rule engine statistics
+ *
+ * @param out Copy of the counters
+ */
+void rule_policy_get_stats(rule_policy_stats_t* out);
+
+/**
+ * @brief Register the "rules" console command
+ */
+void rule_policy_register_console_cmd(void);
+
+#endif  // RULE_POLICY_H
@@ -0,0 +1,262 @@
+#include "state_broadcast.h"
+
+#include <errno.h>
+#include <string.h>
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include "metrics.h"
+#include "radar_reader.h"
+#include "sdkconfig.h"
+#include "statecast.h"
+
+static const char* TAG = "STATECAST";
+
+// Core 0, below the WiFi task and above the system monitor
+#define BROADCAST_STACK_SIZE 3072
+#define BROADCAST_PRIORITY 3
+#define BROADCAST_CORE 0
+
+// Wait while broadcasting is off or the socket could not be opened
+#define IDLE_POLL_MS 1000
+
+// Shortest heartbeat interval honoured
+#define HEARTBEAT_MIN_MS 100
+
+_Static_assert(RADAR_FUSION_MAX_TARGETS <= STATECAST_MAX_TARGETS,
+               "fused targets do not fit a state packet");
+
+// State word from the sensor task: relay mask, presence count and a bit
+// that is set once the first iteration has reported
+#define STATE_VALID (1u << 16)
+
+static uint32_t s_state;
+static uint32_t s_changed_us;  // Low 32 bits of the time of the last change
+static bool s_want_frames;     // Publisher wants a wake-up per new frame
+static TaskHandle_t s_task;
+static uint32_t s_sensor_state;  // Sensor task's last reported state
+
+// Publisher state; the packet buffer and view copy are static so the task
+// stack only holds the loop
+static int s_sock = -1;
+static struct sockaddr_in s_dest;
+static statecast_packet_t s_packet;
+static uint8_t s_buf[STATECAST_PACKET_MAX];
+static radar_view_t s_view;
+
+// Counters (written by the publisher, read by the monitor)
+static struct {
+  uint32_t changes;
+  uint32_t targets;
+  uint32_t heartbeats;
+  uint32_t send_errors;
+} s_stats;
+
+void state_broadcast_update(uint8_t relay_mask, uint8_t present,
+                            bool new_frame) {
+  TaskHandle_t task = __atomic_load_n(&s_task, __ATOMIC_ACQUIRE);
+  if (!task) {
+    return;
+  }
+  uint32_t state = relay_mask | (uint32_t)present << 8 | STATE_VALID;
+  bool changed = state != s_sensor_state;
+  if (changed) {
+    s_sensor_state = state;
+    __atomic_store_n(&s_changed_us, (uint32_t)esp_timer_get_time(),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&s_state, state, __ATOMIC_RELEASE);
+  }
+  if (changed ||
+      (new_frame && __atomic_load_n(&s_want_frames, __ATOMIC_RELAXED))) {
+    xTaskNotifyGive(task);
+  }
+}
+
+static int16_t clamp_i16(float v) {
+  if (v > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (v < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)v;
+}
+
+static bool open_socket(void) {
+  memset(&s_dest, 0, sizeof(s_dest));
+  s_dest.sin_family = AF_INET;
+  s_dest.sin_port = htons(CONFIG_STATECAST_PORT);
+  if (inet_aton(CONFIG_STATECAST_GROUP, &s_dest.sin_addr) == 0) {
+    ESP_LOGE(TAG, "Invalid broadcast group %s", CONFIG_STATECAST_GROUP);
+    return false;
+  }
+
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    ESP_LOGW(TAG, "Failed to create socket: errno %d", errno);
+    return false;
+  }
+  uint8_t ttl = CONFIG_STATECAST_TTL;
+  uint8_t loop = 0;
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  s_sock = sock;
+  ESP_LOGI(TAG, "Broadcasting state to %s:%d", CONFIG_STATECAST_GROUP,
+           CONFIG_STATECAST_PORT);
+  return true;
+}
+
+static void close_socket(void) {
+  if (s_sock >= 0) {
+    close(s_sock);
+    s_sock = -1;
+  }
+}
+
+// Build and send one packet. A full send buffer or a missing route drops
+// it rather than waiting; its sequence number is used all the same, so
+// listeners see the gap.
+static void send_state(uint8_t flags, uint32_t state, int64_t now_us) {
+  // Age of what the packet reports: the change, else the newest frame
+  uint32_t since_us = UINT32_MAX;
+  if (flags & STATECAST_FLAG_CHANGE) {
+    since_us =
+        (uint32_t)now_us - __atomic_load_n(&s_changed_us, __ATOMIC_RELAXED);
+  } else if (s_view.frame_timestamp_us != 0) {
+    since_us = (uint32_t)(now_us - s_view.frame_timestamp_us);
+  }
+  uint32_t age_ms = since_us / 1000;
+
+  s_packet.flags = flags;
+  s_packet.sequence++;
+  s_packet.sent_us = (uint32_t)now_us;
+  s_packet.age_ms = age_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)age_ms;
+  s_packet.relay_mask = (uint8_t)state;
+  s_packet.present = (uint8_t)(state >> 8);
+  s_packet.entry_mask = s_view.entry_mask;
+  s_packet.target_count = (uint8_t)s_view.count;
+  for (size_t i = 0; i < s_view.count; i++) {
+    const radar_fused_target_t* t = &s_view.targets[i];
+    s_packet.targets[i].x_mm = clamp_i16(t->x);
+    s_packet.targets[i].y_mm = clamp_i16(t->y);
+    s_packet.targets[i].speed_cm_s = clamp_i16(t->speed);
+    s_packet.targets[i].sensor_mask = t->sensor_mask;
+  }
+
+  int len = statecast_encode(&s_packet, s_buf, sizeof(s_buf));
+  if (len < 0 || sendto(s_sock, s_buf, (size_t)len, MSG_DONTWAIT,
+                        (struct sockaddr*)&s_dest, sizeof(s_dest)) != len) {
+    s_stats.send_errors++;
+    return;
+  }
+  if (flags & STATECAST_FLAG_CHANGE) {
+    s_stats.changes++;
+    METRICS_HIST_RECORD(METRICS_HIST_BROADCAST, since_us);
+  } else if (flags & STATECAST_FLAG_TARGETS) {
+    s_stats.targets++;
+  } else {
+    s_stats.heartbeats++;
+  }
+}
+
+static void broadcast_task(void* pvParameters) {
+  uint8_t mac[6] = {0};
+  esp_read_mac(mac, ESP_MAC_WIFI_STA);
+  memcpy(s_packet.device, mac, sizeof(s_packet.device));
+  s_packet.boot_id = esp_random() | 1;
+
+  uint32_t sent_state = 0;
+  uint32_t seen_sequence = 0;
+  int64_t last_sent_us = 0;
+  int64_t last_targets_us = 0;
+  size_t sent_count = 0;
+
+  while (1) {
+    const app_config_t* cfg = app_config_get();
+    uint32_t heartbeat_ms = cfg->bcast_interval_ms;
+    uint32_t target_ms = cfg->bcast_target_ms;
+    app_config_release(cfg);
+    __atomic_store_n(&s_want_frames, heartbeat_ms != 0 && target_ms != 0,
+                     __ATOMIC_RELAXED);
+    if (heartbeat_ms == 0 || (s_sock < 0 && !open_socket())) {
+      if (heartbeat_ms == 0) {
+        close_socket();
+      }
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_POLL_MS));
+      continue;
+    }
+    if (heartbeat_ms < HEARTBEAT_MIN_MS) {
+      heartbeat_ms = HEARTBEAT_MIN_MS;
+    }
+
+    uint32_t state = __atomic_load_n(&s_state, __ATOMIC_ACQUIRE);
+    radar_reader_get_view(&s_view);
+    int64_t now_us = esp_timer_get_time();
+
+    // A target packet for a new frame when targets are seen or just left
+    uint8_t flags = 0;
+    if (state != sent_state && (state & STATE_VALID)) {
+      flags |= STATECAST_FLAG_CHANGE;
+    }
+    if (target_ms != 0 && s_view.sequence != seen_sequence &&
+        (s_view.count > 0 || sent_count > 0) &&
+        now_us - last_targets_us >= (int64_t)target_ms * 1000) {
+      flags |= STATECAST_FLAG_TARGETS;
+    }
+    if (flags == 0 && now_us - last_sent_us >= (int64_t)heartbeat_ms * 1000) {
+      flags = STATECAST_FLAG_HEARTBEAT;
+    }
+
+    if (flags) {
+      send_state(flags, state, now_us);
+      sent_state = state;
+      last_sent_us = now_us;
+      if (s_view.sequence != seen_sequence) {
+        last_targets_us = now_us;
+        seen_sequence = s_view.sequence;
+      }
+      sent_count = s_view.count;
+    }
+
+    // Sleep until the sensor task reports something or a heartbeat is due
+    int64_t wait_us =
+        last_sent_us + (int64_t)heartbeat_ms * 1000 - esp_timer_get_time();
+    ulTaskNotifyTake(pdTRUE,
+                     wait_us > 0 ? pdMS_TO_TICKS(wait_us / 1000) + 1 : 0);
+  }
+}
+
+void state_broadcast_start(void) {
+  static StackType_t stack[BROADCAST_STACK_SIZE];
+  static StaticTask_t tcb;
+  if (__atomic_load_n(&s_task, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  TaskHandle_t task = xTaskCreateStaticPinnedToCore(
+      broadcast_task, "statecast", BROADCAST_STACK_SIZE, NULL,
+      BROADCAST_PRIORITY, stack, &tcb, BROADCAST_CORE);
+  __atomic_store_n(&s_task, task, __ATOMIC_RELEASE);
+}
+
+void state_broadcast_log_summary(void) {
+  if (!__atomic_load_n(&s_task, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  const app_config_t* cfg = app_config_get();
+  uint32_t heartbeat_ms = cfg->bcast_interval_ms;
+  app_config_release(cfg);
+  if (heartbeat_ms == 0) {
+    return;
+  }
+  ESP_LOGI(TAG,
+           "State broadcast - Sequence: %lu, Changes: %lu, Targets: %lu, "
+           "Heartbeats: %lu, Send errors: %lu",
+           s_packet.sequence, s_stats.changes, s_stats.targets,
+           s_stats.heartbeats, s_stats.send_errors);
+}
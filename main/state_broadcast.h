@@ -0,0 +1,35 @@
+#ifndef STATE_BROADCAST_H
+#define STATE_BROADCAST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Start the publisher task (WiFi task, once the network is up)
+ *
+ * Packets go to the multicast group in menuconfig while the bcast_interval
+ * setting is non-zero: one on every relay or presence change, one per new
+ * frame with targets at most every bcast_target ms, and a heartbeat when
+ * nothing else was sent for bcast_interval ms. Safe to call repeatedly.
+ */
+void state_broadcast_start(void);
+
+/**
+ * @brief Hand the state of one sensor loop iteration to the publisher
+ *
+ * Sensor task only. Two atomic stores and at most one task notification:
+ * never blocks and does no network work.
+ *
+ * @param relay_mask Relay channels on
+ * @param present Targets within presence range
+ * @param new_frame The iteration acted on a new radar frame
+ */
+void state_broadcast_update(uint8_t relay_mask, uint8_t present,
+                            bool new_frame);
+
+/**
+ * @brief Log packets sent per reason and send failures since boot
+ */
+void state_broadcast_log_summary(void);
+
+#endif  // STATE_BROADCAST_H
@@ -0,0 +1,87 @@
+#include "task_stats.h"
+#include <stdint.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "TASK_STATS";
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && \
+    CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#define TASK_STATS_MAX 32
+
+typedef struct {
+  TaskHandle_t handle;
+  uint32_t runtime;
+} task_runtime_t;
+
+// Static so the monitor task's stack stays small
+static TaskStatus_t s_status[TASK_STATS_MAX];
+static task_runtime_t s_prev[TASK_STATS_MAX];
+static UBaseType_t s_prev_count;
+static uint32_t s_prev_total;
+
+static uint32_t previous_runtime(TaskHandle_t handle) {
+  for (UBaseType_t i = 0; i < s_prev_count; i++) {
+    if (s_prev[i].handle == handle) {
+      return s_prev[i].runtime;
+    }
+  }
+  return 0;
+}
+
+void task_stats_log(void) {
+  uint32_t total = 0;
+  UBaseType_t count = uxTaskGetSystemState(s_status, TASK_STATS_MAX, &total);
+  if (count == 0) {
+    ESP_LOGW(TAG, "More than %d tasks, statistics skipped", TASK_STATS_MAX);
+    return;
+  }
+
+  // Run time is counted per core, so 100% means one core fully busy
+  uint32_t elapsed = total - s_prev_total;
+  uint32_t idle_pct[portNUM_PROCESSORS] = {0};
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    const TaskStatus_t* task = &s_status[i];
+    uint32_t delta = task->ulRunTimeCounter - previous_runtime(task->xHandle);
+    uint32_t pct = elapsed ? (uint32_t)((uint64_t)delta * 100 / elapsed) : 0;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+      if (task->xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+        idle_pct[core] = pct;
+      }
+    }
+
+    char core_id = task->xCoreID < portNUM_PROCESSORS
+                       ? (char)('0' + task->xCoreID)
+                       : '*';
+    ESP_LOGI(TAG, "%-16s core %c prio %2u cpu %3lu%% stack free %5lu B",
+             task->pcTaskName, core_id, (unsigned)task->uxCurrentPriority,
+             (unsigned long)pct, (unsigned long)task->usStackHighWaterMark);
+  }
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    ESP_LOGI(TAG, "Core %d load %3lu%%", core,
+             (unsigned long)(idle_pct[core] > 100 ? 0 : 100 - idle_pct[core]));
+  }
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    s_prev[i].handle = s_status[i].xHandle;
+    s_prev[i].runtime = s_status[i].ulRunTimeCounter;
+  }
+  s_prev_count = count;
+  s_prev_total = total;
+}
+
+#else
+
+void task_stats_log(void) {
+  ESP_LOGW(TAG,
+           "Enable CONFIG_FREERTOS_USE_TRACE_FACILITY and "
+           "CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS for task statistics");
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+/**
+ * @brief Log per-task CPU usage since the previous call, per-core load and
+ *        stack high-water marks
+ *
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; logs a hint otherwise.
+ */
+void task_stats_log(void);
+
+#endif  // TASK_STATS_H
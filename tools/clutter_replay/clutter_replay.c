@@ -0,0 +1,312 @@
+/*
+ * Replays radar frames through the clutter model and compares lights-on time
+ * with and without it. Relays follow presence like the sensor task does:
+ * on while the filtered frame has at least one target.
+ *
+ * Without a capture, synthetic clutter scenarios with known ground truth are
+ * run (10 Hz frames, three hours each) and false-on and missed-presence time
+ * are reported. A capture uses the occupancy_replay format, one frame per
+ * line, and reports raw against filtered on-time:
+ *
+ *   <time_ms> <count> [<x_mm> <y_mm> <speed_cm_s>] * count
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o clutter_replay tools/clutter_replay/clutter_replay.c \
+ *       components/occupancy/clutter.c components/occupancy/heatmap.c \
+ *       -Icomponents/occupancy/include -Icomponents/radar_sensor/include -lm
+ *   ./clutter_replay [-l learn_s] [-f forget_s] [-m motion_cm_s] [capture]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clutter.h"
+
+#define FRAME_MS 100
+#define SCENARIO_S (3 * 3600)
+#define SCENARIO_FRAMES (SCENARIO_S * 1000 / FRAME_MS)
+
+typedef struct {
+  uint32_t learn_s;
+  uint32_t forget_s;
+  uint32_t motion_cm_s;
+} rates_t;
+
+typedef struct {
+  double person_s;
+  double raw_on_s;
+  double on_s;
+  double raw_false_on_s;
+  double false_on_s;
+  double missed_s;
+  double first_quiet_s;  // First empty-room second the lights went off
+  uint64_t frames;
+  uint64_t targets;
+  double filter_ns;
+} result_t;
+
+static clutter_t s_clutter;
+
+static float uniform(float lo, float hi) {
+  return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+// Feed one frame; present is the ground truth, -1 when unknown
+static void step(result_t* r, radar_fused_target_t* targets, size_t count,
+                 int64_t t_ms, double dt_s, int present) {
+  struct timespec a, b;
+  bool raw_on = count > 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  size_t kept = clutter_filter(&s_clutter, targets, count);
+  clutter_sweep(&s_clutter, t_ms * 1000);
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  r->filter_ns += (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+
+  bool on = kept > 0;
+  r->frames++;
+  r->targets += count;
+  r->raw_on_s += raw_on ? dt_s : 0;
+  r->on_s += on ? dt_s : 0;
+  if (present == 1) {
+    r->person_s += dt_s;
+    r->missed_s += on ? 0 : dt_s;
+  } else if (present == 0) {
+    r->raw_false_on_s += raw_on ? dt_s : 0;
+    r->false_on_s += on ? dt_s : 0;
+    if (!on && raw_on && r->first_quiet_s < 0) {
+      r->first_quiet_s = t_ms / 1000.0;
+    }
+  }
+}
+
+// Clutter sources; each adds at most one target to the frame
+static void add_fan(radar_fused_target_t* t, size_t* n) {
+  if (rand() % 20 != 0) {
+    t[(*n)++] = (radar_fused_target_t){uniform(1380, 1620),
+                                       uniform(2880, 3120),
+                                       uniform(-6, 6), 1};
+  }
+}
+
+static void add_curtain(radar_fused_target_t* t, size_t* n) {
+  if (rand() % 2 == 0) {
+    t[(*n)++] = (radar_fused_target_t){uniform(-3700, -3300),
+                                       uniform(3800, 4200),
+                                       uniform(-12, 12), 1};
+  }
+}
+
+// A person who walks from the door to the desk, sits for a while and
+// leaves again, with a visit roughly every half hour. Returns true while
+// the person is in the room.
+typedef struct {
+  int phase;  // 0 away, 1 walking in, 2 seated, 3 walking out
+  int64_t until_ms;
+  int64_t next_fidget_ms;
+  float x, y;
+} person_t;
+
+static const float kDoorX = 3000, kDoorY = 500;
+static const float kDeskX = -1500, kDeskY = 2500;
+
+static bool move_towards(person_t* p, float tx, float ty, float* speed) {
+  float dx = tx - p->x, dy = ty - p->y;
+  float dist = sqrtf(dx * dx + dy * dy);
+  float stride = 100.0f;  // 100 cm/s at 10 Hz
+  *speed = 100.0f;
+  if (dist <= stride) {
+    p->x = tx;
+    p->y = ty;
+    return true;
+  }
+  p->x += dx / dist * stride;
+  p->y += dy / dist * stride;
+  return false;
+}
+
+static bool add_person(person_t* p, int64_t t_ms, int max_still_s,
+                       radar_fused_target_t* t, size_t* n) {
+  float speed = 0;
+  switch (p->phase) {
+    case 0:
+      if (t_ms < p->until_ms) {
+        return false;
+      }
+      p->phase = 1;
+      p->x = kDoorX;
+      p->y = kDoorY;
+      // fall through
+    case 1:
+      if (move_towards(p, kDeskX, kDeskY, &speed)) {
+        p->phase = 2;
+        p->until_ms = t_ms + (int64_t)uniform(300, 2400) * 1000;
+        p->next_fidget_ms = t_ms + (int64_t)uniform(30, max_still_s) * 1000;
+      }
+      break;
+    case 2:
+      speed = uniform(-4, 4);
+      if (t_ms >= p->next_fidget_ms) {
+        // Shifting in the chair or reaching for something
+        speed = uniform(20, 40);
+        p->next_fidget_ms = t_ms + (int64_t)uniform(30, max_still_s) * 1000;
+      }
+      if (t_ms >= p->until_ms) {
+        p->phase = 3;
+      }
+      break;
+    case 3:
+      if (move_towards(p, kDoorX, kDoorY, &speed)) {
+        p->phase = 0;
+        p->until_ms = t_ms + (int64_t)uniform(600, 2400) * 1000;
+        return false;
+      }
+      break;
+  }
+  t[(*n)++] = (radar_fused_target_t){p->x + uniform(-60, 60),
+                                     p->y + uniform(-60, 60), speed, 1};
+  return true;
+}
+
+typedef enum {
+  SCENARIO_FAN,
+  SCENARIO_CURTAIN,
+  SCENARIO_DESK_AND_FAN,
+  SCENARIO_STILL_READER,
+  SCENARIO_COUNT,
+} scenario_t;
+
+static const char* kScenarioNames[SCENARIO_COUNT] = {
+    "fan only", "curtain only", "desk work + fan", "still reader + curtain"};
+
+static void run_scenario(scenario_t scenario, const rates_t* rates,
+                         result_t* r) {
+  srand(100 + scenario);
+  memset(r, 0, sizeof(*r));
+  r->first_quiet_s = -1;
+  clutter_init(&s_clutter, rates->learn_s, rates->forget_s,
+               rates->motion_cm_s);
+
+  person_t person = {.phase = 0, .until_ms = 600 * 1000};
+  for (int64_t f = 1; f <= SCENARIO_FRAMES; f++) {
+    int64_t t_ms = f * FRAME_MS;
+    radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+    size_t n = 0;
+    bool present = false;
+
+    switch (scenario) {
+      case SCENARIO_FAN:
+        add_fan(targets, &n);
+        break;
+      case SCENARIO_CURTAIN:
+        add_curtain(targets, &n);
+        break;
+      case SCENARIO_DESK_AND_FAN:
+        add_fan(targets, &n);
+        present = add_person(&person, t_ms, 240, targets, &n);
+        break;
+      case SCENARIO_STILL_READER:
+        add_curtain(targets, &n);
+        // Fidgets up to 15 minutes apart
+        present = add_person(&person, t_ms, 900, targets, &n);
+        break;
+      default:
+        break;
+    }
+    step(r, targets, n, t_ms, FRAME_MS / 1000.0, present ? 1 : 0);
+  }
+}
+
+static int replay_capture(FILE* f, const rates_t* rates) {
+  result_t r;
+  memset(&r, 0, sizeof(r));
+  r.first_quiet_s = -1;
+  clutter_init(&s_clutter, rates->learn_s, rates->forget_s,
+               rates->motion_cm_s);
+
+  long long t, last_t = -1;
+  unsigned count;
+  while (fscanf(f, "%lld %u", &t, &count) == 2) {
+    radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+    size_t n = 0;
+    for (unsigned i = 0; i < count; i++) {
+      float x, y, speed;
+      if (fscanf(f, "%f %f %f", &x, &y, &speed) != 3) {
+        fprintf(stderr, "truncated frame at %lld ms\n", t);
+        return 1;
+      }
+      if (n < RADAR_FUSION_MAX_TARGETS) {
+        targets[n++] = (radar_fused_target_t){x, y, speed, 1};
+      }
+    }
+    // Frame gaps longer than 2 s are radar silence, not lights-on time
+    double dt_s = last_t < 0 ? 0 : (t - last_t) / 1000.0;
+    step(&r, targets, n, t, dt_s > 2.0 ? 0 : dt_s, -1);
+    last_t = t;
+  }
+
+  printf("%llu frames, %llu targets, %lu suppressed, %lu clutter cells\n",
+         (unsigned long long)r.frames, (unsigned long long)r.targets,
+         (unsigned long)s_clutter.suppressed,
+         (unsigned long)s_clutter.clutter_cells);
+  printf("lights on: %.0f s raw, %.0f s filtered (%.1f%% less)\n",
+         r.raw_on_s, r.on_s,
+         r.raw_on_s > 0 ? 100.0 * (r.raw_on_s - r.on_s) / r.raw_on_s : 0.0);
+  printf("filter: %.0f ns per frame\n",
+         r.frames ? r.filter_ns / r.frames : 0.0);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  rates_t rates = {.learn_s = 1200, .forget_s = 3600, .motion_cm_s = 15};
+  int opt;
+  while ((opt = getopt(argc, argv, "l:f:m:")) != -1) {
+    switch (opt) {
+      case 'l':
+        rates.learn_s = (uint32_t)strtoul(optarg, NULL, 10);
+        break;
+      case 'f':
+        rates.forget_s = (uint32_t)strtoul(optarg, NULL, 10);
+        break;
+      case 'm':
+        rates.motion_cm_s = (uint32_t)strtoul(optarg, NULL, 10);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-l learn_s] [-f forget_s] [-m motion_cm_s] "
+                "[capture]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+  printf("learn %lu s, forget %lu s, motion %lu cm/s, model %u bytes\n",
+         (unsigned long)rates.learn_s, (unsigned long)rates.forget_s,
+         (unsigned long)rates.motion_cm_s, (unsigned)sizeof(clutter_t));
+
+  if (optind < argc) {
+    FILE* f = fopen(argv[optind], "r");
+    if (!f) {
+      perror(argv[optind]);
+      return 1;
+    }
+    int ret = replay_capture(f, &rates);
+    fclose(f);
+    return ret;
+  }
+
+  printf("%-24s %8s %17s %9s %8s %9s\n", "scenario", "person",
+         "false-on raw/filt", "quiet at", "missed", "ns/frame");
+  for (int s = 0; s < SCENARIO_COUNT; s++) {
+    result_t r;
+    run_scenario((scenario_t)s, &rates, &r);
+    printf("%-24s %7.0fs %8.0fs/%6.0fs %8.0fs %7.0fs %9.0f\n",
+           kScenarioNames[s], r.person_s, r.raw_false_on_s, r.false_on_s,
+           r.first_quiet_s, r.missed_s, r.filter_ns / r.frames);
+  }
+  return 0;
+}
@@ -0,0 +1,721 @@
+/*
+ * Host load simulator for a fleet of controllers sharing one Apps Script
+ * backend.
+ *
+ * Every virtual device is a separate process running the real uplink queue
+ * (components/uplink) with the WiFi task's upload loop: state changes first,
+ * at most four summaries per pass, pop only after an acknowledged send and
+ * the jittered exponential backoff after a failure. Every body carries
+ * dev, boot and seq as the firmware sends them. Presence transitions follow
+ * a scripted pattern and each device queues an occupancy summary every
+ * summary period.
+ *
+ * The built-in stand-in models what limits the real backend: a cap on
+ * simultaneous script executions (requests beyond it get 503, as Apps
+ * Script rejects them), a fixed per-execution overhead, and spreadsheet
+ * write calls that are serialised across executions. It answers with the
+ * 302 the device takes as its acknowledgement, and drops repeats with the
+ * same per-device, per-stream high-water mark as appscript.js.
+ *
+ * Faults can be injected into the stand-in: a request lost before the
+ * script runs, or a response lost after the row was written (what a
+ * timeout on a slow execution looks like to the device). The stand-in
+ * counts the rows stored per device and sequence and each device marks the
+ * sequences it saw acknowledged; a run passes the exactly-once check when
+ * no sequence was stored twice and every acknowledged one was stored.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o fleet_sim tools/fleet_sim/fleet_sim.c \
+ *       components/uplink/uplink.c -Icomponents/uplink/include -lpthread -lm
+ *   ./fleet_sim [options]
+ *
+ *   -n 1,10,30,60   device counts to run, one after the other
+ *   -d 30           seconds of traffic per run (then up to 15 s to drain)
+ *   -p random       presence pattern: random (independent transitions) or
+ *                   sync (every device switches at the same instants)
+ *   -e 10           mean seconds between presence transitions per device
+ *   -s 60           summary interval per device (s)
+ *   -c 30           stand-in: simultaneous executions before 503
+ *   -x 250          stand-in: execution overhead (ms)
+ *   -w 50           stand-in: time per spreadsheet write call (ms)
+ *   -k 1            stand-in: write calls per event (appscript.js makes one;
+ *                   the getLastRow/setValue version made four)
+ *   -r 2000         first retry delay after a failed upload (ms); it
+ *                   doubles per consecutive failure, with jitter
+ *   -m 60000        largest retry delay (ms)
+ *   -t 10000        HTTP timeout (ms)
+ *   -q 0            stand-in: percent of requests lost before commit
+ *   -f 0            stand-in: percent of responses lost after commit
+ *   -D              stand-in: no duplicate suppression
+ *   -u URL          replay the request mix against http://host:port/path
+ *                   instead of the stand-in (plain HTTP only)
+ *
+ * Per run it prints requests/s, request latency percentiles, retries,
+ * events that were never delivered and, with the stand-in, rows stored
+ * twice, repeats suppressed and the exactly-once verdict.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uplink.h"
+
+#define UPLOAD_STATUS 0
+#define UPLOAD_SUMMARY 1
+#define UPLOAD_BULK_BATCH 4
+#define DRAIN_S 15
+#define MAX_SAMPLES 4096
+#define MAX_RUNS 16
+#define MAX_DEVICES 1024
+#define MAX_SEQ 4096  // Sequences tracked per device for the exactly-once check
+
+// Options
+static int s_counts[MAX_RUNS] = {1, 10, 30, 60};
+static int s_runs = 4;
+static int s_duration_s = 30;
+static int s_sync;
+static double s_event_s = 10;
+static int s_summary_s = 60;
+static int s_concurrency = 30;
+static int s_exec_ms = 250;
+static int s_write_ms = 50;
+static int s_write_calls = 1;
+static int s_retry_ms = 2000;
+static int s_retry_max_ms = 60000;
+static int s_drop_request_pct;
+static int s_drop_response_pct;
+static int s_dedup = 1;
+static int s_timeout_ms = 10000;
+static char s_host[128] = "127.0.0.1";
+static char s_port[8];
+static char s_path[256] = "/exec";
+static pid_t s_stand_in_pid;
+
+// Stand-in counters, in memory shared with the parent. The stand-in runs
+// in its own process so the parent has no threads when it forks devices.
+typedef struct {
+  int active;
+  int active_max;
+  uint32_t committed;
+  uint32_t rejected;
+  uint32_t suppressed;  // Repeats answered without a write
+  uint32_t faults;      // Requests or responses dropped on purpose
+} stand_in_stats_t;
+
+// Delivery ledger, shared by the stand-in and the device processes
+typedef struct {
+  uint8_t rows[MAX_DEVICES][MAX_SEQ];   // Rows stored, by the stand-in
+  uint8_t acked[MAX_DEVICES][MAX_SEQ];  // Acknowledged, by the device
+} ledger_t;
+
+// High-water mark per device and stream (status, summary), as the script
+// keeps it in CacheService
+typedef struct {
+  uint32_t boot;
+  uint32_t seq;
+} high_water_t;
+
+static pthread_mutex_t s_sheet_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_dedup_lock = PTHREAD_MUTEX_INITIALIZER;
+static stand_in_stats_t* s_stats;
+static ledger_t* s_ledger;
+static high_water_t s_high_water[MAX_DEVICES][2];
+static unsigned s_fault_seed = 1;
+
+// What each device process reports back to the parent
+typedef struct {
+  uint32_t events;     // Presence transitions generated
+  uint32_t summaries;  // Summaries generated
+  uint32_t requests;   // POSTs attempted
+  uint32_t failures;   // POSTs that failed and were retried
+  uint32_t skipped;    // State equal to the last one sent
+  uint32_t coalesced;  // State changes replaced while queued
+  uint32_t dropped;    // Summaries evicted from a full queue
+  uint32_t pending;    // Items still queued after the drain
+  uint32_t samples;    // Entries in latency_ms
+  uint32_t delivery_max_ms;  // Longest event-to-acknowledgement time
+  uint16_t latency_ms[MAX_SAMPLES];
+} device_report_t;
+
+static int64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_us(int64_t us) {
+  if (us > 0) {
+    usleep((useconds_t)(us < 1000000 ? us : 1000000));
+  }
+}
+
+// Exponential inter-arrival time with the given mean, from a private seed
+static int64_t next_gap_us(unsigned* seed, double mean_s) {
+  double u = (rand_r(seed) + 1.0) / ((double)RAND_MAX + 2.0);
+  return (int64_t)(-mean_s * 1e6 * log(u));
+}
+
+// --- Stand-in backend -----------------------------------------------------
+
+static int read_request(int fd, char* buf, size_t size) {
+  size_t used = 0;
+  char* end = NULL;
+  while (!end) {
+    ssize_t n = recv(fd, buf + used, size - 1 - used, 0);
+    if (n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+    buf[used] = '\0';
+    end = strstr(buf, "\r\n\r\n");
+  }
+  const char* cl = strstr(buf, "Content-Length:");
+  size_t want =
+      (size_t)(end + 4 - buf) + (cl ? strtoul(cl + 15, NULL, 10) : 0);
+  while (used < want && used < size - 1) {
+    ssize_t n = recv(fd, buf + used, size - 1 - used, 0);
+    if (n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+  }
+  buf[used] = '\0';
+  return 0;
+}
+
+// Request identity; false for a body without one
+static bool parse_identity(const char* req, int* device, uint32_t* boot,
+                           uint32_t* seq) {
+  const char* dev = strstr(req, "dev=");
+  const char* b = strstr(req, "&boot=");
+  const char* q = strstr(req, "&seq=");
+  if (!dev || !b || !q || strlen(dev + 4) < 12) {
+    return false;
+  }
+  *device = (int)strtoul(dev + 4 + 8, NULL, 16);
+  *boot = (uint32_t)strtoul(b + 6, NULL, 16);
+  *seq = (uint32_t)strtoul(q + 5, NULL, 10);
+  return *device >= 0 && *device < MAX_DEVICES;
+}
+
+// The script's claimSequence(): false if this sequence was already taken
+static bool claim_sequence(int device, int stream, uint32_t boot,
+                           uint32_t seq) {
+  high_water_t* mark = &s_high_water[device][stream];
+  pthread_mutex_lock(&s_dedup_lock);
+  bool fresh = mark->boot != boot || seq > mark->seq;
+  if (fresh) {
+    mark->boot = boot;
+    mark->seq = seq;
+  }
+  pthread_mutex_unlock(&s_dedup_lock);
+  return fresh;
+}
+
+// Percent chance, from one seed shared by the connection threads
+static bool inject(int percent) {
+  if (percent <= 0) {
+    return false;
+  }
+  pthread_mutex_lock(&s_dedup_lock);
+  bool hit = rand_r(&s_fault_seed) % 100 < percent;
+  pthread_mutex_unlock(&s_dedup_lock);
+  if (hit) {
+    __atomic_add_fetch(&s_stats->faults, 1, __ATOMIC_RELAXED);
+  }
+  return hit;
+}
+
+static void* serve_connection(void* arg) {
+  int fd = (int)(intptr_t)arg;
+  char req[4096];
+  static const char ok[] =
+      "HTTP/1.1 302 Moved Temporarily\r\n"
+      "Location: http://127.0.0.1/echo?user_content_key=stub\r\n"
+      "Content-Length: 0\r\nConnection: close\r\n\r\n";
+  static const char busy[] =
+      "HTTP/1.1 503 Service Unavailable\r\n"
+      "Content-Length: 0\r\nConnection: close\r\n\r\n";
+
+  if (read_request(fd, req, sizeof(req)) == 0) {
+    int active = __atomic_add_fetch(&s_stats->active, 1, __ATOMIC_RELAXED);
+    if (active > s_concurrency) {
+      __atomic_add_fetch(&s_stats->rejected, 1, __ATOMIC_RELAXED);
+      send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+    } else {
+      int seen = __atomic_load_n(&s_stats->active_max, __ATOMIC_RELAXED);
+      while (active > seen &&
+             !__atomic_compare_exchange_n(&s_stats->active_max, &seen, active, false,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED)) {
+      }
+      sleep_us((int64_t)s_exec_ms * 1000);
+      int device = 0;
+      int stream = strstr(req, "status=") ? 0 : 1;
+      uint32_t boot = 0;
+      uint32_t seq = 0;
+      bool identified = parse_identity(req, &device, &boot, &seq);
+      if (inject(s_drop_request_pct)) {
+        // Lost on the way in: nothing stored, no answer
+      } else if (s_dedup && identified &&
+                 !claim_sequence(device, stream, boot, seq)) {
+        __atomic_add_fetch(&s_stats->suppressed, 1, __ATOMIC_RELAXED);
+        send(fd, ok, sizeof(ok) - 1, MSG_NOSIGNAL);
+      } else {
+        // Heatmaps and summaries are one appendRow/setValues each
+        int calls = stream == 0 ? s_write_calls : 1;
+        pthread_mutex_lock(&s_sheet_lock);
+        sleep_us((int64_t)calls * s_write_ms * 1000);
+        pthread_mutex_unlock(&s_sheet_lock);
+        __atomic_add_fetch(&s_stats->committed, 1, __ATOMIC_RELAXED);
+        if (identified && seq < MAX_SEQ) {
+          __atomic_add_fetch(&s_ledger->rows[device][seq], 1,
+                             __ATOMIC_RELAXED);
+        }
+        if (!inject(s_drop_response_pct)) {
+          send(fd, ok, sizeof(ok) - 1, MSG_NOSIGNAL);
+        }
+      }
+    }
+    __atomic_sub_fetch(&s_stats->active, 1, __ATOMIC_RELAXED);
+  }
+  close(fd);
+  return NULL;
+}
+
+static void* server_main(void* arg) {
+  int listen_fd = (int)(intptr_t)arg;
+  for (;;) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+    if (pthread_create(&thread, &attr, serve_connection,
+                       (void*)(intptr_t)fd) != 0) {
+      close(fd);
+    }
+    pthread_attr_destroy(&attr);
+  }
+  return NULL;
+}
+
+static void start_stand_in(void) {
+  s_stats = mmap(NULL, sizeof(*s_stats), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  s_ledger = mmap(NULL, sizeof(*s_ledger), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (s_stats == MAP_FAILED || s_ledger == MAP_FAILED) {
+    perror("mmap");
+    exit(1);
+  }
+  memset(s_stats, 0, sizeof(*s_stats));
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 512) != 0) {
+    perror("stand-in");
+    exit(1);
+  }
+  socklen_t len = sizeof(addr);
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  snprintf(s_port, sizeof(s_port), "%u", ntohs(addr.sin_port));
+
+  s_stand_in_pid = fork();
+  if (s_stand_in_pid == 0) {
+    server_main((void*)(intptr_t)fd);
+    _exit(0);
+  }
+  close(fd);
+}
+
+// --- Virtual device -------------------------------------------------------
+
+// POST form to the endpoint; true on 200 or 302, the device's success codes
+static bool http_post(const char* form) {
+  struct addrinfo hints = {0};
+  struct addrinfo* res = NULL;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(s_host, s_port, &hints, &res) != 0) {
+    return false;
+  }
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  struct timeval tv = {s_timeout_ms / 1000, (s_timeout_ms % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  bool ok = connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+
+  char buf[1024];
+  if (ok) {
+    int len = snprintf(buf, sizeof(buf),
+                       "POST %s HTTP/1.1\r\nHost: %s\r\n"
+                       "Content-Type: application/x-www-form-urlencoded\r\n"
+                       "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                       s_path, s_host, strlen(form), form);
+    ok = send(fd, buf, (size_t)len, MSG_NOSIGNAL) == len;
+  }
+  if (ok) {
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+    ok = n >= 12;
+    if (ok) {
+      buf[n] = '\0';
+      int status = atoi(buf + 9);
+      ok = status == 200 || status == 302;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+// Body as the device formats it; the summary is a fixed plausible row. The
+// device number stands in for the low bytes of the MAC.
+static void format_item(const uplink_item_t* item, int device, uint32_t boot,
+                        char* body, size_t len) {
+  uint32_t age_ms = (uint32_t)((now_us() - item->queued_us) / 1000);
+  int used;
+  if (item->kind == UPLOAD_STATUS) {
+    used = snprintf(body, len, "status=%s&age_ms=%u",
+                    item->data[0] ? "ON" : "OFF", age_ms);
+  } else {
+    used = snprintf(body, len,
+                    "type=summary&up=%u&dur=%d&frames=%d&occ_s=120&entries=2"
+                    "&tmean=1.20&tmax=2&dmin=600&dmean=2100&dmax=4800"
+                    "&smin=0.0&smean=12.5&smax=80.0&r1_s=180&r2_s=0&frames_lost=0",
+                    age_ms, s_summary_s, s_summary_s * 10);
+  }
+  snprintf(body + used, len - (size_t)used,
+           "&dev=02000000%04x&boot=%08x&seq=%u", device, boot, item->id);
+}
+
+// One device: scripted producer and the uploader loop, single threaded.
+// Events due while a POST is in flight are queued right after it, with
+// their scheduled time, which is what the producer task would have done.
+static void run_device(int device, int64_t start_us, device_report_t* out) {
+  unsigned seed = s_sync ? 1u : 1u + (unsigned)device * 7919u;
+  int64_t end_us = start_us + (int64_t)s_duration_s * 1000000;
+  int64_t next_event = start_us + next_gap_us(&seed, s_event_s);
+  int64_t next_summary =
+      start_us + (int64_t)s_summary_s * 1000000 * (device % 10 + 1) / 10;
+  int64_t retry_at = 0;
+  uint8_t status = 0;
+  int last_sent = -1;
+  // A fresh boot id per run, so device numbers reused by the next run do
+  // not collide with this run's high-water marks
+  uint32_t boot = ((uint32_t)now_us() * 2654435761u ^ (uint32_t)device) | 1;
+  uplink_backoff_t backoff;
+  uplink_backoff_init(&backoff, (uint32_t)s_retry_ms, (uint32_t)s_retry_max_ms,
+                      boot);
+
+  uplink_init();
+  memset(out, 0, sizeof(*out));
+
+  for (;;) {
+    int64_t now = now_us();
+    while (next_event <= now && next_event < end_us) {
+      status ^= 1;
+      uplink_push(UPLINK_CLASS_STATE, UPLOAD_STATUS, &status, 1, next_event);
+      out->events++;
+      next_event += next_gap_us(&seed, s_event_s);
+    }
+    while (next_summary <= now && next_summary < end_us) {
+      uplink_push(UPLINK_CLASS_BULK, UPLOAD_SUMMARY, NULL, 0, next_summary);
+      out->summaries++;
+      next_summary += (int64_t)s_summary_s * 1000000;
+    }
+
+    uplink_item_t item;
+    uplink_class_t cls;
+    bool queued = uplink_peek(&item, &cls);
+    if (!queued && now >= end_us) {
+      break;
+    }
+    if (now >= end_us + (int64_t)DRAIN_S * 1000000) {
+      break;
+    }
+    if (!queued || now < retry_at) {
+      int64_t wake = next_event < next_summary ? next_event : next_summary;
+      if (queued || wake > end_us) {
+        wake = queued ? retry_at : end_us;
+      }
+      sleep_us(wake - now < 100000 ? wake - now : 100000);
+      continue;
+    }
+
+    int bulk_sent = 0;
+    while (uplink_peek(&item, &cls)) {
+      if (cls == UPLINK_CLASS_BULK && bulk_sent++ >= UPLOAD_BULK_BATCH) {
+        break;
+      }
+      if (item.kind == UPLOAD_STATUS && item.data[0] == last_sent) {
+        out->skipped++;
+        uplink_pop(cls, item.id);
+        continue;
+      }
+      char body[512];
+      format_item(&item, device, boot, body, sizeof(body));
+      int64_t sent_at = now_us();
+      bool ok = http_post(body);
+      int64_t done = now_us();
+      out->requests++;
+      if (out->samples < MAX_SAMPLES) {
+        int64_t ms = (done - sent_at) / 1000;
+        out->latency_ms[out->samples++] = (uint16_t)(ms < 65535 ? ms : 65535);
+      }
+      if (!ok) {
+        out->failures++;
+        retry_at = done + (int64_t)uplink_backoff_next(&backoff) * 1000;
+        break;
+      }
+      uplink_backoff_reset(&backoff);
+      if (s_ledger && item.id < MAX_SEQ) {
+        s_ledger->acked[device][item.id] = 1;
+      }
+      if (item.kind == UPLOAD_STATUS) {
+        last_sent = item.data[0];
+        uint32_t delivery_ms = (uint32_t)((done - item.queued_us) / 1000);
+        if (delivery_ms > out->delivery_max_ms) {
+          out->delivery_max_ms = delivery_ms;
+        }
+      }
+      uplink_pop(cls, item.id);
+    }
+  }
+
+  uplink_class_stats_t stats[UPLINK_CLASS_COUNT];
+  uplink_get_stats(stats, now_us());
+  out->coalesced = stats[UPLINK_CLASS_STATE].coalesced;
+  out->dropped = stats[UPLINK_CLASS_BULK].dropped;
+  out->pending = stats[UPLINK_CLASS_STATE].depth + stats[UPLINK_CLASS_BULK].depth;
+}
+
+// --- Runs -----------------------------------------------------------------
+
+static int cmp_u16(const void* a, const void* b) {
+  return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+static void run_fleet(int devices) {
+  static device_report_t report;
+  static uint16_t latencies[MAX_SAMPLES * 64];
+  static int pipes[1024];
+  size_t latency_count = 0;
+  device_report_t total = {0};
+
+  if (s_stand_in_pid) {
+    __atomic_store_n(&s_stats->committed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats->rejected, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats->active_max, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats->suppressed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats->faults, 0, __ATOMIC_RELAXED);
+    memset(s_ledger, 0, sizeof(*s_ledger));
+  }
+
+  // One pipe per device; a report is far below the pipe capacity, so
+  // children never block on it
+  int64_t start = now_us() + 200000;
+  for (int d = 0; d < devices; d++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      exit(1);
+    }
+    if (fork() == 0) {
+      close(fds[0]);
+      sleep_us(start - now_us());
+      run_device(d, start, &report);
+      size_t len = offsetof(device_report_t, latency_ms) +
+                   report.samples * sizeof(report.latency_ms[0]);
+      const uint8_t* p = (const uint8_t*)&report;
+      while (len > 0) {
+        ssize_t n = write(fds[1], p, len);
+        if (n < 0 && errno != EINTR) {
+          _exit(1);
+        }
+        if (n > 0) {
+          p += n;
+          len -= (size_t)n;
+        }
+      }
+      _exit(0);
+    }
+    close(fds[1]);
+    pipes[d] = fds[0];
+  }
+
+  for (int d = 0; d < devices; d++) {
+    memset(&report, 0, sizeof(report));
+    uint8_t* p = (uint8_t*)&report;
+    size_t got = 0;
+    ssize_t n;
+    while ((n = read(pipes[d], p + got, sizeof(report) - got)) > 0) {
+      got += (size_t)n;
+    }
+    close(pipes[d]);
+    if (got < offsetof(device_report_t, latency_ms)) {
+      continue;
+    }
+    total.events += report.events;
+    total.summaries += report.summaries;
+    total.requests += report.requests;
+    total.failures += report.failures;
+    total.skipped += report.skipped;
+    total.coalesced += report.coalesced;
+    total.dropped += report.dropped;
+    total.pending += report.pending;
+    if (report.delivery_max_ms > total.delivery_max_ms) {
+      total.delivery_max_ms = report.delivery_max_ms;
+    }
+    for (uint32_t i = 0;
+         i < report.samples &&
+         latency_count < sizeof(latencies) / sizeof(latencies[0]);
+         i++) {
+      latencies[latency_count++] = report.latency_ms[i];
+    }
+  }
+  for (int d = 0; d < devices; d++) {
+    wait(NULL);
+  }
+
+  qsort(latencies, latency_count, sizeof(latencies[0]), cmp_u16);
+  double elapsed_s = (now_us() - start) / 1e6;
+  unsigned p50 = latency_count ? latencies[latency_count / 2] : 0;
+  unsigned p95 = latency_count ? latencies[latency_count * 95 / 100] : 0;
+  unsigned p99 = latency_count ? latencies[latency_count * 99 / 100] : 0;
+  uint32_t lost = total.dropped + total.pending;
+
+  printf("%4d %7.1f %6u %6u %6u %7u %7u %6u %5u %5u %9u", devices,
+         total.requests / elapsed_s, p50, p95, p99, total.requests,
+         total.failures, total.events, total.coalesced, lost,
+         total.delivery_max_ms);
+  if (s_stand_in_pid) {
+    // Exactly once: nothing stored twice, nothing acknowledged but unstored
+    uint32_t duplicates = 0;
+    uint32_t missing = 0;
+    for (int d = 0; d < devices; d++) {
+      for (int q = 0; q < MAX_SEQ; q++) {
+        uint8_t rows = s_ledger->rows[d][q];
+        duplicates += rows > 1 ? rows - 1u : 0;
+        missing += s_ledger->acked[d][q] && rows == 0;
+      }
+    }
+    printf(" %7u %6u %4d %6u %5u %5u %4s", s_stats->committed,
+           s_stats->rejected, s_stats->active_max, s_stats->faults,
+           s_stats->suppressed, duplicates,
+           duplicates || missing ? "FAIL" : "PASS");
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+static void parse_counts(const char* arg) {
+  s_runs = 0;
+  while (*arg && s_runs < MAX_RUNS) {
+    int count = atoi(arg);
+    s_counts[s_runs++] = count < 1 ? 1 : count > 1024 ? 1024 : count;
+    const char* comma = strchr(arg, ',');
+    if (!comma) {
+      break;
+    }
+    arg = comma + 1;
+  }
+}
+
+// http://host[:port][/path]
+static void parse_url(const char* url) {
+  if (strncmp(url, "http://", 7) != 0) {
+    fprintf(stderr, "Only http:// endpoints are supported\n");
+    exit(2);
+  }
+  url += 7;
+  const char* slash = strchr(url, '/');
+  size_t host_len = slash ? (size_t)(slash - url) : strlen(url);
+  snprintf(s_host, sizeof(s_host), "%.*s", (int)host_len, url);
+  snprintf(s_path, sizeof(s_path), "%s", slash ? slash : "/");
+  char* colon = strchr(s_host, ':');
+  snprintf(s_port, sizeof(s_port), "%s", colon ? colon + 1 : "80");
+  if (colon) {
+    *colon = '\0';
+  }
+}
+
+int main(int argc, char** argv) {
+  int opt;
+  const char* url = NULL;
+  while ((opt = getopt(argc, argv, "n:d:p:e:s:c:x:w:k:r:m:q:f:Dt:u:")) != -1) {
+    switch (opt) {
+      case 'n': parse_counts(optarg); break;
+      case 'd': s_duration_s = atoi(optarg); break;
+      case 'p': s_sync = strcmp(optarg, "sync") == 0; break;
+      case 'e': s_event_s = atof(optarg); break;
+      case 's': s_summary_s = atoi(optarg); break;
+      case 'c': s_concurrency = atoi(optarg); break;
+      case 'x': s_exec_ms = atoi(optarg); break;
+      case 'w': s_write_ms = atoi(optarg); break;
+      case 'k': s_write_calls = atoi(optarg); break;
+      case 'r': s_retry_ms = atoi(optarg); break;
+      case 'm': s_retry_max_ms = atoi(optarg); break;
+      case 'q': s_drop_request_pct = atoi(optarg); break;
+      case 'f': s_drop_response_pct = atoi(optarg); break;
+      case 'D': s_dedup = 0; break;
+      case 't': s_timeout_ms = atoi(optarg); break;
+      case 'u': url = optarg; break;
+      default:
+        fprintf(stderr, "See the header of tools/fleet_sim/fleet_sim.c\n");
+        return 2;
+    }
+  }
+
+  if (url) {
+    parse_url(url);
+    printf("Endpoint http://%s:%s%s, %s pattern, transition every %.0f s, "
+           "summary every %d s\n",
+           s_host, s_port, s_path, s_sync ? "sync" : "random", s_event_s,
+           s_summary_s);
+  } else {
+    start_stand_in();
+    printf("Stand-in: %d executions, %d ms overhead, %d x %d ms serialised "
+           "writes per event; %s pattern, transition every %.0f s, summary "
+           "every %d s\n",
+           s_concurrency, s_exec_ms, s_write_calls, s_write_ms,
+           s_sync ? "sync" : "random", s_event_s, s_summary_s);
+    printf("Faults: %d%% requests and %d%% responses lost; duplicate "
+           "suppression %s\n",
+           s_drop_request_pct, s_drop_response_pct, s_dedup ? "on" : "off");
+  }
+
+  printf("   N   req/s    p50    p95    p99    reqs retries events coal. "
+         " lost  deliv_max%s\n",
+         url ? "" : " commits    503 conc faults  supp.  dups once");
+  for (int r = 0; r < s_runs; r++) {
+    run_fleet(s_counts[r]);
+  }
+  if (s_stand_in_pid) {
+    kill(s_stand_in_pid, SIGTERM);
+  }
+  return 0;
+}
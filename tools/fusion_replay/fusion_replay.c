@@ -0,0 +1,538 @@
+/*
+ * Replays per-radar target streams through radar_fusion_update() and
+ * radar_fusion_merge() the way the radar reader does (store the frame of the
+ * radar that just reported, then merge) and checks the fused targets.
+ *
+ * Without a capture, fixed cases check the mount transform, the merge
+ * radius, that two targets of one radar are never merged, that a target
+ * joins the nearest cluster, stale-radar aging and the output limit. Then
+ * two synthetic 10 Hz streams from radars on opposite walls follow people
+ * walking through the room, with measurement noise, a limited field of view,
+ * missed detections and regular dropouts of the second radar. Every merge
+ * is checked against the ground truth: one fused target per person the
+ * fresh radars reported, close to where they reported it, and no target
+ * from a radar older than the maximum age.
+ *
+ * A capture holds one radar frame per line, targets in that radar's own
+ * frame, with the radars' mounts given by -s (one per radar, in order):
+ *
+ *   <time_ms> <radar> <count> [<x_mm> <y_mm> <speed_cm_s>] * count
+ *
+ * Each fused frame is printed in the occupancy_replay capture format, so
+ * the output can be fed to occupancy_replay and clutter_replay.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o fusion_replay tools/fusion_replay/fusion_replay.c \
+ *       components/radar_sensor/radar_fusion.c \
+ *       -Icomponents/radar_sensor/include -lm
+ *   ./fusion_replay [-r merge_mm] [-a max_age_ms] [-s x,y,rot]... [capture]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "radar_fusion.h"
+
+#define FRAME_MS 100
+#define STREAM_S 3600
+#define MAX_PEOPLE 3
+#define ROOM_HALF_WIDTH_MM 2000.0f
+#define ROOM_DEPTH_MM 6000.0f
+#define RANGE_MM 6000.0f
+#define FOV_DEG 60.0f
+#define NOISE_MM 80.0f
+#define POSITION_TOLERANCE_MM 250.0f
+
+// Radar 2 goes silent for DROPOUT_MS every DROPOUT_EVERY_MS
+#define DROPOUT_EVERY_MS 60000
+#define DROPOUT_MS 3000
+
+static int s_failures;
+
+static void check(bool ok, const char* what) {
+  printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) {
+    s_failures++;
+  }
+}
+
+static float uniform(float lo, float hi) {
+  return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+static bool near(float a, float b, float tolerance) {
+  return fabsf(a - b) <= tolerance;
+}
+
+static void set_target(radar_target_t* t, float x, float y) {
+  memset(t, 0, sizeof(*t));
+  t->detected = true;
+  t->x = x;
+  t->y = y;
+}
+
+// --- Fixed cases -----------------------------------------------------------
+
+static void run_cases(float merge_mm, int64_t max_age_us) {
+  radar_fusion_t fusion;
+  radar_fused_target_t out[RADAR_FUSION_MAX_TARGETS];
+  radar_target_t a[RADAR_MAX_TARGETS];
+  radar_target_t b[RADAR_MAX_TARGETS];
+  const radar_mount_t origin = {0.0f, 0.0f, 0.0f};
+  size_t n;
+
+  printf("cases (merge radius %.0f mm, max age %lld ms)\n", merge_mm,
+         (long long)(max_age_us / 1000));
+
+  // 90 degrees counter-clockwise: the boresight points along -x
+  radar_fusion_init(&fusion, merge_mm, max_age_us);
+  radar_mount_t turned = {1000.0f, 2000.0f, 90.0f};
+  radar_fusion_add_sensor(&fusion, &turned);
+  memset(a, 0, sizeof(a));
+  set_target(&a[0], 0.0f, 1000.0f);
+  radar_fusion_update(&fusion, 0, a, 1000);
+  n = radar_fusion_merge(&fusion, 1000, out, RADAR_FUSION_MAX_TARGETS);
+  check(n == 1 && near(out[0].x, 0.0f, 1.0f) && near(out[0].y, 2000.0f, 1.0f),
+        "mount offset and rotation");
+
+  // The same person seen by two radars, closer and farther than the radius
+  float inside = merge_mm * 0.8f;
+  float outside = merge_mm * 1.2f;
+  radar_fusion_init(&fusion, merge_mm, max_age_us);
+  radar_fusion_add_sensor(&fusion, &origin);
+  radar_fusion_add_sensor(&fusion, &origin);
+  memset(a, 0, sizeof(a));
+  memset(b, 0, sizeof(b));
+  set_target(&a[0], 0.0f, 3000.0f);
+  set_target(&b[0], inside, 3000.0f);
+  radar_fusion_update(&fusion, 0, a, 1000);
+  radar_fusion_update(&fusion, 1, b, 1000);
+  n = radar_fusion_merge(&fusion, 1000, out, RADAR_FUSION_MAX_TARGETS);
+  check(n == 1 && out[0].sensor_mask == 0x3 &&
+            near(out[0].x, inside / 2.0f, 1.0f),
+        "inside the merge radius: one target at the centroid");
+  set_target(&b[0], outside, 3000.0f);
+  radar_fusion_update(&fusion, 1, b, 1000);
+  n = radar_fusion_merge(&fusion, 1000, out, RADAR_FUSION_MAX_TARGETS);
+  check(n == 2 && out[0].sensor_mask == 0x1 && out[1].sensor_mask == 0x2,
+        "outside the merge radius: two targets");
+
+  // Two people next to each other in front of one radar
+  memset(b, 0, sizeof(b));
+  set_target(&a[1], 100.0f, 3000.0f);
+  radar_fusion_update(&fusion, 0, a, 1000);
+  radar_fusion_update(&fusion, 1, b, 1000);
+  n = radar_fusion_merge(&fusion, 1000, out, RADAR_FUSION_MAX_TARGETS);
+  check(n == 2 && out[0].sensor_mask == 0x1 && out[1].sensor_mask == 0x1,
+        "two targets of one radar are never merged");
+
+  // Radar 2's target lies within the radius of both of radar 1's
+  set_target(&b[0], 70.0f, 3000.0f);
+  radar_fusion_update(&fusion, 1, b, 1000);
+  n = radar_fusion_merge(&fusion, 1000, out, RADAR_FUSION_MAX_TARGETS);
+  check(n == 2 && out[0].sensor_mask == 0x1 && out[1].sensor_mask == 0x3 &&
+            near(out[1].x, 85.0f, 1.0f),
+        "a target joins the nearest cluster");
+
+  // Aging: radar 2 reported at 1 ms and is stale max_age_us later
+  radar_fusion_init(&fusion, merge_mm, max_age_us);
+  radar_fusion_add_sensor(&fusion, &origin);
+  radar_fusion_add_sensor(&fusion, &origin);
+  radar_fusion_add_sensor(&fusion, &origin);
+  memset(a, 0, sizeof(a));
+  memset(b, 0, sizeof(b));
+  set_target(&a[0], 0.0f, 3000.0f);
+  set_target(&b[0], 0.0f, 5000.0f);
+  radar_fusion_update(&fusion, 1, b, 1000);
+  radar_fusion_update(&fusion, 0, a, 1000 + max_age_us);
+  n = radar_fusion_merge(&fusion, 1000 + max_age_us, out,
+                         RADAR_FUSION_MAX_TARGETS);
+  check(n == 2, "a radar exactly max age old still counts");
+  radar_fusion_update(&fusion, 0, a, 1001 + max_age_us);
+  n = radar_fusion_merge(&fusion, 1001 + max_age_us, out,
+                         RADAR_FUSION_MAX_TARGETS);
+  check(n == 1 && out[0].sensor_mask == 0x1,
+        "a stale radar's targets are dropped");
+  check(!(out[0].sensor_mask & 0x4), "a radar without frames is ignored");
+
+  // Output limit
+  set_target(&a[1], 1000.0f, 3000.0f);
+  set_target(&a[2], 2000.0f, 3000.0f);
+  radar_fusion_update(&fusion, 0, a, 2000 + max_age_us);
+  n = radar_fusion_merge(&fusion, 2000 + max_age_us, out, 2);
+  check(n == 2, "no more targets than the caller has room for");
+}
+
+// --- Synthetic streams -----------------------------------------------------
+
+typedef struct {
+  bool present;
+  float x;
+  float y;
+  float heading;
+  float speed_mm_s;
+} person_t;
+
+// What one radar last reported: true positions of the people it saw
+typedef struct {
+  int64_t t_us;
+  size_t count;
+  int person[RADAR_MAX_TARGETS];
+  float x[RADAR_MAX_TARGETS];
+  float y[RADAR_MAX_TARGETS];
+} report_t;
+
+typedef struct {
+  uint64_t merges;
+  uint64_t count_checks;
+  uint64_t count_errors;
+  uint64_t positions;
+  uint64_t position_errors;
+  double error_sum_mm;
+  float error_max_mm;
+  uint64_t stale_checks;
+  uint64_t stale_errors;
+  double merge_ns;
+} stream_result_t;
+
+static void walk(person_t* p, float dt_s) {
+  if (!p->present) {
+    if (rand() % 200 == 0) {
+      p->present = true;
+      p->x = uniform(-ROOM_HALF_WIDTH_MM, ROOM_HALF_WIDTH_MM);
+      p->y = uniform(500.0f, ROOM_DEPTH_MM - 500.0f);
+      p->heading = uniform(0.0f, 6.2832f);
+      p->speed_mm_s = uniform(300.0f, 1200.0f);
+    }
+    return;
+  }
+  if (rand() % 600 == 0) {
+    p->present = false;
+    return;
+  }
+  p->heading += uniform(-0.3f, 0.3f);
+  float nx = p->x + cosf(p->heading) * p->speed_mm_s * dt_s;
+  float ny = p->y + sinf(p->heading) * p->speed_mm_s * dt_s;
+  if (nx < -ROOM_HALF_WIDTH_MM || nx > ROOM_HALF_WIDTH_MM || ny < 300.0f ||
+      ny > ROOM_DEPTH_MM - 300.0f) {
+    p->heading += 3.1416f;  // Turn back at the walls
+    return;
+  }
+  p->x = nx;
+  p->y = ny;
+}
+
+// Room frame to a radar's own frame (inverse of radar_mount_apply)
+static void to_sensor(const radar_mount_t* m, float x, float y, float* sx,
+                      float* sy) {
+  float r = m->rotation_deg * 3.14159265f / 180.0f;
+  float dx = x - m->x_mm;
+  float dy = y - m->y_mm;
+  *sx = dx * cosf(r) + dy * sinf(r);
+  *sy = -dx * sinf(r) + dy * cosf(r);
+}
+
+static void sense(const radar_mount_t* mount, const person_t* people,
+                  int64_t t_us, radar_target_t targets[RADAR_MAX_TARGETS],
+                  report_t* report) {
+  memset(targets, 0, sizeof(radar_target_t) * RADAR_MAX_TARGETS);
+  report->t_us = t_us;
+  report->count = 0;
+  for (int i = 0; i < MAX_PEOPLE; i++) {
+    if (!people[i].present || rand() % 20 == 0) {  // 5% missed detections
+      continue;
+    }
+    float sx, sy;
+    to_sensor(mount, people[i].x, people[i].y, &sx, &sy);
+    float angle = atan2f(sx, sy) * 180.0f / 3.14159265f;
+    if (sy <= 0.0f || hypotf(sx, sy) > RANGE_MM || fabsf(angle) > FOV_DEG) {
+      continue;
+    }
+    size_t k = report->count++;
+    set_target(&targets[k], sx + uniform(-NOISE_MM, NOISE_MM),
+               sy + uniform(-NOISE_MM, NOISE_MM));
+    targets[k].speed = people[i].speed_mm_s / 10.0f;
+    report->person[k] = i;
+    report->x[k] = people[i].x;
+    report->y[k] = people[i].y;
+  }
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Check one merge against the fresh reports
+static void check_merge(const radar_fusion_t* fusion, const report_t* reports,
+                        int64_t now_us, const radar_fused_target_t* out,
+                        size_t count, stream_result_t* r) {
+  float expect_x[MAX_PEOPLE] = {0};
+  float expect_y[MAX_PEOPLE] = {0};
+  int seen[MAX_PEOPLE] = {0};
+  int64_t oldest = now_us;
+  int64_t newest = 0;
+
+  for (size_t s = 0; s < fusion->sensor_count; s++) {
+    const report_t* rep = &reports[s];
+    bool fresh = rep->t_us != 0 && now_us - rep->t_us <= fusion->max_age_us;
+    if (!fresh) {
+      // Nothing may come from a stale radar
+      r->stale_checks++;
+      for (size_t i = 0; i < count; i++) {
+        if (out[i].sensor_mask & (1u << s)) {
+          r->stale_errors++;
+          break;
+        }
+      }
+      continue;
+    }
+    oldest = rep->t_us < oldest ? rep->t_us : oldest;
+    newest = rep->t_us > newest ? rep->t_us : newest;
+    for (size_t k = 0; k < rep->count; k++) {
+      int p = rep->person[k];
+      expect_x[p] += rep->x[k];
+      expect_y[p] += rep->y[k];
+      seen[p]++;
+    }
+  }
+
+  int expected = 0;
+  bool apart = true;
+  for (int p = 0; p < MAX_PEOPLE; p++) {
+    if (!seen[p]) {
+      continue;
+    }
+    expected++;
+    expect_x[p] /= seen[p];
+    expect_y[p] /= seen[p];
+    for (int q = 0; q < p; q++) {
+      if (seen[q] && hypotf(expect_x[p] - expect_x[q],
+                            expect_y[p] - expect_y[q]) <
+                         2.0f * fusion->merge_radius_mm) {
+        apart = false;
+      }
+    }
+  }
+
+  // Count and centroid are only defined while people are clearly apart and
+  // the radars' frames are close in time (a person moves between frames)
+  if (!apart || newest - oldest > 2 * FRAME_MS * 1000) {
+    return;
+  }
+  r->count_checks++;
+  if ((int)count != expected) {
+    r->count_errors++;
+  }
+
+  for (int p = 0; p < MAX_PEOPLE; p++) {
+    if (!seen[p]) {
+      continue;
+    }
+    float best = INFINITY;
+    for (size_t i = 0; i < count; i++) {
+      float d = hypotf(out[i].x - expect_x[p], out[i].y - expect_y[p]);
+      best = d < best ? d : best;
+    }
+    r->positions++;
+    if (best > POSITION_TOLERANCE_MM) {
+      r->position_errors++;
+    } else {
+      r->error_sum_mm += best;
+      r->error_max_mm = best > r->error_max_mm ? best : r->error_max_mm;
+    }
+  }
+}
+
+static void run_streams(float merge_mm, int64_t max_age_us,
+                        stream_result_t* r) {
+  // Radars on opposite walls, facing each other
+  const radar_mount_t mounts[2] = {
+      {0.0f, 0.0f, 0.0f},
+      {0.0f, ROOM_DEPTH_MM, 180.0f},
+  };
+  radar_fusion_t fusion;
+  radar_fusion_init(&fusion, merge_mm, max_age_us);
+  for (int s = 0; s < 2; s++) {
+    radar_fusion_add_sensor(&fusion, &mounts[s]);
+  }
+
+  person_t people[MAX_PEOPLE];
+  memset(people, 0, sizeof(people));
+  report_t reports[2];
+  memset(reports, 0, sizeof(reports));
+  memset(r, 0, sizeof(*r));
+  srand(1);
+
+  // Radar 2 runs half a frame behind radar 1; people move every 50 ms
+  for (int64_t t_ms = 50; t_ms <= (int64_t)STREAM_S * 1000; t_ms += 50) {
+    for (int i = 0; i < MAX_PEOPLE; i++) {
+      walk(&people[i], 0.05f);
+    }
+    int s = (t_ms / 50) % 2;
+    if (s == 1 && t_ms % DROPOUT_EVERY_MS < DROPOUT_MS) {
+      continue;
+    }
+    int64_t t_us = t_ms * 1000;
+    radar_target_t targets[RADAR_MAX_TARGETS];
+    sense(&mounts[s], people, t_us, targets, &reports[s]);
+
+    radar_fused_target_t out[RADAR_FUSION_MAX_TARGETS];
+    double start = now_ns();
+    radar_fusion_update(&fusion, s, targets, t_us);
+    size_t count =
+        radar_fusion_merge(&fusion, t_us, out, RADAR_FUSION_MAX_TARGETS);
+    r->merge_ns += now_ns() - start;
+    r->merges++;
+    check_merge(&fusion, reports, t_us, out, count, r);
+  }
+}
+
+// --- Capture ---------------------------------------------------------------
+
+static int replay_capture(FILE* f, const radar_mount_t* mounts,
+                          size_t mount_count, float merge_mm,
+                          int64_t max_age_us) {
+  radar_fusion_t fusion;
+  radar_fusion_init(&fusion, merge_mm, max_age_us);
+  for (size_t s = 0; s < mount_count; s++) {
+    radar_fusion_add_sensor(&fusion, &mounts[s]);
+  }
+
+  uint64_t frames = 0;
+  uint64_t targets_in = 0;
+  uint64_t targets_out = 0;
+  uint64_t merged = 0;
+  long long t_ms;
+  unsigned radar;
+  unsigned count;
+  while (fscanf(f, "%lld %u %u", &t_ms, &radar, &count) == 3) {
+    radar_target_t targets[RADAR_MAX_TARGETS];
+    memset(targets, 0, sizeof(targets));
+    for (unsigned i = 0; i < count; i++) {
+      float x, y, speed;
+      if (fscanf(f, "%f %f %f", &x, &y, &speed) != 3) {
+        fprintf(stderr, "truncated frame at %lld ms\n", t_ms);
+        return 1;
+      }
+      if (i < RADAR_MAX_TARGETS) {
+        set_target(&targets[i], x, y);
+        targets[i].speed = speed;
+      }
+    }
+    if (radar >= mount_count) {
+      fprintf(stderr, "radar %u at %lld ms has no mount (-s)\n", radar, t_ms);
+      return 1;
+    }
+
+    int64_t t_us = t_ms * 1000;
+    radar_fused_target_t out[RADAR_FUSION_MAX_TARGETS];
+    radar_fusion_update(&fusion, (int)radar, targets, t_us);
+    size_t n = radar_fusion_merge(&fusion, t_us, out, RADAR_FUSION_MAX_TARGETS);
+
+    printf("%lld %zu", t_ms, n);
+    for (size_t i = 0; i < n; i++) {
+      printf(" %.0f %.0f %.1f", out[i].x, out[i].y, out[i].speed);
+      if (out[i].sensor_mask & (out[i].sensor_mask - 1)) {
+        merged++;
+      }
+    }
+    printf("\n");
+    frames++;
+    targets_in += count < RADAR_MAX_TARGETS ? count : RADAR_MAX_TARGETS;
+    targets_out += n;
+  }
+  fprintf(stderr,
+          "%llu radar frames, %llu targets in, %llu fused targets out, "
+          "%llu seen by several radars\n",
+          (unsigned long long)frames, (unsigned long long)targets_in,
+          (unsigned long long)targets_out, (unsigned long long)merged);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  float merge_mm = 500.0f;  // CONFIG_RADAR_FUSION_MERGE_MM default
+  int64_t max_age_us = 500000;  // CONFIG_RADAR_FUSION_MAX_AGE_MS default
+  radar_mount_t mounts[RADAR_FUSION_MAX_SENSORS];
+  size_t mount_count = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:a:s:")) != -1) {
+    switch (opt) {
+      case 'r':
+        merge_mm = strtof(optarg, NULL);
+        break;
+      case 'a':
+        max_age_us = strtoll(optarg, NULL, 10) * 1000;
+        break;
+      case 's': {
+        radar_mount_t* m = &mounts[mount_count];
+        if (mount_count >= RADAR_FUSION_MAX_SENSORS ||
+            sscanf(optarg, "%f,%f,%f", &m->x_mm, &m->y_mm,
+                   &m->rotation_deg) != 3) {
+          fprintf(stderr, "bad or too many mounts: %s\n", optarg);
+          return 2;
+        }
+        mount_count++;
+        break;
+      }
+      default:
+        fprintf(stderr,
+                "usage: %s [-r merge_mm] [-a max_age_ms] [-s x,y,rot]... "
+                "[capture]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+
+  if (optind < argc) {
+    if (mount_count == 0) {
+      fprintf(stderr, "a capture needs one -s mount per radar\n");
+      return 2;
+    }
+    FILE* f = fopen(argv[optind], "r");
+    if (!f) {
+      perror(argv[optind]);
+      return 1;
+    }
+    int ret = replay_capture(f, mounts, mount_count, merge_mm, max_age_us);
+    fclose(f);
+    return ret;
+  }
+
+  run_cases(merge_mm, max_age_us);
+
+  stream_result_t r;
+  run_streams(merge_mm, max_age_us, &r);
+  printf("streams (2 radars, %d s, radar 2 silent %d s of every %d s)\n",
+         STREAM_S, DROPOUT_MS / 1000, DROPOUT_EVERY_MS / 1000);
+  printf("  %llu merges, %.0f ns per update and merge\n",
+         (unsigned long long)r.merges, r.merges ? r.merge_ns / r.merges : 0.0);
+  printf("  target count: %llu of %llu checked merges wrong\n",
+         (unsigned long long)r.count_errors,
+         (unsigned long long)r.count_checks);
+  printf("  position: %llu of %llu people off by more than %.0f mm, "
+         "mean %.0f mm, max %.0f mm\n",
+         (unsigned long long)r.position_errors,
+         (unsigned long long)r.positions, POSITION_TOLERANCE_MM,
+         r.positions > r.position_errors
+             ? r.error_sum_mm / (double)(r.positions - r.position_errors)
+             : 0.0,
+         r.error_max_mm);
+  printf("  stale radar: %llu of %llu merges kept its targets\n",
+         (unsigned long long)r.stale_errors,
+         (unsigned long long)r.stale_checks);
+  if (r.count_errors || r.position_errors || r.stale_errors ||
+      r.count_checks == 0 || r.stale_checks == 0) {
+    s_failures++;
+  }
+
+  printf("%s\n", s_failures ? "FAIL" : "PASS");
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Host benchmark for the occupancy heatmap: grid footprint, per-frame update
+ * cost, decay and export cost, and export size for a synthetic day of
+ * 10 Hz frames with one to three people moving between a few hot spots.
+ * The RLE export is decoded again and compared with the grid.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o heatmap_bench tools/heatmap_bench/heatmap_bench.c \
+ *       components/occupancy/heatmap.c \
+ *       -Icomponents/occupancy/include -Icomponents/radar_sensor/include
+ *   ./heatmap_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "heatmap.h"
+
+#define FRAMES (24 * 3600 * 10)
+#define EXPORT_BUF 8192
+
+static heatmap_t s_map;
+static char s_export[EXPORT_BUF];
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Parse the cells field back into levels and compare with the grid
+static int verify_export(const heatmap_t* map, const char* body) {
+  const char* p = strstr(body, "cells=");
+  if (!p) {
+    return -1;
+  }
+  p += 6;
+  uint16_t peak = heatmap_max(map);
+  size_t i = 0;
+  while (*p && i <= HEATMAP_CELLS) {
+    char* end;
+    unsigned long level = strtoul(p, &end, 10);
+    unsigned long run = 1;
+    if (*end == '*') {
+      run = strtoul(end + 1, &end, 10);
+    }
+    for (unsigned long r = 0; r < run; r++, i++) {
+      uint16_t v = i < HEATMAP_CELLS ? map->cells[i] : 0;
+      unsigned long expect =
+          v == 0 ? 0 : (unsigned long)v * (HEATMAP_EXPORT_LEVELS - 1) / peak;
+      if (v != 0 && expect == 0) {
+        expect = 1;
+      }
+      if (i >= HEATMAP_CELLS || expect != level) {
+        return -1;
+      }
+    }
+    p = *end == '.' ? end + 1 : end;
+  }
+  return i == HEATMAP_CELLS ? 0 : -1;
+}
+
+int main(void) {
+  static const float spots[][2] = {
+      {-1500, 1200}, {800, 2500}, {2000, 4500}, {0, 800}};
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+
+  srand(7);
+  heatmap_reset(&s_map);
+
+  double update_ns = 0;
+  double worst_ns = 0;
+  for (int f = 0; f < FRAMES; f++) {
+    size_t count = 1 + (size_t)((f / 3000) % 3);
+    for (size_t t = 0; t < count; t++) {
+      const float* spot = spots[(f / 6000 + t) % 4];
+      targets[t].x = spot[0] + (float)(rand() % 1200 - 600);
+      targets[t].y = spot[1] + (float)(rand() % 1200 - 600);
+      targets[t].speed = 0;
+      targets[t].sensor_mask = 1;
+    }
+
+    double start = now_ns();
+    heatmap_add(&s_map, targets, count);
+    double elapsed = now_ns() - start;
+    update_ns += elapsed;
+    if (elapsed > worst_ns) {
+      worst_ns = elapsed;
+    }
+  }
+
+  double start = now_ns();
+  int len = heatmap_export(&s_map, s_export, sizeof(s_export));
+  double export_ns = now_ns() - start;
+
+  int ok = len > 0 && verify_export(&s_map, s_export) == 0;
+  uint32_t samples = s_map.samples;
+
+  start = now_ns();
+  heatmap_decay(&s_map, 1);
+  double decay_ns = now_ns() - start;
+
+  printf("Grid: %d x %d cells of %d mm, %zu bytes\n", HEATMAP_COLS,
+         HEATMAP_ROWS, HEATMAP_CELL_MM, sizeof(heatmap_t));
+  // Worst case includes host scheduler noise; the mean is the real cost
+  printf("Update: %.1f ns mean, %.0f ns worst (%d frames, %u samples, %u "
+         "out of range)\n",
+         update_ns / FRAMES, worst_ns, FRAMES, (unsigned)samples,
+         (unsigned)s_map.out_of_range);
+  printf("Decay: %.1f us, export: %.1f us, %d bytes (raw grid %zu)\n",
+         decay_ns / 1000, export_ns / 1000, len, sizeof(s_map.cells));
+  printf("Export round trip: %s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
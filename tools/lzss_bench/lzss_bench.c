@@ -0,0 +1,176 @@
+/*
+ * Host benchmark for compressed upload bodies: compression ratio and CPU
+ * time of the streaming LZSS + base64url path, and the resulting upload
+ * time on a slow link, for two batches:
+ *   heatmap   the export of a synthetic day (as in tools/heatmap_bench),
+ *             streamed from the grid straight into the encoder
+ *   rows      32 occupancy summary rows, as a multi-row upload would
+ *             carry them
+ * Each body is decoded again (base64url, then LZSS, as appscript.js does)
+ * and compared with the uncompressed text.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o lzss_bench tools/lzss_bench/lzss_bench.c \
+ *       components/uplink/lzss.c components/occupancy/heatmap.c \
+ *       -Icomponents/uplink/include -Icomponents/occupancy/include \
+ *       -Icomponents/radar_sensor/include
+ *   ./lzss_bench [link_kbit_s] [rtt_ms]
+ *
+ * Upload time is modelled as one RTT plus the body at the link rate
+ * (defaults 250 kbit/s and 300 ms, a weak WiFi link to Google).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "heatmap.h"
+#include "lzss.h"
+
+#define FRAMES (24 * 3600 * 10)
+#define BODY_MAX 16384
+#define ROWS 32
+#define RUNS 200
+
+static heatmap_t s_map;
+static lzss_encoder_t s_enc;
+static char s_raw[BODY_MAX];
+static char s_z[BODY_MAX * 2];
+static uint8_t s_bin[BODY_MAX * 2];
+static char s_decoded[BODY_MAX];
+static double s_link_kbit_s = 250;
+static double s_rtt_ms = 300;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fill_heatmap(void) {
+  static const float spots[][2] = {
+      {-1500, 1200}, {800, 2500}, {2000, 4500}, {0, 800}};
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+  srand(7);
+  heatmap_reset(&s_map);
+  for (int f = 0; f < FRAMES; f++) {
+    size_t count = 1 + (size_t)((f / 3000) % 3);
+    for (size_t t = 0; t < count; t++) {
+      const float* spot = spots[(f / 6000 + t) % 4];
+      targets[t].x = spot[0] + (float)(rand() % 1200 - 600);
+      targets[t].y = spot[1] + (float)(rand() % 1200 - 600);
+      targets[t].speed = 0;
+      targets[t].sensor_mask = 1;
+    }
+    heatmap_add(&s_map, targets, count);
+  }
+}
+
+// Rows in the occupancy_format() layout with plausible, varying values
+static int build_rows(char* buf, size_t len) {
+  size_t used = 0;
+  srand(11);
+  for (int r = 0; r < ROWS; r++) {
+    int frames = 2900 + rand() % 100;
+    int n = snprintf(
+        buf + used, len - used,
+        "%stype=summary&up=%d&dur=300&frames=%d&occ_s=%d&entries=%d"
+        "&tmean=%.2f&tmax=%d&dmin=%d&dmean=%d&dmax=%d"
+        "&smin=%.1f&smean=%.1f&smax=%.1f&r1_s=%d&r2_s=%d",
+        r ? "\n" : "", 3600 + r * 300, frames, 120 + rand() % 180,
+        rand() % 4, (rand() % 300) / 100.0, 1 + rand() % 3,
+        400 + rand() % 400, 1500 + rand() % 2000, 4000 + rand() % 2000,
+        0.0, (rand() % 400) / 10.0, (rand() % 1500) / 10.0,
+        150 + rand() % 150, rand() % 300);
+    if (n < 0 || used + (size_t)n >= len) {
+      return -1;
+    }
+    used += (size_t)n;
+  }
+  return (int)used;
+}
+
+static bool heatmap_to_lzss(void* ctx, const char* text, size_t len) {
+  return lzss_encoder_write((lzss_encoder_t*)ctx, text, len);
+}
+
+static bool text_to_lzss(const char* text, void* ctx) {
+  return lzss_encoder_write((lzss_encoder_t*)ctx, text, strlen(text));
+}
+
+// Inverse of lzss_b64_sink, as Utilities.base64DecodeWebSafe does it
+static int b64_decode(const char* in, uint8_t* out) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  uint32_t v = 0;
+  int bits = 0;
+  int used = 0;
+  for (; *in; in++) {
+    const char* at = strchr(alphabet, *in);
+    if (!at) {
+      return -1;
+    }
+    v = v << 6 | (uint32_t)(at - alphabet);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out[used++] = (uint8_t)(v >> bits);
+    }
+  }
+  return used;
+}
+
+static double upload_ms(size_t bytes) {
+  return s_rtt_ms + (double)bytes * 8 / s_link_kbit_s;
+}
+
+// Compress one batch RUNS times, check the round trip and print the row
+static int report(const char* name, const char* raw, size_t raw_len,
+                  bool from_heatmap) {
+  lzss_b64_writer_t out;
+  int z_len = -1;
+  double start = now_ns();
+  for (int r = 0; r < RUNS; r++) {
+    lzss_b64_init(&out, s_z, sizeof(s_z));
+    lzss_encoder_init(&s_enc, lzss_b64_sink, &out);
+    bool ok = from_heatmap
+                  ? heatmap_export_stream(&s_map, heatmap_to_lzss, &s_enc)
+                  : text_to_lzss(raw, &s_enc);
+    z_len = ok && lzss_encoder_finish(&s_enc) ? lzss_b64_finish(&out) : -1;
+  }
+  double encode_us = (now_ns() - start) / RUNS / 1000;
+
+  int bin_len = z_len > 0 ? b64_decode(s_z, s_bin) : -1;
+  int dec_len = bin_len > 0 ? lzss_decode(s_bin, (size_t)bin_len,
+                                          (uint8_t*)s_decoded,
+                                          sizeof(s_decoded) - 1)
+                            : -1;
+  bool ok = dec_len == (int)raw_len && memcmp(s_decoded, raw, raw_len) == 0;
+
+  printf("%-8s raw %5zu B  lzss %5u B (%.2fx)  base64url %5d B (%.2fx)  "
+         "%6.1f us  upload %5.0f -> %5.0f ms  %s\n",
+         name, raw_len, (unsigned)s_enc.out_bytes,
+         (double)raw_len / s_enc.out_bytes, z_len, (double)raw_len / z_len,
+         encode_us, upload_ms(raw_len), upload_ms((size_t)z_len),
+         ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) s_link_kbit_s = atof(argv[1]);
+  if (argc > 2) s_rtt_ms = atof(argv[2]);
+
+  printf("Encoder state %zu bytes, window %d, link %.0f kbit/s, RTT %.0f "
+         "ms\n",
+         sizeof(lzss_encoder_t), LZSS_WINDOW, s_link_kbit_s, s_rtt_ms);
+
+  fill_heatmap();
+  int len = heatmap_export(&s_map, s_raw, sizeof(s_raw));
+  int failures = len > 0 ? report("heatmap", s_raw, (size_t)len, true) : 1;
+
+  len = build_rows(s_raw, sizeof(s_raw));
+  failures += len > 0 ? report("rows", s_raw, (size_t)len, false) : 1;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Replays a radar capture through the occupancy aggregator and checks every
+ * interval against a brute-force reference that walks the timeline in 1 ms
+ * steps and recomputes the statistics from the stored frames.
+ *
+ * Capture format, one frame per line (relays follow presence like the
+ * sensor task does):
+ *
+ *   <time_ms> <count> [<x_mm> <y_mm> <speed_cm_s>] * count
+ *
+ * Without a capture file a synthetic day with gaps and dropouts is used.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o occupancy_replay tools/occupancy_replay/occupancy_replay.c \
+ *       components/occupancy/occupancy.c \
+ *       -Icomponents/occupancy/include -Icomponents/radar_sensor/include -lm
+ *   ./occupancy_replay [capture.txt] [interval_s]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "occupancy.h"
+
+#define MAX_GAP_MS 2000
+#define MAX_FRAMES 200000
+
+typedef struct {
+  int64_t t_ms;
+  size_t count;
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+} frame_t;
+
+static frame_t s_frames[MAX_FRAMES];
+static size_t s_frame_count;
+
+static void load_capture(FILE* f) {
+  while (s_frame_count < MAX_FRAMES) {
+    frame_t* fr = &s_frames[s_frame_count];
+    long long t;
+    unsigned count;
+    if (fscanf(f, "%lld %u", &t, &count) != 2) {
+      break;
+    }
+    fr->t_ms = t;
+    fr->count = count > RADAR_FUSION_MAX_TARGETS ? RADAR_FUSION_MAX_TARGETS
+                                                 : count;
+    for (unsigned i = 0; i < count; i++) {
+      float x, y, speed;
+      if (fscanf(f, "%f %f %f", &x, &y, &speed) != 3) {
+        return;
+      }
+      if (i < fr->count) {
+        fr->targets[i] = (radar_fused_target_t){x, y, speed, 1};
+      }
+    }
+    s_frame_count++;
+  }
+}
+
+// 10 Hz frames, visits of random length, occasional 5 s radar dropouts
+static void synthesize(void) {
+  srand(1);
+  int64_t t_ms = 0;
+  size_t people = 0;
+  while (s_frame_count < MAX_FRAMES) {
+    t_ms += 100;
+    if (rand() % 2000 == 0) {
+      t_ms += 5000;
+    }
+    if (rand() % 300 == 0) {
+      people = (size_t)(rand() % 4);
+    }
+    frame_t* fr = &s_frames[s_frame_count++];
+    fr->t_ms = t_ms;
+    fr->count = people;
+    for (size_t i = 0; i < people; i++) {
+      fr->targets[i] = (radar_fused_target_t){
+          (float)(rand() % 4000 - 2000), (float)(rand() % 5000),
+          (float)(rand() % 120 - 60), 1};
+    }
+  }
+}
+
+static bool near(float a, float b, float tolerance) {
+  return fabsf(a - b) <= tolerance;
+}
+
+// Frames in [start_ms, end_ms) plus the last frame before start_ms, which
+// decides the state at the start of the interval
+static bool check_interval(const occupancy_summary_t* s, size_t first,
+                           size_t end, int64_t start_ms, int64_t end_ms) {
+  occupancy_summary_t ref;
+  memset(&ref, 0, sizeof(ref));
+
+  bool prev_occupied = first > 0 && s_frames[first - 1].count > 0;
+  for (size_t i = first; i < end; i++) {
+    const frame_t* fr = &s_frames[i];
+    ref.frames++;
+    ref.target_sum += (uint32_t)fr->count;
+    if (fr->count > ref.target_max) {
+      ref.target_max = (uint32_t)fr->count;
+    }
+    if (fr->count > 0 && !prev_occupied) {
+      ref.entries++;
+    }
+    prev_occupied = fr->count > 0;
+    for (size_t t = 0; t < fr->count; t++) {
+      float d = sqrtf(fr->targets[t].x * fr->targets[t].x +
+                      fr->targets[t].y * fr->targets[t].y);
+      float v = fabsf(fr->targets[t].speed);
+      if (ref.samples == 0 || d < ref.distance_min_mm) ref.distance_min_mm = d;
+      if (ref.samples == 0 || d > ref.distance_max_mm) ref.distance_max_mm = d;
+      if (ref.samples == 0 || v < ref.speed_min) ref.speed_min = v;
+      if (ref.samples == 0 || v > ref.speed_max) ref.speed_max = v;
+      ref.distance_sum_mm += d;
+      ref.speed_sum += v;
+      ref.samples++;
+    }
+  }
+
+  // Walk the interval in 1 ms steps: occupied while the latest frame saw
+  // someone and is at most MAX_GAP_MS old; relays follow the latest frame
+  size_t cursor = first > 0 ? first - 1 : 0;
+  bool have_frame = first > 0;
+  for (int64_t t = start_ms; t < end_ms; t++) {
+    while (cursor + 1 < s_frame_count && s_frames[cursor + 1].t_ms <= t) {
+      cursor++;
+      have_frame = true;
+    }
+    if (!have_frame && s_frames[0].t_ms <= t) {
+      have_frame = true;
+    }
+    if (!have_frame) {
+      continue;
+    }
+    const frame_t* fr = &s_frames[cursor];
+    if (fr->count > 0 && t - fr->t_ms < MAX_GAP_MS) {
+      ref.occupied_ms++;
+    }
+    if (fr->count > 0) {
+      ref.relay_on_ms[0]++;
+    }
+  }
+
+  bool ok = s->frames == ref.frames && s->entries == ref.entries &&
+            s->target_sum == ref.target_sum &&
+            s->target_max == ref.target_max && s->samples == ref.samples &&
+            s->occupied_ms + 1 >= ref.occupied_ms &&
+            s->occupied_ms <= ref.occupied_ms + 1 &&
+            s->relay_on_ms[0] + 1 >= ref.relay_on_ms[0] &&
+            s->relay_on_ms[0] <= ref.relay_on_ms[0] + 1 &&
+            s->relay_on_ms[0] == s->relay_on_ms[1];
+  if (ref.samples > 0) {
+    ok = ok && near(s->distance_min_mm, ref.distance_min_mm, 0.01f) &&
+         near(s->distance_max_mm, ref.distance_max_mm, 0.01f) &&
+         near(s->speed_min, ref.speed_min, 0.01f) &&
+         near(s->speed_max, ref.speed_max, 0.01f) &&
+         near(s->distance_sum_mm / s->samples,
+              ref.distance_sum_mm / ref.samples, 0.5f) &&
+         near(s->speed_sum / s->samples, ref.speed_sum / ref.samples, 0.05f);
+  }
+
+  if (!ok) {
+    printf("MISMATCH at %lld ms: frames %u/%u entries %u/%u occupied %u/%u "
+           "relay %u/%u\n",
+           (long long)start_ms, (unsigned)s->frames, (unsigned)ref.frames,
+           (unsigned)s->entries, (unsigned)ref.entries,
+           (unsigned)s->occupied_ms, (unsigned)ref.occupied_ms,
+           (unsigned)s->relay_on_ms[0], (unsigned)ref.relay_on_ms[0]);
+  }
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int64_t interval_ms = (argc > 2 ? atoll(argv[2]) : 300) * 1000;
+  if (argc > 1 && strcmp(argv[1], "-") != 0) {
+    FILE* f = fopen(argv[1], "r");
+    if (!f) {
+      perror(argv[1]);
+      return 2;
+    }
+    load_capture(f);
+    fclose(f);
+  } else {
+    synthesize();
+  }
+  if (s_frame_count == 0 || interval_ms <= 0) {
+    fprintf(stderr, "No frames\n");
+    return 2;
+  }
+
+  occupancy_t occ;
+  int64_t start_ms = s_frames[0].t_ms;
+  occupancy_init(&occ, start_ms * 1000, MAX_GAP_MS * 1000LL);
+
+  size_t interval_first = 0;
+  unsigned intervals = 0, failures = 0;
+  char body[320];
+
+  for (size_t i = 0; i <= s_frame_count; i++) {
+    int64_t t_ms = i < s_frame_count ? s_frames[i].t_ms : INT64_MAX;
+
+    // Close every interval that ended before this frame, as the sensor
+    // task does on its periodic check
+    while (t_ms >= start_ms + interval_ms &&
+           (i < s_frame_count || interval_first < s_frame_count)) {
+      occupancy_summary_t summary;
+      int64_t end_ms = start_ms + interval_ms;
+      occupancy_close(&occ, end_ms * 1000, &summary);
+      if (!check_interval(&summary, interval_first, i, start_ms, end_ms)) {
+        failures++;
+      }
+      if (intervals < 3) {
+        occupancy_format(&summary, body, sizeof(body));
+        printf("%s\n", body);
+      }
+      intervals++;
+      interval_first = i;
+      start_ms = end_ms;
+      if (i == s_frame_count) {
+        break;
+      }
+    }
+    if (i == s_frame_count) {
+      break;
+    }
+
+    const frame_t* fr = &s_frames[i];
+    occupancy_update(&occ, fr->targets, fr->count, fr->t_ms * 1000);
+    for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+      occupancy_set_relay(&occ, ch, fr->count > 0, fr->t_ms * 1000);
+    }
+  }
+
+  printf("%zu frames, %u intervals checked, %u mismatches\n", s_frame_count,
+         intervals, failures);
+  return failures ? 1 : 0;
+}
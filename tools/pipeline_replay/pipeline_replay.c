@@ -0,0 +1,793 @@
+/*
+ * Host replay of the dual-core pipeline (main/radar_reader.c, the sensor
+ * and aggregator tasks in main/main.c) on pthreads, to show how much of
+ * each core the frame path takes and how much is left at higher frame
+ * rates.
+ *
+ * Core 1 threads, pinned to host CPU 1 where there is one:
+ *   reader      frames each radar's bytes, decodes the report, fuses all
+ *               radars, filters clutter, follows doorway approaches,
+ *               posts the frame to Core 0 and publishes the view
+ *   sensor      woken per view: presence decision, relay "GPIO" write and
+ *               a relay change posted to Core 0
+ * Core 0 threads, pinned to host CPU 0:
+ *   aggregator  drains both handoff rings (components/handoff) in
+ *               timestamp order into the heatmap and occupancy summary and
+ *               queues relay transitions and summaries (components/uplink)
+ *   uploader    formats each queued item, holds it for a simulated round
+ *               trip and pops it
+ *
+ * The radar bytes are LD2450 reports of up to three people walking through
+ * a 4 x 6 m room (none, one, three and two people in turn, two seconds
+ * each), as every radar would see them from its mount. They are built
+ * before the run, and the reader sleeps until each frame's arrival time.
+ *
+ * Every rate in -f runs for -d seconds. Per stage, the busy time of one
+ * call is reported; per core, the stages' share of wall time, multiplied
+ * by -x to estimate the load on the 240 MHz ESP32 (host cores run this
+ * code roughly that much faster). The run passes when no handoff ring
+ * drops a message and the estimated Core 1 load stays below -l percent at
+ * every rate.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o pipeline_replay tools/pipeline_replay/pipeline_replay.c \
+ *       components/handoff/handoff.c components/radar_sensor/radar_frame.c \
+ *       components/radar_sensor/radar_fusion.c \
+ *       components/occupancy/approach.c components/occupancy/clutter.c \
+ *       components/occupancy/heatmap.c components/occupancy/occupancy.c \
+ *       components/uplink/uplink.c -Icomponents/handoff/include \
+ *       -Icomponents/radar_sensor/include -Icomponents/occupancy/include \
+ *       -Icomponents/uplink/include -lpthread -lm
+ *   ./pipeline_replay [options]
+ *
+ *   -f 10,100  frame rates per radar to run (10 Hz is the LD2450's rate)
+ *   -n 2       radars, 1 to 3
+ *   -d 10      seconds per rate
+ *   -x 20      ESP32 slowdown applied to host busy times
+ *   -l 50      highest estimated Core 1 load that passes, percent
+ *   -a 1       occupancy summary interval, seconds
+ *   -r 50      simulated upload round trip, ms
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "approach.h"
+#include "clutter.h"
+#include "handoff.h"
+#include "heatmap.h"
+#include "occupancy.h"
+#include "radar_frame.h"
+#include "radar_fusion.h"
+#include "uplink.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// As in main/main.c
+#define UPLOAD_STATUS 0
+#define UPLOAD_SUMMARY 1
+#define FRAME_SLOTS 32
+#define DECISION_SLOTS 16
+#define AGGREGATOR_POLL_MS 100
+#define UPLOAD_POLL_MS 1000
+#define OCCUPANCY_MAX_GAP_MS 2000
+#define RELAY_ALL 0x03
+
+// Reader defaults from menuconfig and app_config
+#define FUSION_MERGE_MM 500
+#define FUSION_MAX_AGE_MS 500
+#define CLUTTER_LEARN_S 1200
+#define CLUTTER_FORGET_S 3600
+#define CLUTTER_MOTION_CM_S 15
+#define APPROACH_MIN_SPEED_CM_S 40
+#define APPROACH_CONFIRM_FRAMES 3
+
+#define FRAME_BYTES 30
+#define MAX_RATES 8
+#define DRAIN_MS 300
+
+typedef enum {
+  STAGE_FRAME,      // Byte loop up to a complete report
+  STAGE_DECODE,     // Report payload -> targets
+  STAGE_TRACK,      // Fusion, clutter, approach, handoff post, publish
+  STAGE_DECIDE,     // Sensor iteration
+  STAGE_AGGREGATE,  // One handed-off message, or closing a summary
+  STAGE_FORMAT,     // Upload body of one queued item
+  STAGE_COUNT,
+} stage_t;
+
+static const char* const s_stage_names[STAGE_COUNT] = {
+    "frame", "decode", "track", "decide", "aggregate", "format"};
+static const int s_stage_core[STAGE_COUNT] = {1, 1, 1, 1, 0, 0};
+
+// Durations in ns, each series written by one thread
+typedef struct {
+  uint32_t* v;
+  size_t n;
+  size_t cap;
+  uint64_t sum;
+} samples_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  unsigned count;
+} notify_t;
+
+// Published view, as radar_reader_get_view() copies it
+typedef struct {
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+  size_t count;
+  uint32_t sequence;
+  int64_t frame_timestamp_us;
+  uint8_t approach_mask;
+} view_t;
+
+typedef struct {
+  int64_t frame_timestamp_us;
+  int64_t posted_us;
+  size_t count;
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+} frame_msg_t;
+
+typedef struct {
+  int64_t timestamp_us;
+  int64_t posted_us;
+  uint8_t relay_mask;
+} decision_t;
+
+// One radar report on the replay timeline
+typedef struct {
+  int64_t at_us;  // Offset from the start of the run
+  uint8_t radar;
+  uint8_t bytes[FRAME_BYTES];
+} event_t;
+
+static const radar_mount_t s_mounts[RADAR_FUSION_MAX_SENSORS] = {
+    {0.0f, 0.0f, 0.0f},
+    {0.0f, 6000.0f, 180.0f},
+    {-2000.0f, 3000.0f, -90.0f},
+};
+
+static const approach_entry_t s_door = {0.0f, 4500.0f, 180.0f, 1000.0f,
+                                        0x01};
+
+// Options
+static int s_rates[MAX_RATES] = {10, 100};
+static int s_rate_count = 2;
+static int s_radars = 2;
+static int s_seconds = 10;
+static double s_scale = 20.0;
+static double s_load_limit = 50.0;
+static int s_summary_s = 1;
+static int s_rtt_ms = 50;
+
+// Run state
+static event_t* s_events;
+static size_t s_event_count;
+static int64_t s_start_us;
+static volatile int s_running;
+static samples_t s_stage[STAGE_COUNT];
+static samples_t s_handoff;  // Post -> pickup
+static samples_t s_latency;  // Frame arrival -> relay written
+
+static handoff_t s_frame_ring;
+static handoff_t s_decision_ring;
+static frame_msg_t s_frame_slots[FRAME_SLOTS];
+static decision_t s_decision_slots[DECISION_SLOTS];
+static notify_t s_sensor_wake;
+static notify_t s_aggregator_wake;
+static notify_t s_uploader_wake;
+
+static view_t s_view;
+static pthread_mutex_t s_view_lock = PTHREAD_MUTEX_INITIALIZER;
+static heatmap_t s_heatmap;
+static pthread_mutex_t s_heatmap_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_uplink_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static volatile uint8_t s_gpio;  // Relay pins as the sensor thread left them
+static uint32_t s_views_missed;
+static uint32_t s_relay_changes;
+static uint32_t s_decisions_lost;  // Waiting changes replaced by newer ones
+static uint32_t s_summaries;
+static uint32_t s_uploads;
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t now_us(void) { return now_ns() / 1000; }
+
+static void sleep_until_us(int64_t t_us) {
+  struct timespec ts = {t_us / 1000000, (t_us % 1000000) * 1000};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+  }
+}
+
+static void samples_init(samples_t* s, size_t cap) {
+  free(s->v);
+  s->v = malloc(cap * sizeof(*s->v));
+  s->cap = cap;
+  s->n = 0;
+  s->sum = 0;
+  if (!s->v) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+}
+
+static void samples_add(samples_t* s, int64_t value) {
+  uint32_t v = value < 0 ? 0 : value > UINT32_MAX ? UINT32_MAX
+                                                  : (uint32_t)value;
+  s->sum += v;
+  if (s->n < s->cap) {
+    s->v[s->n++] = v;
+  }
+}
+
+static int cmp_u32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+// Sorts the series in place
+static double percentile(samples_t* s, int pct) {
+  if (s->n == 0) {
+    return 0.0;
+  }
+  qsort(s->v, s->n, sizeof(*s->v), cmp_u32);
+  size_t i = (s->n - 1) * (size_t)pct / 100;
+  return s->v[i];
+}
+
+static void notify_init(notify_t* n) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&n->lock, NULL);
+  pthread_cond_init(&n->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  n->count = 0;
+}
+
+// xTaskNotifyGive()
+static void notify_give(notify_t* n) {
+  pthread_mutex_lock(&n->lock);
+  n->count++;
+  pthread_cond_signal(&n->cond);
+  pthread_mutex_unlock(&n->lock);
+}
+
+// ulTaskNotifyTake(pdTRUE, timeout)
+static void notify_take(notify_t* n, int timeout_ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += timeout_ms / 1000;
+  ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  pthread_mutex_lock(&n->lock);
+  while (n->count == 0 && s_running) {
+    if (pthread_cond_timedwait(&n->cond, &n->lock, &ts) != 0) {
+      break;
+    }
+  }
+  n->count = 0;
+  pthread_mutex_unlock(&n->lock);
+}
+
+static bool pin_to(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// --- Synthetic radar stream ------------------------------------------------
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+// Sign-magnitude as the module sends it (bit 15 = negative here)
+static uint16_t sign_mag(float v) {
+  int i = (int)lrintf(v);
+  if (i > 0x7fff) {
+    i = 0x7fff;
+  } else if (i < -0x7fff) {
+    i = -0x7fff;
+  }
+  return i < 0 ? (uint16_t)(0x8000 | -i) : (uint16_t)i;
+}
+
+// People in the room at t seconds: positions and speed along the path
+static int people_at(double t, float* x, float* y, float* speed) {
+  static const int schedule[] = {0, 1, 3, 2};
+  int count = schedule[(int)(t / 2.0) % 4];
+  for (int i = 0; i < count; i++) {
+    double w = 0.6 + 0.15 * i;
+    double phase = 2.1 * i;
+    x[i] = (float)(1500.0 * sin(w * t + phase));
+    y[i] = (float)(3000.0 + 2000.0 * sin(1.3 * w * t + phase));
+    double vx = 1500.0 * w * cos(w * t + phase);
+    double vy = 2000.0 * 1.3 * w * cos(1.3 * w * t + phase);
+    speed[i] = (float)(sqrt(vx * vx + vy * vy) / 10.0);  // cm/s
+  }
+  return count;
+}
+
+// LD2450 report of the people in front of one radar
+static void write_frame(uint8_t* out, const radar_mount_t* mount, double t) {
+  static const uint8_t header[] = {0xAA, 0xFF, 0x03, 0x00};
+  float x[3];
+  float y[3];
+  float speed[3];
+  int people = people_at(t, x, y, speed);
+
+  memcpy(out, header, sizeof(header));
+  uint8_t* payload = out + sizeof(header);
+  memset(payload, 0, 24);
+  float r = mount->rotation_deg * (float)(M_PI / 180.0);
+  float c = cosf(r);
+  float s = sinf(r);
+  int slot = 0;
+  for (int i = 0; i < people && slot < RADAR_MAX_TARGETS; i++) {
+    // Inverse of radar_mount_apply()
+    float dx = x[i] - mount->x_mm;
+    float dy = y[i] - mount->y_mm;
+    float sx = dx * c + dy * s;
+    float sy = -dx * s + dy * c;
+    if (sy < 100.0f) {
+      continue;  // Behind the module
+    }
+    uint8_t* p = payload + slot * 8;
+    put16(p, sign_mag(sx));
+    put16(p + 2, sign_mag(sy));
+    put16(p + 4, sign_mag(speed[i]));
+    put16(p + 6, 360);
+    slot++;
+  }
+  out[28] = 0x55;
+  out[29] = 0xCC;
+}
+
+// Every radar's reports in arrival order, radars evenly staggered
+static void build_stream(int rate) {
+  size_t per_radar = (size_t)rate * (size_t)s_seconds;
+  s_event_count = per_radar * (size_t)s_radars;
+  free(s_events);
+  s_events = malloc(s_event_count * sizeof(*s_events));
+  if (!s_events) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  int64_t period_us = 1000000 / rate;
+  size_t e = 0;
+  for (size_t k = 0; k < per_radar; k++) {
+    for (int r = 0; r < s_radars; r++) {
+      event_t* ev = &s_events[e++];
+      ev->at_us = (int64_t)k * period_us + r * period_us / s_radars;
+      ev->radar = (uint8_t)r;
+      write_frame(ev->bytes, &s_mounts[r], ev->at_us / 1e6);
+    }
+  }
+}
+
+// --- Core 1 ----------------------------------------------------------------
+
+static void* reader_main(void* arg) {
+  (void)arg;
+  pin_to(1);
+  static radar_frame_parser_t parsers[RADAR_FUSION_MAX_SENSORS];
+  static radar_fusion_t fusion;
+  static clutter_t clutter;
+  static approach_t approach;
+  radar_fusion_init(&fusion, FUSION_MERGE_MM, FUSION_MAX_AGE_MS * 1000LL);
+  for (int r = 0; r < s_radars; r++) {
+    radar_frame_reset(&parsers[r]);
+    radar_fusion_add_sensor(&fusion, &s_mounts[r]);
+  }
+  clutter_init(&clutter, CLUTTER_LEARN_S, CLUTTER_FORGET_S,
+               CLUTTER_MOTION_CM_S);
+  approach_init(&approach, &s_door, 1, APPROACH_MIN_SPEED_CM_S,
+                APPROACH_CONFIRM_FRAMES);
+
+  for (size_t e = 0; e < s_event_count && s_running; e++) {
+    const event_t* ev = &s_events[e];
+    int64_t arrival_us = s_start_us + ev->at_us;
+    sleep_until_us(arrival_us);
+
+    int64_t t0 = now_ns();
+    radar_frame_parser_t* parser = &parsers[ev->radar];
+    bool ready = false;
+    for (size_t i = 0; i < FRAME_BYTES; i++) {
+      ready = radar_frame_push(parser, ev->bytes[i]) == RADAR_FRAME_READY;
+    }
+    int64_t t1 = now_ns();
+    samples_add(&s_stage[STAGE_FRAME], t1 - t0);
+    if (!ready) {
+      continue;
+    }
+
+    radar_target_t targets[RADAR_MAX_TARGETS];
+    radar_frame_decode(parser->buffer, targets);
+    int64_t t2 = now_ns();
+    samples_add(&s_stage[STAGE_DECODE], t2 - t1);
+
+    radar_fused_target_t merged[RADAR_FUSION_MAX_TARGETS];
+    radar_fusion_update(&fusion, ev->radar, targets, arrival_us);
+    size_t count = radar_fusion_merge(&fusion, arrival_us, merged,
+                                      RADAR_FUSION_MAX_TARGETS);
+    count = clutter_filter(&clutter, merged, count);
+
+    frame_msg_t* msg = handoff_claim(&s_frame_ring);
+    if (msg) {
+      msg->frame_timestamp_us = arrival_us;
+      msg->count = count;
+      memcpy(msg->targets, merged, count * sizeof(merged[0]));
+      msg->posted_us = now_us();
+      if (handoff_commit(&s_frame_ring) == FRAME_SLOTS / 2) {
+        notify_give(&s_aggregator_wake);
+      }
+    }
+
+    uint8_t approach_mask =
+        approach_update(&approach, merged, count, arrival_us);
+    pthread_mutex_lock(&s_view_lock);
+    memcpy(s_view.targets, merged, count * sizeof(merged[0]));
+    s_view.count = count;
+    s_view.frame_timestamp_us = arrival_us;
+    s_view.approach_mask = approach_mask;
+    s_view.sequence++;
+    pthread_mutex_unlock(&s_view_lock);
+    clutter_sweep(&clutter, arrival_us);
+    samples_add(&s_stage[STAGE_TRACK], now_ns() - t2);
+
+    // Frame driven sensor task
+    notify_give(&s_sensor_wake);
+  }
+  return NULL;
+}
+
+static bool post_decision(uint8_t mask, int64_t timestamp_us) {
+  decision_t* msg = handoff_claim(&s_decision_ring);
+  if (!msg) {
+    return false;
+  }
+  msg->timestamp_us = timestamp_us;
+  msg->relay_mask = mask;
+  msg->posted_us = now_us();
+  handoff_commit(&s_decision_ring);
+  notify_give(&s_aggregator_wake);
+  return true;
+}
+
+static void* sensor_main(void* arg) {
+  (void)arg;
+  pin_to(1);
+  static view_t view;
+  uint32_t seen_sequence = 0;
+  uint8_t mask = 0;
+  uint8_t posted_mask = 0;
+  bool decision_pending = false;
+  uint8_t pending_mask = 0;
+  while (s_running) {
+    notify_take(&s_sensor_wake, 1000);
+    int64_t t0 = now_ns();
+    pthread_mutex_lock(&s_view_lock);
+    memcpy(&view, &s_view, sizeof(view));
+    pthread_mutex_unlock(&s_view_lock);
+    if (view.sequence == seen_sequence) {
+      continue;
+    }
+    s_views_missed += view.sequence - seen_sequence - 1;
+    seen_sequence = view.sequence;
+
+    // Built-in policy: presence drives both channels, an approach its own
+    mask = view.count > 0 ? RELAY_ALL : view.approach_mask;
+    s_gpio = mask;
+    samples_add(&s_latency, now_us() - view.frame_timestamp_us);
+    if (decision_pending && mask != pending_mask) {
+      s_decisions_lost++;
+      decision_pending = false;
+    }
+    if (mask != posted_mask) {
+      if (post_decision(mask, view.frame_timestamp_us)) {
+        posted_mask = mask;
+        decision_pending = false;
+        s_relay_changes++;
+      } else {
+        decision_pending = true;
+        pending_mask = mask;
+      }
+    }
+    samples_add(&s_stage[STAGE_DECIDE], now_ns() - t0);
+  }
+  return NULL;
+}
+
+// --- Core 0 ----------------------------------------------------------------
+
+static void start_interval(occupancy_t* occ, uint8_t mask, int64_t t_us) {
+  occupancy_init(occ, t_us, OCCUPANCY_MAX_GAP_MS * 1000LL);
+  for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+    occupancy_set_relay(occ, ch, (mask >> ch) & 1, t_us);
+  }
+}
+
+static uint32_t frames_dropped(void) {
+  handoff_stats_t stats;
+  handoff_get_stats(&s_frame_ring, &stats);
+  return stats.claim_failures;
+}
+
+static void* aggregator_main(void* arg) {
+  (void)arg;
+  pin_to(0);
+  static occupancy_t occupancy;
+  uint8_t mask = 0;
+  start_interval(&occupancy, mask, now_us());
+  uint32_t dropped_at_start = frames_dropped();
+
+  while (s_running) {
+    while (1) {
+      const frame_msg_t* frame = handoff_peek(&s_frame_ring);
+      const decision_t* decision = handoff_peek(&s_decision_ring);
+      if (!frame && !decision) {
+        break;
+      }
+      int64_t t0 = now_ns();
+      if (decision &&
+          (!frame || decision->timestamp_us <= frame->frame_timestamp_us)) {
+        samples_add(&s_handoff, t0 / 1000 - decision->posted_us);
+        mask = decision->relay_mask;
+        for (int ch = 0; ch < OCCUPANCY_RELAY_CHANNELS; ch++) {
+          occupancy_set_relay(&occupancy, ch, (mask >> ch) & 1,
+                              decision->timestamp_us);
+        }
+        handoff_release(&s_decision_ring);
+        uint8_t status = mask ? 1 : 0;
+        pthread_mutex_lock(&s_uplink_lock);
+        uplink_push(UPLINK_CLASS_STATE, UPLOAD_STATUS, &status,
+                    sizeof(status), t0 / 1000);
+        pthread_mutex_unlock(&s_uplink_lock);
+        notify_give(&s_uploader_wake);
+      } else {
+        samples_add(&s_handoff, t0 / 1000 - frame->posted_us);
+        pthread_mutex_lock(&s_heatmap_lock);
+        heatmap_add(&s_heatmap, frame->targets, frame->count);
+        pthread_mutex_unlock(&s_heatmap_lock);
+        occupancy_update(&occupancy, frame->targets, frame->count,
+                         frame->frame_timestamp_us);
+        handoff_release(&s_frame_ring);
+      }
+      samples_add(&s_stage[STAGE_AGGREGATE], now_ns() - t0);
+    }
+
+    int64_t t0 = now_ns();
+    if (t0 / 1000 - occupancy.current.start_us >=
+        (int64_t)s_summary_s * 1000000) {
+      occupancy_summary_t summary;
+      occupancy_close(&occupancy, t0 / 1000, &summary);
+      uint32_t dropped = frames_dropped();
+      summary.frames_dropped = dropped - dropped_at_start;
+      dropped_at_start = dropped;
+      pthread_mutex_lock(&s_uplink_lock);
+      uplink_push(UPLINK_CLASS_BULK, UPLOAD_SUMMARY, &summary,
+                  sizeof(summary), t0 / 1000);
+      pthread_mutex_unlock(&s_uplink_lock);
+      s_summaries++;
+      samples_add(&s_stage[STAGE_AGGREGATE], now_ns() - t0);
+    }
+
+    notify_take(&s_aggregator_wake, AGGREGATOR_POLL_MS);
+  }
+  return NULL;
+}
+
+static void* uploader_main(void* arg) {
+  (void)arg;
+  pin_to(0);
+  static uplink_item_t item;
+  static char body[512];
+  while (s_running) {
+    notify_take(&s_uploader_wake, UPLOAD_POLL_MS);
+    while (s_running) {
+      uplink_class_t cls;
+      pthread_mutex_lock(&s_uplink_lock);
+      bool have = uplink_peek(&item, &cls);
+      pthread_mutex_unlock(&s_uplink_lock);
+      if (!have) {
+        break;
+      }
+      int64_t t0 = now_ns();
+      if (item.kind == UPLOAD_SUMMARY) {
+        occupancy_summary_t summary;
+        memcpy(&summary, item.data, sizeof(summary));
+        occupancy_format(&summary, body, sizeof(body));
+      } else {
+        snprintf(body, sizeof(body), "status=%s&seq=%lu",
+                 item.data[0] ? "ON" : "OFF", (unsigned long)item.id);
+      }
+      samples_add(&s_stage[STAGE_FORMAT], now_ns() - t0);
+      usleep((useconds_t)s_rtt_ms * 1000);
+      pthread_mutex_lock(&s_uplink_lock);
+      uplink_pop(cls, item.id);
+      pthread_mutex_unlock(&s_uplink_lock);
+      s_uploads++;
+    }
+  }
+  return NULL;
+}
+
+// --- Runs ------------------------------------------------------------------
+
+typedef struct {
+  double load[2];  // Estimated ESP32 load per core, percent
+  bool dropped;
+} result_t;
+
+static result_t run_rate(int rate) {
+  build_stream(rate);
+  size_t cap = s_event_count + 1024;
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    samples_init(&s_stage[i], cap);
+  }
+  samples_init(&s_handoff, cap * 2);
+  samples_init(&s_latency, cap);
+
+  handoff_init(&s_frame_ring, s_frame_slots, sizeof(s_frame_slots[0]),
+               FRAME_SLOTS);
+  handoff_init(&s_decision_ring, s_decision_slots,
+               sizeof(s_decision_slots[0]), DECISION_SLOTS);
+  notify_init(&s_sensor_wake);
+  notify_init(&s_aggregator_wake);
+  notify_init(&s_uploader_wake);
+  memset(&s_view, 0, sizeof(s_view));
+  heatmap_reset(&s_heatmap);
+  uplink_init();
+  s_views_missed = 0;
+  s_relay_changes = 0;
+  s_decisions_lost = 0;
+  s_summaries = 0;
+  s_uploads = 0;
+
+  s_running = 1;
+  s_start_us = now_us() + 20000;
+  pthread_t reader;
+  pthread_t sensor;
+  pthread_t aggregator;
+  pthread_t uploader;
+  pthread_create(&sensor, NULL, sensor_main, NULL);
+  pthread_create(&aggregator, NULL, aggregator_main, NULL);
+  pthread_create(&uploader, NULL, uploader_main, NULL);
+  pthread_create(&reader, NULL, reader_main, NULL);
+  pthread_join(reader, NULL);
+  int64_t wall_us = now_us() - s_start_us;
+
+  // Let Core 0 catch up, then stop everything
+  usleep(DRAIN_MS * 1000);
+  s_running = 0;
+  notify_give(&s_sensor_wake);
+  notify_give(&s_aggregator_wake);
+  notify_give(&s_uploader_wake);
+  pthread_join(sensor, NULL);
+  pthread_join(aggregator, NULL);
+  pthread_join(uploader, NULL);
+
+  result_t result = {{0.0, 0.0}, false};
+  printf("\n%d Hz x %d radars (%d frames/s), %d s\n", rate, s_radars,
+         rate * s_radars, s_seconds);
+  printf("  stage      core      n  p50 us  p99 us  max us  busy %%\n");
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    samples_t* s = &s_stage[i];
+    double busy = 100.0 * (double)s->sum / 1000.0 / (double)wall_us;
+    result.load[s_stage_core[i]] += busy * s_scale;
+    double max = percentile(s, 100);
+    printf("  %-10s %4d %6zu %7.2f %7.2f %7.2f %7.4f\n", s_stage_names[i],
+           s_stage_core[i], s->n, percentile(s, 50) / 1000.0,
+           percentile(s, 99) / 1000.0, max / 1000.0, busy);
+  }
+  for (int core = 1; core >= 0; core--) {
+    printf("  Core %d: estimated ESP32 load %.2f %% (x%.0f), headroom "
+           "%.0fx the frame rate\n",
+           core, result.load[core], s_scale,
+           result.load[core] > 0 ? 100.0 / result.load[core] : 0.0);
+  }
+
+  handoff_stats_t frames;
+  handoff_stats_t decisions;
+  handoff_get_stats(&s_frame_ring, &frames);
+  handoff_get_stats(&s_decision_ring, &decisions);
+  result.dropped = frames.claim_failures > 0 || s_decisions_lost > 0;
+  printf("  Handoff frames: %u, max depth %u/%u, dropped %u; decisions: "
+         "%u, max depth %u/%u, ring full %u, lost %u\n",
+         frames.written, frames.max_depth, frames.capacity,
+         frames.claim_failures, decisions.written, decisions.max_depth,
+         decisions.capacity, decisions.claim_failures, s_decisions_lost);
+  printf("  Handoff latency p50 %.1f ms, p99 %.1f ms; frame -> relay p50 "
+         "%.0f us, p99 %.0f us\n",
+         percentile(&s_handoff, 50) / 1000.0,
+         percentile(&s_handoff, 99) / 1000.0, percentile(&s_latency, 50),
+         percentile(&s_latency, 99));
+  printf("  Views coalesced by the sensor thread: %u; relay changes: %u, "
+         "summaries: %u, uploads: %u\n",
+         s_views_missed, s_relay_changes, s_summaries, s_uploads);
+  return result;
+}
+
+static void parse_rates(const char* arg) {
+  s_rate_count = 0;
+  while (*arg && s_rate_count < MAX_RATES) {
+    int rate = atoi(arg);
+    if (rate > 0 && rate <= 1000) {
+      s_rates[s_rate_count++] = rate;
+    }
+    const char* comma = strchr(arg, ',');
+    if (!comma) {
+      break;
+    }
+    arg = comma + 1;
+  }
+}
+
+int main(int argc, char** argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "f:n:d:x:l:a:r:")) != -1) {
+    switch (opt) {
+      case 'f': parse_rates(optarg); break;
+      case 'n': s_radars = atoi(optarg); break;
+      case 'd': s_seconds = atoi(optarg); break;
+      case 'x': s_scale = atof(optarg); break;
+      case 'l': s_load_limit = atof(optarg); break;
+      case 'a': s_summary_s = atoi(optarg); break;
+      case 'r': s_rtt_ms = atoi(optarg); break;
+      default:
+        fprintf(stderr, "See the header of tools/pipeline_replay\n");
+        return 2;
+    }
+  }
+  if (s_radars < 1 || s_radars > RADAR_FUSION_MAX_SENSORS ||
+      s_seconds < 1 || s_rate_count == 0 || s_summary_s < 1) {
+    fprintf(stderr, "Invalid options\n");
+    return 2;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("Pipeline replay: %d radar(s), %d s per rate, busy times x%.0f "
+         "for the ESP32, pass below %.0f %% Core 1 load\n",
+         s_radars, s_seconds, s_scale, s_load_limit);
+  if (cpus < 2) {
+    printf("Only %ld host CPU: both cores share it, so wake-up latencies "
+           "include the other core's threads\n",
+           cpus);
+  }
+
+  bool pass = true;
+  for (int i = 0; i < s_rate_count; i++) {
+    result_t result = run_rate(s_rates[i]);
+    if (result.dropped || result.load[1] >= s_load_limit) {
+      pass = false;
+    }
+  }
+  printf("\n%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,570 @@
+/*
+ * Injects pipeline faults into a simulated controller and measures how
+ * long the health supervisor (components/health) takes to get each stage
+ * going again.
+ *
+ * The stages and recovery ladders are those of main/health_monitor.c with
+ * one radar, and the loops run at their default rates: a radar frame every
+ * 100 ms, the relay loop once per frame, the uploader once a second with
+ * requests of up to the HTTP timeout in between, and the supervisor once a
+ * second. A step asked of the radar reader is carried out at its next
+ * wake-up (within 200 ms). A restart takes the watchdog timeout plus the
+ * boot time to the first frame; relay state comes back from RTC memory, so
+ * a restart only pauses relay decisions.
+ *
+ * Fault classes and what clears them:
+ *
+ *   parser desync      bytes arrive, no valid frame         resync
+ *   UART wedged        no bytes                             UART reinstall
+ *   radar dropout      module silent for 2 s                nothing needed
+ *   uploader stuck     a request never returns              WiFi restart
+ *   WiFi wedged        as above, WiFi restart does not help restart
+ *   relay loop hung    sensor task stops                    restart
+ *   radar unplugged    no bytes from then on                (one restart)
+ *   radar missing      no bytes since boot                  (no restart)
+ *
+ * Each class runs many times with the fault at a random moment after a
+ * minute of normal operation. Recovery time runs from the fault to the
+ * stage's next progress. A simulated day without faults but with slow
+ * requests, long connects and short radar gaps checks for false alarms.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o recovery_sim tools/recovery_sim/recovery_sim.c \
+ *       components/health/health.c -Icomponents/health/include
+ *   ./recovery_sim [-n trials] [-r radar_ms] [-u uploader_s] [-w wdt_s]
+ *                  [-t http_timeout_ms] [-s seed]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "health.h"
+
+#define STEP_MS 10
+#define FRAME_MS 100
+#define READER_POLL_MS 200
+#define SUPERVISOR_MS 1000
+#define UPLOAD_POLL_MS 1000
+#define WIFI_CONNECT_MS 3000
+#define WIFI_CONNECT_MAX_MS 20000
+#define BOOT_NETWORK_DELAY_MS 3000
+
+// Boot to first frame, relay loop and supervisor start
+#define BOOT_RADAR_MS 300
+#define BOOT_LOOP_MS 350
+#define BOOT_SUPERVISOR_MS 400
+
+// Ladders of main/health_monitor.c
+#define RADAR_RESYNC_MS 2000
+#define RADAR_REINSTALL_MS 3000
+#define WIFI_RESTART_MS 60000
+#define SENSOR_PERIOD_MS 1000
+#define LOOP_PERIODS 3
+#define LOOP_MARGIN_MS 2000
+
+#define WARMUP_MS 60000
+#define TRIAL_MS 600000
+#define SOAK_MS (24LL * 3600 * 1000)
+
+typedef enum {
+  FAULT_DESYNC,
+  FAULT_WEDGED,
+  FAULT_DROPOUT,
+  FAULT_UPLOADER_STUCK,
+  FAULT_WIFI_WEDGED,
+  FAULT_LOOP_HUNG,
+  FAULT_UNPLUGGED,
+  FAULT_MISSING,
+  FAULT_COUNT,
+  FAULT_NONE = FAULT_COUNT,
+} fault_t;
+
+typedef enum {
+  STAGE_BYTES,
+  STAGE_FRAMES,
+  STAGE_LOOP,
+  STAGE_UPLOADER,
+} stage_t;
+
+typedef struct {
+  const char* name;
+  stage_t stage;              // Stage whose progress ends the outage
+  health_action_t fixed_by;   // Step expected to end it
+  int restarts;               // Restarts expected per trial, -1 any
+} fault_info_t;
+
+static const fault_info_t s_faults[FAULT_COUNT] = {
+    {"parser desync", STAGE_FRAMES, HEALTH_ACTION_RESYNC, 0},
+    {"UART wedged", STAGE_BYTES, HEALTH_ACTION_REINSTALL, 0},
+    {"radar dropout 2 s", STAGE_BYTES, HEALTH_ACTION_NONE, 0},
+    {"uploader stuck", STAGE_UPLOADER, HEALTH_ACTION_RESTART_WIFI, 0},
+    {"WiFi wedged", STAGE_UPLOADER, HEALTH_ACTION_REBOOT, 1},
+    {"relay loop hung", STAGE_LOOP, HEALTH_ACTION_REBOOT, 1},
+    {"radar unplugged", STAGE_BYTES, HEALTH_ACTION_NONE, 1},
+    {"radar missing", STAGE_BYTES, HEALTH_ACTION_NONE, 0},
+};
+
+typedef struct {
+  uint32_t radar_timeout_ms;
+  uint32_t uploader_timeout_ms;
+  uint32_t wdt_ms;
+  uint32_t http_timeout_ms;
+} sim_config_t;
+
+typedef struct {
+  const sim_config_t* cfg;
+  health_t health;
+  int64_t now_ms;
+
+  // Progress counters the supervisor reads
+  uint32_t bytes;
+  uint32_t frames;
+  uint32_t loop;
+  uint32_t uploads;
+
+  // Faults in force
+  bool desync;
+  bool wedged;
+  bool uploader_stuck;
+  bool wifi_wedged;
+  bool loop_hung;
+  bool unplugged;
+  int64_t dropout_until_ms;
+
+  // Process state
+  int64_t boot_ms;
+  int64_t restart_at_ms;     // Watchdog reset pending, 0 for none
+  int64_t upload_free_ms;    // Uploader blocked until
+  bool jitter;               // Slow requests and radar gaps (soak)
+  health_action_t radar_req;
+  int64_t radar_req_at_ms;
+
+  // Record
+  int restarts;
+  uint32_t steps[HEALTH_ACTION_COUNT];
+  health_action_t last_step[4];  // Per stage_t
+  int64_t first_step_ms;
+} world_t;
+
+static int64_t rand_range(int64_t lo, int64_t hi) {
+  return lo + (int64_t)(((uint64_t)rand() << 16 ^ (uint64_t)rand()) %
+                        (uint64_t)(hi - lo + 1));
+}
+
+static void add_stages(world_t* w) {
+  const sim_config_t* cfg = w->cfg;
+  int64_t now_us = w->now_ms * 1000;
+  health_init(&w->health);
+
+  health_stage_config_t bytes = {
+      .name = "radar0_bytes",
+      .timeout_ms = cfg->radar_timeout_ms,
+      .depends_on = -1,
+      .step_count = 3,
+      .steps = {HEALTH_ACTION_REINSTALL, HEALTH_ACTION_REINSTALL,
+                HEALTH_ACTION_REBOOT},
+      .step_ms = {RADAR_REINSTALL_MS, RADAR_REINSTALL_MS, RADAR_REINSTALL_MS},
+  };
+  health_stage_config_t frames = {
+      .name = "radar0_frames",
+      .timeout_ms = cfg->radar_timeout_ms,
+      .depends_on = STAGE_BYTES,
+      .step_count = 3,
+      .steps = {HEALTH_ACTION_RESYNC, HEALTH_ACTION_REINSTALL,
+                HEALTH_ACTION_REBOOT},
+      .step_ms = {RADAR_RESYNC_MS, RADAR_REINSTALL_MS, RADAR_REINSTALL_MS},
+  };
+  health_stage_config_t loop = {
+      .name = "relay_loop",
+      .timeout_ms = SENSOR_PERIOD_MS * LOOP_PERIODS + LOOP_MARGIN_MS,
+      .depends_on = -1,
+      .step_count = 1,
+      .steps = {HEALTH_ACTION_REBOOT},
+      .step_ms = {cfg->wdt_ms},
+  };
+  health_stage_config_t uploader = {
+      .name = "uploader",
+      .timeout_ms = cfg->uploader_timeout_ms,
+      .depends_on = -1,
+      .step_count = 2,
+      .steps = {HEALTH_ACTION_RESTART_WIFI, HEALTH_ACTION_REBOOT},
+      .step_ms = {WIFI_RESTART_MS, cfg->wdt_ms},
+  };
+  health_add_stage(&w->health, &bytes, now_us);
+  health_add_stage(&w->health, &frames, now_us);
+  health_add_stage(&w->health, &loop, now_us);
+  health_add_stage(&w->health, &uploader, now_us);
+}
+
+// Chip reset: counters and every fault but a missing radar are gone
+static void boot(world_t* w) {
+  w->boot_ms = w->now_ms;
+  w->restart_at_ms = 0;
+  w->bytes = w->frames = w->loop = w->uploads = 0;
+  w->desync = w->wedged = w->uploader_stuck = false;
+  w->wifi_wedged = w->loop_hung = false;
+  w->dropout_until_ms = 0;
+  w->radar_req = HEALTH_ACTION_NONE;
+  // The WiFi task waits for the first relay decision, then connects
+  w->upload_free_ms = w->now_ms + BOOT_LOOP_MS + WIFI_CONNECT_MS;
+}
+
+static void carry_out(world_t* w, int stage, health_action_t action) {
+  w->steps[action]++;
+  w->last_step[stage] = action;
+  if (w->first_step_ms == 0) {
+    w->first_step_ms = w->now_ms;
+  }
+  switch (action) {
+    case HEALTH_ACTION_RESYNC:
+    case HEALTH_ACTION_REINSTALL:
+      if (action > w->radar_req) {
+        w->radar_req = action;
+      }
+      w->radar_req_at_ms = w->now_ms + READER_POLL_MS;
+      break;
+    case HEALTH_ACTION_RESTART_WIFI:
+      // The stuck request fails at once and the uploader reconnects
+      if (!w->wifi_wedged && w->uploader_stuck) {
+        w->uploader_stuck = false;
+        w->upload_free_ms = w->now_ms;
+      }
+      break;
+    case HEALTH_ACTION_REBOOT:
+      if (w->restart_at_ms == 0) {
+        w->restart_at_ms = w->now_ms + w->cfg->wdt_ms;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// One STEP_MS of simulated time
+static void step(world_t* w) {
+  int64_t t = w->now_ms;
+  int64_t up = t - w->boot_ms;
+
+  if (w->restart_at_ms && t >= w->restart_at_ms) {
+    w->restarts++;
+    boot(w);
+    return;
+  }
+
+  // Radar reader: requested steps at the next wake-up, then the stream
+  if (w->radar_req != HEALTH_ACTION_NONE && t >= w->radar_req_at_ms) {
+    w->desync = false;
+    if (w->radar_req == HEALTH_ACTION_REINSTALL) {
+      w->wedged = false;
+    }
+    w->radar_req = HEALTH_ACTION_NONE;
+  }
+  bool frame_due = up >= BOOT_RADAR_MS && (up - BOOT_RADAR_MS) % FRAME_MS == 0;
+  if (frame_due && !w->wedged && !w->unplugged && t >= w->dropout_until_ms) {
+    w->bytes += 30;
+    if (!w->desync) {
+      w->frames++;
+    }
+  }
+
+  // Relay loop, frame driven and at least once per sensor period
+  if (!w->loop_hung && up >= BOOT_LOOP_MS &&
+      (up - BOOT_LOOP_MS) % FRAME_MS == 0) {
+    w->loop++;
+  }
+
+  // Uploader: beats at the top of its loop and after every request
+  if (!w->uploader_stuck && !w->wifi_wedged && t >= w->upload_free_ms) {
+    w->uploads++;
+    int64_t busy = UPLOAD_POLL_MS;
+    if (w->jitter && rand() % 20 == 0) {
+      // A slow request, a reconnect or a heatmap plus rules download back
+      // to back (the rules download reports no progress of its own)
+      int kind = rand() % 3;
+      busy = kind == 0   ? w->cfg->http_timeout_ms
+             : kind == 1 ? WIFI_CONNECT_MAX_MS + UPLOAD_POLL_MS
+                         : 2LL * w->cfg->http_timeout_ms;
+    }
+    w->upload_free_ms = t + busy;
+  }
+
+  if (w->jitter && frame_due && rand() % 6000 == 0) {
+    // Module hiccup well below the stall timeout
+    w->dropout_until_ms = t + rand_range(100, w->cfg->radar_timeout_ms / 2);
+  }
+
+  // Supervisor
+  if (up >= BOOT_SUPERVISOR_MS &&
+      (up - BOOT_SUPERVISOR_MS) % SUPERVISOR_MS == 0) {
+    int64_t now_us = t * 1000;
+    if (up == BOOT_SUPERVISOR_MS) {
+      add_stages(w);
+    }
+    health_observe(&w->health, STAGE_BYTES, w->bytes, now_us);
+    health_observe(&w->health, STAGE_FRAMES, w->frames, now_us);
+    health_observe(&w->health, STAGE_LOOP, w->loop, now_us);
+    health_observe(&w->health, STAGE_UPLOADER, w->uploads, now_us);
+    int stage;
+    health_action_t action;
+    while ((action = health_check(&w->health, now_us, &stage)) !=
+           HEALTH_ACTION_NONE) {
+      carry_out(w, stage, action);
+    }
+  }
+}
+
+static uint32_t stage_counter(const world_t* w, stage_t stage) {
+  switch (stage) {
+    case STAGE_BYTES:
+      return w->bytes;
+    case STAGE_FRAMES:
+      return w->frames;
+    case STAGE_LOOP:
+      return w->loop;
+    default:
+      return w->uploads;
+  }
+}
+
+static void inject(world_t* w, fault_t fault) {
+  switch (fault) {
+    case FAULT_DESYNC:
+      w->desync = true;
+      break;
+    case FAULT_WEDGED:
+      w->wedged = true;
+      break;
+    case FAULT_DROPOUT:
+      w->dropout_until_ms = w->now_ms + 2000;
+      break;
+    case FAULT_UPLOADER_STUCK:
+      w->uploader_stuck = true;
+      break;
+    case FAULT_WIFI_WEDGED:
+      w->wifi_wedged = true;
+      break;
+    case FAULT_LOOP_HUNG:
+      w->loop_hung = true;
+      break;
+    case FAULT_UNPLUGGED:
+    case FAULT_MISSING:
+      w->unplugged = true;
+      break;
+    default:
+      break;
+  }
+}
+
+typedef struct {
+  int64_t detect_ms;  // Fault to first step, -1 for none
+  int64_t outage_ms;  // Fault to progress, -1 if it never came back
+  health_action_t fixed_by;
+  uint32_t steps;
+  int restarts;
+} trial_t;
+
+static void run_trial(const sim_config_t* cfg, fault_t fault, trial_t* out) {
+  world_t w;
+  memset(&w, 0, sizeof(w));
+  w.cfg = cfg;
+  w.now_ms = 1000 + rand_range(0, SUPERVISOR_MS - 1);
+  boot(&w);
+
+  int64_t fault_ms = fault == FAULT_MISSING
+                         ? w.now_ms
+                         : w.now_ms + WARMUP_MS + rand_range(0, 999);
+  int64_t end_ms = fault_ms + TRIAL_MS;
+  const fault_info_t* info = &s_faults[fault];
+  bool injected = false;
+  uint32_t counter = 0;
+  int restarts_at_fault = 0;
+
+  out->outage_ms = -1;
+  for (; w.now_ms < end_ms; w.now_ms += STEP_MS) {
+    if (!injected && w.now_ms >= fault_ms) {
+      inject(&w, fault);
+      injected = true;
+      counter = stage_counter(&w, info->stage);
+      memset(w.steps, 0, sizeof(w.steps));
+      memset(w.last_step, 0, sizeof(w.last_step));
+      w.first_step_ms = 0;
+      restarts_at_fault = w.restarts;
+    }
+    step(&w);
+    if (injected && out->outage_ms < 0 &&
+        stage_counter(&w, info->stage) != counter) {
+      // A restart zeroes the counter; its first move counts
+      out->outage_ms = w.now_ms - fault_ms;
+      out->fixed_by = w.last_step[info->stage];
+      if (fault != FAULT_UNPLUGGED && fault != FAULT_MISSING) {
+        break;
+      }
+    }
+    if (injected && w.restarts != restarts_at_fault &&
+        stage_counter(&w, info->stage) == 0) {
+      counter = 0;
+    }
+  }
+  out->detect_ms = w.first_step_ms ? w.first_step_ms - fault_ms : -1;
+  out->steps = 0;
+  for (int a = 0; a < HEALTH_ACTION_COUNT; a++) {
+    out->steps += w.steps[a];
+  }
+  out->restarts = w.restarts - restarts_at_fault;
+}
+
+static int cmp_i64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// A day of normal operation: any step is a false alarm
+static int run_soak(const sim_config_t* cfg) {
+  world_t w;
+  memset(&w, 0, sizeof(w));
+  w.cfg = cfg;
+  w.jitter = true;
+  w.now_ms = 1000;
+  boot(&w);
+  // The first connect may wait for the network delay and the full timeout
+  w.upload_free_ms += BOOT_NETWORK_DELAY_MS + WIFI_CONNECT_MAX_MS;
+  int64_t end_ms = w.now_ms + SOAK_MS;
+  for (; w.now_ms < end_ms; w.now_ms += STEP_MS) {
+    step(&w);
+  }
+  uint32_t steps = 0;
+  for (int a = 0; a < HEALTH_ACTION_COUNT; a++) {
+    steps += w.steps[a];
+  }
+  printf("fault-free day with jitter: %u steps, %d restarts  %s\n", steps,
+         w.restarts, steps == 0 ? "PASS" : "FAIL");
+  return steps == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  sim_config_t cfg = {
+      .radar_timeout_ms = 3000,
+      .uploader_timeout_ms = 180000,
+      .wdt_ms = 5000,
+      .http_timeout_ms = 10000,
+  };
+  int trials = 200;
+  unsigned seed = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "n:r:u:w:t:s:")) != -1) {
+    switch (c) {
+      case 'n':
+        trials = atoi(optarg);
+        break;
+      case 'r':
+        cfg.radar_timeout_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'u':
+        cfg.uploader_timeout_ms = (uint32_t)atoi(optarg) * 1000;
+        break;
+      case 'w':
+        cfg.wdt_ms = (uint32_t)atoi(optarg) * 1000;
+        break;
+      case 't':
+        cfg.http_timeout_ms = (uint32_t)atoi(optarg);
+        break;
+      case 's':
+        seed = (unsigned)atoi(optarg);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-n trials] [-r radar_ms] [-u uploader_s] "
+                "[-w wdt_s] [-t http_timeout_ms] [-s seed]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+  if (trials < 1) {
+    trials = 1;
+  }
+  srand(seed);
+
+  printf("radar timeout %u ms, uploader timeout %u s, watchdog %u s, HTTP "
+         "timeout %u ms, %d trials per fault\n\n",
+         cfg.radar_timeout_ms, cfg.uploader_timeout_ms / 1000,
+         cfg.wdt_ms / 1000, cfg.http_timeout_ms, trials);
+  printf("%-18s %9s %9s %9s %9s %6s %8s  %-14s %s\n", "fault", "detect",
+         "recovery", "p95", "max", "steps", "restarts", "fixed by", "check");
+
+  int64_t* outages = malloc(sizeof(int64_t) * (size_t)trials);
+  int failures = 0;
+  for (int f = 0; f < FAULT_COUNT; f++) {
+    const fault_info_t* info = &s_faults[f];
+    int64_t detect_sum = 0;
+    int detected = 0;
+    int64_t outage_sum = 0;
+    int recovered = 0;
+    uint32_t steps = 0;
+    int restarts = 0;
+    int wrong = 0;
+    health_action_t fixed_by = HEALTH_ACTION_NONE;
+
+    for (int i = 0; i < trials; i++) {
+      trial_t trial;
+      run_trial(&cfg, (fault_t)f, &trial);
+      if (trial.detect_ms >= 0) {
+        detect_sum += trial.detect_ms;
+        detected++;
+      }
+      steps += trial.steps;
+      restarts += trial.restarts;
+      if (info->restarts >= 0 && trial.restarts != info->restarts) {
+        wrong++;
+      }
+      if (f == FAULT_UNPLUGGED || f == FAULT_MISSING) {
+        continue;
+      }
+      if (trial.outage_ms < 0 || trial.fixed_by != info->fixed_by) {
+        wrong++;
+        continue;
+      }
+      outages[recovered++] = trial.outage_ms;
+      outage_sum += trial.outage_ms;
+      fixed_by = trial.fixed_by;
+    }
+
+    char detect[24] = "-";
+    if (detected) {
+      snprintf(detect, sizeof(detect), "%lld",
+               (long long)(detect_sum / detected));
+    }
+    char mean[24] = "-";
+    char p95[24] = "-";
+    char max[24] = "-";
+    if (recovered) {
+      qsort(outages, (size_t)recovered, sizeof(int64_t), cmp_i64);
+      snprintf(mean, sizeof(mean), "%lld",
+               (long long)(outage_sum / recovered));
+      snprintf(p95, sizeof(p95), "%lld",
+               (long long)outages[(recovered * 95) / 100 < recovered
+                                      ? (recovered * 95) / 100
+                                      : recovered - 1]);
+      snprintf(max, sizeof(max), "%lld", (long long)outages[recovered - 1]);
+    }
+    failures += wrong ? 1 : 0;
+    printf("%-18s %9s %9s %9s %9s %6.1f %8.2f  %-14s %s\n", info->name,
+           detect, mean, p95, max, (double)steps / trials,
+           (double)restarts / trials,
+           recovered ? health_action_name(fixed_by) : "-",
+           wrong ? "FAIL" : "PASS");
+  }
+  free(outages);
+  printf("(times in ms from the fault: first recovery step, stage "
+         "progressing again)\n\n");
+
+  failures += run_soak(&cfg);
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
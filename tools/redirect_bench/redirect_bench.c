@@ -0,0 +1,394 @@
+/*
+ * Host comparison of the two upload paths against a local Apps Script
+ * stand-in.
+ *
+ * The stand-in answers a POST to /exec the way script.google.com does: it
+ * runs the "script" (a configurable delay), then replies 302 with a Location
+ * on the echo service and a small HTML body. A GET on that location waits again
+ * (the echo service looking up the stored result) and returns the JSON reply.
+ * Every new connection first waits for a configurable handshake time, which
+ * stands in for TCP + TLS setup to Google.
+ *
+ * Two clients run against it, each with a fresh connection per request as on
+ * the device:
+ *   follow  the old path: five headers, read the 302 body into a 512-byte
+ *           buffer, reconnect and follow the redirect, read the reply
+ *   ack     the lean path: Content-Type only, stop at the 302 status line
+ *           and its Location
+ *
+ * A third run points the 302 at a sign-in page instead, as Apps Script does
+ * for a deployment that is not anonymous or has been replaced. The script
+ * never ran, so the lean path must count every such upload as failed.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o redirect_bench tools/redirect_bench/redirect_bench.c -lpthread
+ *   ./redirect_bench [uploads] [handshake_ms] [script_ms] [echo_ms]
+ *   ./redirect_bench --serve port [handshake_ms] [script_ms] [echo_ms]
+ *
+ * --serve only runs the stand-in, so the device can be pointed at it with
+ * config set script_url http://<host>:<port>/exec (plain HTTP) and the
+ * metrics breakdown compared with http_verify 0 and 1.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REQUEST_MAX 4096
+#define RESPONSE_BUFFER 512  // Stack buffer the old path copied into
+
+static int s_handshake_ms = 150;
+static int s_script_ms = 400;
+static int s_echo_ms = 150;
+static uint16_t s_port;
+static int s_signin;          // 302 to a sign-in page instead of the echo
+static char s_location[512];  // Location of the last response read
+
+static int64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_ms(int ms) {
+  if (ms > 0) {
+    usleep((useconds_t)ms * 1000);
+  }
+}
+
+static int send_all(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return -1;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// Read one request (headers plus Content-Length body) into buf
+static int read_request(int fd, char* buf, size_t size) {
+  size_t used = 0;
+  char* end = NULL;
+  while (!end) {
+    ssize_t n = recv(fd, buf + used, size - 1 - used, 0);
+    if (n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+    buf[used] = '\0';
+    end = strstr(buf, "\r\n\r\n");
+  }
+  const char* cl = strstr(buf, "Content-Length:");
+  size_t want =
+      (size_t)(end + 4 - buf) + (cl ? strtoul(cl + 15, NULL, 10) : 0);
+  while (used < want && used < size - 1) {
+    ssize_t n = recv(fd, buf + used, size - 1 - used, 0);
+    if (n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+  }
+  buf[used] = '\0';
+  return 0;
+}
+
+static void serve_connection(int fd) {
+  char req[REQUEST_MAX];
+  char resp[2048];
+  sleep_ms(s_handshake_ms);
+  if (read_request(fd, req, sizeof(req)) != 0) {
+    return;
+  }
+
+  if (strncmp(req, "POST ", 5) == 0) {
+    sleep_ms(s_script_ms);
+    static const char body[] =
+        "<HTML>\n<HEAD>\n<TITLE>Moved Temporarily</TITLE>\n</HEAD>\n"
+        "<BODY BGCOLOR=\"#FFFFFF\" TEXT=\"#000000\">\n"
+        "<H1>Moved Temporarily</H1>\nThe document has moved "
+        "<A HREF=\"/macros/echo?user_content_key=stub\">here</A>.\n"
+        "</BODY>\n</HTML>\n";
+    char location[128];
+    if (s_signin) {
+      snprintf(location, sizeof(location),
+               "https://accounts.google.com/ServiceLogin?service=wise");
+    } else {
+      snprintf(location, sizeof(location),
+               "http://127.0.0.1:%u/macros/echo?user_content_key=stub",
+               s_port);
+    }
+    int len = snprintf(
+        resp, sizeof(resp),
+        "HTTP/1.1 302 Moved Temporarily\r\n"
+        "Content-Type: text/html; charset=UTF-8\r\n"
+        "Cache-Control: no-cache, no-store, max-age=0, must-revalidate\r\n"
+        "Pragma: no-cache\r\n"
+        "Expires: Mon, 01 Jan 1990 00:00:00 GMT\r\n"
+        "Location: %s\r\n"
+        "X-Content-Type-Options: nosniff\r\n"
+        "X-Frame-Options: SAMEORIGIN\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n\r\n%s",
+        location, sizeof(body) - 1, body);
+    send_all(fd, resp, (size_t)len);
+  } else {
+    sleep_ms(s_echo_ms);
+    static const char body[] =
+        "{\"result\":\"success\",\"message\":\"Status logged successfully\","
+        "\"timestamp\":\"2024-01-01T00:00:00.000Z\",\"status\":\"ON\"}";
+    int len = snprintf(resp, sizeof(resp),
+                       "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: application/json; charset=utf-8\r\n"
+                       "Cache-Control: no-cache, no-store, max-age=0\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n%s",
+                       sizeof(body) - 1, body);
+    send_all(fd, resp, (size_t)len);
+  }
+}
+
+static void* server_main(void* arg) {
+  int listen_fd = *(int*)arg;
+  for (;;) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    serve_connection(fd);
+    close(fd);
+  }
+  return NULL;
+}
+
+static int open_listener(uint16_t port, int any) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(any ? INADDR_ANY : INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 4) != 0) {
+    perror("listen");
+    exit(1);
+  }
+  socklen_t len = sizeof(addr);
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  s_port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static int connect_local(void) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(s_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Read the status line and headers; returns the status code. With copy set,
+// the body is also read to the end and its first bytes kept in a stack
+// buffer, as the old client did for logging.
+static int read_response(int fd, int copy, size_t* bytes) {
+  char buf[4096];
+  size_t used = 0;
+  char* end = NULL;
+  while (!end && used < sizeof(buf) - 1) {
+    ssize_t n = recv(fd, buf + used, sizeof(buf) - 1 - used, 0);
+    if (n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+    buf[used] = '\0';
+    end = strstr(buf, "\r\n\r\n");
+  }
+  if (!end) {
+    return -1;
+  }
+  int status = atoi(buf + 9);
+  s_location[0] = '\0';
+  const char* location = strstr(buf, "\r\nLocation: ");
+  if (location && location < end) {
+    location += 12;
+    size_t len = strcspn(location, "\r\n");
+    len = len < sizeof(s_location) - 1 ? len : sizeof(s_location) - 1;
+    memcpy(s_location, location, len);
+    s_location[len] = '\0';
+  }
+  if (copy) {
+    char response[RESPONSE_BUFFER];
+    size_t kept = used - (size_t)(end + 4 - buf);
+    kept = kept < sizeof(response) ? kept : sizeof(response);
+    memcpy(response, end + 4, kept);
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+      used += (size_t)n;
+      if (kept < sizeof(response)) {
+        size_t take = sizeof(response) - kept;
+        take = (size_t)n < take ? (size_t)n : take;
+        memcpy(response + kept, buf, take);
+        kept += take;
+      }
+    }
+  }
+  *bytes += used;
+  return status;
+}
+
+static int post(const char* headers, const char* form, int copy,
+                size_t* bytes) {
+  char req[1024];
+  int len = snprintf(req, sizeof(req),
+                     "POST /exec HTTP/1.1\r\nHost: 127.0.0.1\r\n%s"
+                     "Content-Length: %zu\r\n\r\n%s",
+                     headers, strlen(form), form);
+  int fd = connect_local();
+  if (fd < 0 || send_all(fd, req, (size_t)len) != 0) {
+    return -1;
+  }
+  *bytes += (size_t)len;
+  int status = read_response(fd, copy, bytes);
+  close(fd);
+  return status;
+}
+
+static int upload_follow(const char* form, size_t* bytes) {
+  static const char headers[] =
+      "Content-Type: application/x-www-form-urlencoded\r\n"
+      "User-Agent: ESP32-RadarWatch/1.0\r\n"
+      "Accept: */*\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Connection: close\r\n";
+  int status = post(headers, form, 1, bytes);
+  if (status != 302) {
+    return status;
+  }
+  char req[512];
+  int len = snprintf(req, sizeof(req),
+                     "GET /macros/echo?user_content_key=stub HTTP/1.1\r\n"
+                     "Host: 127.0.0.1\r\n%s\r\n",
+                     headers);
+  int fd = connect_local();
+  if (fd < 0 || send_all(fd, req, (size_t)len) != 0) {
+    return -1;
+  }
+  *bytes += (size_t)len;
+  status = read_response(fd, 1, bytes);
+  close(fd);
+  return status;
+}
+
+// The device's acceptance rule: the result page on the echo host, or on the
+// script's own host for a stand-in like this one
+static int is_echo_location(const char* location) {
+  const char* host = strstr(location, "://");
+  if (!host) {
+    return 0;
+  }
+  host += 3;
+  size_t len = strcspn(host, ":/?#");
+  const char* path = host + len + strcspn(host + len, "/?#");
+  if (strncmp(path, "/macros/echo", 12) != 0) {
+    return 0;
+  }
+  return (len == 28 && strncasecmp(host, "script.googleusercontent.com",
+                                   len) == 0) ||
+         (len == 9 && strncmp(host, "127.0.0.1", len) == 0);
+}
+
+static int upload_ack(const char* form, size_t* bytes) {
+  int status = post("Content-Type: application/x-www-form-urlencoded\r\n",
+                    form, 0, bytes);
+  return status == 302 && is_echo_location(s_location) ? 200 : status;
+}
+
+static int cmp_i64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Returns the number of failed uploads
+static int run(const char* name, int (*upload)(const char*, size_t*),
+               int uploads) {
+  int64_t* rtt = calloc((size_t)uploads, sizeof(*rtt));
+  size_t bytes = 0;
+  int failures = 0;
+  for (int i = 0; i < uploads; i++) {
+    int64_t start = now_us();
+    if (upload(i & 1 ? "status=OFF" : "status=ON", &bytes) != 200) {
+      failures++;
+    }
+    rtt[i] = now_us() - start;
+  }
+  qsort(rtt, (size_t)uploads, sizeof(*rtt), cmp_i64);
+  int64_t sum = 0;
+  for (int i = 0; i < uploads; i++) {
+    sum += rtt[i];
+  }
+  printf("%-7s mean %6lld ms  p50 %6lld ms  p95 %6lld ms  %5zu B/upload  %d "
+         "failed\n",
+         name, (long long)(sum / uploads / 1000),
+         (long long)(rtt[uploads / 2] / 1000),
+         (long long)(rtt[uploads * 95 / 100] / 1000), bytes / (size_t)uploads,
+         failures);
+  free(rtt);
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  int serve = argc > 1 && strcmp(argv[1], "--serve") == 0;
+  int arg = 1;
+  int uploads = 20;
+  uint16_t port = 0;
+  if (serve) {
+    port = argc > 2 ? (uint16_t)atoi(argv[2]) : 8080;
+    arg = 3;
+  } else if (argc > 1) {
+    uploads = atoi(argv[1]);
+    arg = 2;
+  }
+  if (argc > arg) s_handshake_ms = atoi(argv[arg]);
+  if (argc > arg + 1) s_script_ms = atoi(argv[arg + 1]);
+  if (argc > arg + 2) s_echo_ms = atoi(argv[arg + 2]);
+  if (uploads <= 0) {
+    uploads = 1;
+  }
+
+  int listen_fd = open_listener(port, serve);
+  printf("Stand-in on port %u: handshake %d ms, script %d ms, echo %d ms\n",
+         s_port, s_handshake_ms, s_script_ms, s_echo_ms);
+  if (serve) {
+    server_main(&listen_fd);
+    return 0;
+  }
+
+  pthread_t server;
+  pthread_create(&server, NULL, server_main, &listen_fd);
+  run("follow", upload_follow, uploads);
+  run("ack", upload_ack, uploads);
+
+  s_signin = 1;
+  int kept = run("signin", upload_ack, uploads);
+  printf("ack on a sign-in redirect: %d of %d kept for a retry\n%s\n", kept,
+         uploads, kept == uploads ? "PASS" : "FAIL");
+  return kept == uploads ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+/*
+ * Host checks and benchmark for the relay rule engine
+ * (components/rules/rules.c).
+ *
+ * First a table of rule texts is compiled and evaluated against fixed
+ * frames, and texts that must be rejected are checked to be. Then four
+ * programs run over the same random frame stream (zero to nine fused
+ * targets, random doorway approaches, a clock that advances a minute per
+ * frame):
+ *
+ *   typical     presence with a hold, a zone limited to a night window,
+ *               and a doorway; checked frame by frame against the same
+ *               policy written in C, which is timed alongside
+ *   default     "relay1 = present; relay2 = present", the built-in policy
+ *   in() chain  as many zone tests as fit in the bytecode
+ *   moving      as many fastest-target reads as fit in the text
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o rules_bench tools/rules_bench/rules_bench.c \
+ *       components/rules/rules.c -Icomponents/rules/include \
+ *       -Icomponents/radar_sensor/include
+ *   ./rules_bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rules.h"
+
+#define DEFAULT_FRAMES 200000
+#define RUNS 15
+#define FRAME_US 100000  // 10 Hz
+
+static const char* const s_typical =
+    "relay1 = present hold 120\n"
+    "relay2 = in(-1500, 0, 1500, 2500) & during(18:00, 06:00) | approach(1)";
+
+typedef struct {
+  radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+  size_t count;
+  uint32_t present;
+  uint8_t approach_mask;
+  int32_t minute_of_day;
+} frame_t;
+
+static frame_t* s_frames;
+static size_t s_frame_count;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static rules_input_t input_for(size_t i) {
+  const frame_t* f = &s_frames[i];
+  rules_input_t input = {
+      .targets = f->targets,
+      .count = f->count,
+      .present = f->present,
+      .approach_mask = f->approach_mask,
+      .minute_of_day = f->minute_of_day,
+      .now_us = (int64_t)i * FRAME_US,
+  };
+  return input;
+}
+
+// --- Semantic checks -------------------------------------------------------
+
+typedef struct {
+  const char* text;
+  int targets;        // Targets at (0, 1000), all present
+  int minute_of_day;  // -1 for unknown
+  uint8_t approach;   // Doorway bits
+  uint8_t expected;   // Relay mask
+} eval_case_t;
+
+static const eval_case_t s_eval_cases[] = {
+    {"relay1 = present", 1, -1, 0, 0x01},
+    {"relay1 = present", 0, -1, 0, 0x00},
+    {"relay2 = targets >= 2", 2, -1, 0, 0x02},
+    {"relay2 = targets >= 2", 1, -1, 0, 0x00},
+    {"relay1 = !present", 0, -1, 0, 0x01},
+    {"relay1 = not present and not targets", 0, -1, 0, 0x01},
+    {"relay3 = in(-100, 500, 100, 1500)", 1, -1, 0, 0x04},
+    {"relay3 = in(100, 500, -100, 1500)", 1, -1, 0, 0x04},  // Corners swapped
+    {"relay3 = in(200, 500, 400, 1500)", 1, -1, 0, 0x00},
+    {"relay1 = in(-100, 0, 100, 2000) == 3", 3, -1, 0, 0x01},
+    {"relay1 = approach(2)", 0, -1, 0x02, 0x01},
+    {"relay1 = approach(1)", 0, -1, 0x02, 0x00},
+    {"relay1 = during(18:00, 06:00)", 0, 23 * 60, 0, 0x01},
+    {"relay1 = during(18:00, 06:00)", 0, 5 * 60 + 59, 0, 0x01},
+    {"relay1 = during(18:00, 06:00)", 0, 6 * 60, 0, 0x00},
+    {"relay1 = during(08:00, 17:00)", 0, 12 * 60, 0, 0x01},
+    {"relay1 = during(00:00, 23:59)", 0, -1, 0, 0x00},  // Clock unknown
+    {"relay1 = hour == 7 & minute >= 30", 0, 7 * 60 + 45, 0, 0x01},
+    {"relay1 = time < 07:30", 0, 7 * 60 + 45, 0, 0x00},
+    {"relay1 = hour < 0", 0, -1, 0, 0x01},
+    {"relay1 = present | approach(1); relay2 = present & (hour >= 22 | "
+     "hour < 6)",
+     1, 12 * 60, 0, 0x01},
+    {"relay1 = 0; relay1 = present  # ORed with the rule before", 1, -1, 0,
+     0x01},
+    {"RELAY8 = Present", 1, -1, 0, 0x80},
+    {"relay1 = moving > 20", 1, -1, 0, 0x01},
+    {"relay1 = moving > 40", 1, -1, 0, 0x00},
+    {"relay1 = -5 < 0 && !(1 == 2) || 0", 0, -1, 0, 0x01},
+    {"", 1, -1, 0, 0x00},
+    {"\n; # only a comment\n", 1, -1, 0, 0x00},
+};
+
+static const char* const s_bad_texts[] = {
+    "relay0 = present",
+    "relay9 = present",
+    "light = present",
+    "relay1 present",
+    "relay1 = presence",
+    "relay1 = present &",
+    "relay1 = (present",
+    "relay1 = present)",
+    "relay1 = in(0, 0, 1)",
+    "relay1 = in(0, 0, 1, 40000)",
+    "relay1 = approach(0)",
+    "relay1 = during(25:00, 06:00)",
+    "relay1 = during(18:00)",
+    "relay1 = present hold -1",
+    "relay1 = present hold 100000",
+    "relay1 = 1 < 2 < 3",
+    "relay1 = present $",
+    // 17 nested groups: deeper than the compiler recurses
+    "relay1 = ((((((((((((((((( 1 )))))))))))))))))",
+    // 17 values pending on the stack
+    "relay1 = 1|(1&(1|(1&(1|(1&(1|(1&(1|(1&(1|(1&(1|(1&(1|(1&(1|1))))))))"
+    "))))))))",
+};
+
+static int check_semantics(void) {
+  static rules_program_t program;
+  int failures = 0;
+
+  for (size_t c = 0; c < sizeof(s_eval_cases) / sizeof(s_eval_cases[0]);
+       c++) {
+    const eval_case_t* tc = &s_eval_cases[c];
+    rules_error_t error = {0};
+    if (!rules_compile(&program, tc->text, &error)) {
+      printf("FAIL compile \"%s\": %s at %zu\n", tc->text, error.message,
+             error.offset);
+      failures++;
+      continue;
+    }
+    radar_fused_target_t targets[RADAR_FUSION_MAX_TARGETS];
+    for (int t = 0; t < tc->targets; t++) {
+      targets[t] = (radar_fused_target_t){0.0f, 1000.0f, -30.0f, 1};
+    }
+    rules_input_t input = {
+        .targets = targets,
+        .count = (size_t)tc->targets,
+        .present = (uint32_t)tc->targets,
+        .approach_mask = tc->approach,
+        .minute_of_day = tc->minute_of_day,
+        .now_us = 0,
+    };
+    uint8_t mask = rules_eval(&program, &input);
+    if (mask != tc->expected) {
+      printf("FAIL \"%s\": relays 0x%02x, expected 0x%02x\n", tc->text, mask,
+             tc->expected);
+      failures++;
+    }
+  }
+
+  for (size_t b = 0; b < sizeof(s_bad_texts) / sizeof(s_bad_texts[0]); b++) {
+    rules_error_t error = {0};
+    if (rules_compile(&program, s_bad_texts[b], &error)) {
+      printf("FAIL accepted \"%s\"\n", s_bad_texts[b]);
+      failures++;
+    } else if (program.code_len != 0 || !error.message) {
+      printf("FAIL \"%s\": rejected without a message or left code\n",
+             s_bad_texts[b]);
+      failures++;
+    }
+  }
+
+  // Hold: on while present, then 2 s more, then off
+  rules_compile(&program, "relay1 = present hold 2", NULL);
+  static const struct {
+    uint32_t present;
+    int64_t now_us;
+    uint8_t expected;
+  } hold_steps[] = {
+      {0, 0, 0x00},       {1, 1000000, 0x01}, {0, 1500000, 0x01},
+      {0, 2999999, 0x01}, {0, 3000000, 0x00}, {1, 3100000, 0x01},
+      {0, 5099999, 0x01}, {0, 5100000, 0x00},
+  };
+  for (size_t s = 0; s < sizeof(hold_steps) / sizeof(hold_steps[0]); s++) {
+    rules_input_t input = {.present = hold_steps[s].present,
+                           .minute_of_day = -1,
+                           .now_us = hold_steps[s].now_us};
+    uint8_t mask = rules_eval(&program, &input);
+    if (mask != hold_steps[s].expected) {
+      printf("FAIL hold step %zu: relays 0x%02x, expected 0x%02x\n", s, mask,
+             hold_steps[s].expected);
+      failures++;
+    }
+  }
+
+  size_t cases = sizeof(s_eval_cases) / sizeof(s_eval_cases[0]) +
+                 sizeof(s_bad_texts) / sizeof(s_bad_texts[0]) +
+                 sizeof(hold_steps) / sizeof(hold_steps[0]);
+  printf("semantics: %zu checks, %d failed\n", cases, failures);
+  return failures;
+}
+
+// --- Benchmark -------------------------------------------------------------
+
+static void build_frames(size_t count) {
+  s_frames = calloc(count, sizeof(*s_frames));
+  s_frame_count = count;
+  srand(12345);
+  for (size_t i = 0; i < count; i++) {
+    frame_t* f = &s_frames[i];
+    // Runs of empty frames so holds and windows switch both ways
+    f->count = (i / 50) % 3 == 0 ? 0 : (size_t)(rand() % 10);
+    for (size_t t = 0; t < f->count; t++) {
+      f->targets[t].x = (float)(rand() % 8000 - 4000);
+      f->targets[t].y = (float)(rand() % 6000);
+      f->targets[t].speed = (float)(rand() % 200 - 100);
+      f->targets[t].sensor_mask = 1;
+    }
+    f->present = (uint32_t)f->count;
+    f->approach_mask = rand() % 20 == 0 ? 0x01 : 0x00;
+    f->minute_of_day = (int32_t)(i % 1440);
+  }
+}
+
+// The typical program written by hand, for equivalence and as the baseline
+typedef struct {
+  int64_t last_present_us;
+  bool seen;
+} typical_state_t;
+
+static uint8_t typical_in_c(typical_state_t* state, const rules_input_t* in) {
+  uint8_t mask = 0;
+  if (in->present) {
+    state->seen = true;
+    state->last_present_us = in->now_us;
+  }
+  if (in->present ||
+      (state->seen && in->now_us - state->last_present_us < 120000000LL)) {
+    mask |= 0x01;
+  }
+  int zone = 0;
+  for (size_t t = 0; t < in->count; t++) {
+    const radar_fused_target_t* tg = &in->targets[t];
+    zone += tg->x >= -1500 && tg->x <= 1500 && tg->y >= 0 && tg->y <= 2500;
+  }
+  int32_t m = in->minute_of_day;
+  bool night = m >= 0 && (m >= 18 * 60 || m < 6 * 60);
+  if ((zone && night) || (in->approach_mask & 0x01)) {
+    mask |= 0x02;
+  }
+  return mask;
+}
+
+// Longest chain of one term ORed together that the compiler accepts; with
+// in() the code size runs out first, with moving the text length
+static const char* chain_text(char* text, size_t size, const char* term) {
+  static char candidate[RULES_TEXT_MAX];
+  static rules_program_t program;
+  snprintf(text, size, "relay1 = %s", term);
+  for (;;) {
+    int n = snprintf(candidate, sizeof(candidate), "%s|%s", text, term);
+    if (n < 0 || (size_t)n >= size ||
+        !rules_compile(&program, candidate, NULL)) {
+      return text;
+    }
+    memcpy(text, candidate, (size_t)n + 1);
+  }
+}
+
+static double time_program(rules_program_t* program, uint32_t* digest) {
+  uint32_t sum = 0;
+  double start = now_ns();
+  for (size_t i = 0; i < s_frame_count; i++) {
+    rules_input_t input = input_for(i);
+    sum = sum * 31 + rules_eval(program, &input);
+  }
+  double ns = (now_ns() - start) / s_frame_count;
+  *digest = sum;
+  return ns;
+}
+
+static double time_c(uint32_t* digest) {
+  typical_state_t state = {0};
+  uint32_t sum = 0;
+  double start = now_ns();
+  for (size_t i = 0; i < s_frame_count; i++) {
+    rules_input_t input = input_for(i);
+    sum = sum * 31 + typical_in_c(&state, &input);
+  }
+  double ns = (now_ns() - start) / s_frame_count;
+  *digest = sum;
+  return ns;
+}
+
+static double time_compile(const char* text) {
+  static rules_program_t program;
+  const int reps = 2000;
+  double start = now_ns();
+  for (int r = 0; r < reps; r++) {
+    rules_compile(&program, text, NULL);
+  }
+  return (now_ns() - start) / reps;
+}
+
+static double best(double a, double b) { return a > 0 && a < b ? a : b; }
+
+int main(int argc, char** argv) {
+  size_t frames = argc > 1 ? (size_t)atol(argv[1]) : DEFAULT_FRAMES;
+  int failures = check_semantics();
+
+  build_frames(frames);
+
+  // Frame-by-frame equivalence of the typical program and its C version
+  static rules_program_t typical;
+  if (!rules_compile(&typical, s_typical, NULL)) {
+    printf("FAIL typical program does not compile\n");
+    return 1;
+  }
+  typical_state_t state = {0};
+  size_t mismatches = 0;
+  for (size_t i = 0; i < s_frame_count; i++) {
+    rules_input_t input = input_for(i);
+    mismatches += rules_eval(&typical, &input) != typical_in_c(&state, &input);
+  }
+  printf("typical program vs C: %zu of %zu frames differ\n", mismatches,
+         s_frame_count);
+  failures += mismatches != 0;
+
+  static rules_program_t builtin;
+  static rules_program_t in_chain;
+  static rules_program_t moving_chain;
+  static char in_text[RULES_TEXT_MAX];
+  static char moving_text[RULES_TEXT_MAX];
+  rules_compile(&builtin, "relay1 = present; relay2 = present", NULL);
+  chain_text(in_text, sizeof(in_text), "in(-1500,0,1500,2500)");
+  chain_text(moving_text, sizeof(moving_text), "moving");
+  rules_compile(&in_chain, in_text, NULL);
+  rules_compile(&moving_chain, moving_text, NULL);
+
+  struct {
+    const char* name;
+    const char* text;
+    rules_program_t* program;
+    double ns;
+  } programs[] = {
+      {"default", "relay1 = present; relay2 = present", &builtin, 0},
+      {"typical", s_typical, &typical, 0},
+      {"in() chain", in_text, &in_chain, 0},
+      {"moving", moving_text, &moving_chain, 0},
+  };
+  size_t program_count = sizeof(programs) / sizeof(programs[0]);
+  double c_ns = 0;
+  uint32_t digest;
+
+  // Runs alternate between the programs so frequency changes hit all alike
+  for (int r = 0; r < RUNS; r++) {
+    for (size_t p = 0; p < program_count; p++) {
+      programs[p].program->was_true[0] = false;
+      programs[p].ns =
+          best(programs[p].ns, time_program(programs[p].program, &digest));
+    }
+    c_ns = best(c_ns, time_c(&digest));
+  }
+
+  printf("%zu frames, 0-%d targets\n", s_frame_count,
+         RADAR_FUSION_MAX_TARGETS);
+  printf("%-11s %5s %5s %6s %10s %10s\n", "program", "rules", "bytes", "cost",
+         "compile", "eval");
+  for (size_t p = 0; p < program_count; p++) {
+    rules_program_t* prog = programs[p].program;
+    printf("%-11s %5u %5u %6u %8.0f ns %7.1f ns\n", programs[p].name,
+           prog->rule_count, prog->code_len, prog->cost,
+           time_compile(programs[p].text), programs[p].ns);
+  }
+  printf("typical in C                          %7.1f ns (bytecode %.2fx)\n",
+         c_ns, programs[1].ns / c_ns);
+  for (size_t p = 2; p < program_count; p++) {
+    printf("%-11s %.2f ns per operation\n", programs[p].name,
+           programs[p].ns / programs[p].program->cost);
+  }
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Host soak harness for the heap-free steady state.
+ *
+ * Runs simulated days of 10 Hz radar frames through the fusion code and, once
+ * a minute, replays the allocation pattern of a TLS upload against the
+ * mem_pool allocator. malloc/calloc/realloc/free are wrapped by the linker and
+ * counted; after the warm-up upload the steady state must not touch the heap.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o soak tools/soak/soak.c \
+ *       components/mem_pool/mem_pool.c components/radar_sensor/radar_fusion.c \
+ *       -Icomponents/mem_pool/include -Icomponents/radar_sensor/include \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free -lm
+ *   ./soak [days]
+ *
+ * Exits non-zero if any heap allocation happened after warm-up or a request
+ * fell back to the heap.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_pool.h"
+#include "radar_fusion.h"
+
+#define FRAME_PERIOD_US 100000LL  // 10 Hz
+#define FRAMES_PER_UPLOAD 600     // One upload a minute
+#define FRAMES_PER_DAY (24LL * 3600 * 1000000 / FRAME_PERIOD_US)
+
+static uint64_t s_heap_allocs;
+static uint64_t s_heap_frees;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+  s_heap_allocs++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  s_heap_allocs++;
+  return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  s_heap_allocs++;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr) {
+    s_heap_frees++;
+  }
+  __real_free(ptr);
+}
+
+/*
+ * Approximate mbedTLS client handshake against script.google.com: ASN.1 and
+ * MPI temporaries, SSL/x509 contexts, then the 4 KB out and 16 KB in record
+ * buffers. Sizes vary a little between uploads like the real certificates.
+ */
+typedef struct {
+  size_t size;
+  int count;
+} tls_alloc_t;
+
+static const tls_alloc_t tls_pattern[] = {
+    {24, 70}, {96, 48}, {400, 24}, {1600, 6}, {4 * 1024 + 500, 1},
+    {16 * 1024 + 700, 1},
+};
+
+#define TLS_MAX_LIVE 160
+
+static void simulate_upload(uint32_t seed) {
+  void* live[TLS_MAX_LIVE];
+  int count = 0;
+
+  for (size_t i = 0; i < sizeof(tls_pattern) / sizeof(tls_pattern[0]); i++) {
+    for (int n = 0; n < tls_pattern[i].count && count < TLS_MAX_LIVE; n++) {
+      size_t jitter = (seed + (uint32_t)n * 7u) % 16u;
+      size_t size = tls_pattern[i].size > 16 ? tls_pattern[i].size - jitter
+                                             : tls_pattern[i].size;
+      live[count] = mem_pool_calloc(1, size);
+      if (live[count]) {
+        memset(live[count], 0xA5, size);
+        count++;
+      }
+    }
+  }
+
+  // Handshake temporaries go first, the session buffers last
+  for (int i = 0; i < count; i += 2) {
+    mem_pool_free(live[i]);
+  }
+  for (int i = 1; i < count; i += 2) {
+    mem_pool_free(live[i]);
+  }
+}
+
+static void fill_targets(radar_target_t targets[RADAR_MAX_TARGETS],
+                         int64_t frame, int sensor) {
+  for (int t = 0; t < RADAR_MAX_TARGETS; t++) {
+    // People wander in and out over a ten-minute cycle
+    int64_t phase = (frame + t * 2000 + sensor * 300) % 6000;
+    targets[t].detected = phase < 3000 + t * 500;
+    targets[t].x = (float)((phase % 400) * 5 - 1000);
+    targets[t].y = (float)(1000 + (phase % 700) * 4);
+    targets[t].speed = (float)((phase % 60) - 30);
+  }
+}
+
+int main(int argc, char** argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 7;
+  if (days <= 0) {
+    days = 7;
+  }
+
+  radar_fusion_t fusion;
+  radar_fusion_init(&fusion, 500.0f, 500000);
+  radar_mount_t mounts[2] = {{0, 0, 0}, {4000, 0, 90}};
+  radar_fusion_add_sensor(&fusion, &mounts[0]);
+  radar_fusion_add_sensor(&fusion, &mounts[1]);
+
+  radar_target_t targets[RADAR_MAX_TARGETS];
+  radar_fused_target_t fused[RADAR_FUSION_MAX_TARGETS];
+  uint64_t fused_total = 0;
+
+  // Warm-up: first upload initialises the pool
+  simulate_upload(0);
+  uint64_t base_allocs = s_heap_allocs;
+  uint64_t base_frees = s_heap_frees;
+
+  int64_t frames = FRAMES_PER_DAY * days;
+  uint64_t uploads = 0;
+  for (int64_t frame = 0; frame < frames; frame++) {
+    int64_t now_us = frame * FRAME_PERIOD_US;
+    int sensor = (int)(frame & 1);
+    fill_targets(targets, frame, sensor);
+    radar_fusion_update(&fusion, sensor, targets, now_us);
+    fused_total += radar_fusion_merge(&fusion, now_us, fused,
+                                      RADAR_FUSION_MAX_TARGETS);
+
+    if (frame % FRAMES_PER_UPLOAD == 0) {
+      simulate_upload((uint32_t)uploads++);
+    }
+  }
+
+  uint64_t allocs = s_heap_allocs - base_allocs;
+  uint64_t frees = s_heap_frees - base_frees;
+
+  mem_pool_stats_t stats;
+  mem_pool_get_stats(&stats);
+
+  printf("Simulated %d days: %lld frames, %llu uploads, %llu fused targets\n",
+         days, (long long)frames, (unsigned long long)uploads,
+         (unsigned long long)fused_total);
+  printf("Heap after warm-up: %llu allocs, %llu frees\n",
+         (unsigned long long)allocs, (unsigned long long)frees);
+  for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+    const mem_pool_class_stats_t* cls = &stats.classes[c];
+    printf("  %5u B x %3u: peak %3u, in use %u\n", (unsigned)cls->block_size,
+           (unsigned)cls->blocks, (unsigned)cls->high_water,
+           (unsigned)cls->in_use);
+  }
+  printf("Heap fallbacks: %u\n", (unsigned)stats.fallback_allocs);
+
+  bool ok = allocs == 0 && stats.fallback_allocs == 0;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
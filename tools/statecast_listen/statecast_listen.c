@@ -0,0 +1,478 @@
+/*
+ * Listener for the LAN state broadcast (components/statecast).
+ *
+ * By default it joins the multicast group, prints every packet and keeps
+ * per-device loss counts from the sequence numbers: what a wall display or
+ * HVAC controller would see. Device clocks are not synchronised with the
+ * host, so in this mode it reports the state age the device stamped into
+ * each packet and the gap between packets instead of a one-way latency.
+ *
+ * With -L it measures delivery over the loopback interface. A sender
+ * thread plays the firmware publisher with the real encoder: a target
+ * packet per radar frame, a presence change every -c frames and a
+ * heartbeat when nothing else was sent, and it can skip a share of its
+ * packets (-d) the way a full send buffer does on the device. The sender
+ * stamps each packet with the host's monotonic clock, so the listener gets
+ * the true send-to-receive latency. The run passes when every skipped
+ * sequence number is reported as lost, nothing else is, and the p99
+ * latency is below 100 ms. The group is tried on the loopback interface
+ * first; where loopback has no multicast route, the packets go to
+ * 127.0.0.1 directly.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o statecast_listen tools/statecast_listen/statecast_listen.c \
+ *       components/statecast/statecast.c -Icomponents/statecast/include \
+ *       -lpthread
+ *   ./statecast_listen [options]
+ *
+ *   -g 239.255.42.99  multicast group (menuconfig: LAN state broadcast)
+ *   -p 42999          UDP port
+ *   -i 0.0.0.0        address of the interface to join on
+ *   -t 0              stop after this many seconds, 0 runs until Ctrl-C
+ *   -q                listen: no line per packet, only the summary
+ *   -L                loopback latency and loss test
+ *   -f 10             test: radar frames per second
+ *   -n 600            test: frames to send
+ *   -c 20             test: frames between presence changes
+ *   -d 0              test: percent of packets the sender skips
+ *   -s 1              test: random seed
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "statecast.h"
+
+#define MAX_DEVICES 32
+#define RECV_POLL_MS 100
+#define DRAIN_MS 500
+#define LATENCY_LIMIT_US 100000
+#define HEARTBEAT_FRAMES 10
+
+typedef struct {
+  const char* group;
+  int port;
+  const char* iface;
+  int seconds;
+  bool quiet;
+  bool loopback;
+  int fps;
+  int frames;
+  int change_every;
+  int drop_pct;
+  unsigned seed;
+} options_t;
+
+typedef struct {
+  statecast_rx_t rx;
+  uint32_t last_arrival_us;
+  uint32_t max_gap_us;
+  uint32_t max_age_ms;
+} device_t;
+
+typedef struct {
+  const options_t* opts;
+  struct sockaddr_in dest;
+  uint32_t sent;
+  uint32_t skipped;
+  uint32_t leading;   // Skipped before the first packet sent
+  uint32_t trailing;  // Skipped after the last packet sent
+  uint32_t changes;
+  uint32_t errors;
+} sender_t;
+
+static volatile sig_atomic_t s_stop;
+static volatile int s_sender_done;
+
+static uint32_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static void on_signal(int sig) {
+  (void)sig;
+  s_stop = 1;
+}
+
+static int cmp_u32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+static int open_receiver(const options_t* opts, struct in_addr iface,
+                         bool* joined) {
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    perror("socket");
+    return -1;
+  }
+  int one = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  int rcvbuf = 1 << 20;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  struct timeval tv = {0, RECV_POLL_MS * 1000};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)opts->port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    close(sock);
+    return -1;
+  }
+
+  struct ip_mreq mreq;
+  memset(&mreq, 0, sizeof(mreq));
+  inet_aton(opts->group, &mreq.imr_multiaddr);
+  mreq.imr_interface = iface;
+  *joined = setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+                       sizeof(mreq)) == 0;
+  if (!*joined && !opts->loopback) {
+    fprintf(stderr, "cannot join %s on %s: %s\n", opts->group, opts->iface,
+            strerror(errno));
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+// The firmware publisher's schedule, driven by simulated frames
+static void* sender_main(void* arg) {
+  sender_t* s = arg;
+  const options_t* opts = s->opts;
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    perror("socket");
+    s_sender_done = 1;
+    return NULL;
+  }
+  struct in_addr lo;
+  inet_aton("127.0.0.1", &lo);
+  uint8_t loop = 1;
+  uint8_t ttl = 1;
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+  static statecast_packet_t packet;
+  static uint8_t buf[STATECAST_PACKET_MAX];
+  memset(&packet, 0, sizeof(packet));
+  memcpy(packet.device, "\x02\x00\x00\x00\x00\x01", 6);
+  packet.boot_id = (uint32_t)rand() | 1;
+
+  uint32_t frame_ns = 1000000000u / (uint32_t)opts->fps;
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  int quiet_frames = 0;
+  bool present = false;
+
+  for (int f = 0; f < opts->frames && !s_stop; f++) {
+    next.tv_nsec += frame_ns;
+    while (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+    // A person walks across while present; the room is empty otherwise
+    uint8_t flags = 0;
+    if (f % opts->change_every == 0) {
+      present = !present;
+      flags |= STATECAST_FLAG_CHANGE;
+      s->changes++;
+    }
+    packet.relay_mask = present ? 0x03 : 0x00;
+    packet.present = present ? 1 : 0;
+    packet.target_count = present ? 1 : 0;
+    packet.targets[0].x_mm = (int16_t)(-2000 + (f % 40) * 100);
+    packet.targets[0].y_mm = 1500;
+    packet.targets[0].speed_cm_s = 50;
+    packet.targets[0].sensor_mask = 1;
+    if (present) {
+      flags |= STATECAST_FLAG_TARGETS;
+    }
+    if (flags == 0 && ++quiet_frames < HEARTBEAT_FRAMES) {
+      continue;
+    }
+    if (flags == 0) {
+      flags = STATECAST_FLAG_HEARTBEAT;
+    }
+    quiet_frames = 0;
+
+    packet.flags = flags;
+    packet.sequence++;
+    packet.age_ms = 0;
+    if (rand() % 100 < opts->drop_pct) {
+      s->skipped++;
+      s->trailing++;
+      if (s->sent == 0) {
+        s->leading++;
+      }
+      continue;
+    }
+    packet.sent_us = now_us();
+    int len = statecast_encode(&packet, buf, sizeof(buf));
+    if (sendto(sock, buf, (size_t)len, MSG_DONTWAIT,
+               (struct sockaddr*)&s->dest, sizeof(s->dest)) != len) {
+      s->errors++;
+      continue;
+    }
+    s->sent++;
+    s->trailing = 0;
+  }
+  close(sock);
+  s_sender_done = 1;
+  return NULL;
+}
+
+static device_t* find_device(device_t* devices, int* count,
+                             const statecast_packet_t* p) {
+  for (int i = 0; i < *count; i++) {
+    if (memcmp(devices[i].rx.device, p->device, 6) == 0) {
+      return &devices[i];
+    }
+  }
+  if (*count >= MAX_DEVICES) {
+    return NULL;
+  }
+  device_t* d = &devices[(*count)++];
+  memset(d, 0, sizeof(*d));
+  statecast_rx_init(&d->rx);
+  return d;
+}
+
+static void print_packet(const statecast_packet_t* p, uint32_t lost) {
+  printf("%02x%02x%02x%02x%02x%02x seq %-8u %-9s relays 0x%x present %u "
+         "age %u ms",
+         p->device[0], p->device[1], p->device[2], p->device[3],
+         p->device[4], p->device[5], p->sequence,
+         (p->flags & STATECAST_FLAG_CHANGE)    ? "change"
+         : (p->flags & STATECAST_FLAG_TARGETS) ? "targets"
+                                               : "heartbeat",
+         p->relay_mask, p->present, p->age_ms);
+  for (int i = 0; i < p->target_count; i++) {
+    printf(" (%d,%d %d cm/s)", p->targets[i].x_mm, p->targets[i].y_mm,
+           p->targets[i].speed_cm_s);
+  }
+  if (lost) {
+    printf("  [%u lost]", lost);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  options_t opts = {
+      .group = "239.255.42.99",
+      .port = 42999,
+      .iface = "0.0.0.0",
+      .fps = 10,
+      .frames = 600,
+      .change_every = 20,
+      .seed = 1,
+  };
+  int c;
+  while ((c = getopt(argc, argv, "g:p:i:t:qLf:n:c:d:s:")) != -1) {
+    switch (c) {
+      case 'g':
+        opts.group = optarg;
+        break;
+      case 'p':
+        opts.port = atoi(optarg);
+        break;
+      case 'i':
+        opts.iface = optarg;
+        break;
+      case 't':
+        opts.seconds = atoi(optarg);
+        break;
+      case 'q':
+        opts.quiet = true;
+        break;
+      case 'L':
+        opts.loopback = true;
+        opts.quiet = true;
+        break;
+      case 'f':
+        opts.fps = atoi(optarg);
+        break;
+      case 'n':
+        opts.frames = atoi(optarg);
+        break;
+      case 'c':
+        opts.change_every = atoi(optarg);
+        break;
+      case 'd':
+        opts.drop_pct = atoi(optarg);
+        break;
+      case 's':
+        opts.seed = (unsigned)atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "usage: see the header of %s\n", __FILE__);
+        return 2;
+    }
+  }
+  if (opts.fps < 1 || opts.frames < 1 || opts.change_every < 1) {
+    fprintf(stderr, "-f, -n and -c must be positive\n");
+    return 2;
+  }
+  srand(opts.seed);
+  signal(SIGINT, on_signal);
+
+  struct in_addr iface;
+  if (inet_aton(opts.loopback ? "127.0.0.1" : opts.iface, &iface) == 0) {
+    fprintf(stderr, "bad interface address %s\n", opts.iface);
+    return 2;
+  }
+  bool joined = false;
+  int sock = open_receiver(&opts, iface, &joined);
+  if (sock < 0) {
+    return 1;
+  }
+
+  // Loopback test: multicast over lo where it is routable, else unicast
+  static sender_t sender;
+  pthread_t sender_thread;
+  uint32_t* latencies = NULL;
+  size_t latency_count = 0;
+  if (opts.loopback) {
+    sender.opts = &opts;
+    sender.dest.sin_family = AF_INET;
+    sender.dest.sin_port = htons((uint16_t)opts.port);
+    inet_aton(opts.group, &sender.dest.sin_addr);
+    bool multicast = joined;
+    if (multicast) {
+      // Probe: a route to the group via lo is needed for the sends
+      int probe = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      setsockopt(probe, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+      multicast = connect(probe, (struct sockaddr*)&sender.dest,
+                          sizeof(sender.dest)) == 0;
+      close(probe);
+    }
+    if (!multicast) {
+      sender.dest.sin_addr = iface;
+    }
+    printf("loopback test: %d frames at %d Hz to %s:%d (%s), change every "
+           "%d frames, sender skips %d%%\n",
+           opts.frames, opts.fps, inet_ntoa(sender.dest.sin_addr), opts.port,
+           multicast ? "multicast on lo" : "unicast, lo has no multicast",
+           opts.change_every, opts.drop_pct);
+    latencies = malloc(sizeof(uint32_t) * (size_t)opts.frames);
+    pthread_create(&sender_thread, NULL, sender_main, &sender);
+  } else {
+    printf("listening on %s:%d (interface %s)\n", opts.group, opts.port,
+           opts.iface);
+  }
+
+  static device_t devices[MAX_DEVICES];
+  int device_count = 0;
+  uint32_t malformed = 0;
+  uint32_t start_us = now_us();
+  uint32_t done_at_us = 0;
+  uint8_t buf[1500];
+
+  while (!s_stop) {
+    uint32_t t = now_us();
+    if (opts.seconds > 0 && t - start_us >= (uint32_t)opts.seconds * 1000000) {
+      break;
+    }
+    if (opts.loopback && s_sender_done) {
+      if (done_at_us == 0) {
+        done_at_us = t;
+      } else if (t - done_at_us >= DRAIN_MS * 1000) {
+        break;
+      }
+    }
+    ssize_t len = recv(sock, buf, sizeof(buf), 0);
+    if (len < 0) {
+      continue;
+    }
+    uint32_t arrival_us = now_us();
+    statecast_packet_t p;
+    if (!statecast_decode(buf, (size_t)len, &p)) {
+      malformed++;
+      continue;
+    }
+    device_t* d = find_device(devices, &device_count, &p);
+    if (!d) {
+      continue;
+    }
+    bool first = !d->rx.started;
+    uint32_t lost = statecast_rx_update(&d->rx, &p);
+    if (!first && arrival_us - d->last_arrival_us > d->max_gap_us) {
+      d->max_gap_us = arrival_us - d->last_arrival_us;
+    }
+    d->last_arrival_us = arrival_us;
+    if (p.age_ms > d->max_age_ms && p.age_ms != UINT16_MAX) {
+      d->max_age_ms = p.age_ms;
+    }
+    if (opts.loopback && latency_count < (size_t)opts.frames) {
+      latencies[latency_count++] = arrival_us - p.sent_us;
+    }
+    if (!opts.quiet) {
+      print_packet(&p, lost);
+    }
+  }
+
+  if (opts.loopback) {
+    s_stop = 1;
+    pthread_join(sender_thread, NULL);
+  }
+  close(sock);
+
+  printf("\n%-12s %8s %6s %6s %8s %10s %10s\n", "device", "received", "lost",
+         "late", "restarts", "max gap ms", "max age ms");
+  for (int i = 0; i < device_count; i++) {
+    const device_t* d = &devices[i];
+    printf("%02x%02x%02x%02x%02x%02x %8u %6u %6u %8u %10u %10u\n",
+           d->rx.device[0], d->rx.device[1], d->rx.device[2],
+           d->rx.device[3], d->rx.device[4], d->rx.device[5], d->rx.received,
+           d->rx.lost, d->rx.late, d->rx.restarts, d->max_gap_us / 1000,
+           d->max_age_ms);
+  }
+  if (malformed) {
+    printf("%u malformed datagrams ignored\n", malformed);
+  }
+  if (!opts.loopback) {
+    return 0;
+  }
+
+  // Skips before the first or after the last packet leave no gap to detect
+  uint32_t lost = device_count ? devices[0].rx.lost : 0;
+  uint32_t received = device_count ? devices[0].rx.received : 0;
+  bool ok = device_count == 1 && received == sender.sent &&
+            lost == sender.skipped - sender.leading - sender.trailing &&
+            sender.errors == 0;
+  printf("\nsent %u, skipped %u, send errors %u, changes %u\n", sender.sent,
+         sender.skipped, sender.errors, sender.changes);
+  if (latency_count > 0) {
+    qsort(latencies, latency_count, sizeof(uint32_t), cmp_u32);
+    uint32_t p50 = latencies[latency_count / 2];
+    uint32_t p99 = latencies[(latency_count * 99) / 100];
+    uint32_t max = latencies[latency_count - 1];
+    printf("latency us: p50 %u, p99 %u, max %u\n", p50, p99, max);
+    ok = ok && p99 < LATENCY_LIMIT_US;
+  } else {
+    ok = false;
+  }
+  free(latencies);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}